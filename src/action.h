@@ -0,0 +1,105 @@
+#ifndef ACTION_H
+#define ACTION_H
+
+#include <cstdint>
+#include <string>
+
+// Ação gravada (uma linha da lista). Mantida fora do mainwindow.h para que os
+// módulos de reprodução não dependam de <windows.h>.
+struct Action {
+    std::string type;
+    int x;
+    int y;
+    std::uint16_t key;
+    bool pressed;
+    double delay;
+    int frequency;           // "wait_region"/"anchor_click": tempo limite em ms
+    int monitorIndex;
+    bool required = false;   // espera mantida mesmo no modo de máxima velocidade
+    int delta = 0;           // roda do mouse: 120 = um "dente"; positivo = para cima/direita
+    std::string text;        // "type_text": caracteres digitados (UTF-8); "wait_region"/"anchor_click": imagem;
+                             // "mouse_click": janela de destino (opcional)
+};
+
+// "wait_region": espera a região da tela com canto superior esquerdo em (x, y)
+// e o tamanho da imagem de referência ('text') coincidir com ela.
+//   key = diferença máxima por canal (0-255), delta = pixels diferentes aceitos
+//   (milésimos da região), frequency = tempo limite (ms), required = esgotado o
+//   tempo, a macro falha (senão segue)
+
+// "anchor_click": clique (down e up) do botão 'key' onde a imagem ('text')
+// estiver na tela, procurada primeiro em volta da posição gravada (x, y).
+//   delta = ponto do clique dentro da imagem (PackAnchorOffset; negativo = centro),
+//   frequency = tempo limite (ms), required = sem a imagem, a macro falha
+//   (senão clica na posição gravada)
+inline int PackAnchorOffset(int dx, int dy) { return (dx << 16) | (dy & 0xFFFF); }
+inline int AnchorOffsetX(int delta) { return delta < 0 ? -1 : delta >> 16; }
+inline int AnchorOffsetY(int delta) { return delta < 0 ? -1 : delta & 0xFFFF; }
+
+// "mouse_click" com janela de destino: text = janela ("processo|classe|título",
+// ver WindowTarget), delta = ponto do clique a partir do canto superior
+// esquerdo da janela (PackWindowOffset). Na reprodução o cursor vai até esse
+// ponto da janela, onde ela estiver; sem a janela, até (x, y).
+inline int PackWindowOffset(int dx, int dy) {
+    dx = dx < 0 ? 0 : (dx > 0x7FFF ? 0x7FFF : dx);
+    dy = dy < 0 ? 0 : (dy > 0xFFFF ? 0xFFFF : dy);
+    return (dx << 16) | dy;
+}
+inline int WindowOffsetX(int delta) { return delta >> 16; }
+inline int WindowOffsetY(int delta) { return delta & 0xFFFF; }
+
+// Botões do mouse (Action::key nos cliques)
+enum MouseButton : std::uint16_t {
+    kMouseLeft = 0,
+    kMouseRight = 1,
+    kMouseMiddle = 2,
+    kMouseX1 = 3,
+    kMouseX2 = 4
+};
+
+// Eixo da roda (Action::key em "mouse_wheel")
+enum WheelAxis : std::uint16_t {
+    kWheelVertical = 0,
+    kWheelHorizontal = 1
+};
+
+// Tipo da ação em forma numérica, para os caminhos quentes (compilador, codecs)
+enum class ActionKind : std::uint8_t {
+    Unknown = 0,
+    KeyPress,
+    MouseClick,
+    MouseMove,
+    Delay,
+    MouseWheel,
+    TypeText,
+    WaitRegion,
+    AnchorClick
+};
+
+inline ActionKind ActionKindFromString(const std::string& type) {
+    if (type == "key_press") return ActionKind::KeyPress;
+    if (type == "mouse_click") return ActionKind::MouseClick;
+    if (type == "mouse_move") return ActionKind::MouseMove;
+    if (type == "delay") return ActionKind::Delay;
+    if (type == "mouse_wheel") return ActionKind::MouseWheel;
+    if (type == "type_text") return ActionKind::TypeText;
+    if (type == "wait_region") return ActionKind::WaitRegion;
+    if (type == "anchor_click") return ActionKind::AnchorClick;
+    return ActionKind::Unknown;
+}
+
+inline const char* ActionKindToString(ActionKind kind) {
+    switch (kind) {
+        case ActionKind::KeyPress: return "key_press";
+        case ActionKind::MouseClick: return "mouse_click";
+        case ActionKind::MouseMove: return "mouse_move";
+        case ActionKind::Delay: return "delay";
+        case ActionKind::MouseWheel: return "mouse_wheel";
+        case ActionKind::TypeText: return "type_text";
+        case ActionKind::WaitRegion: return "wait_region";
+        case ActionKind::AnchorClick: return "anchor_click";
+        default: return "unknown";
+    }
+}
+
+#endif // ACTION_H
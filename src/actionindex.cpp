@@ -0,0 +1,396 @@
+#include "actionindex.h"
+#include "actionstream.h"
+#include "actiontable.h"
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr std::uint16_t KindBit(ActionKind kind) { return static_cast<std::uint16_t>(1u << static_cast<int>(kind)); }
+
+// Tipos com posição e tela (filtros de região e "tela:")
+constexpr std::uint16_t kMouseKinds = KindBit(ActionKind::MouseMove) | KindBit(ActionKind::MouseClick) |
+                                      KindBit(ActionKind::MouseWheel) | KindBit(ActionKind::WaitRegion) |
+                                      KindBit(ActionKind::AnchorClick);
+
+// Um único tipo no filtro -> esse tipo; senão Unknown
+ActionKind SingleKind(std::uint16_t kinds) {
+    for (int k = 1; k <= static_cast<int>(ActionKind::AnchorClick); ++k) {
+        if (kinds == (1u << k)) return static_cast<ActionKind>(k);
+    }
+    return ActionKind::Unknown;
+}
+
+bool ParseNumber(const QString& text, double& value) {
+    bool ok;
+    value = text.trimmed().toDouble(&ok);
+    return ok && value >= 0;
+}
+
+bool ParseMicros(const QString& text, std::int64_t& value) {
+    return ParseTimeSpec(text, value);
+}
+
+// "a-b", ">a", "<b" ou "a" (limites inclusivos)
+template <typename T>
+bool ParseRange(QString text, bool (*parse)(const QString&, T&), T& lo, T& hi) {
+    text.remove('=');
+    if (text.startsWith('>')) return parse(text.mid(1), lo);
+    if (text.startsWith('<')) return parse(text.mid(1), hi);
+    const int dash = text.indexOf('-');
+    if (dash > 0) return parse(text.left(dash), lo) && parse(text.mid(dash + 1), hi);
+    if (!parse(text, lo)) return false;
+    hi = lo;
+    return true;
+}
+
+// Faixa em % da tela -> centésimos de %, cruzada com a faixa atual
+bool ParseAxis(const QString& text, int& axisMin, int& axisMax) {
+    double lo = 0, hi = 100;
+    if (!ParseRange<double>(text, ParseNumber, lo, hi)) return false;
+    axisMin = std::max(axisMin, static_cast<int>(lo * 100));
+    axisMax = std::min(axisMax, static_cast<int>(hi * 100 + 0.5));
+    return true;
+}
+
+} // namespace
+
+bool ParseTimeSpec(QString text, std::int64_t& micros) {
+    text = text.trimmed();
+    if (text.endsWith('s', Qt::CaseInsensitive)) text.chop(1);
+    QStringList parts = text.split(':');
+    if (parts.isEmpty() || parts.size() > 3) return false;
+    double seconds = 0;
+    for (const QString& part : parts) {
+        bool ok;
+        double value = part.trimmed().toDouble(&ok);
+        if (!ok || value < 0) return false;
+        seconds = seconds * 60 + value;
+    }
+    micros = static_cast<std::int64_t>(seconds * 1e6);
+    return true;
+}
+
+// =============================================
+// CONSULTA
+// =============================================
+
+bool ActionQuery::Empty() const {
+    return kinds == 0 && key < 0 && pressed < 0 && monitor < 0 && !hasRegion &&
+           fromMicros <= 0 && toMicros == INT64_MAX && delayMinMicros < 0 && delayMaxMicros == INT64_MAX;
+}
+
+bool ActionQuery::Matches(const Action& action, std::int64_t micros) const {
+    const ActionKind kind = ActionKindFromString(action.type);
+    if (kinds && !(kinds & KindBit(kind))) return false;
+    if (micros < fromMicros || micros > toMicros) return false;
+    if (key >= 0 && (action.key != key || (kind != ActionKind::KeyPress && kind != ActionKind::MouseClick))) return false;
+    if (pressed >= 0 && (action.pressed != (pressed == 1) || (kind != ActionKind::KeyPress && kind != ActionKind::MouseClick))) return false;
+    const bool mouse = (kMouseKinds & KindBit(kind)) != 0;
+    if (monitor >= 0 && (!mouse || action.monitorIndex != monitor)) return false;
+    if (hasRegion && (!mouse || action.x < xMin || action.x > xMax || action.y < yMin || action.y > yMax)) return false;
+    if (delayMinMicros >= 0 || delayMaxMicros != INT64_MAX) {
+        const std::int64_t delay = ScheduledMicros(action);
+        if (kind != ActionKind::Delay || delay < delayMinMicros || delay > delayMaxMicros) return false;
+    }
+    return true;
+}
+
+bool ParseActionQuery(const QString& text, ActionQuery& query, QString& error,
+                      const std::function<int(const QString&)>& keyCode) {
+    query = ActionQuery();
+    for (const QString& term : text.split(' ', Qt::SkipEmptyParts)) {
+        const int colon = term.indexOf(':');
+        const QString name = (colon < 0 ? term : term.left(colon)).toLower();
+        const QString value = colon < 0 ? QString() : term.mid(colon + 1);
+        bool ok = true;
+
+        if (colon < 0 && (name == "clique" || name == "cliques" || name == "click")) {
+            query.kinds |= KindBit(ActionKind::MouseClick);
+        } else if (colon < 0 && (name == "tecla" || name == "teclas" || name == "key")) {
+            query.kinds |= KindBit(ActionKind::KeyPress);
+        } else if (colon < 0 && (name == "mover" || name == "movimento" || name == "move")) {
+            query.kinds |= KindBit(ActionKind::MouseMove);
+        } else if (colon < 0 && (name == "delay" || name == "espera" || name == "esperas")) {
+            query.kinds |= KindBit(ActionKind::Delay);
+        } else if (colon < 0 && (name == "roda" || name == "rolagem" || name == "wheel")) {
+            query.kinds |= KindBit(ActionKind::MouseWheel);
+        } else if (colon < 0 && (name == "texto" || name == "text")) {
+            query.kinds |= KindBit(ActionKind::TypeText);
+        } else if (colon < 0 && (name == "regiao" || name == "região" || name == "pixels")) {
+            query.kinds |= KindBit(ActionKind::WaitRegion);
+        } else if (colon < 0 && (name == "imagem" || name == "ancora" || name == "âncora")) {
+            query.kinds |= KindBit(ActionKind::AnchorClick);
+        } else if (colon < 0 && (name == "down" || name == "up")) {
+            query.pressed = name == "down" ? 1 : 0;
+        } else if (colon < 0 && (name == "esquerda" || name == "direita" || name == "topo" || name == "baixo" || name == "centro")) {
+            // Terços da tela
+            query.hasRegion = true;
+            if (name == "esquerda") query.xMax = std::min(query.xMax, 3333);
+            if (name == "direita") query.xMin = std::max(query.xMin, 6667);
+            if (name == "topo") query.yMax = std::min(query.yMax, 3333);
+            if (name == "baixo") query.yMin = std::max(query.yMin, 6667);
+            if (name == "centro") {
+                query.xMin = std::max(query.xMin, 3333);
+                query.xMax = std::min(query.xMax, 6667);
+                query.yMin = std::max(query.yMin, 3333);
+                query.yMax = std::min(query.yMax, 6667);
+            }
+        } else if (name == "tecla" || name == "key") {
+            query.kinds |= KindBit(ActionKind::KeyPress);
+            const QString upper = value.toUpper();
+            query.key = keyCode ? keyCode(upper) : -1;
+            if (query.key < 0 && upper.size() == 1 && (upper[0].isLetterOrNumber())) query.key = upper[0].unicode();
+            if (query.key < 0 && upper.startsWith("KEY_")) query.key = upper.mid(4).toInt(&ok);
+            ok = ok && query.key >= 0 && query.key <= 0xFFFF;
+        } else if (name == "botao" || name == "botão" || name == "button") {
+            query.kinds |= KindBit(ActionKind::MouseClick);
+            const QString button = value.toLower();
+            if (button.startsWith("esq") || button == "left") query.key = 0;
+            else if (button.startsWith("dir") || button == "right") query.key = 1;
+            else if (button == "meio" || button == "middle") query.key = 2;
+            else if (button == "x1") query.key = 3;
+            else if (button == "x2") query.key = 4;
+            else query.key = button.toInt(&ok);
+        } else if (name == "tela" || name == "monitor") {
+            query.monitor = value.toInt(&ok) - 1;
+            ok = ok && query.monitor >= 0;
+        } else if (name == "x") {
+            query.hasRegion = true;
+            ok = ParseAxis(value, query.xMin, query.xMax);
+        } else if (name == "y") {
+            query.hasRegion = true;
+            ok = ParseAxis(value, query.yMin, query.yMax);
+        } else if (name == "tempo" || name == "time") {
+            ok = ParseRange<std::int64_t>(value, ParseMicros, query.fromMicros, query.toMicros);
+        } else if (name == "delay" || name == "espera") {
+            query.kinds |= KindBit(ActionKind::Delay);
+            double lo = 0, hi = -1;
+            ok = ParseRange<double>(value, ParseNumber, lo, hi);
+            query.delayMinMicros = static_cast<std::int64_t>(lo * 1e6);
+            if (hi >= 0) query.delayMaxMicros = static_cast<std::int64_t>(hi * 1e6);
+        } else {
+            error = QString("Termo desconhecido: %1").arg(term);
+            return false;
+        }
+        if (!ok) {
+            error = QString("Valor inválido: %1").arg(term);
+            return false;
+        }
+    }
+    return true;
+}
+
+// =============================================
+// ÍNDICE
+// =============================================
+
+void ActionIndex::Append(const Action& action) {
+    const std::uint32_t position = static_cast<std::uint32_t>(kinds.size());
+    const ActionKind kind = ActionKindFromString(action.type);
+    const bool mouse = (kMouseKinds & KindBit(kind)) != 0;
+    const int monitor = mouse ? std::min(std::max(action.monitorIndex, -1), 126) : -1;
+
+    kinds.push_back(static_cast<std::uint8_t>(kind));
+    flags.push_back(action.pressed ? 1 : 0);
+    monitors.push_back(static_cast<std::int8_t>(monitor));
+    keys.push_back(action.key);
+    xs.push_back(static_cast<std::uint16_t>(std::min(std::max(action.x, 0), 0xFFFF)));
+    ys.push_back(static_cast<std::uint16_t>(std::min(std::max(action.y, 0), 0xFFFF)));
+    times.push_back(end);
+    const std::int64_t advance = ScheduledMicros(action);
+    end += advance;
+    if (position % kZoneActions == 0) zoneMaxDelay.push_back(-1);
+    if (kind == ActionKind::Delay) zoneMaxDelay.back() = std::max(zoneMaxDelay.back(), advance);
+
+    byKind[static_cast<int>(kind)].push_back(position);
+    if (kind == ActionKind::KeyPress || kind == ActionKind::MouseClick) {
+        byKey[(static_cast<std::uint32_t>(kind) << 16) | action.key].push_back(position);
+    }
+    if (mouse) {
+        if (byMonitor.size() <= static_cast<size_t>(monitor + 1)) byMonitor.resize(monitor + 2);
+        byMonitor[monitor + 1].push_back(position);
+    }
+}
+
+void ActionIndex::TruncatePostings(Postings& postings, size_t count) {
+    postings.erase(std::lower_bound(postings.begin(), postings.end(), static_cast<std::uint32_t>(std::min<size_t>(count, UINT32_MAX))),
+                   postings.end());
+}
+
+void ActionIndex::Truncate(size_t count) {
+    if (count >= size()) return;
+    end = times[count];
+    kinds.resize(count);
+    flags.resize(count);
+    monitors.resize(count);
+    keys.resize(count);
+    xs.resize(count);
+    ys.resize(count);
+    times.resize(count);
+    // O último trecho ficou parcial: máximo recalculado só com o que sobrou
+    zoneMaxDelay.resize((count + kZoneActions - 1) / kZoneActions);
+    if (!zoneMaxDelay.empty()) {
+        zoneMaxDelay.back() = -1;
+        for (size_t i = (zoneMaxDelay.size() - 1) * kZoneActions; i < count; ++i) {
+            if (kinds[i] != static_cast<std::uint8_t>(ActionKind::Delay)) continue;
+            zoneMaxDelay.back() = std::max(zoneMaxDelay.back(), (i + 1 < count ? times[i + 1] : end) - times[i]);
+        }
+    }
+    for (Postings& postings : byKind) TruncatePostings(postings, count);
+    for (auto& entry : byKey) TruncatePostings(entry.second, count);
+    for (Postings& postings : byMonitor) TruncatePostings(postings, count);
+}
+
+void ActionIndex::Sync(const ActionTable& actions) {
+    if (actions.size() < size()) Truncate(actions.size());
+    if (actions.size() == size()) return;
+    actions.ForEachIn(size(), actions.size() - size(), [this](const Action& action) { Append(action); });
+}
+
+void ActionIndex::Build(const ActionStream& stream) {
+    Truncate(0);
+    stream.ForEach([this](const Action& action) { Append(action); });
+}
+
+bool ActionIndex::Check(size_t i, const ActionQuery& query) const {
+    const std::uint16_t kindBit = static_cast<std::uint16_t>(1u << kinds[i]);
+    if (query.kinds && !(query.kinds & kindBit)) return false;
+    const bool keyed = kinds[i] == static_cast<std::uint8_t>(ActionKind::KeyPress) ||
+                       kinds[i] == static_cast<std::uint8_t>(ActionKind::MouseClick);
+    if (query.key >= 0 && (!keyed || keys[i] != query.key)) return false;
+    if (query.pressed >= 0 && (!keyed || flags[i] != query.pressed)) return false;
+    const bool mouse = (kMouseKinds & kindBit) != 0;
+    if (query.monitor >= 0 && (!mouse || monitors[i] != query.monitor)) return false;
+    if (query.hasRegion && (!mouse || xs[i] < query.xMin || xs[i] > query.xMax ||
+                            ys[i] < query.yMin || ys[i] > query.yMax)) return false;
+    if (query.delayMinMicros >= 0 || query.delayMaxMicros != INT64_MAX) {
+        const std::int64_t delay = (i + 1 < times.size() ? times[i + 1] : end) - times[i];
+        if (kinds[i] != static_cast<std::uint8_t>(ActionKind::Delay) ||
+            delay < query.delayMinMicros || delay > query.delayMaxMicros) return false;
+    }
+    return true;
+}
+
+std::vector<std::uint32_t> ActionIndex::Find(const ActionQuery& query, size_t limit) const {
+    std::vector<std::uint32_t> result;
+    // Intervalo de tempo: os instantes são crescentes, então vira um trecho de posições
+    const auto lo = static_cast<std::uint32_t>(std::lower_bound(times.begin(), times.end(), query.fromMicros) - times.begin());
+    const auto hi = static_cast<std::uint32_t>(std::upper_bound(times.begin(), times.end(), query.toMicros) - times.begin());
+    if (lo >= hi) return result;
+
+    // Menor lista de posições entre os critérios indexados; o resto é
+    // conferido nas colunas
+    const Postings* best = nullptr;
+    size_t bestCount = hi - lo;
+    auto consider = [&](const Postings* postings) {
+        if (!postings) return;
+        const size_t count = std::lower_bound(postings->begin(), postings->end(), hi) -
+                             std::lower_bound(postings->begin(), postings->end(), lo);
+        if (!best || count < bestCount) {
+            best = postings;
+            bestCount = count;
+        }
+    };
+    static const Postings kNone;
+    const ActionKind kind = SingleKind(query.kinds);
+    if (kind != ActionKind::Unknown) consider(&byKind[static_cast<int>(kind)]);
+    if (query.key >= 0 && (kind == ActionKind::KeyPress || kind == ActionKind::MouseClick)) {
+        auto it = byKey.find((static_cast<std::uint32_t>(kind) << 16) | static_cast<std::uint32_t>(query.key));
+        consider(it != byKey.end() ? &it->second : &kNone);
+    }
+    if (query.monitor >= 0) {
+        consider(static_cast<size_t>(query.monitor + 1) < byMonitor.size() ? &byMonitor[query.monitor + 1] : &kNone);
+    }
+
+    const bool delayFilter = query.delayMinMicros > 0 && kind == ActionKind::Delay;
+    if (delayFilter && (!best || best == &byKind[static_cast<int>(ActionKind::Delay)])) {
+        for (size_t zone = lo / kZoneActions; zone < zoneMaxDelay.size() && zone * kZoneActions < hi; ++zone) {
+            if (zoneMaxDelay[zone] < query.delayMinMicros) continue;
+            const auto last = static_cast<std::uint32_t>(std::min<size_t>(hi, (zone + 1) * kZoneActions));
+            for (auto i = static_cast<std::uint32_t>(std::max<size_t>(lo, zone * kZoneActions)); i < last; ++i) {
+                if (Check(i, query)) {
+                    result.push_back(i);
+                    if (result.size() >= limit) return result;
+                }
+            }
+        }
+    } else if (best) {
+        for (auto it = std::lower_bound(best->begin(), best->end(), lo); it != best->end() && *it < hi; ++it) {
+            if (Check(*it, query)) {
+                result.push_back(*it);
+                if (result.size() >= limit) break;
+            }
+        }
+    } else {
+        for (std::uint32_t i = lo; i < hi; ++i) {
+            if (Check(i, query)) {
+                result.push_back(i);
+                if (result.size() >= limit) break;
+            }
+        }
+    }
+    return result;
+}
+
+size_t ActionIndex::MemoryBytes() const {
+    size_t bytes = kinds.capacity() + flags.capacity() + monitors.capacity() +
+                   (keys.capacity() + xs.capacity() + ys.capacity()) * sizeof(std::uint16_t) +
+                   (times.capacity() + zoneMaxDelay.capacity()) * sizeof(std::int64_t);
+    for (const Postings& postings : byKind) bytes += postings.capacity() * sizeof(std::uint32_t);
+    for (const auto& entry : byKey) bytes += entry.second.capacity() * sizeof(std::uint32_t) + 32;
+    for (const Postings& postings : byMonitor) bytes += postings.capacity() * sizeof(std::uint32_t);
+    return bytes;
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+IndexBenchmarkResult BenchmarkActionIndex(size_t actions) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::vector<Action> trace = SyntheticActionTrace(2, actions, 23);
+    ActionTable table(trace);
+    IndexBenchmarkResult r = {trace.size(), 0, 0, 0, {}};
+
+    ActionIndex index;
+    auto start = Clock::now();
+    index.Sync(table);
+    r.buildMs = elapsedMs(start);
+    r.indexBytes = index.MemoryBytes();
+
+    // Gravação: uma ação por vez no fim
+    ActionIndex recording;
+    start = Clock::now();
+    for (const Action& action : trace) recording.Append(action);
+    r.appendNs = elapsedMs(start) * 1e6 / std::max<size_t>(1, trace.size());
+
+    auto keyCode = [](const QString&) { return -1; };
+    for (const char* text : {"clique tela:1 x:<45", "tecla:Q down", "delay:>0.25", "mover tempo:1:00-1:10 y:>50"}) {
+        ActionQuery query;
+        QString error;
+        if (!ParseActionQuery(text, query, error, keyCode)) continue;
+        IndexQueryResult q = {text, 0, 0, 0};
+
+        start = Clock::now();
+        q.matches = index.Find(query).size();
+        q.indexMs = elapsedMs(start);
+
+        size_t scanned = 0;
+        std::int64_t micros = 0;
+        start = Clock::now();
+        table.ForEach([&](const Action& action) {
+            if (query.Matches(action, micros)) ++scanned;
+            micros += ScheduledMicros(action);
+        });
+        q.scanMs = elapsedMs(start);
+        if (scanned != q.matches) q.query += " (DIVERGENTE)";
+        r.queries.push_back(q);
+    }
+    return r;
+}
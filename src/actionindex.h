@@ -0,0 +1,115 @@
+#ifndef ACTIONINDEX_H
+#define ACTIONINDEX_H
+
+#include "action.h"
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class ActionTable;
+class ActionStream;
+
+// "1:02:03.5", "1:30", "90", "90s" -> microssegundos
+bool ParseTimeSpec(QString text, std::int64_t& micros);
+
+// Filtro da lista de ações. Todos os critérios precisam valer (E lógico);
+// os que não foram dados não restringem nada.
+struct ActionQuery {
+    std::uint16_t kinds = 0;            // bits (1 << ActionKind); 0 = qualquer tipo
+    int key = -1;                       // tecla (VK) ou botão do mouse
+    int pressed = -1;                   // 1 = DOWN, 0 = UP
+    int monitor = -1;                   // índice da tela (0 = Tela 1)
+    bool hasRegion = false;             // região da tela, em centésimos de %
+    int xMin = 0, xMax = 10000;
+    int yMin = 0, yMax = 10000;
+    std::int64_t fromMicros = 0;        // instante da ação na gravação
+    std::int64_t toMicros = INT64_MAX;
+    std::int64_t delayMinMicros = -1;   // espera depois da ação (só ações "delay")
+    std::int64_t delayMaxMicros = INT64_MAX;
+
+    bool Empty() const;
+    // Versão direta (sem índice), usada na verificação e no benchmark;
+    // 'micros' = instante da ação
+    bool Matches(const Action& action, std::int64_t micros) const;
+};
+
+// Converte o texto da busca em ActionQuery. Termos separados por espaço:
+//   clique | tecla | mover | roda | texto | regiao | imagem | delay
+//                                         tipo (aceita também click/key/move/wheel/text/pixels/ancora/espera)
+//   tecla:A  botao:esq|dir|meio|x1|x2     tecla ou botão específico
+//   down | up                             pressionado / solto
+//   tela:2                                tela (1 = primeira)
+//   x:0-33  y:>50  esquerda|direita|topo|baixo|centro   região (% da tela; terços)
+//   tempo:1:00-2:30  tempo:>90            instante na gravação
+//   delay:>0.5  delay:0.1-0.3             esperas (segundos)
+// 'keyCode' traduz nomes de teclas ("ENTER", "F5") para VK; -1 se desconhecido.
+bool ParseActionQuery(const QString& text, ActionQuery& query, QString& error,
+                      const std::function<int(const QString&)>& keyCode);
+
+// Índices por coluna de uma lista de ações, para filtrar milhões de ações em
+// milissegundos. Colunas compactas (tipo, tecla, tela, x, y, instante) e
+// listas de posições por tipo, por tecla/botão e por tela. As ações entram só
+// no fim (Append/Sync), como na gravação; uma edição no meio da lista descarta
+// o índice a partir do ponto editado (Truncate) e o resto é reindexado.
+class ActionIndex {
+public:
+    size_t size() const { return kinds.size(); }
+    void Append(const Action& action);
+    // Mantém só as primeiras 'count' ações
+    void Truncate(size_t count);
+    // Indexa as ações de 'actions' que ainda não estão no índice
+    void Sync(const ActionTable& actions);
+    void Build(const ActionStream& stream);
+
+    // Posições que satisfazem a consulta, em ordem crescente (no máximo 'limit')
+    std::vector<std::uint32_t> Find(const ActionQuery& query, size_t limit = SIZE_MAX) const;
+    std::int64_t MicrosAt(size_t action) const { return action < times.size() ? times[action] : end; }
+    size_t MemoryBytes() const;
+
+private:
+    using Postings = std::vector<std::uint32_t>;
+
+    bool Check(size_t i, const ActionQuery& query) const;
+    static void TruncatePostings(Postings& postings, size_t count);
+
+    // Colunas
+    std::vector<std::uint8_t> kinds;
+    std::vector<std::uint8_t> flags;        // bit 0 = pressed
+    std::vector<std::int8_t> monitors;
+    std::vector<std::uint16_t> keys;
+    std::vector<std::uint16_t> xs;
+    std::vector<std::uint16_t> ys;
+    std::vector<std::int64_t> times;        // instante de cada ação (crescente)
+    std::int64_t end = 0;                   // instante depois da última ação
+    // Maior espera de cada trecho de kZoneActions ações: "delay:>X" pula os
+    // trechos sem nenhuma espera tão longa
+    static constexpr size_t kZoneActions = 1024;
+    std::vector<std::int64_t> zoneMaxDelay;
+
+    // Listas de posições (crescentes)
+    Postings byKind[static_cast<int>(ActionKind::AnchorClick) + 1];
+    std::unordered_map<std::uint32_t, Postings> byKey;     // (tipo << 16) | tecla/botão
+    std::vector<Postings> byMonitor;                       // [tela + 1] (0 = tela desconhecida)
+};
+
+struct IndexQueryResult {
+    QString query;
+    size_t matches;
+    double indexMs;         // com o índice
+    double scanMs;          // percorrendo a ActionTable
+};
+
+struct IndexBenchmarkResult {
+    size_t actions;
+    double buildMs;
+    double appendNs;        // por ação, na gravação
+    size_t indexBytes;
+    std::vector<IndexQueryResult> queries;
+};
+
+IndexBenchmarkResult BenchmarkActionIndex(size_t actions);
+
+#endif // ACTIONINDEX_H
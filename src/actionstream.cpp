@@ -0,0 +1,1021 @@
+#include "actionstream.h"
+#include "macrovm.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+
+enum StreamKind : std::uint8_t {
+    KIND_KEY = 1,
+    KIND_CLICK = 2,
+    KIND_MOVE = 3,
+    KIND_DELAY = 4,
+    KIND_WHEEL = 5,
+    KIND_RAW = 7
+};
+
+enum ActionFlags : std::uint8_t {
+    FLAG_PRESSED = 1 << 0,
+    FLAG_PRE_DELAY = 1 << 1,            // ação "delay" anterior fundida nesta
+    FLAG_PRE_DELAY_REQUIRED = 1 << 2,
+    FLAG_KEY_CHANGED = 1 << 3,
+    FLAG_MONITOR_CHANGED = 1 << 4,
+    FLAG_OWN_DELAY = 1 << 5
+};
+
+constexpr std::uint32_t kMaxRun = 32;
+constexpr double kMaxMicros = 4.0e18;
+
+const char kFileMagic[4] = {'M', 'S', 'T', 'R'};
+const char kIndexMagic[4] = {'M', 'I', 'D', 'X'};
+constexpr std::uint32_t kLegacyVersion = 1;
+constexpr size_t kLegacyHeaderSize = 4 + 4 + 8 + 4;
+constexpr size_t kLegacyBlockHeaderSize = 4 + 4 + 8;
+constexpr std::uint32_t kFileVersion = 2;
+// magic, versão, ações, duração, repetições, intervalo
+constexpr size_t kFileHeaderSize = 4 + 4 + 8 + 8 + 4 + 4;
+// posição, bytes, ações, primeira ação, instante inicial, duração
+constexpr size_t kIndexEntrySize = 8 + 4 + 4 + 8 + 8 + 8;
+// posição do índice, blocos, magic
+constexpr size_t kFooterSize = 8 + 4 + 4;
+
+inline std::uint64_t ZigZag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t UnZigZag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+// Soma uma diferença (zig-zag) a uma coordenada; false se sair do int (arquivo corrompido)
+inline bool AddZigZag(int& value, std::uint64_t encoded) {
+    const std::int64_t delta = UnZigZag(encoded);
+    if (delta < -static_cast<std::int64_t>(UINT32_MAX) || delta > static_cast<std::int64_t>(UINT32_MAX)) return false;
+    const std::int64_t next = value + delta;
+    if (next < INT32_MIN || next > INT32_MAX) return false;
+    value = static_cast<int>(next);
+    return true;
+}
+
+inline void PutVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+inline bool GetVarint(const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        std::uint8_t byte = *p++;
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+template <typename T>
+void PutFixed(std::vector<std::uint8_t>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8 * i)));
+    }
+}
+
+template <typename T>
+T GetFixed(const std::uint8_t* p) {
+    std::uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+    return static_cast<T>(value);
+}
+
+inline std::int64_t ToMicros(double seconds) {
+    return static_cast<std::int64_t>(std::llround(seconds * 1e6));
+}
+
+inline bool IsCompactDelay(const Action& a) {
+    return a.x == 0 && a.y == 0 && a.key == 0 && !a.pressed && a.frequency == 0 && a.monitorIndex == -1 &&
+           a.delay >= 0 && a.delay * 1e6 < kMaxMicros;
+}
+
+inline StreamKind CompactKind(const Action& a) {
+    if (a.frequency != 0 || a.required || !a.text.empty() || !(a.delay >= 0) || a.delay * 1e6 >= kMaxMicros) return KIND_RAW;
+    const ActionKind kind = ActionKindFromString(a.type);
+    if (a.delta != 0 && kind != ActionKind::MouseWheel) return KIND_RAW;
+    switch (kind) {
+        case ActionKind::KeyPress: return a.x == 0 && a.y == 0 ? KIND_KEY : KIND_RAW;
+        case ActionKind::MouseClick: return KIND_CLICK;
+        case ActionKind::MouseMove: return KIND_MOVE;
+        case ActionKind::Delay: return IsCompactDelay(a) ? KIND_DELAY : KIND_RAW;
+        case ActionKind::MouseWheel: return KIND_WHEEL;
+        default: return KIND_RAW;
+    }
+}
+
+const std::string kKeyType = ActionKindToString(ActionKind::KeyPress);
+const std::string kClickType = ActionKindToString(ActionKind::MouseClick);
+const std::string kMoveType = ActionKindToString(ActionKind::MouseMove);
+const std::string kDelayType = ActionKindToString(ActionKind::Delay);
+const std::string kWheelType = ActionKindToString(ActionKind::MouseWheel);
+
+struct FileHeader {
+    std::uint64_t total = 0;
+    std::int64_t duration = 0;
+    RepetitionLayout layout;
+    std::uint64_t indexOffset = 0;
+    std::uint32_t blockCount = 0;
+};
+
+bool ParseFileHeader(const std::uint8_t* p, size_t available, std::uint64_t fileSize, FileHeader& header, std::string& error) {
+    if (available < kFileHeaderSize || fileSize < kFileHeaderSize + kFooterSize || std::memcmp(p, kFileMagic, 4) != 0) {
+        error = "não é um arquivo de macro binário";
+        return false;
+    }
+    if (GetFixed<std::uint32_t>(p + 4) != kFileVersion) {
+        error = "versão de arquivo não suportada";
+        return false;
+    }
+    header.total = GetFixed<std::uint64_t>(p + 8);
+    header.duration = GetFixed<std::int64_t>(p + 16);
+    header.layout.count = static_cast<int>(std::min<std::uint32_t>(GetFixed<std::uint32_t>(p + 24), 1000000));
+    header.layout.gapMs = static_cast<int>(std::min<std::uint32_t>(GetFixed<std::uint32_t>(p + 28), 86400000));
+    return true;
+}
+
+bool ParseFooter(const std::uint8_t* p, std::uint64_t fileSize, FileHeader& header, std::string& error) {
+    if (std::memcmp(p + 12, kIndexMagic, 4) != 0) {
+        error = "índice do arquivo ausente (arquivo incompleto?)";
+        return false;
+    }
+    header.indexOffset = GetFixed<std::uint64_t>(p);
+    header.blockCount = GetFixed<std::uint32_t>(p + 8);
+    if (header.indexOffset < kFileHeaderSize ||
+        header.indexOffset + static_cast<std::uint64_t>(header.blockCount) * kIndexEntrySize + kFooterSize != fileSize) {
+        error = "índice de blocos corrompido";
+        return false;
+    }
+    return true;
+}
+
+// A linha do tempo de reprodução repete a gravação 'count' vezes com 'gapMs'
+// entre elas; instantes dentro do intervalo caem no início da repetição seguinte
+template <typename ActionAt>
+PlaybackPosition LocateInRepetitions(std::int64_t micros, std::int64_t duration, const RepetitionLayout& layout, ActionAt actionAt) {
+    PlaybackPosition position;
+    if (micros <= 0) return position;
+    const std::int64_t period = duration + static_cast<std::int64_t>(std::max(0, layout.gapMs)) * 1000;
+    const int count = std::max(1, layout.count);
+    if (period > 0) {
+        position.repetition = static_cast<int>(std::min<std::int64_t>(micros / period, count - 1));
+        micros -= position.repetition * period;
+    }
+    if (micros > duration && position.repetition + 1 < count) {
+        ++position.repetition;
+        return position;
+    }
+    position.action = actionAt(micros);
+    return position;
+}
+
+} // namespace
+
+// =============================================
+// CODIFICADOR
+// =============================================
+
+class ActionStream::Encoder {
+public:
+    std::uint32_t Count() const { return block.count + (hasPending ? 1 : 0); }
+    bool Empty() const { return Count() == 0; }
+
+    void Append(const Action& action) {
+        StreamKind kind = CompactKind(action);
+        if (kind == KIND_DELAY && !action.required) {
+            // Segura o delay: se a próxima ação for compacta, ele vira "espera anterior"
+            FlushPending();
+            pending = action;
+            hasPending = true;
+            return;
+        }
+        if (kind == KIND_DELAY || kind == KIND_RAW) {
+            FlushPending();
+            if (kind == KIND_DELAY) WriteDelay(action);
+            else WriteRaw(action);
+            return;
+        }
+        WriteCompact(kind, action);
+    }
+
+    void FlushPending() {
+        if (!hasPending) return;
+        hasPending = false;
+        WriteDelay(pending);
+    }
+
+    EncodedBlock Take() {
+        FlushPending();
+        EncodedBlock result = std::move(block);
+        *this = Encoder();
+        return result;
+    }
+
+    bool Decode(const std::function<void(const Action&)>& visit) const {
+        if (!DecodeBlock(block, visit)) return false;
+        if (hasPending) visit(pending);
+        return true;
+    }
+
+    size_t Bytes() const { return block.bytes.size(); }
+    std::int64_t Duration() const { return block.durationMicros + (hasPending ? ToMicros(pending.delay) : 0); }
+
+private:
+    void BeginAction(StreamKind kind) {
+        if (runCount == 0 || runKind != kind || runCount == kMaxRun) {
+            runHeader = block.bytes.size();
+            block.bytes.push_back(0);
+            runKind = kind;
+            runCount = 0;
+        }
+        ++runCount;
+        block.bytes[runHeader] = static_cast<std::uint8_t>(kind | ((runCount - 1) << 3));
+        ++block.count;
+    }
+
+    void WriteDelay(const Action& action) {
+        BeginAction(KIND_DELAY);
+        std::int64_t micros = ToMicros(action.delay);
+        PutVarint(block.bytes, (static_cast<std::uint64_t>(micros) << 1) | (action.required ? 1 : 0));
+        block.durationMicros += micros;
+    }
+
+    void WriteCompact(StreamKind kind, const Action& action) {
+        std::uint8_t flags = action.pressed ? FLAG_PRESSED : 0;
+        std::int64_t preMicros = 0;
+        if (hasPending) {
+            flags |= FLAG_PRE_DELAY;
+            if (pending.required) flags |= FLAG_PRE_DELAY_REQUIRED;
+            preMicros = ToMicros(pending.delay);
+            hasPending = false;
+            ++block.count;   // o delay fundido também é uma ação do bloco
+        }
+        if (action.key != prevKey) flags |= FLAG_KEY_CHANGED;
+        if (action.monitorIndex != prevMonitor) flags |= FLAG_MONITOR_CHANGED;
+        std::int64_t ownMicros = ToMicros(action.delay);
+        if (ownMicros != 0) flags |= FLAG_OWN_DELAY;
+
+        BeginAction(kind);
+        block.bytes.push_back(flags);
+        if (flags & FLAG_PRE_DELAY) PutVarint(block.bytes, static_cast<std::uint64_t>(preMicros));
+        if (flags & FLAG_KEY_CHANGED) PutVarint(block.bytes, action.key);
+        if (kind != KIND_KEY) {
+            PutVarint(block.bytes, ZigZag(static_cast<std::int64_t>(action.x) - prevX));
+            PutVarint(block.bytes, ZigZag(static_cast<std::int64_t>(action.y) - prevY));
+            prevX = action.x;
+            prevY = action.y;
+        }
+        if (kind == KIND_WHEEL) PutVarint(block.bytes, ZigZag(action.delta));
+        if (flags & FLAG_MONITOR_CHANGED) PutVarint(block.bytes, ZigZag(static_cast<std::int64_t>(action.monitorIndex) - prevMonitor));
+        if (flags & FLAG_OWN_DELAY) PutVarint(block.bytes, static_cast<std::uint64_t>(ownMicros));
+
+        prevKey = action.key;
+        prevMonitor = action.monitorIndex;
+        block.durationMicros += preMicros + ownMicros;
+    }
+
+    void WriteRaw(const Action& action) {
+        BeginAction(KIND_RAW);
+        PutVarint(block.bytes, action.type.size());
+        block.bytes.insert(block.bytes.end(), action.type.begin(), action.type.end());
+        PutVarint(block.bytes, ZigZag(action.x));
+        PutVarint(block.bytes, ZigZag(action.y));
+        PutVarint(block.bytes, action.key);
+        block.bytes.push_back(static_cast<std::uint8_t>((action.pressed ? 1 : 0) | (action.required ? 2 : 0) |
+                                                        (action.delta != 0 ? 4 : 0) | (!action.text.empty() ? 8 : 0)));
+        std::uint64_t bits;
+        std::memcpy(&bits, &action.delay, sizeof(bits));
+        PutFixed(block.bytes, bits);
+        PutVarint(block.bytes, ZigZag(action.frequency));
+        PutVarint(block.bytes, ZigZag(action.monitorIndex));
+        if (action.delta != 0) PutVarint(block.bytes, ZigZag(action.delta));
+        if (!action.text.empty()) {
+            PutVarint(block.bytes, action.text.size());
+            block.bytes.insert(block.bytes.end(), action.text.begin(), action.text.end());
+        }
+        if (action.delay > 0 && action.delay * 1e6 < kMaxMicros) block.durationMicros += ToMicros(action.delay);
+    }
+
+    EncodedBlock block;
+    // Preditores: recomeçam a cada bloco, igual ao decodificador
+    int prevX = 0;
+    int prevY = 0;
+    int prevMonitor = -1;
+    std::uint16_t prevKey = 0;
+    size_t runHeader = 0;
+    StreamKind runKind = KIND_RAW;
+    std::uint32_t runCount = 0;
+    bool hasPending = false;
+    Action pending;
+};
+
+// =============================================
+// DECODIFICADOR
+// =============================================
+
+bool DecodeBlock(const EncodedBlock& block, const std::function<void(const Action&)>& visit) {
+    const std::uint8_t* p = block.bytes.data();
+    const std::uint8_t* end = p + block.bytes.size();
+    int prevX = 0, prevY = 0, prevMonitor = -1;
+    std::uint16_t prevKey = 0;
+    std::uint32_t decoded = 0;
+
+    Action delay = {kDelayType, 0, 0, 0, false, 0.0, 0, -1, false, 0, {}};
+    Action action = {std::string(), 0, 0, 0, false, 0.0, 0, -1, false, 0, {}};
+    std::uint64_t v;
+
+    while (p < end) {
+        const std::uint8_t header = *p++;
+        const std::uint8_t kind = header & 7;
+        const std::uint32_t count = (header >> 3) + 1u;
+
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (kind == KIND_DELAY) {
+                if (!GetVarint(p, end, v)) return false;
+                delay.delay = static_cast<double>(v >> 1) / 1e6;
+                delay.required = (v & 1) != 0;
+                visit(delay);
+                ++decoded;
+                continue;
+            }
+
+            if (kind == KIND_RAW) {
+                std::uint64_t length;
+                if (!GetVarint(p, end, length) || length > static_cast<std::uint64_t>(end - p)) return false;
+                Action raw;
+                raw.type.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+                p += length;
+                std::uint64_t x, y, key, frequency, monitor;
+                if (!GetVarint(p, end, x) || !GetVarint(p, end, y) || !GetVarint(p, end, key)) return false;
+                if (end - p < 9) return false;
+                std::uint8_t bits = *p++;
+                std::uint64_t delayBits = GetFixed<std::uint64_t>(p);
+                p += 8;
+                if (!GetVarint(p, end, frequency) || !GetVarint(p, end, monitor)) return false;
+                raw.x = static_cast<int>(UnZigZag(x));
+                raw.y = static_cast<int>(UnZigZag(y));
+                raw.key = static_cast<std::uint16_t>(key);
+                raw.pressed = (bits & 1) != 0;
+                raw.required = (bits & 2) != 0;
+                std::memcpy(&raw.delay, &delayBits, sizeof(delayBits));
+                raw.frequency = static_cast<int>(UnZigZag(frequency));
+                raw.monitorIndex = static_cast<int>(UnZigZag(monitor));
+                if (bits & 4) {
+                    if (!GetVarint(p, end, v)) return false;
+                    raw.delta = static_cast<int>(UnZigZag(v));
+                }
+                if (bits & 8) {
+                    if (!GetVarint(p, end, length) || length > static_cast<std::uint64_t>(end - p)) return false;
+                    raw.text.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+                    p += length;
+                }
+                visit(raw);
+                ++decoded;
+                continue;
+            }
+
+            if (kind != KIND_KEY && kind != KIND_CLICK && kind != KIND_MOVE && kind != KIND_WHEEL) return false;
+            if (p == end) return false;
+            const std::uint8_t flags = *p++;
+            if (flags & FLAG_PRE_DELAY) {
+                if (!GetVarint(p, end, v)) return false;
+                delay.delay = static_cast<double>(v) / 1e6;
+                delay.required = (flags & FLAG_PRE_DELAY_REQUIRED) != 0;
+                visit(delay);
+                ++decoded;
+            }
+            if (flags & FLAG_KEY_CHANGED) {
+                if (!GetVarint(p, end, v)) return false;
+                prevKey = static_cast<std::uint16_t>(v);
+            }
+            if (kind != KIND_KEY) {
+                std::uint64_t dx, dy;
+                if (!GetVarint(p, end, dx) || !GetVarint(p, end, dy)) return false;
+                if (!AddZigZag(prevX, dx) || !AddZigZag(prevY, dy)) return false;
+            }
+            action.delta = 0;
+            if (kind == KIND_WHEEL) {
+                if (!GetVarint(p, end, v)) return false;
+                action.delta = static_cast<int>(UnZigZag(v));
+            }
+            if (flags & FLAG_MONITOR_CHANGED) {
+                if (!GetVarint(p, end, v) || !AddZigZag(prevMonitor, v)) return false;
+            }
+            action.delay = 0.0;
+            if (flags & FLAG_OWN_DELAY) {
+                if (!GetVarint(p, end, v)) return false;
+                action.delay = static_cast<double>(v) / 1e6;
+            }
+
+            action.type = kind == KIND_KEY ? kKeyType : kind == KIND_CLICK ? kClickType :
+                          kind == KIND_WHEEL ? kWheelType : kMoveType;
+            action.x = kind == KIND_KEY ? 0 : prevX;
+            action.y = kind == KIND_KEY ? 0 : prevY;
+            action.key = prevKey;
+            action.pressed = (flags & FLAG_PRESSED) != 0;
+            action.monitorIndex = prevMonitor;
+            visit(action);
+            ++decoded;
+        }
+    }
+    return decoded == block.count;
+}
+
+// =============================================
+// FLUXO
+// =============================================
+
+ActionStream::ActionStream() : tail(std::make_shared<Encoder>()) {
+}
+
+void ActionStream::Append(const Action& action) {
+    // Cópias do fluxo compartilham o bloco aberto até a primeira escrita
+    if (tail.use_count() > 1) tail = std::make_shared<Encoder>(*tail);
+    if (tail->Count() >= kBlockActions) SealTail();
+    tail->Append(action);
+    ++total;
+}
+
+void ActionStream::Clear() {
+    *this = ActionStream();
+}
+
+void ActionStream::SealTail() {
+    if (tail->Empty()) return;
+    if (tail.use_count() > 1) tail = std::make_shared<Encoder>(*tail);
+    PushBlock(std::make_shared<const EncodedBlock>(tail->Take()));
+}
+
+void ActionStream::Seal() {
+    SealTail();
+}
+
+void ActionStream::AppendBlock(EncodedBlockPtr block) {
+    if (block->count == 0) return;
+    SealTail();
+    total += block->count;
+    PushBlock(std::move(block));
+}
+
+void ActionStream::PushBlock(EncodedBlockPtr block) {
+    blockFirst.push_back(sealedActions);
+    blockStart.push_back(sealedMicros);
+    sealedActions += block->count;
+    sealedMicros += block->durationMicros;
+    blocks.push_back(std::move(block));
+}
+
+size_t ActionStream::EncodedBytes() const {
+    size_t bytes = tail->Bytes();
+    for (const auto& block : blocks) bytes += block->bytes.size();
+    return bytes;
+}
+
+std::int64_t ActionStream::DurationMicros() const {
+    return sealedMicros + tail->Duration();
+}
+
+size_t ActionStream::SegmentOfAction(size_t action) const {
+    if (action >= sealedActions) return blocks.size();
+    return static_cast<size_t>(std::upper_bound(blockFirst.begin(), blockFirst.end(), action) - blockFirst.begin()) - 1;
+}
+
+size_t ActionStream::SegmentOfMicros(std::int64_t micros) const {
+    if (blocks.empty() || (micros >= sealedMicros && !tail->Empty())) return blocks.size();
+    return static_cast<size_t>(std::upper_bound(blockStart.begin(), blockStart.end(), micros) - blockStart.begin()) - 1;
+}
+
+void ActionStream::VisitSegment(size_t segment, const std::function<void(const Action&)>& visit) const {
+    if (segment < blocks.size()) DecodeBlock(*blocks[segment], visit);
+    else tail->Decode(visit);
+}
+
+void ActionStream::ForEach(const std::function<void(const Action&)>& visit) const {
+    for (const auto& block : blocks) DecodeBlock(*block, visit);
+    tail->Decode(visit);
+}
+
+void ActionStream::ForEachFrom(size_t first, const std::function<void(const Action&)>& visit) const {
+    if (first >= total) return;
+    size_t segment = SegmentOfAction(first);
+    size_t index = SegmentFirst(segment);
+    VisitSegment(segment, [&](const Action& action) {
+        if (index++ >= first) visit(action);
+    });
+    for (++segment; segment < blocks.size(); ++segment) DecodeBlock(*blocks[segment], visit);
+    if (segment == blocks.size()) tail->Decode(visit);
+}
+
+std::vector<Action> ActionStream::DecodeAll() const {
+    std::vector<Action> actions;
+    actions.reserve(total);
+    ForEach([&actions](const Action& action) { actions.push_back(action); });
+    return actions;
+}
+
+std::int64_t ActionStream::MicrosAt(size_t action) const {
+    if (action >= total) return DurationMicros();
+    const size_t segment = SegmentOfAction(action);
+    size_t index = SegmentFirst(segment);
+    std::int64_t time = SegmentStart(segment);
+    std::int64_t result = time;
+    VisitSegment(segment, [&](const Action& a) {
+        if (index == action) result = time;
+        time += ScheduledMicros(a);
+        ++index;
+    });
+    return result;
+}
+
+size_t ActionStream::ActionAtMicros(std::int64_t micros) const {
+    if (total == 0 || micros <= 0) return 0;
+    const size_t segment = SegmentOfMicros(micros);
+    size_t index = SegmentFirst(segment);
+    std::int64_t time = SegmentStart(segment);
+    size_t result = index;
+    VisitSegment(segment, [&](const Action& a) {
+        if (time <= micros) result = index;
+        time += ScheduledMicros(a);
+        ++index;
+    });
+    return std::min(result, total - 1);
+}
+
+PlaybackPosition ActionStream::Locate(std::int64_t micros, const RepetitionLayout& layout) const {
+    return LocateInRepetitions(micros, DurationMicros(), layout,
+                               [this](std::int64_t offset) { return ActionAtMicros(offset); });
+}
+
+ActionStream ActionStream::FromActions(const std::vector<Action>& actions) {
+    ActionStream stream;
+    for (const auto& action : actions) stream.Append(action);
+    return stream;
+}
+
+std::vector<std::uint8_t> ActionStream::Serialize(const RepetitionLayout& layout) const {
+    ActionStream sealed = *this;
+    sealed.Seal();
+
+    std::vector<std::uint8_t> out;
+    out.reserve(kFileHeaderSize + sealed.EncodedBytes() + sealed.blocks.size() * kIndexEntrySize + kFooterSize);
+    for (char c : kFileMagic) out.push_back(static_cast<std::uint8_t>(c));
+    PutFixed<std::uint32_t>(out, kFileVersion);
+    PutFixed<std::uint64_t>(out, total);
+    PutFixed<std::int64_t>(out, sealed.sealedMicros);
+    PutFixed<std::uint32_t>(out, static_cast<std::uint32_t>(std::max(1, layout.count)));
+    PutFixed<std::uint32_t>(out, static_cast<std::uint32_t>(std::max(0, layout.gapMs)));
+
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(sealed.blocks.size());
+    for (const auto& block : sealed.blocks) {
+        offsets.push_back(out.size());
+        out.insert(out.end(), block->bytes.begin(), block->bytes.end());
+    }
+
+    // Índice no final: a gravação pode ser escrita em sequência e o leitor
+    // encontra tudo a partir do rodapé de tamanho fixo
+    const std::uint64_t indexOffset = out.size();
+    for (size_t b = 0; b < sealed.blocks.size(); ++b) {
+        PutFixed<std::uint64_t>(out, offsets[b]);
+        PutFixed<std::uint32_t>(out, static_cast<std::uint32_t>(sealed.blocks[b]->bytes.size()));
+        PutFixed<std::uint32_t>(out, sealed.blocks[b]->count);
+        PutFixed<std::uint64_t>(out, sealed.blockFirst[b]);
+        PutFixed<std::int64_t>(out, sealed.blockStart[b]);
+        PutFixed<std::int64_t>(out, sealed.blocks[b]->durationMicros);
+    }
+    PutFixed<std::uint64_t>(out, indexOffset);
+    PutFixed<std::uint32_t>(out, static_cast<std::uint32_t>(sealed.blocks.size()));
+    for (char c : kIndexMagic) out.push_back(static_cast<std::uint8_t>(c));
+    return out;
+}
+
+namespace {
+
+// Os cabeçalhos dizem quantas ações cada bloco tem; só decodificando se sabe
+// se os bytes entregam essas ações. ForEach, DecodeAll e o índice confiam em size().
+bool BlockDecodes(const EncodedBlock& block) {
+    return DecodeBlock(block, [](const Action&) {});
+}
+
+} // namespace
+
+bool ActionStream::Deserialize(const std::uint8_t* data, size_t size, ActionStream& out, std::string& error,
+                               RepetitionLayout* layout) {
+    if (size < kLegacyHeaderSize || std::memcmp(data, kFileMagic, 4) != 0) {
+        error = "não é um arquivo de macro binário";
+        return false;
+    }
+    const std::uint32_t version = GetFixed<std::uint32_t>(data + 4);
+    ActionStream stream;
+    // Duração negativa ou que estoura a soma (int64) só vem de arquivo corrompido
+    auto durationFits = [&stream](std::int64_t micros) {
+        return micros >= 0 && micros <= INT64_MAX - stream.sealedMicros;
+    };
+
+    if (version == kLegacyVersion) {
+        // Versão 1: blocos em sequência, cada um com seu cabeçalho, sem índice
+        const std::uint64_t expected = GetFixed<std::uint64_t>(data + 8);
+        const std::uint32_t blockCount = GetFixed<std::uint32_t>(data + 16);
+        size_t offset = kLegacyHeaderSize;
+        for (std::uint32_t b = 0; b < blockCount; ++b) {
+            if (size - offset < kLegacyBlockHeaderSize) {
+                error = "arquivo truncado";
+                return false;
+            }
+            auto block = std::make_shared<EncodedBlock>();
+            block->count = GetFixed<std::uint32_t>(data + offset);
+            std::uint32_t length = GetFixed<std::uint32_t>(data + offset + 4);
+            block->durationMicros = GetFixed<std::int64_t>(data + offset + 8);
+            offset += kLegacyBlockHeaderSize;
+            if (!durationFits(block->durationMicros)) {
+                error = "duração de bloco corrompida";
+                return false;
+            }
+            if (size - offset < length) {
+                error = "arquivo truncado";
+                return false;
+            }
+            block->bytes.assign(data + offset, data + offset + length);
+            offset += length;
+            if (!BlockDecodes(*block)) {
+                error = "bloco de ações corrompido";
+                return false;
+            }
+            stream.AppendBlock(std::move(block));
+        }
+        if (stream.total != expected) {
+            error = "contagem de ações inconsistente";
+            return false;
+        }
+        if (layout) *layout = RepetitionLayout();
+        out = std::move(stream);
+        return true;
+    }
+
+    FileHeader header;
+    if (!ParseFileHeader(data, size, size, header, error)) return false;
+    if (!ParseFooter(data + size - kFooterSize, size, header, error)) return false;
+
+    const std::uint8_t* entry = data + header.indexOffset;
+    for (std::uint32_t b = 0; b < header.blockCount; ++b, entry += kIndexEntrySize) {
+        const std::uint64_t offset = GetFixed<std::uint64_t>(entry);
+        const std::uint32_t length = GetFixed<std::uint32_t>(entry + 8);
+        if (offset < kFileHeaderSize || offset > header.indexOffset || length > header.indexOffset - offset) {
+            error = "índice de blocos corrompido";
+            return false;
+        }
+        auto block = std::make_shared<EncodedBlock>();
+        block->count = GetFixed<std::uint32_t>(entry + 12);
+        block->durationMicros = GetFixed<std::int64_t>(entry + 32);
+        if (!durationFits(block->durationMicros)) {
+            error = "duração de bloco corrompida";
+            return false;
+        }
+        block->bytes.assign(data + offset, data + offset + length);
+        if (!BlockDecodes(*block)) {
+            error = "bloco de ações corrompido";
+            return false;
+        }
+        stream.AppendBlock(std::move(block));
+    }
+    if (stream.total != header.total) {
+        error = "contagem de ações inconsistente";
+        return false;
+    }
+    if (layout) *layout = header.layout;
+    out = std::move(stream);
+    return true;
+}
+
+// =============================================
+// ARQUIVO COM ACESSO ALEATÓRIO
+// =============================================
+
+bool ActionStreamFile::Open(const std::string& path, std::string& error) {
+    Close();
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "não foi possível abrir o arquivo";
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    const std::uint64_t size = static_cast<std::uint64_t>(file.tellg());
+
+    std::uint8_t head[kFileHeaderSize];
+    std::uint8_t foot[kFooterSize];
+    FileHeader header;
+    bool ok = size >= kFileHeaderSize + kFooterSize;
+    if (ok) {
+        file.seekg(0);
+        ok = static_cast<bool>(file.read(reinterpret_cast<char*>(head), sizeof(head)));
+    }
+    if (ok && GetFixed<std::uint32_t>(head + 4) == kLegacyVersion) {
+        error = "arquivo da versão 1 (sem índice): salve-o novamente para abrir com busca";
+        Close();
+        return false;
+    }
+    if (ok) {
+        file.seekg(static_cast<std::streamoff>(size - kFooterSize));
+        ok = static_cast<bool>(file.read(reinterpret_cast<char*>(foot), sizeof(foot)));
+    }
+    if (!ok) {
+        error = "não é um arquivo de macro binário";
+        Close();
+        return false;
+    }
+    if (!ParseFileHeader(head, sizeof(head), size, header, error) || !ParseFooter(foot, size, header, error)) {
+        Close();
+        return false;
+    }
+
+    std::vector<std::uint8_t> raw(static_cast<size_t>(header.blockCount) * kIndexEntrySize);
+    file.seekg(static_cast<std::streamoff>(header.indexOffset));
+    if (!raw.empty() && !file.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(raw.size()))) {
+        error = "arquivo truncado";
+        Close();
+        return false;
+    }
+    index.resize(header.blockCount);
+    std::uint64_t expectedFirst = 0;
+    std::int64_t expectedStart = 0;
+    for (size_t b = 0; b < index.size(); ++b) {
+        const std::uint8_t* entry = raw.data() + b * kIndexEntrySize;
+        IndexEntry& e = index[b];
+        e.offset = GetFixed<std::uint64_t>(entry);
+        e.length = GetFixed<std::uint32_t>(entry + 8);
+        e.count = GetFixed<std::uint32_t>(entry + 12);
+        e.first = GetFixed<std::uint64_t>(entry + 16);
+        e.start = GetFixed<std::int64_t>(entry + 24);
+        e.duration = GetFixed<std::int64_t>(entry + 32);
+        // Blocos contíguos no tempo: a busca por instante depende disso
+        if (e.first != expectedFirst || e.count == 0 || e.offset > header.indexOffset ||
+            e.length > header.indexOffset - e.offset || e.start != expectedStart ||
+            e.duration < 0 || e.duration > INT64_MAX - expectedStart) {
+            error = "índice de blocos corrompido";
+            Close();
+            return false;
+        }
+        expectedFirst += e.count;
+        expectedStart += e.duration;
+    }
+    if (expectedFirst != header.total) {
+        error = "contagem de ações inconsistente";
+        Close();
+        return false;
+    }
+    total = static_cast<size_t>(header.total);
+    duration = header.duration;
+    layout = header.layout;
+    return true;
+}
+
+void ActionStreamFile::Close() {
+    if (file.is_open()) file.close();
+    file.clear();
+    index.clear();
+    cache.clear();
+    total = 0;
+    duration = 0;
+    layout = RepetitionLayout();
+}
+
+EncodedBlockPtr ActionStreamFile::Block(size_t block) {
+    for (size_t i = 0; i < cache.size(); ++i) {
+        if (cache[i].first == block) {
+            auto hit = cache[i];
+            cache.erase(cache.begin() + static_cast<std::ptrdiff_t>(i));
+            cache.push_back(hit);
+            return hit.second;
+        }
+    }
+    const IndexEntry& e = index[block];
+    auto loaded = std::make_shared<EncodedBlock>();
+    loaded->count = e.count;
+    loaded->durationMicros = e.duration;
+    loaded->bytes.resize(e.length);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(e.offset));
+    if (!file.read(reinterpret_cast<char*>(loaded->bytes.data()), e.length)) {
+        loaded->bytes.clear();   // bloco vazio: a decodificação falha sem ações
+    }
+    if (cache.size() == kCachedBlocks) cache.erase(cache.begin());
+    cache.emplace_back(block, loaded);
+    return loaded;
+}
+
+size_t ActionStreamFile::BlockOfAction(size_t action) const {
+    auto it = std::upper_bound(index.begin(), index.end(), static_cast<std::uint64_t>(action),
+                               [](std::uint64_t value, const IndexEntry& e) { return value < e.first; });
+    return static_cast<size_t>(it - index.begin()) - 1;
+}
+
+std::int64_t ActionStreamFile::MicrosAt(size_t action) {
+    if (action >= total) return duration;
+    const size_t b = BlockOfAction(action);
+    size_t i = static_cast<size_t>(index[b].first);
+    std::int64_t time = index[b].start;
+    std::int64_t result = time;
+    DecodeBlock(*Block(b), [&](const Action& a) {
+        if (i == action) result = time;
+        time += ScheduledMicros(a);
+        ++i;
+    });
+    return result;
+}
+
+size_t ActionStreamFile::ActionAtMicros(std::int64_t micros) {
+    if (total == 0 || micros <= 0) return 0;
+    auto it = std::upper_bound(index.begin(), index.end(), micros,
+                               [](std::int64_t value, const IndexEntry& e) { return value < e.start; });
+    if (it == index.begin()) return 0;
+    const size_t b = static_cast<size_t>(it - index.begin()) - 1;
+    size_t i = static_cast<size_t>(index[b].first);
+    std::int64_t time = index[b].start;
+    size_t result = i;
+    DecodeBlock(*Block(b), [&](const Action& a) {
+        if (time <= micros) result = i;
+        time += ScheduledMicros(a);
+        ++i;
+    });
+    return std::min(result, total - 1);
+}
+
+PlaybackPosition ActionStreamFile::Locate(std::int64_t micros) {
+    return LocateInRepetitions(micros, duration, layout,
+                               [this](std::int64_t offset) { return ActionAtMicros(offset); });
+}
+
+std::vector<Action> ActionStreamFile::Read(size_t first, size_t count) {
+    std::vector<Action> actions;
+    if (first >= total || count == 0) return actions;
+    const size_t last = std::min(total, first + count);
+    actions.reserve(last - first);
+    for (size_t b = BlockOfAction(first); b < index.size() && index[b].first < last; ++b) {
+        size_t i = static_cast<size_t>(index[b].first);
+        DecodeBlock(*Block(b), [&](const Action& a) {
+            if (i >= first && i < last) actions.push_back(a);
+            ++i;
+        });
+    }
+    return actions;
+}
+
+bool ActionStreamFile::LoadStream(ActionStream& out, std::string& error) {
+    ActionStream stream;
+    for (size_t b = 0; b < index.size(); ++b) {
+        EncodedBlockPtr block = Block(b);
+        if (block->bytes.size() != index[b].length) {
+            error = "arquivo truncado";
+            return false;
+        }
+        if (!BlockDecodes(*block)) {
+            error = "bloco de ações corrompido";
+            return false;
+        }
+        stream.AppendBlock(std::move(block));
+    }
+    out = std::move(stream);
+    return true;
+}
+// =============================================
+// BENCHMARK
+// =============================================
+
+namespace {
+
+std::vector<Action> SyntheticTrace(int shape, size_t count, std::mt19937& rng) {
+    std::vector<Action> trace;
+    trace.reserve(count + 8);
+    std::normal_distribution<double> step(0.0, 6.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    int x = 5000, y = 5000;
+
+    while (trace.size() < count) {
+        bool typing = shape == 1 || (shape == 2 && unit(rng) < 0.3);
+        if (typing) {
+            // Digitação: down, pressão ~80 ms, up, intervalo ~150 ms
+            std::uint16_t key = static_cast<std::uint16_t>(0x41 + static_cast<int>(unit(rng) * 26));
+            trace.push_back({"key_press", 0, 0, key, true, 0.0, 0, -1, false, 0, {}});
+            trace.push_back({"delay", 0, 0, 0, false, 0.05 + unit(rng) * 0.07, 0, -1, false, 0, {}});
+            trace.push_back({"key_press", 0, 0, key, false, 0.0, 0, -1, false, 0, {}});
+            trace.push_back({"delay", 0, 0, 0, false, 0.08 + unit(rng) * 0.2, 0, -1, false, 0, {}});
+        } else {
+            // Movimento contínuo: passos pequenos a cada ~8 ms, clique ocasional
+            for (int i = 0; i < 40 && trace.size() < count; ++i) {
+                x = std::clamp(x + static_cast<int>(step(rng)), 0, 10000);
+                y = std::clamp(y + static_cast<int>(step(rng)), 0, 10000);
+                trace.push_back({"delay", 0, 0, 0, false, 0.006 + unit(rng) * 0.006, 0, -1, false, 0, {}});
+                trace.push_back({"mouse_move", x, y, 0, false, 0.0, 0, 0, false, 0, {}});
+            }
+            if (unit(rng) < 0.5) {
+                trace.push_back({"mouse_click", x, y, 0, true, 0.0, 0, 0, false, 0, {}});
+                trace.push_back({"delay", 0, 0, 0, false, 0.09, 0, -1, false, 0, {}});
+                trace.push_back({"mouse_click", x, y, 0, false, 0.0, 0, 0, false, 0, {}});
+            }
+        }
+    }
+    trace.resize(count);
+    return trace;
+}
+
+size_t JsonBytes(const std::vector<Action>& actions) {
+    // Mesmo conteúdo que on_saveButton_clicked grava (formato compacto)
+    size_t bytes = 2;
+    char buffer[256];
+    for (const auto& a : actions) {
+        int n = std::snprintf(buffer, sizeof(buffer),
+            "{\"delay\":%.17g,\"frequency\":%d,\"key\":%d,\"monitorIndex\":%d,\"pressed\":%s,\"type\":\"%s\",\"x\":%d,\"y\":%d},",
+            a.delay, a.frequency, a.key, a.monitorIndex, a.pressed ? "true" : "false", a.type.c_str(), a.x, a.y);
+        bytes += n > 0 ? static_cast<size_t>(n) : 0;
+    }
+    return bytes;
+}
+
+} // namespace
+
+std::vector<Action> SyntheticActionTrace(int shape, size_t count, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    return SyntheticTrace(shape, count, rng);
+}
+
+std::vector<StreamBenchmarkResult> BenchmarkActionStream(size_t actionsPerTrace) {
+    using Clock = std::chrono::steady_clock;
+    const char* names[] = {"mouse", "teclado", "misto"};
+    std::vector<StreamBenchmarkResult> results;
+    std::mt19937 rng(2024);
+
+    for (int shape = 0; shape < 3; ++shape) {
+        std::vector<Action> trace = SyntheticTrace(shape, actionsPerTrace, rng);
+        StreamBenchmarkResult r = {names[shape], trace.size(), trace.size() * sizeof(Action), JsonBytes(trace), 0, 0, 0, 0};
+
+        auto start = Clock::now();
+        ActionStream stream = ActionStream::FromActions(trace);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        r.encodedBytes = stream.EncodedBytes();
+        r.encodeMActionsPerSec = seconds > 0 ? trace.size() / seconds / 1e6 : 0;
+
+        size_t checksum = 0;
+        start = Clock::now();
+        stream.ForEach([&checksum](const Action& a) { checksum += static_cast<size_t>(a.x) + a.key; });
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        r.decodeMActionsPerSec = seconds > 0 ? trace.size() / seconds / 1e6 : 0;
+
+        start = Clock::now();
+        MacroProgram program = MacroCompiler::FromStream(stream, 1, 0);
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        r.compileMActionsPerSec = seconds > 0 ? trace.size() / seconds / 1e6 : 0;
+
+        if (checksum == 0 && program.empty()) r.trace += "?";
+        results.push_back(r);
+    }
+    return results;
+}
+
+SeekBenchmarkResult BenchmarkStreamSeek(size_t actions, const std::string& path) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 rng(99);
+    SeekBenchmarkResult r = {actions, 0, 0, 0};
+
+    {
+        ActionStream stream = ActionStream::FromActions(SyntheticTrace(2, actions, rng));
+        std::vector<std::uint8_t> data = stream.Serialize();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        r.fileBytes = data.size();
+    }
+
+    ActionStreamFile file;
+    std::string error;
+    auto start = Clock::now();
+    bool opened = file.Open(path, error);
+    r.openUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if (!opened) return r;
+
+    const int seeks = 1000;
+    std::uniform_int_distribution<std::int64_t> when(0, std::max<std::int64_t>(0, file.DurationMicros()));
+    size_t checksum = 0;
+    start = Clock::now();
+    for (int i = 0; i < seeks; ++i) {
+        size_t action = file.ActionAtMicros(when(rng));
+        checksum += file.Read(action, 50).size();
+    }
+    r.seekUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / seeks;
+    if (checksum == 0) r.seekUs = -1;
+    file.Close();
+    std::remove(path.c_str());
+    return r;
+}
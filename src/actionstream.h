@@ -0,0 +1,195 @@
+#ifndef ACTIONSTREAM_H
+#define ACTIONSTREAM_H
+
+#include "action.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Bloco imutável de ações codificadas. Cada bloco é independente (o preditor
+// recomeça no início), então pode ser decodificado sem os anteriores.
+//
+// Formato: sequência de "runs" de ações do mesmo tipo.
+//   cabeçalho do run (1 byte): tipo (3 bits) | (quantidade - 1) << 3   (até 32)
+//   KeyPress/MouseClick/MouseMove/MouseWheel: byte de flags + campos presentes:
+//     [espera anterior: varint µs] [tecla/botão/eixo: varint, se mudou]
+//     [x, y: zig-zag varint do delta, só mouse] [delta da roda: zig-zag varint]
+//     [monitor: zig-zag delta, se mudou] [delay próprio: varint µs]
+//   Delay isolado: varint (µs << 1 | obrigatória)
+//   Raw: qualquer ação fora do modelo compacto, com todos os campos e o tipo
+//     (no fim, o delta da roda se o bit 2 das flags estiver ligado e o texto
+//     de "type_text" se o bit 3 estiver)
+// Uma ação "delay" simples seguida de tecla/mouse é fundida nesta como
+// "espera anterior": num rastro gravado os movimentos viram runs contínuos.
+struct EncodedBlock {
+    std::vector<std::uint8_t> bytes;
+    std::uint32_t count = 0;            // ações decodificadas do bloco
+    std::int64_t durationMicros = 0;    // soma das esperas do bloco
+};
+
+using EncodedBlockPtr = std::shared_ptr<const EncodedBlock>;
+
+// Decodifica um bloco inteiro; false se os bytes estiverem corrompidos
+bool DecodeBlock(const EncodedBlock& block, const std::function<void(const Action&)>& visit);
+
+// Repetições gravadas junto com o arquivo: a repetição r começa no instante
+// r * (duração + intervalo) da linha do tempo de reprodução
+struct RepetitionLayout {
+    int count = 1;
+    int gapMs = 0;
+};
+
+// Ponto de partida da reprodução: ação dentro de uma repetição
+struct PlaybackPosition {
+    int repetition = 0;
+    size_t action = 0;
+};
+
+// Espera que a ação acrescenta à linha do tempo gravada (mesma conta da
+// duração dos blocos, das buscas e da linha do tempo da interface)
+inline std::int64_t ScheduledMicros(const Action& a) {
+    return a.delay > 0 && a.delay < 4.0e12 ? static_cast<std::int64_t>(std::llround(a.delay * 1e6)) : 0;
+}
+
+// Fluxo de ações codificado: anexar é O(1) amortizado, blocos fechados são
+// imutáveis e compartilháveis (cópias do fluxo não duplicam os bytes).
+class ActionStream {
+public:
+    static constexpr std::uint32_t kBlockActions = 4096;
+
+    ActionStream();
+
+    void Append(const Action& action);
+    void Clear();
+    // Fecha o bloco em construção (Blocks() passa a conter todas as ações)
+    void Seal();
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+    size_t EncodedBytes() const;
+    std::int64_t DurationMicros() const;
+    const std::vector<EncodedBlockPtr>& Blocks() const { return blocks; }
+
+    // Fecha o bloco aberto e anexa um bloco já codificado
+    void AppendBlock(EncodedBlockPtr block);
+
+    void ForEach(const std::function<void(const Action&)>& visit) const;
+    // A partir da ação 'first': decodifica só o bloco que a contém e os seguintes
+    void ForEachFrom(size_t first, const std::function<void(const Action&)>& visit) const;
+    std::vector<Action> DecodeAll() const;
+
+    // Tempo gravado (soma das esperas anteriores) em que a ação começa
+    std::int64_t MicrosAt(size_t action) const;
+    // Última ação que começa até 'micros'
+    size_t ActionAtMicros(std::int64_t micros) const;
+    // Instante da linha do tempo de reprodução -> repetição e ação
+    PlaybackPosition Locate(std::int64_t micros, const RepetitionLayout& layout) const;
+
+    static ActionStream FromActions(const std::vector<Action>& actions);
+
+    // Formato em disco (versão 2): cabeçalho, blocos e um índice no final com
+    // posição, primeira ação e instante inicial de cada bloco (ver ActionStreamFile).
+    // Deserialize também lê a versão 1, sem índice.
+    std::vector<std::uint8_t> Serialize(const RepetitionLayout& layout = RepetitionLayout()) const;
+    static bool Deserialize(const std::uint8_t* data, size_t size, ActionStream& out, std::string& error,
+                            RepetitionLayout* layout = nullptr);
+
+private:
+    class Encoder;
+
+    void SealTail();
+    void PushBlock(EncodedBlockPtr block);
+    // Segmento = bloco fechado, ou blocks.size() para o bloco aberto
+    size_t SegmentOfAction(size_t action) const;
+    size_t SegmentOfMicros(std::int64_t micros) const;
+    void VisitSegment(size_t segment, const std::function<void(const Action&)>& visit) const;
+    size_t SegmentFirst(size_t segment) const { return segment < blocks.size() ? blockFirst[segment] : sealedActions; }
+    std::int64_t SegmentStart(size_t segment) const { return segment < blocks.size() ? blockStart[segment] : sealedMicros; }
+
+    std::vector<EncodedBlockPtr> blocks;
+    std::vector<size_t> blockFirst;         // primeira ação de cada bloco fechado
+    std::vector<std::int64_t> blockStart;   // instante inicial de cada bloco fechado
+    size_t sealedActions = 0;
+    std::int64_t sealedMicros = 0;
+    std::shared_ptr<Encoder> tail;      // bloco aberto (cópia sob demanda)
+    size_t total = 0;
+};
+
+// Arquivo .mstream aberto para acesso aleatório: só o cabeçalho e o índice
+// final são lidos na abertura; os blocos são lidos sob demanda (com um pequeno
+// cache), então abrir e buscar não dependem do tamanho da gravação.
+class ActionStreamFile {
+public:
+    bool Open(const std::string& path, std::string& error);
+    void Close();
+    bool IsOpen() const { return file.is_open(); }
+
+    size_t size() const { return total; }
+    std::int64_t DurationMicros() const { return duration; }
+    const RepetitionLayout& Layout() const { return layout; }
+    size_t BlockCount() const { return index.size(); }
+
+    std::int64_t MicrosAt(size_t action);
+    size_t ActionAtMicros(std::int64_t micros);
+    PlaybackPosition Locate(std::int64_t micros);
+    // Ações [first, first + count), lendo só os blocos envolvidos
+    std::vector<Action> Read(size_t first, size_t count);
+    // Arquivo inteiro como fluxo (os blocos não são decodificados)
+    bool LoadStream(ActionStream& out, std::string& error);
+
+private:
+    struct IndexEntry {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t count;
+        std::uint64_t first;
+        std::int64_t start;
+        std::int64_t duration;
+    };
+
+    EncodedBlockPtr Block(size_t block);
+    size_t BlockOfAction(size_t action) const;
+
+    static constexpr size_t kCachedBlocks = 8;
+
+    std::ifstream file;
+    std::vector<IndexEntry> index;
+    size_t total = 0;
+    std::int64_t duration = 0;
+    RepetitionLayout layout;
+    std::vector<std::pair<size_t, EncodedBlockPtr>> cache;   // mais recente no fim
+};
+
+struct StreamBenchmarkResult {
+    std::string trace;
+    size_t actions;
+    size_t structBytes;     // vector<Action> em memória
+    size_t jsonBytes;       // JSON compacto equivalente ao salvo pelo app
+    size_t encodedBytes;
+    double encodeMActionsPerSec;
+    double decodeMActionsPerSec;
+    double compileMActionsPerSec;   // fluxo -> programa da VM, sem materializar as ações
+};
+
+struct SeekBenchmarkResult {
+    size_t actions;
+    size_t fileBytes;
+    double openUs;          // abrir o arquivo (cabeçalho + índice)
+    double seekUs;          // média de tempo -> ação + leitura de 50 ações
+};
+
+// Grava um rastro de 'actions' ações em 'path' e mede abertura e busca aleatória
+SeekBenchmarkResult BenchmarkStreamSeek(size_t actions, const std::string& path);
+
+// Rastro sintético com o formato de gravações reais: 0 = movimento contínuo do
+// mouse com cliques esparsos, 1 = digitação com tempos de pressão, 2 = misto
+std::vector<Action> SyntheticActionTrace(int shape, size_t count, std::uint32_t seed);
+
+std::vector<StreamBenchmarkResult> BenchmarkActionStream(size_t actionsPerTrace);
+
+#endif // ACTIONSTREAM_H
@@ -0,0 +1,322 @@
+#include "actiontable.h"
+#include "actionstream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+namespace {
+
+// Prioridades da treap: splitmix64 de um contador (distribuição uniforme,
+// sem estado por thread)
+std::uint32_t NextPriority() {
+    static std::atomic<std::uint64_t> counter{0x9E3779B97F4A7C15ull};
+    std::uint64_t z = counter.fetch_add(0x9E3779B97F4A7C15ull, std::memory_order_relaxed);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<std::uint32_t>((z ^ (z >> 31)) >> 32);
+}
+
+} // namespace
+
+// =============================================
+// NÓS (IMUTÁVEIS)
+// =============================================
+
+ActionTable::NodePtr ActionTable::MakeNode(NodePtr left, NodePtr right, BlockPtr block, std::uint32_t offset,
+                                           std::uint32_t length, std::uint32_t priority) {
+    auto node = std::make_shared<Node>();
+    node->total = length + (left ? left->total : 0) + (right ? right->total : 0);
+    node->pieces = 1 + (left ? left->pieces : 0) + (right ? right->pieces : 0);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    node->block = std::move(block);
+    node->offset = offset;
+    node->length = length;
+    node->priority = priority;
+    return node;
+}
+
+ActionTable::NodePtr ActionTable::Leaf(BlockPtr block, std::uint32_t offset, std::uint32_t length) {
+    return MakeNode(nullptr, nullptr, std::move(block), offset, length, NextPriority());
+}
+
+ActionTable::NodePtr ActionTable::WithChildren(const Node& node, NodePtr left, NodePtr right) {
+    return MakeNode(std::move(left), std::move(right), node.block, node.offset, node.length, node.priority);
+}
+
+void ActionTable::Split(NodePtr node, size_t count, NodePtr& left, NodePtr& right) {
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    const size_t leftTotal = node->left ? node->left->total : 0;
+    if (count <= leftTotal) {
+        NodePtr middle;
+        Split(node->left, count, left, middle);
+        right = WithChildren(*node, middle, node->right);
+    } else if (count >= leftTotal + node->length) {
+        NodePtr middle;
+        Split(node->right, count - leftTotal - node->length, middle, right);
+        left = WithChildren(*node, node->left, middle);
+    } else {
+        // Corte no meio do trecho: as duas metades apontam para o mesmo bloco
+        // e herdam a prioridade do nó (a propriedade de heap continua valendo)
+        const std::uint32_t cut = static_cast<std::uint32_t>(count - leftTotal);
+        left = MakeNode(node->left, nullptr, node->block, node->offset, cut, node->priority);
+        right = MakeNode(nullptr, node->right, node->block, node->offset + cut, node->length - cut, node->priority);
+    }
+}
+
+ActionTable::NodePtr ActionTable::Merge(const NodePtr& left, const NodePtr& right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority) {
+        return WithChildren(*left, left->left, Merge(left->right, right));
+    }
+    return WithChildren(*right, Merge(left, right->left), right->right);
+}
+
+ActionTable::NodePtr ActionTable::FromVector(std::vector<Action> actions) {
+    if (actions.size() <= kBlockActions) {
+        if (actions.empty()) return nullptr;
+        const auto length = static_cast<std::uint32_t>(actions.size());
+        return Leaf(std::make_shared<const std::vector<Action>>(std::move(actions)), 0, length);
+    }
+    NodePtr node;
+    for (size_t first = 0; first < actions.size(); first += kBlockActions) {
+        const size_t end = std::min(actions.size(), first + kBlockActions);
+        auto block = std::make_shared<const std::vector<Action>>(
+            std::make_move_iterator(actions.begin() + first), std::make_move_iterator(actions.begin() + end));
+        node = Merge(node, Leaf(std::move(block), 0, static_cast<std::uint32_t>(end - first)));
+    }
+    return node;
+}
+
+void ActionTable::Visit(const NodePtr& node, size_t first, size_t count,
+                        const std::function<void(const Action&)>& visit) {
+    if (!node || count == 0) return;
+    const size_t leftTotal = node->left ? node->left->total : 0;
+    const size_t pieceEnd = leftTotal + node->length;
+    const size_t end = first + count;
+    if (first < leftTotal) {
+        Visit(node->left, first, std::min(end, leftTotal) - first, visit);
+    }
+    const size_t from = std::max(first, leftTotal);
+    const size_t to = std::min(end, pieceEnd);
+    const Action* actions = node->block->data() + node->offset;
+    for (size_t i = from; i < to; ++i) {
+        visit(actions[i - leftTotal]);
+    }
+    if (end > pieceEnd) {
+        const size_t rightFirst = std::max(first, pieceEnd);
+        Visit(node->right, rightFirst - pieceEnd, end - rightFirst, visit);
+    }
+}
+
+// =============================================
+// TABELA
+// =============================================
+
+ActionTable::ActionTable(std::vector<Action> actions)
+    : root(FromVector(std::move(actions))) {}
+
+const Action& ActionTable::operator[](size_t index) const {
+    const Node* node = root.get();
+    if (!node || index >= node->total) {
+        return tail[index - (node ? node->total : 0)];
+    }
+    for (;;) {
+        const size_t leftTotal = node->left ? node->left->total : 0;
+        if (index < leftTotal) {
+            node = node->left.get();
+        } else if (index < leftTotal + node->length) {
+            return (*node->block)[node->offset + index - leftTotal];
+        } else {
+            index -= leftTotal + node->length;
+            node = node->right.get();
+        }
+    }
+}
+
+void ActionTable::push_back(const Action& action) {
+    if (tail.empty()) tail.reserve(kBlockActions);
+    tail.push_back(action);
+    if (tail.size() >= kBlockActions) FlushTail();
+}
+
+void ActionTable::clear() {
+    root = nullptr;
+    tail.clear();
+}
+
+void ActionTable::FlushTail() {
+    if (tail.empty()) return;
+    root = Merge(root, FromVector(std::move(tail)));
+    tail = std::vector<Action>();
+}
+
+void ActionTable::Insert(size_t position, const ActionTable& items) {
+    if (items.empty()) return;
+    FlushTail();
+    NodePtr inserted = items.root;
+    if (!items.tail.empty()) inserted = Merge(inserted, FromVector(items.tail));
+    NodePtr left, right;
+    Split(root, std::min(position, size()), left, right);
+    root = Merge(Merge(left, inserted), right);
+}
+
+void ActionTable::Insert(size_t position, std::vector<Action> items) {
+    if (items.empty()) return;
+    FlushTail();
+    NodePtr left, right;
+    Split(root, std::min(position, size()), left, right);
+    root = Merge(Merge(left, FromVector(std::move(items))), right);
+}
+
+void ActionTable::Remove(size_t first, size_t count) {
+    if (first >= size() || count == 0) return;
+    FlushTail();
+    NodePtr left, middle, right;
+    Split(root, first, left, middle);
+    Split(middle, count, middle, right);
+    root = Merge(left, right);
+}
+
+void ActionTable::Set(size_t index, const Action& action) {
+    if (index >= size()) return;
+    const size_t treeTotal = root ? root->total : 0;
+    if (index >= treeTotal) {
+        tail[index - treeTotal] = action;
+        return;
+    }
+    Remove(index, 1);
+    Insert(index, std::vector<Action>{action});
+}
+
+ActionTable ActionTable::Slice(size_t first, size_t count) const {
+    ActionTable slice;
+    const size_t total = size();
+    if (first >= total || count == 0) return slice;
+    count = std::min(count, total - first);
+
+    const size_t treeTotal = root ? root->total : 0;
+    if (first < treeTotal) {
+        NodePtr left, middle, right;
+        Split(root, first, left, middle);
+        Split(middle, std::min(count, treeTotal - first), middle, right);
+        slice.root = middle;
+    }
+    // Parte que cai no bloco aberto: copiada (no máximo kBlockActions)
+    if (first + count > treeTotal) {
+        const size_t tailFirst = first > treeTotal ? first - treeTotal : 0;
+        slice.tail.assign(tail.begin() + tailFirst, tail.begin() + (first + count - treeTotal));
+    }
+    return slice;
+}
+
+void ActionTable::ForEach(const std::function<void(const Action&)>& visit) const {
+    ForEachIn(0, size(), visit);
+}
+
+void ActionTable::ForEachIn(size_t first, size_t count, const std::function<void(const Action&)>& visit) const {
+    const size_t treeTotal = root ? root->total : 0;
+    const size_t end = std::min(size(), first + count);
+    if (first < treeTotal) {
+        Visit(root, first, std::min(end, treeTotal) - first, visit);
+    }
+    for (size_t i = std::max(first, treeTotal); i < end; ++i) {
+        visit(tail[i - treeTotal]);
+    }
+}
+
+std::vector<Action> ActionTable::ToVector() const {
+    std::vector<Action> actions;
+    actions.reserve(size());
+    ForEach([&actions](const Action& action) { actions.push_back(action); });
+    return actions;
+}
+
+size_t ActionTable::OwnBytes() const {
+    // Nó + bloco de controle do make_shared
+    return PieceCount() * (sizeof(Node) + 2 * sizeof(void*)) + tail.capacity() * sizeof(Action);
+}
+
+void ActionTable::Compact() {
+    root = FromVector(ToVector());
+    tail.clear();
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+TableBenchmarkResult BenchmarkActionTable(size_t actions, size_t edits) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::vector<Action> vec = SyntheticActionTrace(2, actions, 13);
+    ActionTable table(vec);
+    TableBenchmarkResult r = {vec.size(), edits, 0, 0, 0, 0, 0, 0, 0};
+
+    // A mesma sequência de edições nas duas estruturas
+    struct Edit { int kind; size_t position; };
+    std::vector<Edit> plan;
+    plan.reserve(edits);
+    std::mt19937_64 rng(17);
+    size_t length = vec.size();
+    for (size_t i = 0; i < edits; ++i) {
+        int kind = static_cast<int>(rng() % 3);
+        if (length == 0) kind = 0;
+        size_t position = length ? rng() % length : 0;
+        plan.push_back({kind, position});
+        if (kind == 0) ++length;
+        if (kind == 1) --length;
+    }
+    Action inserted = vec.empty() ? Action() : vec.front();
+
+    auto start = Clock::now();
+    for (const Edit& edit : plan) {
+        if (edit.kind == 0) vec.insert(vec.begin() + edit.position, inserted);
+        else if (edit.kind == 1) vec.erase(vec.begin() + edit.position);
+        else vec[edit.position].delay += 0.001;
+    }
+    r.vectorMs = elapsedMs(start);
+
+    start = Clock::now();
+    for (const Edit& edit : plan) {
+        if (edit.kind == 0) {
+            table.Insert(edit.position, std::vector<Action>{inserted});
+        } else if (edit.kind == 1) {
+            table.Remove(edit.position, 1);
+        } else {
+            Action changed = table[edit.position];
+            changed.delay += 0.001;
+            table.Set(edit.position, changed);
+        }
+    }
+    r.tableMs = elapsedMs(start);
+    r.pieces = table.PieceCount();
+
+    // Acesso por índice aleatório
+    const int lookups = 200000;
+    double sink = 0;
+    start = Clock::now();
+    for (int i = 0; i < lookups; ++i) sink += vec[rng() % vec.size()].delay;
+    r.vectorIndexNs = elapsedMs(start) * 1e6 / lookups;
+    start = Clock::now();
+    for (int i = 0; i < lookups; ++i) sink += table[rng() % table.size()].delay;
+    r.tableIndexNs = elapsedMs(start) * 1e6 / lookups;
+
+    start = Clock::now();
+    ActionTable snapshot = table;
+    r.snapshotUs = elapsedMs(start) * 1000.0;
+
+    start = Clock::now();
+    snapshot.ForEach([&sink](const Action& action) { sink += action.x; });
+    r.iterateMs = elapsedMs(start);
+    if (sink == -1) r.pieces = 0;   // mantém 'sink' vivo
+    return r;
+}
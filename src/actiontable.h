@@ -0,0 +1,108 @@
+#ifndef ACTIONTABLE_H
+#define ACTIONTABLE_H
+
+#include "action.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Lista de ações editável para gravações grandes (piece table).
+//
+// As ações ficam em blocos imutáveis; a lista é uma árvore (treap implícita)
+// de trechos [offset, offset + length) desses blocos. Inserir, remover e
+// acessar por índice custam O(log n) e nunca deslocam as ações seguintes.
+// Os nós também são imutáveis (cada edição copia só o caminho até a raiz),
+// então copiar uma ActionTable é O(1): a cópia é um instantâneo que pode ser
+// percorrido em outra thread (gravação em disco, reprodução) enquanto a
+// original continua sendo editada.
+//
+// push_back acumula as ações num bloco aberto que entra na árvore a cada
+// kBlockActions, para a gravação não pagar O(log n) por evento.
+class ActionTable {
+public:
+    static constexpr size_t kBlockActions = 4096;
+
+    ActionTable() = default;
+    explicit ActionTable(std::vector<Action> actions);
+
+    size_t size() const { return (root ? root->total : 0) + tail.size(); }
+    bool empty() const { return size() == 0; }
+    // O(log n); a referência vale enquanto esta tabela (ou uma cópia) existir
+    // e a ação não for editada
+    const Action& operator[](size_t index) const;
+
+    void push_back(const Action& action);
+    void clear();
+
+    void Insert(size_t position, const ActionTable& items);
+    void Insert(size_t position, std::vector<Action> items);
+    void Remove(size_t first, size_t count);
+    void Set(size_t index, const Action& action);
+    // Trecho [first, first + count) como outra tabela (compartilha os blocos)
+    ActionTable Slice(size_t first, size_t count) const;
+
+    void ForEach(const std::function<void(const Action&)>& visit) const;
+    // Só as ações de [first, first + count), sem descer nos trechos anteriores
+    void ForEachIn(size_t first, size_t count, const std::function<void(const Action&)>& visit) const;
+    std::vector<Action> ToVector() const;
+
+    // Número de trechos na árvore: cresce com edições espalhadas
+    size_t PieceCount() const { return root ? root->pieces : 0; }
+    // Memória dos nós e do bloco aberto (os blocos são compartilhados e não entram)
+    size_t OwnBytes() const;
+    // Regrava tudo em blocos cheios (O(n)); útil depois de muitas edições pequenas
+    void Compact();
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    using BlockPtr = std::shared_ptr<const std::vector<Action>>;
+
+    struct Node {
+        NodePtr left;
+        NodePtr right;
+        BlockPtr block;
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t priority;
+        size_t total;       // ações na subárvore
+        size_t pieces;      // trechos na subárvore
+    };
+
+    static NodePtr MakeNode(NodePtr left, NodePtr right, BlockPtr block, std::uint32_t offset,
+                            std::uint32_t length, std::uint32_t priority);
+    static NodePtr Leaf(BlockPtr block, std::uint32_t offset, std::uint32_t length);
+    static NodePtr WithChildren(const Node& node, NodePtr left, NodePtr right);
+    // Primeiras 'count' ações em 'left', o resto em 'right' ('node' por valor: pode ser
+    // a mesma variável de uma das saídas)
+    static void Split(NodePtr node, size_t count, NodePtr& left, NodePtr& right);
+    static NodePtr Merge(const NodePtr& left, const NodePtr& right);
+    static NodePtr FromVector(std::vector<Action> actions);
+    static void Visit(const NodePtr& node, size_t first, size_t count,
+                      const std::function<void(const Action&)>& visit);
+
+    void FlushTail();
+
+    NodePtr root;
+    std::vector<Action> tail;       // bloco aberto do push_back (fora da árvore)
+};
+
+struct TableBenchmarkResult {
+    size_t actions;
+    size_t edits;
+    double vectorMs;        // mesmas edições em std::vector<Action>
+    double tableMs;
+    double vectorIndexNs;   // acesso por índice aleatório
+    double tableIndexNs;
+    double snapshotUs;      // copiar a tabela (instantâneo)
+    double iterateMs;       // percorrer a tabela inteira
+    size_t pieces;          // trechos depois das edições
+};
+
+// Edições aleatórias (inserções, remoções e trocas de uma ação) numa macro
+// de 'actions' ações
+TableBenchmarkResult BenchmarkActionTable(size_t actions, size_t edits);
+
+#endif // ACTIONTABLE_H
@@ -0,0 +1,361 @@
+#include "controlserver.h"
+#include "actionstream.h"
+#include "macrosaver.h"
+#include "metrics.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+bool LoadMacroProgram(const QString& fileName, MacroProgram& out, std::string& error) {
+    ScopedMetricTimer loadTimer(AppMetrics::Get().loadDuration);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = "Não foi possível abrir o arquivo.";
+        return false;
+    }
+
+    if (fileName.endsWith(".mscript", Qt::CaseInsensitive)) {
+        if (!MacroCompiler::FromScript(file.readAll().toStdString(), out, error)) {
+            error = "Script inválido:\n" + error;
+            return false;
+        }
+    } else if (fileName.endsWith(".mstream", Qt::CaseInsensitive)) {
+        // Compilado direto dos blocos, sem materializar o vetor de ações
+        QByteArray data = file.readAll();
+        ActionStream stream;
+        if (!ActionStream::Deserialize(reinterpret_cast<const std::uint8_t*>(data.constData()), data.size(), stream, error)) {
+            error = "Arquivo de macro inválido:\n" + error;
+            return false;
+        }
+        out = MacroCompiler::FromStream(stream, 1, 0);
+    } else {
+        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        if (doc.isNull()) {
+            error = "Arquivo JSON inválido.";
+            return false;
+        }
+        out = MacroCompiler::FromActions(ActionsFromJson(doc.array()), 1, 0);
+    }
+    return true;
+}
+
+namespace {
+
+const char* EventName(MacroScheduler::RunEvent event) {
+    switch (event) {
+        case MacroScheduler::RunEvent::Started: return "started";
+        case MacroScheduler::RunEvent::Finished: return "finished";
+        case MacroScheduler::RunEvent::Stopped: return "stopped";
+        case MacroScheduler::RunEvent::Failed: return "failed";
+        case MacroScheduler::RunEvent::Skipped: return "skipped";
+    }
+    return "?";
+}
+
+// Contadores de 64 bits: micros cabem num double; a semente vai como texto
+void AddStatus(QJsonObject& object, const MacroScheduler::RunStatus& status) {
+    object["running"] = status.running;
+    object["queued"] = status.queued;
+    object["runs"] = static_cast<double>(status.runs);
+    object["repetition"] = static_cast<double>(status.repetition);
+    object["elapsed_us"] = static_cast<double>(status.elapsedMicros);
+    object["seed"] = QString::number(status.seed);
+}
+
+QJsonObject Failure(const QString& message) {
+    QJsonObject reply;
+    reply["ok"] = false;
+    reply["error"] = message;
+    return reply;
+}
+
+} // namespace
+
+ControlServer::ControlServer(MacroScheduler& scheduler)
+    : scheduler(scheduler) {
+    thread.setObjectName("ControlServer");
+    context = new QObject();
+    context->moveToThread(&thread);
+    thread.start();
+}
+
+ControlServer::~ControlServer() {
+    QMetaObject::invokeMethod(context, [this]() {
+        // Sem os sinais, fechar os sockets não volta para Accept/Read
+        for (auto& entry : clients) QObject::disconnect(entry.first, nullptr, context, nullptr);
+        for (auto& entry : clients) delete entry.first;
+        clients.clear();
+        delete server;
+        server = nullptr;
+    }, Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+    delete context;
+}
+
+bool ControlServer::Start(const QString& name, QString& error) {
+    bool ok = false;
+    QMetaObject::invokeMethod(context, [&]() {
+        server = new QLocalServer(context);
+        // Só o usuário atual: quem conecta controla o teclado e o mouse
+        server->setSocketOptions(QLocalServer::UserAccessOption);
+        QObject::connect(server, &QLocalServer::newConnection, context, [this]() { Accept(); });
+        ok = server->listen(name);
+        if (!ok && server->serverError() == QAbstractSocket::AddressInUseError) {
+            // Socket Unix deixado por uma execução que caiu: só remove se ninguém responde
+            QLocalSocket probe;
+            probe.connectToServer(name);
+            if (!probe.waitForConnected(200)) {
+                QLocalServer::removeServer(name);
+                ok = server->listen(name);
+            }
+        }
+        if (ok) {
+            fullServerName = server->fullServerName();
+        } else {
+            error = server->errorString();
+            delete server;
+            server = nullptr;
+        }
+    }, Qt::BlockingQueuedConnection);
+    return ok;
+}
+
+void ControlServer::Publish(MacroScheduler::MacroId id, MacroScheduler::RunEvent event, const std::string& detail) {
+    // Andamento lido aqui: ao fim, é a duração da execução que terminou
+    QJsonObject message;
+    message["event"] = EventName(event);
+    message["macro"] = id;
+    message["detail"] = QString::fromStdString(detail);
+    AddStatus(message, scheduler.Status(id));
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    QMetaObject::invokeMethod(context, [this, line]() {
+        std::vector<QLocalSocket*> stalled;
+        for (auto& entry : clients) {
+            if (!entry.second.subscribed) continue;
+            QLocalSocket* socket = entry.first;
+            if (socket->bytesToWrite() > kMaxPendingBytes) {
+                stalled.push_back(socket);
+                continue;
+            }
+            socket->write(line);
+        }
+        // Fora do laço: a desconexão tira o cliente do mapa
+        for (QLocalSocket* socket : stalled) {
+            qDebug() << "Controle: cliente não lê os eventos, desconectado";
+            socket->abort();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void ControlServer::Accept() {
+    while (QLocalSocket* socket = server->nextPendingConnection()) {
+        clients.emplace(socket, Client());
+        QObject::connect(socket, &QLocalSocket::readyRead, context, [this, socket]() { Read(socket); });
+        QObject::connect(socket, &QLocalSocket::disconnected, context, [this, socket]() {
+            clients.erase(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void ControlServer::Read(QLocalSocket* socket) {
+    auto it = clients.find(socket);
+    if (it == clients.end()) return;
+
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) continue;
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        if (!doc.isObject()) {
+            Send(socket, Failure(doc.isNull() ? "JSON inválido: " + parseError.errorString()
+                                              : QString("esperado um objeto JSON")));
+            continue;
+        }
+        const QJsonObject request = doc.object();
+        QJsonObject reply = Handle(request, it->second);
+        if (request.contains("id")) reply["id"] = request.value("id");
+        Send(socket, reply);
+    }
+    // Sem quebra de linha à vista: protocolo errado, não um pedido grande
+    if (socket->bytesAvailable() > kMaxLineBytes) {
+        Send(socket, Failure("linha maior que o limite"));
+        socket->disconnectFromServer();
+    }
+}
+
+QJsonObject ControlServer::Handle(const QJsonObject& request, Client& client) {
+    const QString command = request.value("cmd").toString();
+    const MacroScheduler::MacroId id = request.value("macro").toInt();
+    QJsonObject reply;
+    reply["ok"] = true;
+
+    if (command == "ping") {
+        reply["server"] = fullServerName;
+    } else if (command == "load") {
+        const QString path = request.value("path").toString();
+        if (path.isEmpty()) return Failure("'path' obrigatório");
+        MacroProgram program;
+        std::string error;
+        if (!LoadMacroProgram(path, program, error)) return Failure(QString::fromStdString(error));
+        MacroOptions options;
+        if (!ParseMacroOptions(request.value("options").toString().toStdString(), options, error)) {
+            return Failure("opções inválidas: " + QString::fromStdString(error));
+        }
+        options.name = request.contains("name") ? request.value("name").toString().toStdString()
+                                                : QFileInfo(path).fileName().toStdString();
+        reply["instructions"] = static_cast<double>(program.size());
+        if (request.contains("replace")) {
+            const MacroScheduler::MacroId target = request.value("replace").toInt();
+            if (!scheduler.Status(target).exists) return Failure("macro inexistente");
+            scheduler.Replace(target, std::move(program), options);
+            reply["macro"] = target;
+        } else {
+            reply["macro"] = scheduler.Add(std::move(program), options);
+        }
+    } else if (command == "start") {
+        if (!scheduler.Status(id).exists) return Failure("macro inexistente");
+        const int delay = std::max(0, request.value("delay_ms").toInt());
+        if (!scheduler.Start(id, std::chrono::milliseconds(delay))) return Failure("macro já em execução");
+    } else if (command == "stop") {
+        if (request.contains("macro")) {
+            scheduler.Stop(id);
+        } else {
+            scheduler.StopAll();
+        }
+    } else if (command == "remove") {
+        if (!scheduler.Status(id).exists) return Failure("macro inexistente");
+        scheduler.Remove(id);
+    } else if (command == "status") {
+        const MacroScheduler::RunStatus status = scheduler.Status(id);
+        if (!status.exists) return Failure("macro inexistente");
+        reply["macro"] = id;
+        AddStatus(reply, status);
+        reply["queue_depth"] = static_cast<double>(scheduler.QueueDepth());
+    } else if (command == "list") {
+        QJsonArray list;
+        for (const auto& entry : scheduler.List()) {
+            QJsonObject macro;
+            macro["macro"] = entry.first;
+            macro["name"] = QString::fromStdString(entry.second.name);
+            macro["priority"] = entry.second.priority;
+            macro["running"] = scheduler.IsRunning(entry.first);
+            list.append(macro);
+        }
+        reply["macros"] = list;
+    } else if (command == "subscribe") {
+        client.subscribed = request.value("events").toBool(true);
+    } else if (command == "metrics") {
+        reply["text"] = QString::fromStdString(MetricsRegistry::Global().Exposition());
+    } else {
+        return Failure(QString("comando desconhecido: '%1'").arg(command));
+    }
+    return reply;
+}
+
+void ControlServer::Send(QLocalSocket* socket, const QJsonObject& message) {
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    socket->write(line);
+}
+
+// =============================================
+// BENCHMARK DO CONTROLE EXTERNO
+// =============================================
+
+namespace {
+
+class DiscardSink : public MacroSink {
+public:
+    void OnKey(std::uint16_t, bool) override {}
+    void OnMouseClick(int, bool, int, int, int) override {}
+    void OnMouseMove(int, int, int) override {}
+    void OnMouseWheel(int, int, int) override {}
+    void OnText(const std::string&) override {}
+};
+
+} // namespace
+
+ControlBenchmarkResult BenchmarkControlServer(size_t requests) {
+    using Clock = std::chrono::steady_clock;
+    ControlBenchmarkResult result = {requests, 0, 0, 0, 0};
+    if (requests == 0) return result;
+
+    TimerWheel wheel;
+    DiscardSink sink;
+    auto scheduler = std::make_unique<MacroScheduler>(wheel, sink);
+    const MacroScheduler::MacroId id = scheduler->Add(MacroCompiler::FromActions({}, 1, 0), MacroOptions());
+    {
+        ControlServer server(*scheduler);
+        QString error;
+        const QString name = QString("MacroApp-benchmark-%1").arg(QCoreApplication::applicationPid());
+        QLocalSocket socket;
+        if (server.Start(name, error)) {
+            socket.connectToServer(name);
+        }
+        if (socket.waitForConnected(2000)) {
+            auto readLine = [&socket]() {
+                while (!socket.canReadLine()) {
+                    if (!socket.waitForReadyRead(2000)) return false;
+                }
+                socket.readLine();
+                return true;
+            };
+            QJsonObject status;
+            status["cmd"] = "status";
+            status["macro"] = id;
+            const QByteArray request = QJsonDocument(status).toJson(QJsonDocument::Compact) + '\n';
+
+            // Um pedido por vez: latência de ida e volta
+            std::vector<double> samples;
+            samples.reserve(requests);
+            bool ok = true;
+            for (size_t i = 0; i < requests && ok; ++i) {
+                auto start = Clock::now();
+                socket.write(request);
+                socket.flush();
+                ok = readLine();
+                samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            }
+            std::sort(samples.begin(), samples.end());
+            double sum = 0;
+            for (double sample : samples) sum += sample;
+            result.roundTripMeanUs = sum / samples.size();
+            result.roundTripP99Us = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+
+            // Todos de uma vez: vazão do servidor
+            auto start = Clock::now();
+            socket.write(request.repeated(static_cast<int>(requests)));
+            socket.flush();
+            for (size_t i = 0; i < requests && ok; ++i) ok = readLine();
+            if (ok) result.pipelinedPerSec = requests / std::chrono::duration<double>(Clock::now() - start).count();
+
+            // Eventos publicados por outra thread até chegarem ao cliente
+            socket.write("{\"cmd\":\"subscribe\"}\n");
+            socket.flush();
+            ok = ok && readLine();
+            start = Clock::now();
+            for (size_t i = 0; i < requests; ++i) server.Publish(id, MacroScheduler::RunEvent::Finished, "");
+            for (size_t i = 0; i < requests && ok; ++i) ok = readLine();
+            if (ok) result.eventsPerSec = requests / std::chrono::duration<double>(Clock::now() - start).count();
+            socket.disconnectFromServer();
+        } else {
+            qDebug() << "Benchmark do controle: servidor indisponível" << error;
+        }
+    }
+    wheel.Shutdown();
+    scheduler.reset();
+    return result;
+}
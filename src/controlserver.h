@@ -0,0 +1,87 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include "macroscheduler.h"
+#include "macrovm.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QThread>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+class QLocalServer;
+class QLocalSocket;
+
+// Programa de um arquivo .json, .mstream ou .mscript (pelo nome). Usado pelo
+// botão Agendar e pelo comando "load" do controle externo; roda em qualquer thread.
+bool LoadMacroProgram(const QString& fileName, MacroProgram& out, std::string& error);
+
+// Controle local da reprodução para outros processos (scripts de orquestração):
+// QLocalServer, ou seja, pipe nomeado no Windows e socket Unix no Linux, só
+// para o usuário atual. Protocolo: um objeto JSON por linha nos dois sentidos.
+//
+//   {"cmd":"load","path":"C:/m/login.mstream","options":"prio=5 rate=2"}  -> {"ok":true,"macro":3,"instructions":812}
+//   {"cmd":"start","macro":3,"delay_ms":0}   {"cmd":"stop","macro":3}   {"cmd":"stop"} (todas)
+//   {"cmd":"status","macro":3}   -> {"ok":true,"running":true,"repetition":2,"elapsed_us":5120334,...}
+//   {"cmd":"list"}   {"cmd":"remove","macro":3}   {"cmd":"ping"}
+//   {"cmd":"metrics"}   -> {"ok":true,"text":"# HELP ..."} (exposição do Prometheus)
+//   {"cmd":"subscribe"}   -> a partir daí chegam {"event":"finished","macro":3,"elapsed_us":...,"detail":""}
+//
+// O "id" de um pedido, se houver, volta na resposta. O servidor tem thread e
+// laço de eventos próprios: os pedidos chamam o agendador (thread-safe) direto
+// de lá, sem passar pela thread da interface.
+class ControlServer {
+public:
+    static constexpr const char* kDefaultName = "MacroApp";
+    static constexpr qint64 kMaxLineBytes = 64 * 1024;
+    // Cliente inscrito que não lê os eventos é desconectado, em vez de acumular memória
+    static constexpr qint64 kMaxPendingBytes = 4 * 1024 * 1024;
+
+    explicit ControlServer(MacroScheduler& scheduler);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Começa a escutar em 'name' (espera a thread do servidor confirmar)
+    bool Start(const QString& name, QString& error);
+    // Caminho completo do pipe/socket (vazio antes do Start)
+    QString FullServerName() const { return fullServerName; }
+
+    // Evento do agendador para os clientes inscritos; chamado de qualquer
+    // thread (o callback de estado roda na thread da roda)
+    void Publish(MacroScheduler::MacroId id, MacroScheduler::RunEvent event, const std::string& detail);
+
+private:
+    struct Client {
+        bool subscribed = false;
+    };
+
+    // Na thread do servidor
+    void Accept();
+    void Read(QLocalSocket* socket);
+    QJsonObject Handle(const QJsonObject& request, Client& client);
+    void Send(QLocalSocket* socket, const QJsonObject& message);
+
+    MacroScheduler& scheduler;
+    QThread thread;
+    QObject* context = nullptr;          // vive na thread do servidor
+    QLocalServer* server = nullptr;
+    std::unordered_map<QLocalSocket*, Client> clients;
+    QString fullServerName;
+};
+
+struct ControlBenchmarkResult {
+    size_t requests;
+    double roundTripMeanUs;     // um pedido por vez ("status"), ida e volta
+    double roundTripP99Us;
+    double pipelinedPerSec;     // pedidos enviados de uma vez, respostas por segundo
+    double eventsPerSec;        // eventos entregues a um cliente inscrito
+};
+
+// Cliente e servidor no mesmo processo, sob um nome temporário
+ControlBenchmarkResult BenchmarkControlServer(size_t requests);
+
+#endif // CONTROLSERVER_H
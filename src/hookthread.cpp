@@ -0,0 +1,356 @@
+#include "hookthread.h"
+#include "hookwatchdog.h"
+#include "macroscheduler.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "tracing.h"
+#include <algorithm>
+
+bool CaptureQueue::Push(const CapturedInput& input) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= kCapacity) return false;
+    items[t & (kCapacity - 1)] = input;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool CaptureQueue::Pop(CapturedInput& input) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    input = items[h & (kCapacity - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+size_t CaptureQueue::Size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+#ifdef _WIN32
+
+namespace {
+
+// Os callbacks não têm contexto: cada thread de hooks se registra aqui
+thread_local HookThread* currentThread = nullptr;
+
+// Pedido da interface (HookThread::Call) à espera na thread dos hooks
+const UINT kRequestMessage = WM_APP + 1;
+
+std::int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint8_t KeyModifiers() {
+    std::uint8_t modifiers = 0;
+    if (GetAsyncKeyState(VK_CONTROL) & 0x8000) modifiers |= CapturedInput::kCtrl;
+    if (GetAsyncKeyState(VK_SHIFT) & 0x8000) modifiers |= CapturedInput::kShift;
+    if (GetAsyncKeyState(VK_MENU) & 0x8000) modifiers |= CapturedInput::kAlt;
+    if ((GetAsyncKeyState(VK_LWIN) | GetAsyncKeyState(VK_RWIN)) & 0x8000) modifiers |= CapturedInput::kWin;
+    return modifiers;
+}
+
+// Tempo do callback (até o retorno do CallNextHookEx) para as métricas e para
+// o vigia dos hooks de gravação
+class HookCallbackTimer {
+public:
+    HookCallbackTimer(HookWatchdog* watchdog, DWORD eventTick)
+        : watchdog(watchdog), eventTick(eventTick), start(std::chrono::steady_clock::now()) {}
+    ~HookCallbackTimer() {
+        const std::int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        AppMetrics::Get().hookDuration.Record(micros);
+        if (watchdog) watchdog->OnCallback(eventTick, micros);
+    }
+
+private:
+    HookWatchdog* watchdog;
+    DWORD eventTick;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace
+
+HookThread::HookThread(HookWatchdog* watchdog, WakeCallback onWake, HotkeyHandler onHotkey)
+    : watchdog(watchdog), onWake(std::move(onWake)), onHotkey(std::move(onHotkey)) {
+}
+
+HookThread::~HookThread() {
+    if (!thread.joinable()) return;
+    PostThreadMessage(threadId, WM_QUIT, 0, 0);
+    thread.join();
+}
+
+bool HookThread::Start() {
+    thread = std::thread(&HookThread::ThreadMain, this);
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return started; });
+    return shortcutHook != nullptr;
+}
+
+void HookThread::ThreadMain() {
+    currentThread = this;
+    // Acima da interface e do motor: a entrada do sistema inteiro espera por estes callbacks
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    TraceRecorder::Global().SetThreadName("hooks");
+
+    // A fila de mensagens só existe depois da primeira chamada que a usa
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+    shortcutHook = SetWindowsHookEx(WH_KEYBOARD_LL, ShortcutHookProc, GetModuleHandle(NULL), 0);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadId = GetCurrentThreadId();
+        started = true;
+    }
+    cv.notify_all();
+
+    // Os callbacks dos hooks rodam dentro do GetMessage; o resto é pedido da interface
+    while (GetMessage(&msg, NULL, 0, 0) > 0) {
+        if (msg.hwnd != NULL || msg.message != kRequestMessage) continue;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!request) continue;
+        requestResult = (*request)();
+        request = nullptr;
+        requestDone = true;
+        cv.notify_all();
+    }
+
+    RemoveRecordingHooks();
+    if (probeHook) UnhookWindowsHookEx(probeHook);
+    if (shortcutHook) UnhookWindowsHookEx(shortcutHook);
+    probeHook = shortcutHook = nullptr;
+    currentThread = nullptr;
+}
+
+bool HookThread::Call(const std::function<bool()>& call) {
+    std::lock_guard<std::mutex> serial(callMutex);
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!started) return false;
+    request = &call;
+    requestDone = false;
+    if (!PostThreadMessage(threadId, kRequestMessage, 0, 0)) {
+        request = nullptr;
+        return false;
+    }
+    cv.wait(lock, [this] { return requestDone; });
+    return requestResult;
+}
+
+bool HookThread::InstallRecordingHooks() {
+    keyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardHookProc, GetModuleHandle(NULL), 0);
+    mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc, GetModuleHandle(NULL), 0);
+    if (keyboardHook && mouseHook) return true;
+    RemoveRecordingHooks();
+    return false;
+}
+
+void HookThread::RemoveRecordingHooks() {
+    // Um hook removido pelo sistema não precisa de Unhook (falha sem efeito)
+    if (keyboardHook) UnhookWindowsHookEx(keyboardHook);
+    if (mouseHook) UnhookWindowsHookEx(mouseHook);
+    keyboardHook = mouseHook = nullptr;
+}
+
+bool HookThread::StartRecording(bool keyboard, bool mouse) {
+    return Call([this, keyboard, mouse]() {
+        RemoveRecordingHooks();
+        if (!InstallRecordingHooks()) return false;
+        recordingKeyboard.store(keyboard, std::memory_order_relaxed);
+        recordingMouse.store(mouse, std::memory_order_relaxed);
+        recording.store(true, std::memory_order_release);
+        return true;
+    });
+}
+
+void HookThread::StopRecording() {
+    Call([this]() {
+        recording.store(false, std::memory_order_release);
+        RemoveRecordingHooks();
+        return true;
+    });
+}
+
+bool HookThread::Reinstall() {
+    return Call([this]() {
+        // O de atalhos primeiro: o último instalado é chamado antes, e os de
+        // gravação continuam vendo o F10 que encerra a gravação
+        if (shortcutHook) UnhookWindowsHookEx(shortcutHook);
+        shortcutHook = SetWindowsHookEx(WH_KEYBOARD_LL, ShortcutHookProc, GetModuleHandle(NULL), 0);
+        if (!recording.load(std::memory_order_relaxed)) return true;
+        RemoveRecordingHooks();
+        return InstallRecordingHooks();
+    });
+}
+
+size_t HookThread::Drain(const std::function<void(const CapturedInput&)>& handle) {
+    // Antes de ler: o que chegar depois disto acorda o consumidor de novo
+    wakePending.exchange(false, std::memory_order_acq_rel);
+    size_t count = 0;
+    CapturedInput input;
+    while (queue.Pop(input)) {
+        handle(input);
+        ++count;
+    }
+    return count;
+}
+
+void HookThread::Enqueue(const CapturedInput& input) {
+    if (!queue.Push(input)) {
+        // Interface parada há muito tempo: perder o evento, nunca segurar o hook
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        AppMetrics::Get().captureOverflows.Add();
+        return;
+    }
+    if (!wakePending.exchange(true, std::memory_order_acq_rel) && onWake) onWake();
+}
+
+bool HookThread::InstallProbe(std::vector<std::int64_t>* received) {
+    return Call([this, received]() {
+        if (probeHook) return false;
+        probeReceived = received;
+        probeHook = SetWindowsHookEx(WH_MOUSE_LL, ProbeHookProc, GetModuleHandle(NULL), 0);
+        return probeHook != nullptr;
+    });
+}
+
+void HookThread::RemoveProbe() {
+    Call([this]() {
+        if (probeHook) UnhookWindowsHookEx(probeHook);
+        probeHook = nullptr;
+        probeReceived = nullptr;
+        return true;
+    });
+}
+
+// Atalhos globais (F9, F10, F11) e os das macros agendadas; sempre instalado
+LRESULT CALLBACK HookThread::ShortcutHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    ScopedMetricTimer hookTimer(AppMetrics::Get().hookDuration);
+    HookThread* self = currentThread;
+    if (nCode >= 0 && self && (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN)) {
+        KBDLLHOOKSTRUCT* kbStruct = (KBDLLHOOKSTRUCT*)lParam;
+        // F9 grava, F10 para, F11 mostra/oculta: quem decide é a interface
+        if (kbStruct->vkCode == VK_F9 || kbStruct->vkCode == VK_F10 || kbStruct->vkCode == VK_F11) {
+            self->Enqueue({CapturedInput::Kind::Shortcut, 0, (std::uint16_t)kbStruct->vkCode, (std::uint32_t)wParam,
+                           (std::uint32_t)kbStruct->scanCode, 0, 0, 0, std::chrono::steady_clock::now()});
+            return 1;
+        }
+        // Atalhos das macros agendadas (não durante a gravação); o agendador
+        // só marca o disparo, que acontece na thread da roda
+        if (!self->recording.load(std::memory_order_acquire) && self->onHotkey) {
+            std::uint16_t modifiers = 0;
+            if (GetAsyncKeyState(VK_CONTROL) & 0x8000) modifiers |= HOTKEY_CTRL;
+            if (GetAsyncKeyState(VK_SHIFT) & 0x8000) modifiers |= HOTKEY_SHIFT;
+            if (GetAsyncKeyState(VK_MENU) & 0x8000) modifiers |= HOTKEY_ALT;
+            if (self->onHotkey((std::uint16_t)kbStruct->vkCode, modifiers)) return 1;
+        }
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+LRESULT CALLBACK HookThread::KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    HookThread* self = currentThread;
+    HookCallbackTimer hookTimer(self ? self->watchdog : nullptr,
+                                nCode >= 0 ? ((KBDLLHOOKSTRUCT*)lParam)->time : GetTickCount());
+    ScopedTraceSpan span("hook teclado", "gravação");
+    if (nCode >= 0 && self && self->recording.load(std::memory_order_acquire) &&
+        self->recordingKeyboard.load(std::memory_order_relaxed)) {
+        KBDLLHOOKSTRUCT* kbStruct = (KBDLLHOOKSTRUCT*)lParam;
+        // Atraso do hook: do carimbo do sistema (ms) até aqui
+        TelemetryRing::Global().Publish(TelemetryKind::Captured, (std::uint16_t)kbStruct->vkCode, -1,
+                                        (std::int64_t)(GetTickCount() - kbStruct->time) * 1000);
+        AppMetrics::Get().capturedEvents.Add();
+
+        // Ignorar atalhos globais durante gravação
+        const std::uint8_t modifiers = KeyModifiers();
+        if ((modifiers & CapturedInput::kCtrl) && (modifiers & CapturedInput::kAlt) &&
+            (kbStruct->vkCode == 'S' || kbStruct->vkCode == 'P')) {
+            return CallNextHookEx(NULL, nCode, wParam, lParam);
+        }
+
+        self->Enqueue({CapturedInput::Kind::Key, modifiers, (std::uint16_t)kbStruct->vkCode, (std::uint32_t)wParam,
+                       (std::uint32_t)kbStruct->scanCode, 0, 0, 0, std::chrono::steady_clock::now()});
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+LRESULT CALLBACK HookThread::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    HookThread* self = currentThread;
+    HookCallbackTimer hookTimer(self ? self->watchdog : nullptr,
+                                nCode >= 0 ? ((MSLLHOOKSTRUCT*)lParam)->time : GetTickCount());
+    ScopedTraceSpan span("hook mouse", "gravação");
+    if (nCode >= 0 && self && self->recording.load(std::memory_order_acquire) &&
+        self->recordingMouse.load(std::memory_order_relaxed)) {
+        MSLLHOOKSTRUCT* mouseStruct = (MSLLHOOKSTRUCT*)lParam;
+        TelemetryRing::Global().Publish(TelemetryKind::Captured, (std::uint16_t)wParam, -1,
+                                        (std::int64_t)(GetTickCount() - mouseStruct->time) * 1000);
+        AppMetrics::Get().capturedEvents.Add();
+
+        self->Enqueue({CapturedInput::Kind::Mouse, 0, 0, (std::uint32_t)wParam, 0, (std::uint32_t)mouseStruct->mouseData,
+                       (std::int32_t)mouseStruct->pt.x, (std::int32_t)mouseStruct->pt.y, std::chrono::steady_clock::now()});
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+LRESULT CALLBACK HookThread::ProbeHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    HookThread* self = currentThread;
+    if (nCode >= 0 && self && self->probeReceived) {
+        MSLLHOOKSTRUCT* mouseStruct = (MSLLHOOKSTRUCT*)lParam;
+        if ((mouseStruct->flags & LLMHF_INJECTED) && (mouseStruct->dwExtraInfo & ~kProbeIndexMask) == kProbeTag) {
+            const size_t index = mouseStruct->dwExtraInfo & kProbeIndexMask;
+            if (index < self->probeReceived->size()) (*self->probeReceived)[index] = NowMicros();
+            return 1;   // não move o cursor nem chega aos outros hooks
+        }
+    }
+    return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+// =============================================
+// BENCHMARK DA THREAD DOS HOOKS
+// =============================================
+
+HookThreadBenchmarkResult BenchmarkHookThread(HookThread& hooks, size_t events, int intervalMs) {
+    using Clock = std::chrono::steady_clock;
+    events = std::min<size_t>(events, HookThread::kProbeIndexMask + 1);
+    HookThreadBenchmarkResult result = {events, 0, 0, 0, 0, 0};
+    std::vector<std::int64_t> sent(events, 0);
+    std::vector<std::int64_t> received(events, 0);
+    if (events == 0 || !hooks.InstallProbe(&received)) return result;
+
+    std::thread sender([&sent, events, intervalMs]() {
+        for (size_t i = 0; i < events; ++i) {
+            // Movimento relativo nulo: o hook de medição o engole de qualquer jeito
+            INPUT input = {};
+            input.type = INPUT_MOUSE;
+            input.mi.dwFlags = MOUSEEVENTF_MOVE;
+            input.mi.dwExtraInfo = HookThread::kProbeTag | i;
+            sent[i] = NowMicros();
+            SendInput(1, &input, sizeof(INPUT));
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+    });
+    // A thread que chamou (a interface, no benchmark) fica travada enquanto os
+    // eventos chegam: com os hooks nela, nenhum seria atendido antes do fim
+    auto blockStart = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs) * events);
+    sender.join();
+    result.blockedMs = std::chrono::duration<double, std::milli>(Clock::now() - blockStart).count();
+    // Os últimos ainda podem estar a caminho
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    hooks.RemoveProbe();
+
+    std::vector<double> latencies;
+    latencies.reserve(events);
+    for (size_t i = 0; i < events; ++i) {
+        if (received[i] && sent[i]) latencies.push_back(static_cast<double>(received[i] - sent[i]));
+    }
+    result.received = latencies.size();
+    if (latencies.empty()) return result;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50Micros = latencies[latencies.size() / 2];
+    result.p99Micros = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    result.maxMicros = latencies.back();
+    return result;
+}
+
+#endif
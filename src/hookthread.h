@@ -0,0 +1,153 @@
+#ifndef HOOKTHREAD_H
+#define HOOKTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class HookWatchdog;
+
+// Evento como o hook recebeu; a conversão em ação fica para a interface
+struct CapturedInput {
+    enum class Kind : std::uint8_t { Key, Mouse, Shortcut };
+    // Modificadores no instante do evento (só teclado)
+    enum : std::uint8_t { kCtrl = 1 << 0, kShift = 1 << 1, kAlt = 1 << 2, kWin = 1 << 3 };
+
+    Kind kind;
+    std::uint8_t modifiers;
+    std::uint16_t vkCode;           // tecla (Key) ou F9/F10/F11 (Shortcut)
+    std::uint32_t message;          // WM_KEYDOWN, WM_LBUTTONDOWN...
+    std::uint32_t scanCode;
+    std::uint32_t mouseData;        // roda e botões laterais (palavra alta)
+    std::int32_t x;
+    std::int32_t y;
+    std::chrono::steady_clock::time_point captured;
+};
+
+// Fila de um produtor (a thread dos hooks) e um consumidor (a interface), sem
+// lock e de tamanho fixo: cheia, o evento é descartado em vez de segurar o hook
+class CaptureQueue {
+public:
+    static constexpr size_t kCapacity = 1 << 14;
+
+    bool Push(const CapturedInput& input);
+    bool Pop(CapturedInput& input);
+    size_t Size() const;
+
+private:
+    std::unique_ptr<CapturedInput[]> items{new CapturedInput[kCapacity]};
+    alignas(64) std::atomic<size_t> head{0};   // próximo a ler (consumidor)
+    alignas(64) std::atomic<size_t> tail{0};   // próximo a escrever (produtor)
+};
+
+#ifdef _WIN32
+// Hooks de baixo nível numa thread própria, de prioridade alta, com um laço de
+// mensagens mínimo. O sistema entrega cada evento pela fila de mensagens da
+// thread que instalou o hook e segura a entrada de todo o sistema até o
+// callback voltar: na interface, qualquer trabalho dela (lista, pintura,
+// diálogos) atrasava mouse e teclado. Aqui os callbacks só copiam o evento
+// para a fila e voltam; a interface converte quando puder.
+class HookThread {
+public:
+    // Thread dos hooks, quando a fila deixa de estar vazia: acordar o consumidor
+    using WakeCallback = std::function<void()>;
+    // Thread dos hooks, tecla fora da gravação (modificadores HOTKEY_*); true consome a tecla
+    using HotkeyHandler = std::function<bool(std::uint16_t vkCode, std::uint16_t modifiers)>;
+
+    // Marca dos eventos injetados pela medição de latência (dwExtraInfo; a parte baixa é o índice)
+    static constexpr std::uintptr_t kProbeTag = 0x4D500000;
+    static constexpr std::uintptr_t kProbeIndexMask = 0x000FFFFF;
+
+    HookThread(HookWatchdog* watchdog, WakeCallback onWake, HotkeyHandler onHotkey);
+    ~HookThread();
+
+    HookThread(const HookThread&) = delete;
+    HookThread& operator=(const HookThread&) = delete;
+
+    // Cria a thread e instala o hook dos atalhos globais; false se o hook falhou
+    // (a thread continua, para a gravação)
+    bool Start();
+    // Instala os dois hooks de gravação; 'keyboard' e 'mouse' dizem o que entra na fila
+    bool StartRecording(bool keyboard, bool mouse);
+    void StopRecording();
+    // Todos os hooks de novo (vigia); false se os de gravação não voltaram
+    bool Reinstall();
+
+    // Consumidor: tira da fila tudo o que chegou, na ordem
+    size_t Drain(const std::function<void(const CapturedInput&)>& handle);
+    std::uint64_t Overflows() const { return overflows.load(std::memory_order_relaxed); }
+
+    // Medição: um hook de mouse extra, chamado antes dos outros, engole os
+    // eventos marcados com kProbeTag e anota em 'received' o instante (us,
+    // steady_clock) de cada um. Só a thread que chamou lê o vetor, depois de RemoveProbe.
+    bool InstallProbe(std::vector<std::int64_t>* received);
+    void RemoveProbe();
+
+private:
+    static LRESULT CALLBACK ShortcutHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static LRESULT CALLBACK ProbeHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+
+    void ThreadMain();
+    // Executa 'call' na thread dos hooks e espera a resposta
+    bool Call(const std::function<bool()>& call);
+    void Enqueue(const CapturedInput& input);
+    bool InstallRecordingHooks();
+    void RemoveRecordingHooks();
+
+    HookWatchdog* const watchdog;
+    const WakeCallback onWake;
+    const HotkeyHandler onHotkey;
+
+    std::thread thread;
+    std::mutex callMutex;                   // um pedido por vez
+    std::mutex mutex;
+    std::condition_variable cv;
+    DWORD threadId = 0;
+    bool started = false;
+    const std::function<bool()>* request = nullptr;
+    bool requestDone = false;
+    bool requestResult = false;
+
+    // Só a thread dos hooks
+    HHOOK shortcutHook = nullptr;
+    HHOOK keyboardHook = nullptr;
+    HHOOK mouseHook = nullptr;
+    HHOOK probeHook = nullptr;
+    std::vector<std::int64_t>* probeReceived = nullptr;
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> recordingKeyboard{false};
+    std::atomic<bool> recordingMouse{false};
+    CaptureQueue queue;
+    std::atomic<bool> wakePending{false};
+    std::atomic<std::uint64_t> overflows{0};
+};
+
+struct HookThreadBenchmarkResult {
+    size_t sent;
+    size_t received;
+    double blockedMs;       // interface travada de propósito durante o envio
+    double p50Micros;       // do SendInput até o hook
+    double p99Micros;
+    double maxMicros;
+};
+
+// Injeta 'events' movimentos marcados (um a cada 'intervalMs') enquanto a
+// thread que chamou fica travada, e mede quanto cada um levou até o hook
+HookThreadBenchmarkResult BenchmarkHookThread(HookThread& hooks, size_t events, int intervalMs);
+#endif
+
+#endif // HOOKTHREAD_H
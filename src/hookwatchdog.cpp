@@ -0,0 +1,146 @@
+#include "hookwatchdog.h"
+#include <algorithm>
+#include <chrono>
+
+HookWatchdog::HookWatchdog()
+    : config() {
+}
+
+HookWatchdog::HookWatchdog(const Config& config)
+    : config(config) {
+}
+
+void HookWatchdog::OnCallback(std::uint32_t eventTick, std::int64_t durationMicros) {
+    // Os hooks rodam todos na mesma thread: só ela escreve (sem read-modify-write)
+    if (After(eventTick, lastHookTick.load(std::memory_order_relaxed))) {
+        lastHookTick.store(eventTick, std::memory_order_release);
+    }
+    hookEvents.store(hookEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (durationMicros > config.budgetMicros) {
+        slowCallbacks.fetch_add(1, std::memory_order_relaxed);
+        if (durationMicros >= config.timeoutMicros) timedOut.store(true, std::memory_order_release);
+    }
+}
+
+HookWatchdog::Verdict HookWatchdog::Check(std::uint32_t lastInputTick, std::uint32_t nowTick) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!armed) return Verdict::Healthy;
+    const std::uint32_t hookTick = lastHookTick.load(std::memory_order_acquire);
+    const std::uint64_t events = hookEvents.load(std::memory_order_relaxed);
+
+    if (!After(lastInputTick, hookTick + config.skewMs)) {
+        // Os hooks viram tudo o que o sistema recebeu (o que parecia perdido só atrasou)
+        const std::uint32_t window = nowTick - checkedTick;
+        if (events > checkedEvents && window > 0 && window < 10 * config.silenceMs) {
+            const double rate = static_cast<double>(events - checkedEvents) / window;
+            eventsPerMs = eventsPerMs > 0 ? 0.75 * eventsPerMs + 0.25 * rate : rate;
+        }
+        checkedEvents = events;
+        checkedTick = nowTick;
+        unseenInputs = 0;
+        lastCountedInput = lastInputTick;
+        return timedOut.exchange(false, std::memory_order_acq_rel) ? Verdict::TimedOut : Verdict::Healthy;
+    }
+    checkedEvents = events;
+    checkedTick = nowTick;
+    if (After(lastInputTick, lastCountedInput)) {
+        ++unseenInputs;
+        lastCountedInput = lastInputTick;
+    }
+
+    // Entrada contínua sem os hooks por mais que o limite, ou um evento antigo
+    // que nunca chegou
+    const bool silent = lastInputTick - hookTick > config.silenceMs ||
+                        static_cast<std::int32_t>(nowTick - lastInputTick) > static_cast<std::int32_t>(config.silenceMs);
+    const bool timeout = timedOut.exchange(false, std::memory_order_acq_rel);
+    if (!silent && !timeout) return Verdict::Healthy;
+    // Trecho da falha ainda não contado, no ritmo de antes da falha
+    const std::uint32_t from = After(estimatedUntil, hookTick) ? estimatedUntil : hookTick;
+    const std::uint64_t byRate = static_cast<std::uint64_t>(eventsPerMs * static_cast<double>(lastInputTick - from) + 0.5);
+    lostEvents.fetch_add(std::max(unseenInputs, byRate), std::memory_order_relaxed);
+    estimatedUntil = lastInputTick;
+    unseenInputs = 0;
+    return timeout ? Verdict::TimedOut : Verdict::Silent;
+}
+
+std::uint32_t HookWatchdog::OnReinstalled(std::uint32_t nowTick) {
+    std::lock_guard<std::mutex> lock(mutex);
+    reinstalls.fetch_add(1, std::memory_order_relaxed);
+    const std::uint32_t gap = nowTick - lastHookTick.load(std::memory_order_acquire);
+    // O que chegar a partir de agora é responsabilidade dos hooks novos
+    ForgetLocked(nowTick);
+    return gap;
+}
+
+void HookWatchdog::Arm(std::uint32_t nowTick) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ForgetLocked(nowTick);
+    eventsPerMs = 0;
+    armed = true;
+}
+
+void HookWatchdog::Disarm() {
+    std::lock_guard<std::mutex> lock(mutex);
+    armed = false;
+}
+
+void HookWatchdog::ForgetLocked(std::uint32_t nowTick) {
+    lastHookTick.store(nowTick, std::memory_order_release);
+    lastCountedInput = nowTick;
+    estimatedUntil = nowTick;
+    unseenInputs = 0;
+    checkedEvents = hookEvents.load(std::memory_order_relaxed);
+    checkedTick = nowTick;
+    timedOut.store(false, std::memory_order_release);
+}
+
+// =============================================
+// BENCHMARK DO VIGIA DOS HOOKS
+// =============================================
+
+HookWatchdogBenchmarkResult BenchmarkHookWatchdog(size_t callbacks) {
+    using Clock = std::chrono::steady_clock;
+    HookWatchdogBenchmarkResult result = {callbacks, 0, 0, 0, 0, 0};
+    if (callbacks == 0) return result;
+
+    HookWatchdog measured;
+    auto start = Clock::now();
+    for (size_t i = 0; i < callbacks; ++i) measured.OnCallback(static_cast<std::uint32_t>(i), 50);
+    result.callbackNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / callbacks;
+
+    // Linha do tempo simulada (ms): entrada a cada 8 ms; de 1000 a 1250 a thread
+    // dos hooks trava (os eventos chegam atrasados, sem falha); em 3000 os
+    // hooks são removidos. O vigia olha a cada 100 ms.
+    HookWatchdog watchdog;
+    watchdog.Arm(0);
+    const std::uint32_t kStallStart = 1000, kStallEnd = 1250, kRemovedAt = 3000;
+    std::uint32_t lastInput = 0;
+    std::uint32_t stalledFrom = 0;
+    for (std::uint32_t now = 1; now < 10000; ++now) {
+        if (now % 8 == 0) {
+            lastInput = now;
+            if (now >= kRemovedAt) {
+                ++result.lostActual;
+            } else if (now < kStallStart || now >= kStallEnd) {
+                watchdog.OnCallback(now, 100);
+            } else if (!stalledFrom) {
+                stalledFrom = now;
+            }
+        }
+        if (now == kStallEnd) {
+            // A thread volta: os eventos represados chegam com o instante original
+            for (std::uint32_t tick = stalledFrom; tick < kStallEnd; tick += 8) watchdog.OnCallback(tick, 100);
+        }
+        if (now % 100 != 0) continue;
+        const HookWatchdog::Verdict verdict = watchdog.Check(lastInput, now);
+        if (verdict == HookWatchdog::Verdict::Healthy) continue;
+        if (now < kRemovedAt) {
+            ++result.falseAlarms;
+            continue;
+        }
+        result.detectionMs = now - kRemovedAt;
+        result.lostEstimated = watchdog.LostEvents();
+        break;
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+#ifndef HOOKWATCHDOG_H
+#define HOOKWATCHDOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Vigia dos hooks de baixo nível. O Windows remove em silêncio um hook cujo
+// callback passa do LowLevelHooksTimeout (e, antes disso, deixa de chamá-lo
+// enquanto a thread dele está travada): a gravação para de receber eventos
+// sem erro nenhum. O vigia compara o último evento visto pelos hooks com o
+// último evento de entrada do sistema (GetLastInputInfo); entrada nova que os
+// hooks não viram por mais de 'silenceMs' significa hooks mortos. Os instantes
+// são os do GetTickCount (ms, com volta a cada 49 dias).
+class HookWatchdog {
+public:
+    struct Config {
+        std::int64_t budgetMicros = 20000;     // acima disso o callback conta como lento
+        std::int64_t timeoutMicros = 300000;   // LowLevelHooksTimeout: o hook provavelmente foi removido
+        std::uint32_t silenceMs = 500;         // entrada sem eventos nos hooks por mais que isso
+        std::uint32_t skewMs = 50;             // diferença tolerada entre o instante do hook e o do sistema
+    };
+
+    enum class Verdict { Healthy, Silent, TimedOut };
+
+    HookWatchdog();
+    explicit HookWatchdog(const Config& config);
+
+    // Thread dos hooks, a cada callback: instante do evento (campo 'time' da
+    // estrutura do hook) e tempo gasto no callback
+    void OnCallback(std::uint32_t eventTick, std::int64_t durationMicros);
+
+    // Thread do vigia, periodicamente. Em Silent e TimedOut, reinstalar os hooks
+    // e chamar OnReinstalled. Desarmado, sempre Healthy.
+    Verdict Check(std::uint32_t lastInputTick, std::uint32_t nowTick);
+    // Devolve a duração da falha (ms): do último evento visto até agora
+    std::uint32_t OnReinstalled(std::uint32_t nowTick);
+    // Hooks recém-instalados (gravação começando): esquece a entrada anterior
+    void Arm(std::uint32_t nowTick);
+    void Disarm();
+
+    // Eventos de entrada que os hooks não viram, estimados: o sistema só
+    // informa o instante do último evento, então a conta usa o ritmo recente
+    // dos hooks ao longo da falha (e, no mínimo, um por instante novo visto)
+    std::uint64_t LostEvents() const { return lostEvents.load(std::memory_order_relaxed); }
+    std::uint64_t SlowCallbacks() const { return slowCallbacks.load(std::memory_order_relaxed); }
+    std::uint64_t Reinstalls() const { return reinstalls.load(std::memory_order_relaxed); }
+
+private:
+    static bool After(std::uint32_t a, std::uint32_t b) { return static_cast<std::int32_t>(a - b) > 0; }
+
+    const Config config;
+    // Escritos pela thread dos hooks
+    std::atomic<std::uint32_t> lastHookTick{0};
+    std::atomic<std::uint64_t> hookEvents{0};
+    std::atomic<bool> timedOut{false};
+    std::atomic<std::uint64_t> slowCallbacks{0};
+    // Lado do vigia (Check, OnReinstalled, Arm)
+    std::mutex mutex;
+    bool armed = false;
+    std::uint32_t lastCountedInput = 0;
+    std::uint64_t unseenInputs = 0;        // instantes de entrada ainda não vistos pelos hooks
+    std::uint32_t estimatedUntil = 0;      // falha já contada até este instante
+    std::uint64_t checkedEvents = 0;
+    std::uint32_t checkedTick = 0;
+    double eventsPerMs = 0;                // ritmo recente dos hooks (média móvel, só janelas com entrada)
+
+    void ForgetLocked(std::uint32_t nowTick);
+    std::atomic<std::uint64_t> lostEvents{0};
+    std::atomic<std::uint64_t> reinstalls{0};
+};
+
+struct HookWatchdogBenchmarkResult {
+    size_t callbacks;
+    double callbackNs;              // custo do OnCallback
+    std::uint32_t detectionMs;      // hooks removidos até o vigia perceber (simulado)
+    std::uint64_t lostActual;       // eventos gerados durante a falha (simulado)
+    std::uint64_t lostEstimated;    // estimativa do vigia para os mesmos eventos
+    std::uint32_t falseAlarms;      // vereditos de falha com os hooks vivos e lentos (simulado)
+};
+
+// Callbacks medidos + falha simulada: entrada a cada 8 ms, vigia a cada 100 ms
+HookWatchdogBenchmarkResult BenchmarkHookWatchdog(size_t callbacks);
+
+#endif // HOOKWATCHDOG_H
@@ -0,0 +1,137 @@
+#include "humanizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+inline std::uint64_t RotateLeft(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+std::uint64_t SplitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+void Xoshiro256::Seed(std::uint64_t seed) {
+    std::uint64_t state = seed;
+    for (auto& word : s) word = SplitMix64(state);
+}
+
+std::uint64_t Xoshiro256::Next() {
+    const std::uint64_t result = RotateLeft(s[1] * 5, 7) * 9;
+    const std::uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = RotateLeft(s[3], 45);
+    return result;
+}
+
+Humanizer::Humanizer(std::uint64_t seed, HumanizeProfile profile)
+    : profile(profile) {
+    Reset(seed);
+}
+
+void Humanizer::Reset(std::uint64_t value) {
+    seed = value;
+    rng.Seed(value);
+    nextUniform = kBatch;
+    nextNormal = kBatch;
+}
+
+std::uint64_t Humanizer::RandomSeed() {
+    std::random_device device;
+    std::uint64_t seed = (static_cast<std::uint64_t>(device()) << 32) ^ device();
+    seed ^= static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return seed ? seed : 1;
+}
+
+void Humanizer::RefillUniforms() {
+    for (size_t i = 0; i < kBatch; ++i) uniforms[i] = rng.NextDouble();
+    nextUniform = 0;
+}
+
+void Humanizer::RefillNormals() {
+    // Box-Muller: cada par de uniformes gera duas normais independentes
+    for (size_t i = 0; i < kBatch; i += 2) {
+        double u1 = 1.0 - rng.NextDouble();   // (0, 1]: log finito
+        double u2 = rng.NextDouble();
+        double radius = std::sqrt(-2.0 * std::log(u1));
+        normals[i] = radius * std::cos(2.0 * kPi * u2);
+        normals[i + 1] = radius * std::sin(2.0 * kPi * u2);
+    }
+    nextNormal = 0;
+}
+
+double Humanizer::Uniform() {
+    if (nextUniform == kBatch) RefillUniforms();
+    return uniforms[nextUniform++];
+}
+
+double Humanizer::Normal() {
+    if (nextNormal == kBatch) RefillNormals();
+    return normals[nextNormal++];
+}
+
+std::int64_t Humanizer::Delay(std::int64_t micros, std::int64_t maxDeviationMicros) {
+    if (micros <= 0) return micros;
+    double factor = std::exp(profile.delaySigma * Normal());
+    std::int64_t result = static_cast<std::int64_t>(micros * factor);
+    if (maxDeviationMicros > 0) {
+        result = std::clamp(result, micros - maxDeviationMicros, micros + maxDeviationMicros);
+    }
+    return std::max<std::int64_t>(result, 1000);
+}
+
+std::int64_t Humanizer::Dwell(std::int64_t micros) {
+    double median = micros > 0 ? static_cast<double>(micros) : profile.dwellMedianMs * 1000.0;
+    double sample = median * std::exp(profile.dwellSigma * Normal());
+    // Sem toques impossivelmente curtos nem teclas "presas"
+    return static_cast<std::int64_t>(std::clamp(sample, 15000.0, median * 4.0 + 15000.0));
+}
+
+std::pair<int, int> Humanizer::ClickOffset() {
+    if (profile.clickRadius <= 0) return {0, 0};
+    // sqrt no raio: distribuição uniforme na área do círculo
+    double radius = profile.clickRadius * std::sqrt(Uniform());
+    double angle = 2.0 * kPi * Uniform();
+    return {static_cast<int>(std::lround(radius * std::cos(angle))),
+            static_cast<int>(std::lround(radius * std::sin(angle)))};
+}
+
+std::vector<std::pair<int, int>> Humanizer::CurvePath(int fromX, int fromY, int toX, int toY) {
+    std::vector<std::pair<int, int>> points;
+    if (!profile.curvedPaths || profile.pathSteps <= 0) return points;
+
+    const double dx = toX - fromX;
+    const double dy = toY - fromY;
+    const double length = std::sqrt(dx * dx + dy * dy);
+    if (length < 1.0) return points;
+
+    // Controle no meio do trajeto, deslocado na perpendicular (até 20% do comprimento)
+    const double bend = 0.2 * length * (2.0 * Uniform() - 1.0);
+    const double cx = (fromX + toX) / 2.0 - dy / length * bend;
+    const double cy = (fromY + toY) / 2.0 + dx / length * bend;
+
+    points.reserve(profile.pathSteps);
+    for (int i = 1; i <= profile.pathSteps; ++i) {
+        // Aceleração no início e desaceleração no fim (smoothstep)
+        double t = static_cast<double>(i) / (profile.pathSteps + 1);
+        t = t * t * (3.0 - 2.0 * t);
+        double a = (1 - t) * (1 - t), b = 2 * (1 - t) * t, c = t * t;
+        points.emplace_back(static_cast<int>(std::lround(a * fromX + b * cx + c * toX)),
+                            static_cast<int>(std::lround(a * fromY + b * cy + c * toY)));
+    }
+    return points;
+}
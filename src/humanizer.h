@@ -0,0 +1,78 @@
+#ifndef HUMANIZER_H
+#define HUMANIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// xoshiro256** (Blackman/Vigna): rápido, 256 bits de estado, semeado por splitmix64
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(std::uint64_t seed = 0) { Seed(seed); }
+
+    void Seed(std::uint64_t seed);
+    std::uint64_t Next();
+    // [0, 1) com 53 bits de mantissa
+    double NextDouble() { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    std::uint64_t s[4];
+};
+
+// Parâmetros das distribuições por tipo de ação
+struct HumanizeProfile {
+    double delaySigma = 0.15;         // desvio do log do fator multiplicativo das esperas gravadas
+    double dwellMedianMs = 85.0;      // tempo típico com a tecla pressionada (tap sem duração gravada)
+    double dwellSigma = 0.35;         // desvio do log do tempo de pressão
+    int clickRadius = 12;             // raio do desvio do ponto, em centésimos de % da tela (~2 px em 1920)
+    bool curvedPaths = true;          // movimentos em curva em vez de salto direto
+    int pathSteps = 8;                // pontos intermediários de cada curva
+    int pathStepMs = 4;               // intervalo entre pontos da curva
+};
+
+// Gera todo o "ruído humano" de uma execução a partir de uma única semente:
+// a mesma semente reproduz exatamente a mesma execução.
+// Os números aleatórios são gerados em lotes à frente do consumo (normais
+// por Box-Muller aos pares), fora do caminho de cada ação individual.
+class Humanizer {
+public:
+    explicit Humanizer(std::uint64_t seed = 0, HumanizeProfile profile = HumanizeProfile());
+
+    void Reset(std::uint64_t seed);
+    std::uint64_t Seed() const { return seed; }
+    const HumanizeProfile& Profile() const { return profile; }
+    void SetProfile(const HumanizeProfile& value) { profile = value; }
+
+    // Espera gravada: fator log-normal (mediana preservada). maxDeviationMicros > 0
+    // limita o desvio absoluto (o antigo "Variação Máx").
+    std::int64_t Delay(std::int64_t micros, std::int64_t maxDeviationMicros);
+    // Tempo de tecla pressionada; micros <= 0 usa a mediana do perfil
+    std::int64_t Dwell(std::int64_t micros);
+    // Desvio uniforme dentro do círculo de raio clickRadius
+    std::pair<int, int> ClickOffset();
+    // Pontos intermediários de uma curva (Bézier quadrática com controle
+    // deslocado para um dos lados), sem incluir origem e destino
+    std::vector<std::pair<int, int>> CurvePath(int fromX, int fromY, int toX, int toY);
+
+    // Semente nova a partir do relógio e de std::random_device
+    static std::uint64_t RandomSeed();
+
+private:
+    double Uniform();
+    double Normal();
+    void RefillUniforms();
+    void RefillNormals();
+
+    static constexpr size_t kBatch = 256;
+
+    std::uint64_t seed = 0;
+    HumanizeProfile profile;
+    Xoshiro256 rng;
+    double uniforms[kBatch];
+    double normals[kBatch];
+    size_t nextUniform = kBatch;
+    size_t nextNormal = kBatch;
+};
+
+#endif // HUMANIZER_H
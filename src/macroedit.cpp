@@ -0,0 +1,394 @@
+#include "macroedit.h"
+#include "actionstream.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Inserir e remover são o mesmo comando em sentidos opostos: as ações ficam
+// na lista ou em 'held', nunca nos dois (o comando aplicado de uma inserção
+// não guarda nada). Com a ActionTable, 'held' é só um trecho que compartilha
+// os blocos: remover um milhão de ações custa O(log n).
+class SpliceCommand : public EditCommand {
+public:
+    SpliceCommand(size_t first, size_t count, bool inserts, ActionTable held = ActionTable())
+        : first(first), count(count), inserts(inserts), held(std::move(held)) {}
+
+    EditRange Apply(ActionTable& actions) override { return inserts ? In(actions) : Out(actions); }
+    EditRange Revert(ActionTable& actions) override { return inserts ? Out(actions) : In(actions); }
+    QString Describe() const override {
+        return QString(inserts ? "Inserir %1 ações" : "Remover %1 ações").arg(count);
+    }
+    size_t Bytes() const override { return sizeof(*this) + held.OwnBytes(); }
+
+private:
+    EditRange In(ActionTable& actions) {
+        actions.Insert(first, held);
+        held.clear();
+        return {first, count, true};
+    }
+    EditRange Out(ActionTable& actions) {
+        held = actions.Slice(first, count);
+        actions.Remove(first, count);
+        return {first, 0, true};
+    }
+
+    size_t first;
+    size_t count;
+    bool inserts;
+    ActionTable held;
+};
+
+// Bloco recortado e reinserido; desfazer o leva de volta
+class MoveCommand : public EditCommand {
+public:
+    MoveCommand(size_t first, size_t count, size_t to)
+        : first(first), count(count), movedFirst(to > first ? to - count : to) {}
+
+    EditRange Apply(ActionTable& actions) override {
+        Relocate(actions, first, movedFirst);
+        return Affected();
+    }
+    EditRange Revert(ActionTable& actions) override {
+        Relocate(actions, movedFirst, first);
+        return Affected();
+    }
+    QString Describe() const override { return QString("Mover %1 ações").arg(count); }
+    size_t Bytes() const override { return sizeof(*this); }
+
+private:
+    // 'to' é a posição do bloco depois de movido
+    void Relocate(ActionTable& actions, size_t from, size_t to) const {
+        ActionTable block = actions.Slice(from, count);
+        actions.Remove(from, count);
+        actions.Insert(to, block);
+    }
+    EditRange Affected() const {
+        size_t low = std::min(first, movedFirst);
+        size_t high = std::max(first, movedFirst) + count;
+        return {low, high - low, true};
+    }
+
+    size_t first;
+    size_t count;
+    size_t movedFirst;
+};
+
+double GetField(const Action& action, ActionField field) {
+    switch (field) {
+        case ActionField::Delay: return action.delay;
+        case ActionField::Required: return action.required ? 1 : 0;
+        case ActionField::X: return action.x;
+        case ActionField::Y: return action.y;
+        case ActionField::Key: return action.key;
+        case ActionField::Pressed: return action.pressed ? 1 : 0;
+        case ActionField::MonitorIndex: return action.monitorIndex;
+    }
+    return 0;
+}
+
+void SetFieldValue(Action& action, ActionField field, double value) {
+    switch (field) {
+        case ActionField::Delay: action.delay = value; break;
+        case ActionField::Required: action.required = value != 0; break;
+        case ActionField::X: action.x = static_cast<int>(value); break;
+        case ActionField::Y: action.y = static_cast<int>(value); break;
+        case ActionField::Key: action.key = static_cast<std::uint16_t>(value); break;
+        case ActionField::Pressed: action.pressed = value != 0; break;
+        case ActionField::MonitorIndex: action.monitorIndex = static_cast<int>(value); break;
+    }
+}
+
+class SetFieldCommand : public EditCommand {
+public:
+    SetFieldCommand(size_t index, ActionField field, double value)
+        : index(index), field(field), newValue(value) {}
+
+    EditRange Apply(ActionTable& actions) override {
+        oldValue = GetField(actions[index], field);
+        return Write(actions, newValue);
+    }
+    EditRange Revert(ActionTable& actions) override { return Write(actions, oldValue); }
+    QString Describe() const override { return QString("Editar ação %1").arg(index + 1); }
+    size_t Bytes() const override { return sizeof(*this); }
+
+private:
+    EditRange Write(ActionTable& actions, double value) const {
+        Action action = actions[index];
+        SetFieldValue(action, field, value);
+        actions.Set(index, action);
+        return {index, 1, false};
+    }
+
+    size_t index;
+    ActionField field;
+    double newValue;
+    double oldValue = 0;
+};
+
+// Desfazer divide pelo mesmo fator: o valor volta com no máximo 1 ulp de
+// diferença (bilionésimos de microssegundo), sem guardar as esperas antigas
+class ScaleDelaysCommand : public EditCommand {
+public:
+    ScaleDelaysCommand(size_t first, size_t count, double factor)
+        : first(first), count(count), factor(factor) {}
+
+    EditRange Apply(ActionTable& actions) override { return Scale(actions, true); }
+    EditRange Revert(ActionTable& actions) override { return Scale(actions, false); }
+    QString Describe() const override {
+        return QString("Escalar delays (%1x)").arg(factor, 0, 'g', 3);
+    }
+    size_t Bytes() const override { return sizeof(*this); }
+
+private:
+    // O trecho é regravado em blocos novos (os antigos continuam valendo para
+    // quem tiver um instantâneo)
+    EditRange Scale(ActionTable& actions, bool forward) {
+        std::vector<Action> scaled;
+        scaled.reserve(count);
+        actions.ForEachIn(first, count, [&](const Action& action) {
+            scaled.push_back(action);
+            if (ActionKindFromString(action.type) == ActionKind::Delay) {
+                scaled.back().delay = forward ? action.delay * factor : action.delay / factor;
+            }
+        });
+        actions.Remove(first, count);
+        actions.Insert(first, std::move(scaled));
+        return {first, count, false};
+    }
+
+    size_t first;
+    size_t count;
+    double factor;
+};
+
+// Limpar troca a lista inteira com o comando (O(1), sem copiar)
+class ClearCommand : public EditCommand {
+public:
+    EditRange Apply(ActionTable& actions) override {
+        count = actions.size();
+        std::swap(held, actions);
+        return {0, 0, true};
+    }
+    EditRange Revert(ActionTable& actions) override {
+        std::swap(held, actions);
+        return {0, actions.size(), true};
+    }
+    QString Describe() const override { return QString("Limpar %1 ações").arg(count); }
+    size_t Bytes() const override { return sizeof(*this) + held.OwnBytes(); }
+
+private:
+    size_t count = 0;
+    ActionTable held;
+};
+
+class GroupCommand : public EditCommand {
+public:
+    explicit GroupCommand(const QString& description) : description(description) {}
+
+    EditRange Apply(ActionTable& actions) override {
+        EditRange range;
+        bool first = true;
+        for (auto& command : commands) {
+            EditRange r = command->Apply(actions);
+            range = first ? r : MergeEditRanges(range, r);
+            first = false;
+        }
+        return range;
+    }
+    EditRange Revert(ActionTable& actions) override {
+        EditRange range;
+        bool first = true;
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+            EditRange r = (*it)->Revert(actions);
+            range = first ? r : MergeEditRanges(range, r);
+            first = false;
+        }
+        return range;
+    }
+    QString Describe() const override { return description; }
+    size_t Bytes() const override {
+        size_t bytes = sizeof(*this);
+        for (const auto& command : commands) bytes += command->Bytes();
+        return bytes;
+    }
+
+    void Add(std::unique_ptr<EditCommand> command) { commands.push_back(std::move(command)); }
+    bool empty() const { return commands.empty(); }
+
+private:
+    QString description;
+    std::vector<std::unique_ptr<EditCommand>> commands;
+};
+
+} // namespace
+
+EditRange MergeEditRanges(const EditRange& a, const EditRange& b) {
+    size_t first = std::min(a.first, b.first);
+    size_t end = std::max(a.first + a.count, b.first + b.count);
+    return {first, end - first, a.structural || b.structural};
+}
+
+EditJournal::EditJournal(ActionTable& actions)
+    : actions(actions) {}
+
+EditRange EditJournal::Insert(size_t position, ActionTable items) {
+    if (items.empty()) return EditRange();
+    position = std::min(position, actions.size());
+    const size_t count = items.size();
+    return Push(std::make_unique<SpliceCommand>(position, count, true, std::move(items)));
+}
+
+EditRange EditJournal::Insert(size_t position, std::vector<Action> items) {
+    return Insert(position, ActionTable(std::move(items)));
+}
+
+EditRange EditJournal::Remove(size_t first, size_t count) {
+    if (first >= actions.size()) return EditRange();
+    count = std::min(count, actions.size() - first);
+    if (count == 0) return EditRange();
+    return Push(std::make_unique<SpliceCommand>(first, count, false));
+}
+
+EditRange EditJournal::Move(size_t first, size_t count, size_t to) {
+    if (first >= actions.size()) return EditRange();
+    count = std::min(count, actions.size() - first);
+    to = std::min(to, actions.size());
+    // Destino dentro do próprio bloco ou logo depois dele: nada muda
+    if (count == 0 || (to >= first && to <= first + count)) return EditRange();
+    return Push(std::make_unique<MoveCommand>(first, count, to));
+}
+
+EditRange EditJournal::SetField(size_t index, ActionField field, double value) {
+    if (index >= actions.size() || GetField(actions[index], field) == value) return EditRange();
+    return Push(std::make_unique<SetFieldCommand>(index, field, value));
+}
+
+EditRange EditJournal::ScaleDelays(size_t first, size_t count, double factor) {
+    if (first >= actions.size() || !(factor > 0) || factor == 1.0) return EditRange();
+    count = std::min(count, actions.size() - first);
+    return Push(std::make_unique<ScaleDelaysCommand>(first, count, factor));
+}
+
+EditRange EditJournal::Clear() {
+    if (actions.empty()) return EditRange();
+    return Push(std::make_unique<ClearCommand>());
+}
+
+void EditJournal::BeginGroup(const QString& description) {
+    if (groupDepth++ == 0) {
+        openGroup = std::make_unique<GroupCommand>(description);
+    }
+}
+
+void EditJournal::EndGroup() {
+    if (groupDepth == 0 || --groupDepth > 0) return;
+    std::unique_ptr<EditCommand> group = std::move(openGroup);
+    if (static_cast<GroupCommand*>(group.get())->empty()) return;
+    for (auto& command : redoStack) historyBytes -= command->Bytes();
+    redoStack.clear();
+    historyBytes += group->Bytes();
+    undoStack.push_back(std::move(group));
+    Trim();
+}
+
+EditRange EditJournal::Push(std::unique_ptr<EditCommand> command) {
+    EditRange range = command->Apply(actions);
+    if (openGroup) {
+        static_cast<GroupCommand*>(openGroup.get())->Add(std::move(command));
+        return range;
+    }
+    for (auto& redo : redoStack) historyBytes -= redo->Bytes();
+    redoStack.clear();
+    historyBytes += command->Bytes();
+    undoStack.push_back(std::move(command));
+    Trim();
+    return range;
+}
+
+EditRange EditJournal::Undo() {
+    if (undoStack.empty() || openGroup) return EditRange();
+    std::unique_ptr<EditCommand> command = std::move(undoStack.back());
+    undoStack.pop_back();
+    historyBytes -= command->Bytes();
+    EditRange range = command->Revert(actions);
+    historyBytes += command->Bytes();
+    redoStack.push_back(std::move(command));
+    return range;
+}
+
+EditRange EditJournal::Redo() {
+    if (redoStack.empty() || openGroup) return EditRange();
+    std::unique_ptr<EditCommand> command = std::move(redoStack.back());
+    redoStack.pop_back();
+    historyBytes -= command->Bytes();
+    EditRange range = command->Apply(actions);
+    historyBytes += command->Bytes();
+    undoStack.push_back(std::move(command));
+    return range;
+}
+
+QString EditJournal::UndoText() const {
+    return undoStack.empty() ? QString() : undoStack.back()->Describe();
+}
+
+QString EditJournal::RedoText() const {
+    return redoStack.empty() ? QString() : redoStack.back()->Describe();
+}
+
+void EditJournal::Reset() {
+    undoStack.clear();
+    redoStack.clear();
+    openGroup.reset();
+    groupDepth = 0;
+    historyBytes = 0;
+}
+
+void EditJournal::Trim() {
+    // O último comando fica sempre, mesmo acima do limite de memória
+    while (undoStack.size() > 1 && (undoStack.size() > kMaxCommands || historyBytes > kMaxHistoryBytes)) {
+        historyBytes -= undoStack.front()->Bytes();
+        undoStack.pop_front();
+    }
+}
+
+EditBenchmarkResult BenchmarkEditJournal(size_t count) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    ActionTable actions(SyntheticActionTrace(2, count, 11));
+    EditJournal journal(actions);
+    EditBenchmarkResult r = {actions.size(), 0, 0, 0, 0, 0, 0, 0};
+
+    // Antes: para desfazer seria preciso copiar a lista inteira a cada edição
+    auto start = Clock::now();
+    std::vector<Action> snapshot = actions.ToVector();
+    r.snapshotMs = elapsedMs(start);
+    r.snapshotBytes = snapshot.capacity() * sizeof(Action);
+    snapshot.clear();
+
+    start = Clock::now();
+    journal.ScaleDelays(0, actions.size(), 0.5);
+    r.scaleMs = elapsedMs(start);
+    r.commandBytes = journal.HistoryBytes();
+
+    start = Clock::now();
+    journal.Undo();
+    r.undoMs = elapsedMs(start);
+
+    start = Clock::now();
+    journal.Redo();
+    r.redoMs = elapsedMs(start);
+
+    const int edits = 100000;
+    start = Clock::now();
+    for (int i = 0; i < edits; ++i) {
+        size_t index = (static_cast<size_t>(i) * 7919) % actions.size();
+        journal.SetField(index, ActionField::Delay, 0.001 * (i % 100 + 1));
+        if (i % 2) journal.Undo();
+    }
+    r.fieldEditsPerSec = edits / (elapsedMs(start) / 1000.0);
+    return r;
+}
@@ -0,0 +1,114 @@
+#ifndef MACROEDIT_H
+#define MACROEDIT_H
+
+#include "action.h"
+#include "actiontable.h"
+#include <QString>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Campos editáveis de uma ação (EditJournal::SetField)
+enum class ActionField {
+    Delay,
+    Required,
+    X,
+    Y,
+    Key,
+    Pressed,
+    MonitorIndex
+};
+
+// Trecho da lista afetado por uma edição: 'structural' indica que ações
+// entraram, saíram ou mudaram de posição (a numeração a partir de 'first'
+// mudou); caso contrário só o texto das linhas [first, first + count) mudou.
+struct EditRange {
+    size_t first = 0;
+    size_t count = 0;
+    bool structural = false;
+};
+
+// Uma edição reversível. Guarda só o necessário para desfazer: parâmetros da
+// operação e, quando a operação destrói dados (remover, limpar), o trecho
+// removido. Nunca uma cópia da lista inteira.
+class EditCommand {
+public:
+    virtual ~EditCommand() = default;
+
+    virtual EditRange Apply(ActionTable& actions) = 0;
+    virtual EditRange Revert(ActionTable& actions) = 0;
+    virtual QString Describe() const = 0;
+    // Memória guardada pelo comando, para o benchmark e o limite do histórico
+    virtual size_t Bytes() const = 0;
+};
+
+// Histórico de desfazer/refazer sobre a lista de ações. Cada operação é
+// aplicada imediatamente e registrada como comando; Undo/Redo aplicam o
+// inverso, então o custo de uma edição é proporcional ao trecho editado e não
+// ao tamanho da macro.
+class EditJournal {
+public:
+    explicit EditJournal(ActionTable& actions);
+
+    // Todas retornam o trecho afetado (count == 0 e !structural: nada mudou)
+    EditRange Insert(size_t position, ActionTable items);
+    EditRange Insert(size_t position, std::vector<Action> items);
+    EditRange Remove(size_t first, size_t count);
+    // Move [first, first + count) para antes da ação 'to' (índice na lista atual)
+    EditRange Move(size_t first, size_t count, size_t to);
+    EditRange SetField(size_t index, ActionField field, double value);
+    // Multiplica as esperas (ações "delay") do trecho por 'factor' (> 0)
+    EditRange ScaleDelays(size_t first, size_t count, double factor);
+    EditRange Clear();
+
+    // Agrupa as operações seguintes num só passo de desfazer (ex.: remover
+    // uma seleção não contígua)
+    void BeginGroup(const QString& description);
+    void EndGroup();
+
+    EditRange Undo();
+    EditRange Redo();
+    bool CanUndo() const { return !undoStack.empty(); }
+    bool CanRedo() const { return !redoStack.empty(); }
+    QString UndoText() const;
+    QString RedoText() const;
+
+    // A lista foi substituída por fora (gravação, arquivo carregado):
+    // o histórico não se aplica mais
+    void Reset();
+
+    size_t HistoryBytes() const { return historyBytes; }
+
+private:
+    EditRange Push(std::unique_ptr<EditCommand> command);
+    void Trim();
+
+    static constexpr size_t kMaxCommands = 1000;
+    static constexpr size_t kMaxHistoryBytes = 256 * 1024 * 1024;
+
+    ActionTable& actions;
+    std::deque<std::unique_ptr<EditCommand>> undoStack;
+    std::deque<std::unique_ptr<EditCommand>> redoStack;
+    std::unique_ptr<EditCommand> openGroup;
+    int groupDepth = 0;
+    size_t historyBytes = 0;
+};
+
+// Une dois trechos afetados (usado ao agrupar comandos)
+EditRange MergeEditRanges(const EditRange& a, const EditRange& b);
+
+struct EditBenchmarkResult {
+    size_t actions;
+    double scaleMs;             // escalar todas as esperas (um comando)
+    double undoMs;
+    double redoMs;
+    double snapshotMs;          // alternativa antiga: copiar a lista antes de editar
+    size_t commandBytes;        // memória do comando no histórico
+    size_t snapshotBytes;       // memória de uma cópia da lista
+    double fieldEditsPerSec;    // edições de campo isoladas (com desfazer)
+};
+
+EditBenchmarkResult BenchmarkEditJournal(size_t actions);
+
+#endif // MACROEDIT_H
@@ -0,0 +1,517 @@
+#include "macrosaver.h"
+#include "metrics.h"
+#include "tracing.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <io.h>   // _commit
+
+namespace {
+
+const char kJournalMagic[4] = {'M', 'J', 'R', 'N'};
+constexpr std::uint32_t kJournalVersion = 1;
+constexpr int kJournalHeaderSize = 16;
+constexpr int kRecordHeaderSize = 8;
+constexpr int kRecordFixedSize = 24;     // revisão, início, removidas
+
+struct Crc32Table {
+    std::uint32_t entries[256];
+    Crc32Table() {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+std::uint32_t Crc32(const char* data, size_t size) {
+    static const Crc32Table table;
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) crc = table.entries[(crc ^ static_cast<std::uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void Put(QByteArray& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out.append(static_cast<char>(static_cast<std::uint64_t>(value) >> (8 * i)));
+}
+
+template <typename T>
+T Get(const char* p) {
+    std::uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(p[i])) << (8 * i);
+    return static_cast<T>(value);
+}
+
+bool SameAction(const Action& a, const Action& b) {
+    return a.x == b.x && a.y == b.y && a.key == b.key && a.pressed == b.pressed && a.delay == b.delay &&
+           a.frequency == b.frequency && a.monitorIndex == b.monitorIndex && a.required == b.required && a.type == b.type &&
+           a.delta == b.delta && a.text == b.text;
+}
+
+QByteArray StreamBytes(const ActionStream& stream, const RepetitionLayout& layout = RepetitionLayout()) {
+    std::vector<std::uint8_t> data = stream.Serialize(layout);
+    return QByteArray(reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()));
+}
+
+bool StreamFromBytes(const char* data, size_t size, std::vector<Action>& actions, QString& error) {
+    ActionStream stream;
+    std::string message;
+    if (!ActionStream::Deserialize(reinterpret_cast<const std::uint8_t*>(data), size, stream, message)) {
+        error = QString::fromStdString(message);
+        return false;
+    }
+    actions = stream.DecodeAll();
+    return true;
+}
+
+// Garante que os bytes acrescentados ao diário chegaram ao disco
+void SyncToDisk(QFile& file) {
+    file.flush();
+    _commit(file.handle());
+}
+
+} // namespace
+
+QByteArray ActionsToJson(const std::vector<Action>& actions) {
+    QJsonArray array;
+    for (const auto& act : actions) {
+        QJsonObject obj;
+        obj["type"] = QString::fromStdString(act.type);
+        obj["x"] = act.x;
+        obj["y"] = act.y;
+        obj["key"] = (int)act.key;
+        obj["pressed"] = act.pressed;
+        obj["delay"] = act.delay;
+        obj["frequency"] = act.frequency;
+        obj["monitorIndex"] = act.monitorIndex;
+        if (act.required) {
+            obj["required"] = true;
+        }
+        if (act.delta != 0) {
+            obj["delta"] = act.delta;
+        }
+        if (!act.text.empty()) {
+            obj["text"] = QString::fromStdString(act.text);
+        }
+        array.append(obj);
+    }
+    return QJsonDocument(array).toJson();
+}
+
+std::vector<Action> ActionsFromJson(const QJsonArray &array) {
+    std::vector<Action> actions;
+    actions.reserve(array.size());
+    for (const auto& obj : array) {
+        QJsonObject o = obj.toObject();
+        Action act = {
+            o["type"].toString().toStdString(),
+            o["x"].toInt(),
+            o["y"].toInt(),
+            (std::uint16_t)o["key"].toInt(),
+            o["pressed"].toBool(),
+            o["delay"].toDouble(),
+            o["frequency"].toInt(),
+            o["monitorIndex"].toInt(-1), // -1 para arquivos antigos
+            o["required"].toBool(false),
+            o["delta"].toInt(0),
+            o["text"].toString().toStdString()
+        };
+        actions.push_back(act);
+    }
+    return actions;
+}
+
+bool WriteFileAtomic(const QString& path, const QByteArray& data, QString& error) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        error = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    // commit(): flush + sincronização com o disco + rename sobre o destino
+    if (!file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+// =============================================
+// THREAD DE GRAVAÇÃO
+// =============================================
+
+MacroSaver::MacroSaver(const QString& autosaveDir) : directory(autosaveDir) {
+    QDir().mkpath(directory);
+    worker = std::thread(&MacroSaver::ThreadMain, this);
+}
+
+MacroSaver::~MacroSaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeUp.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void MacroSaver::Enqueue(std::function<void()> work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(work));
+    }
+    wakeUp.notify_one();
+}
+
+void MacroSaver::SaveWith(const QString& path, std::function<QByteArray()> serialize, Done done) {
+    Enqueue([path, serialize, done]() {
+        auto start = std::chrono::steady_clock::now();
+        QByteArray data = serialize();
+        SaveResult result;
+        result.path = path;
+        result.bytes = data.size();
+        result.ok = WriteFileAtomic(path, data, result.error);
+        result.workMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        AppMetrics::Get().saveDuration.Record(static_cast<std::int64_t>(result.workMs * 1000));
+        if (done) done(result);
+    });
+}
+
+void MacroSaver::Save(const QString& path, Format format, ActionTable actions, RepetitionLayout layout, Done done) {
+    auto snapshot = std::make_shared<const ActionTable>(std::move(actions));
+    SaveWith(path, [snapshot, format, layout]() {
+        if (format == Format::Json) return ActionsToJson(snapshot->ToVector());
+        ActionStream stream;
+        snapshot->ForEach([&stream](const Action& action) { stream.Append(action); });
+        return StreamBytes(stream, layout);
+    }, std::move(done));
+}
+
+void MacroSaver::SaveFromFile(const QString& path, Format format, const QString& sourcePath, RepetitionLayout layout, Done done) {
+    Enqueue([path, format, sourcePath, layout, done]() {
+        auto start = std::chrono::steady_clock::now();
+        SaveResult result;
+        result.path = path;
+
+        ActionStreamFile source;
+        ActionStream stream;
+        std::string error;
+        if (!source.Open(sourcePath.toLocal8Bit().toStdString(), error) || !source.LoadStream(stream, error)) {
+            result.error = QString::fromStdString(error);
+        } else {
+            source.Close();
+            QByteArray data = format == Format::Json ? ActionsToJson(stream.DecodeAll()) : StreamBytes(stream, layout);
+            result.bytes = data.size();
+            result.ok = WriteFileAtomic(path, data, result.error);
+        }
+        result.workMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        AppMetrics::Get().saveDuration.Record(static_cast<std::int64_t>(result.workMs * 1000));
+        if (done) done(result);
+    });
+}
+
+void MacroSaver::WriteMetrics(const QString& path) {
+    Enqueue([path]() {
+        QString error;
+        if (!MetricsRegistry::Global().WriteExposition(path, error)) qDebug() << "Métricas:" << error;
+    });
+}
+
+void MacroSaver::Autosave(std::uint64_t revision, ActionTable actions) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (revision <= pendingRevision && pendingSnapshot) return;
+        pendingSnapshot = std::make_shared<const ActionTable>(std::move(actions));
+        pendingRevision = revision;
+    }
+    wakeUp.notify_one();
+}
+
+void MacroSaver::MarkSaved(std::uint64_t revision) {
+    Enqueue([this, revision]() {
+        if (journaledRevision > revision) return;
+        RemoveAutosaveFiles();
+        journaledRevision = revision;
+    });
+}
+
+void MacroSaver::DiscardAutosave() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingSnapshot.reset();
+    }
+    Enqueue([this]() { RemoveAutosaveFiles(); });
+}
+
+void MacroSaver::Flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [this] { return jobs.empty() && !pendingSnapshot && !busy; });
+}
+
+void MacroSaver::ThreadMain() {
+    TraceRecorder::Global().SetThreadName("gravação em disco");
+    for (;;) {
+        std::function<void()> job;
+        std::shared_ptr<const ActionTable> snapshot;
+        std::uint64_t revision = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return !running || !jobs.empty() || pendingSnapshot; });
+            if (jobs.empty() && !pendingSnapshot) break;   // encerrando, fila vazia
+            // Salvamentos explícitos antes do autosave
+            if (!jobs.empty()) {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            } else {
+                snapshot = std::move(pendingSnapshot);
+                revision = pendingRevision;
+            }
+            busy = true;
+        }
+
+        if (job) {
+            job();
+        } else if (revision > journaledRevision) {
+            WriteAutosave(revision, snapshot->ToVector());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+            if (jobs.empty() && !pendingSnapshot) drained.notify_all();
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    drained.notify_all();
+}
+
+// =============================================
+// AUTOSAVE (BASE + DIÁRIO)
+// =============================================
+
+QString MacroSaver::BasePath(std::uint32_t gen) const {
+    return QDir(directory).absoluteFilePath(QString("autosave-%1.mstream").arg(gen));
+}
+
+QString MacroSaver::JournalPath() const {
+    return QDir(directory).absoluteFilePath("autosave.journal");
+}
+
+bool MacroSaver::WriteBase(const std::vector<Action>& actions) {
+    const std::uint32_t next = generation + 1;
+    QByteArray base = StreamBytes(ActionStream::FromActions(actions));
+    QString error;
+    if (!WriteFileAtomic(BasePath(next), base, error)) {
+        qDebug() << "Autosave: falha ao gravar base:" << error;
+        return false;
+    }
+
+    // O diário só passa a apontar para a nova base depois que ela está no disco
+    QByteArray header(kJournalMagic, 4);
+    Put<std::uint32_t>(header, kJournalVersion);
+    Put<std::uint32_t>(header, next);
+    Put<std::uint32_t>(header, 0);
+    if (!WriteFileAtomic(JournalPath(), header, error)) {
+        qDebug() << "Autosave: falha ao gravar diário:" << error;
+        QFile::remove(BasePath(next));
+        return false;
+    }
+    if (generation != 0) QFile::remove(BasePath(generation));
+
+    generation = next;
+    baseBytes = base.size();
+    journalBytes = header.size();
+    return true;
+}
+
+void MacroSaver::WriteAutosave(std::uint64_t revision, const std::vector<Action>& actions) {
+    if (generation == 0 || journalBytes > std::max(kMinJournalBytes, baseBytes)) {
+        if (WriteBase(actions)) {
+            journaled = actions;
+            journaledRevision = revision;
+        }
+        return;
+    }
+
+    // Diferença: um único intervalo trocado entre o prefixo e o sufixo comuns
+    const size_t oldSize = journaled.size();
+    const size_t newSize = actions.size();
+    const size_t common = std::min(oldSize, newSize);
+    size_t prefix = 0;
+    while (prefix < common && SameAction(journaled[prefix], actions[prefix])) ++prefix;
+    size_t suffix = 0;
+    while (suffix < common - prefix && SameAction(journaled[oldSize - 1 - suffix], actions[newSize - 1 - suffix])) ++suffix;
+    if (prefix == oldSize && oldSize == newSize) {
+        journaledRevision = revision;
+        return;
+    }
+
+    ActionStream inserted;
+    for (size_t i = prefix; i < newSize - suffix; ++i) inserted.Append(actions[i]);
+
+    QByteArray payload;
+    Put<std::uint64_t>(payload, revision);
+    Put<std::uint64_t>(payload, prefix);
+    Put<std::uint64_t>(payload, oldSize - prefix - suffix);
+    payload.append(StreamBytes(inserted));
+
+    QByteArray record;
+    Put<std::uint32_t>(record, static_cast<std::uint32_t>(payload.size()));
+    Put<std::uint32_t>(record, Crc32(payload.constData(), static_cast<size_t>(payload.size())));
+    record.append(payload);
+
+    QFile journal(JournalPath());
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append) || journal.write(record) != record.size()) {
+        qDebug() << "Autosave: falha ao acrescentar ao diário:" << journal.errorString();
+        generation = 0;   // próxima tentativa grava uma base nova
+        return;
+    }
+    SyncToDisk(journal);
+    journal.close();
+
+    journalBytes += record.size();
+    journaled = actions;
+    journaledRevision = revision;
+}
+
+void MacroSaver::RemoveAutosaveFiles() {
+    QFile::remove(JournalPath());
+    if (generation != 0) QFile::remove(BasePath(generation));
+    generation = 0;
+    journaled.clear();
+    baseBytes = 0;
+    journalBytes = 0;
+}
+
+bool MacroSaver::HasRecovery() const {
+    return QFileInfo(JournalPath()).size() >= kJournalHeaderSize;
+}
+
+bool MacroSaver::Recover(std::vector<Action>& actions, QString& error) {
+    QFile journal(JournalPath());
+    if (!journal.open(QIODevice::ReadWrite)) {
+        error = journal.errorString();
+        return false;
+    }
+    QByteArray data = journal.readAll();
+    if (data.size() < kJournalHeaderSize || std::memcmp(data.constData(), kJournalMagic, 4) != 0 ||
+        Get<std::uint32_t>(data.constData() + 4) != kJournalVersion) {
+        error = "diário de autosave inválido";
+        return false;
+    }
+    const std::uint32_t gen = Get<std::uint32_t>(data.constData() + 8);
+
+    QFile baseFile(BasePath(gen));
+    if (!baseFile.open(QIODevice::ReadOnly)) {
+        error = "base do autosave ausente";
+        return false;
+    }
+    QByteArray base = baseFile.readAll();
+    std::vector<Action> state;
+    if (!StreamFromBytes(base.constData(), static_cast<size_t>(base.size()), state, error)) return false;
+
+    // Reaplica os registros até o primeiro incompleto ou corrompido
+    qint64 offset = kJournalHeaderSize;
+    std::uint64_t revision = 0;
+    while (data.size() - offset >= kRecordHeaderSize) {
+        const char* p = data.constData() + offset;
+        const std::uint32_t length = Get<std::uint32_t>(p);
+        if (length < kRecordFixedSize || data.size() - offset - kRecordHeaderSize < length) break;
+        const char* payload = p + kRecordHeaderSize;
+        if (Crc32(payload, length) != Get<std::uint32_t>(p + 4)) break;
+
+        const std::uint64_t start = Get<std::uint64_t>(payload + 8);
+        const std::uint64_t removed = Get<std::uint64_t>(payload + 16);
+        std::vector<Action> inserted;
+        QString recordError;
+        if (start + removed > state.size() ||
+            !StreamFromBytes(payload + kRecordFixedSize, length - kRecordFixedSize, inserted, recordError)) {
+            break;
+        }
+        state.erase(state.begin() + static_cast<std::ptrdiff_t>(start),
+                    state.begin() + static_cast<std::ptrdiff_t>(start + removed));
+        state.insert(state.begin() + static_cast<std::ptrdiff_t>(start), inserted.begin(), inserted.end());
+        revision = Get<std::uint64_t>(payload);
+        offset += kRecordHeaderSize + length;
+    }
+
+    // Corta um final incompleto para que novos registros fiquem legíveis
+    if (offset < data.size()) {
+        qDebug() << "Autosave: descartando" << (data.size() - offset) << "bytes incompletos do diário";
+        journal.resize(offset);
+    }
+
+    generation = gen;
+    baseBytes = base.size();
+    journalBytes = offset;
+    journaled = state;
+    journaledRevision = revision;
+    actions = std::move(state);
+    return true;
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+SaveBenchmarkResult BenchmarkMacroSaver(size_t actions, const QString& dir) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::vector<Action> trace = SyntheticActionTrace(2, actions, 7);
+    const QString path = QDir(dir).absoluteFilePath("macroapp_save_bench.json");
+    const QString autosaveDir = QDir(dir).absoluteFilePath("macroapp_save_bench_autosave");
+    SaveBenchmarkResult r = {trace.size(), 0, 0, 0, 0, 0, 0};
+
+    // Antes: tudo na thread da interface, sobrescrevendo o destino
+    auto start = Clock::now();
+    QByteArray json = ActionsToJson(trace);
+    QFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(json);
+        file.close();
+    }
+    r.syncUiMs = elapsedMs(start);
+    r.jsonBytes = json.size();
+
+    MacroSaver saver(autosaveDir);
+    ActionTable table(trace);
+    start = Clock::now();
+    saver.Save(path, MacroSaver::Format::Json, table, RepetitionLayout(), nullptr);
+    r.asyncUiMs = elapsedMs(start);
+    saver.Flush();
+    r.asyncTotalMs = elapsedMs(start);
+
+    // Autosave: base completa, depois uma edição pequena vira um registro do diário
+    saver.Autosave(1, table);
+    saver.Flush();
+    const qint64 journalBefore = QFileInfo(QDir(autosaveDir).absoluteFilePath("autosave.journal")).size();
+    Action edited = table[table.size() / 2];
+    edited.delay += 0.25;
+    table.Set(table.size() / 2, edited);
+    start = Clock::now();
+    saver.Autosave(2, table);
+    r.autosaveUiMs = elapsedMs(start);
+    saver.Flush();
+    r.journalRecordBytes = QFileInfo(QDir(autosaveDir).absoluteFilePath("autosave.journal")).size() - journalBefore;
+
+    saver.DiscardAutosave();
+    saver.Flush();
+    QFile::remove(path);
+    QDir().rmdir(autosaveDir);
+    return r;
+}
@@ -0,0 +1,126 @@
+#ifndef MACROSAVER_H
+#define MACROSAVER_H
+
+#include "action.h"
+#include "actionstream.h"
+#include "actiontable.h"
+#include <QByteArray>
+#include <QJsonArray>
+#include <QString>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Conversão entre a lista de ações e o JSON dos arquivos .json
+QByteArray ActionsToJson(const std::vector<Action>& actions);
+std::vector<Action> ActionsFromJson(const QJsonArray& array);
+
+// Escreve num temporário do mesmo diretório, sincroniza com o disco e só então
+// renomeia por cima do destino (QSaveFile): o arquivo antigo continua intacto
+// se o processo cair no meio da escrita.
+bool WriteFileAtomic(const QString& path, const QByteArray& data, QString& error);
+
+struct SaveResult {
+    QString path;
+    bool ok = false;
+    QString error;
+    qint64 bytes = 0;
+    double workMs = 0;      // serialização + escrita, na thread de gravação
+};
+
+// Thread de gravação: salvamentos e autosave saem da thread da interface, que
+// só tira um instantâneo da ActionTable (O(1)) e enfileira.
+//
+// Autosave: um arquivo base (.mstream) mais um diário de diferenças. Cada
+// registro do diário troca um intervalo de ações por outro (prefixo e sufixo
+// comuns são omitidos), com tamanho e CRC para descartar um final incompleto.
+// Quando o diário passa do tamanho da base, uma nova base é gravada; o diário
+// guarda o número da base a que se refere, então uma queda no meio da troca
+// ainda recupera o estado anterior.
+class MacroSaver {
+public:
+    using Done = std::function<void(const SaveResult&)>;
+    enum class Format { Json, Stream };
+
+    explicit MacroSaver(const QString& autosaveDir);
+    ~MacroSaver();
+
+    MacroSaver(const MacroSaver&) = delete;
+    MacroSaver& operator=(const MacroSaver&) = delete;
+
+    // 'done' roda na thread de gravação
+    void Save(const QString& path, Format format, ActionTable actions, RepetitionLayout layout, Done done);
+    // Conteúdo de outro .mstream (arquivo grande aberto só para leitura): os
+    // blocos são lidos e copiados na thread de gravação, sem decodificar
+    void SaveFromFile(const QString& path, Format format, const QString& sourcePath, RepetitionLayout layout, Done done);
+
+    // Registra o estado da lista; revisões repetidas ou mais antigas são ignoradas
+    void Autosave(std::uint64_t revision, ActionTable actions);
+    // O estado até 'revision' está salvo em arquivo: o autosave só é apagado se
+    // nada mais novo foi registrado depois
+    void MarkSaved(std::uint64_t revision);
+    void DiscardAutosave();
+
+    // Chamar antes do primeiro Autosave
+    bool HasRecovery() const;
+    bool Recover(std::vector<Action>& actions, QString& error);
+
+    // Exposição das métricas (metrics.h) em 'path', na thread de gravação
+    void WriteMetrics(const QString& path);
+
+    // Espera a fila esvaziar
+    void Flush();
+
+private:
+    void Enqueue(std::function<void()> work);
+    void SaveWith(const QString& path, std::function<QByteArray()> serialize, Done done);
+    void ThreadMain();
+
+    // Só na thread de gravação
+    void WriteAutosave(std::uint64_t revision, const std::vector<Action>& actions);
+    bool WriteBase(const std::vector<Action>& actions);
+    void RemoveAutosaveFiles();
+    QString BasePath(std::uint32_t generation) const;
+    QString JournalPath() const;
+
+    static constexpr qint64 kMinJournalBytes = 64 * 1024;
+
+    const QString directory;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable drained;
+    std::deque<std::function<void()>> jobs;
+    // Autosave mais recente ainda não gravado (os anteriores são descartados)
+    std::shared_ptr<const ActionTable> pendingSnapshot;
+    std::uint64_t pendingRevision = 0;
+    bool busy = false;
+    bool running = true;
+
+    std::vector<Action> journaled;          // estado já registrado no autosave
+    std::uint64_t journaledRevision = 0;
+    std::uint32_t generation = 0;           // 0 = nenhum autosave em disco
+    qint64 baseBytes = 0;
+    qint64 journalBytes = 0;
+
+    std::thread worker;
+};
+
+struct SaveBenchmarkResult {
+    size_t actions;
+    qint64 jsonBytes;
+    double syncUiMs;        // caminho antigo: JSON + escrita na thread da interface
+    double asyncUiMs;       // agora: instantâneo da tabela + enfileirar
+    double asyncTotalMs;    // até o arquivo estar no disco
+    double autosaveUiMs;    // instantâneo para o autosave após uma edição pequena
+    qint64 journalRecordBytes;
+};
+
+SaveBenchmarkResult BenchmarkMacroSaver(size_t actions, const QString& directory);
+
+#endif // MACROSAVER_H
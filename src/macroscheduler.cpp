@@ -0,0 +1,1238 @@
+#include "macroscheduler.h"
+#include "metrics.h"
+#include "pixelmatch.h"
+#include "telemetry.h"
+#include "templatematch.h"
+#include "tracing.h"
+#include "windowtarget.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Fatia máxima de uma macro sem esperas antes de ceder a vez às outras
+constexpr std::uint64_t kSliceBudget = 100000;
+// Esperas nulas seguidas resolvidas dentro de uma mesma fatia
+constexpr int kZeroWaitResumes = 256;
+// Atraso acumulado máximo que uma macro tenta recuperar encurtando esperas
+constexpr std::chrono::milliseconds kMaxTimingDebt(50);
+
+std::uint64_t NowTick() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string ToLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+bool ParseNumber(const std::string& text, int& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    long v = std::strtol(text.c_str(), &end, 10);
+    if (!end || *end != '\0') return false;
+    value = static_cast<int>(v);
+    return true;
+}
+
+// "500ms", "30s", "5m", "2h"
+bool ParseInterval(const std::string& token, std::chrono::milliseconds& out) {
+    std::string t = ToLower(token);
+    double scale = 1000.0;
+    if (t.size() > 2 && t.compare(t.size() - 2, 2, "ms") == 0) { scale = 1.0; t.resize(t.size() - 2); }
+    else if (!t.empty() && t.back() == 's') { t.pop_back(); }
+    else if (!t.empty() && t.back() == 'm') { scale = 60000.0; t.pop_back(); }
+    else if (!t.empty() && t.back() == 'h') { scale = 3600000.0; t.pop_back(); }
+    char* end = nullptr;
+    double value = std::strtod(t.c_str(), &end);
+    if (t.empty() || !end || *end != '\0' || value <= 0) return false;
+    out = std::chrono::milliseconds(static_cast<std::int64_t>(value * scale));
+    return out.count() > 0;
+}
+
+template <size_t N>
+bool ParseCronField(const std::string& field, int lo, int hi, std::bitset<N>& bits, bool& any) {
+    bits.reset();
+    any = field == "*";
+    std::stringstream items(field);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        int step = 1;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            if (!ParseNumber(item.substr(slash + 1), step) || step <= 0) return false;
+            item.resize(slash);
+        }
+        int first = lo, last = hi;
+        if (item != "*") {
+            size_t dash = item.find('-');
+            if (dash == std::string::npos) {
+                if (!ParseNumber(item, first)) return false;
+                last = slash != std::string::npos ? hi : first;
+            } else if (!ParseNumber(item.substr(0, dash), first) || !ParseNumber(item.substr(dash + 1), last)) {
+                return false;
+            }
+        }
+        if (first < lo || last > hi || first > last) return false;
+        for (int v = first; v <= last; v += step) bits.set(static_cast<size_t>(v));
+    }
+    return bits.any();
+}
+
+std::tm LocalTime(std::time_t t) {
+    std::tm tm = {};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    return tm;
+}
+
+} // namespace
+
+// =============================================
+// CRON
+// =============================================
+
+bool CronSpec::Parse(const std::string& text, CronSpec& out, std::string& error) {
+    std::istringstream in(text);
+    std::vector<std::string> fields;
+    for (std::string f; in >> f;) fields.push_back(f);
+    if (fields.size() != 5) {
+        error = "cron precisa de 5 campos (min hora dia mês dia-da-semana)";
+        return false;
+    }
+
+    CronSpec spec;
+    bool anyMinute, anyHour, anyMonth;
+    std::bitset<8> weekdays;
+    if (!ParseCronField(fields[0], 0, 59, spec.minutes, anyMinute) ||
+        !ParseCronField(fields[1], 0, 23, spec.hours, anyHour) ||
+        !ParseCronField(fields[2], 1, 31, spec.days, spec.anyDay) ||
+        !ParseCronField(fields[3], 1, 12, spec.months, anyMonth) ||
+        !ParseCronField(fields[4], 0, 7, weekdays, spec.anyWeekday)) {
+        error = "campo cron inválido em '" + text + "'";
+        return false;
+    }
+    // 0 e 7 são ambos domingo
+    for (size_t d = 0; d < 7; ++d) spec.weekdays[d] = weekdays[d];
+    if (weekdays[7]) spec.weekdays[0] = true;
+
+    out = spec;
+    return true;
+}
+
+std::chrono::system_clock::time_point CronSpec::Next(std::chrono::system_clock::time_point after) const {
+    std::time_t t = std::chrono::system_clock::to_time_t(after);
+    t = t - (t % 60) + 60;
+    std::tm tm = LocalTime(t);
+    tm.tm_sec = 0;
+
+    auto normalize = [&tm]() {
+        tm.tm_isdst = -1;
+        std::time_t fixed = std::mktime(&tm);
+        tm = LocalTime(fixed);
+    };
+    auto dayMatches = [this, &tm]() {
+        if (anyDay && anyWeekday) return true;
+        if (anyDay) return static_cast<bool>(weekdays[tm.tm_wday]);
+        if (anyWeekday) return static_cast<bool>(days[tm.tm_mday]);
+        return days[tm.tm_mday] || weekdays[tm.tm_wday];
+    };
+
+    // Avança pelo campo mais significativo que não casa; limitado a ~5 anos
+    for (int guard = 0; guard < 5 * 366 * 24 + 60 * 24; ++guard) {
+        if (!months[tm.tm_mon + 1]) {
+            tm.tm_mon += 1; tm.tm_mday = 1; tm.tm_hour = 0; tm.tm_min = 0;
+        } else if (!dayMatches()) {
+            tm.tm_mday += 1; tm.tm_hour = 0; tm.tm_min = 0;
+        } else if (!hours[tm.tm_hour]) {
+            tm.tm_hour += 1; tm.tm_min = 0;
+        } else if (!minutes[tm.tm_min]) {
+            tm.tm_min += 1;
+        } else {
+            tm.tm_isdst = -1;
+            return std::chrono::system_clock::from_time_t(std::mktime(&tm));
+        }
+        normalize();
+    }
+    return std::chrono::system_clock::time_point::max();
+}
+
+bool ParseMacroOptions(const std::string& spec, MacroOptions& out, std::string& error) {
+    std::istringstream in(spec);
+    std::vector<std::string> t;
+    for (std::string w; in >> w;) t.push_back(w);
+
+    MacroOptions options = out;
+    for (size_t i = 0; i < t.size(); ++i) {
+        std::string word = ToLower(t[i]);
+        size_t eq = word.find('=');
+
+        if (word == "manual") {
+            options.trigger = MacroTrigger();
+        } else if (word == "every" && i + 1 < t.size()) {
+            options.trigger = MacroTrigger();
+            options.trigger.type = TriggerType::Interval;
+            if (!ParseInterval(t[++i], options.trigger.interval)) {
+                error = "intervalo inválido '" + t[i] + "'";
+                return false;
+            }
+        } else if (word == "cron" && i + 5 < t.size()) {
+            std::string expr = t[i + 1] + " " + t[i + 2] + " " + t[i + 3] + " " + t[i + 4] + " " + t[i + 5];
+            options.trigger = MacroTrigger();
+            options.trigger.type = TriggerType::Cron;
+            if (!CronSpec::Parse(expr, options.trigger.cron, error)) return false;
+            i += 5;
+        } else if (word == "at" && i + 1 < t.size()) {
+            // Atalho para um horário diário: "at 14:30" == "cron 30 14 * * *"
+            std::string hhmm = t[++i];
+            size_t colon = hhmm.find(':');
+            int hour, minute;
+            if (colon == std::string::npos || !ParseNumber(hhmm.substr(0, colon), hour) ||
+                !ParseNumber(hhmm.substr(colon + 1), minute)) {
+                error = "horário inválido '" + hhmm + "'";
+                return false;
+            }
+            options.trigger = MacroTrigger();
+            options.trigger.type = TriggerType::Cron;
+            if (!CronSpec::Parse(std::to_string(minute) + " " + std::to_string(hour) + " * * *", options.trigger.cron, error))
+                return false;
+        } else if (word == "hotkey" && i + 1 < t.size()) {
+            options.trigger = MacroTrigger();
+            options.trigger.type = TriggerType::Hotkey;
+            std::stringstream combo(t[++i]);
+            std::string part;
+            std::vector<std::string> parts;
+            while (std::getline(combo, part, '+')) parts.push_back(part);
+            for (size_t p = 0; p + 1 < parts.size(); ++p) {
+                std::string mod = ToLower(parts[p]);
+                if (mod == "ctrl") options.trigger.hotkeyModifiers |= HOTKEY_CTRL;
+                else if (mod == "shift") options.trigger.hotkeyModifiers |= HOTKEY_SHIFT;
+                else if (mod == "alt") options.trigger.hotkeyModifiers |= HOTKEY_ALT;
+                else { error = "modificador inválido '" + parts[p] + "'"; return false; }
+            }
+            std::int32_t vk;
+            if (parts.empty() || !ParseKeyName(parts.back(), vk)) {
+                error = "tecla de atalho inválida '" + t[i] + "'";
+                return false;
+            }
+            options.trigger.hotkeyVk = static_cast<std::uint16_t>(vk);
+        } else if (word == "throughput") {
+            options.timing.maxThroughput = true;
+        } else if (word == "normalize") {
+            options.normalizeModifiers = true;
+        } else if (eq != std::string::npos) {
+            std::string key = word.substr(0, eq);
+            std::string value = t[i].substr(eq + 1);
+            if (key == "prio" || key == "priority") {
+                if (!ParseNumber(value, options.priority)) { error = "prioridade inválida '" + value + "'"; return false; }
+            } else if (key == "group") {
+                options.exclusionGroup = value;
+            } else if (key == "name") {
+                options.name = value;
+            } else if (key == "humanize") {
+                options.humanize = true;
+                options.variationMax = std::strtod(value.c_str(), nullptr);
+            } else if (key == "rate") {
+                char* end = nullptr;
+                double rate = std::strtod(value.c_str(), &end);
+                if (value.empty() || !end || *end != '\0' ||
+                    rate < PlaybackTiming::kMinRate || rate > PlaybackTiming::kMaxRate) {
+                    error = "velocidade inválida '" + value + "' (0.1 a 100)";
+                    return false;
+                }
+                options.timing.rate = rate;
+            } else if (key == "idlecap") {
+                std::chrono::milliseconds cap;
+                if (!ParseInterval(value, cap)) { error = "limite de pausa inválido '" + value + "'"; return false; }
+                options.timing.idleCapMicros = cap.count() * 1000;
+            } else if (key == "cadence") {
+                std::chrono::milliseconds cadence(0);
+                if (value != "0" && !ParseInterval(value, cadence)) { error = "cadência inválida '" + value + "'"; return false; }
+                options.typeCharMicros = cadence.count() * 1000;
+            } else if (key == "seed") {
+                char* end = nullptr;
+                options.seed = std::strtoull(value.c_str(), &end, 10);
+                if (value.empty() || !end || *end != '\0') { error = "semente inválida '" + value + "'"; return false; }
+            } else {
+                error = "opção desconhecida '" + key + "'";
+                return false;
+            }
+        } else {
+            error = "termo inválido '" + t[i] + "'";
+            return false;
+        }
+    }
+
+    out = options;
+    return true;
+}
+
+std::int64_t PlaybackTiming::Apply(std::int64_t micros, std::uint8_t waitFlags) const {
+    if (waitFlags & WAIT_REQUIRED) return micros;
+    if (maxThroughput) return 0;
+    double r = std::min(kMaxRate, std::max(kMinRate, rate));
+    if (r != 1.0) micros = static_cast<std::int64_t>(micros / r);
+    if (idleCapMicros > 0) micros = std::min(micros, idleCapMicros);
+    return micros;
+}
+
+// =============================================
+// FILA DE INJEÇÃO
+// =============================================
+
+InjectionQueue::InjectionQueue(MacroSink& output) : output(output) {
+    worker = std::thread(&InjectionQueue::ThreadMain, this);
+}
+
+InjectionQueue::~InjectionQueue() {
+    Shutdown();
+}
+
+void InjectionQueue::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    available.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void InjectionQueue::ReleaseMacro(int macroId, int priority) {
+    Push({InputEvent::Release, RELEASE_ALL, false, 0, 0, -1, macroId, priority, NowTick(), 0, 0, {}});
+}
+
+void InjectionQueue::Push(InputEvent event) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        event.sequence = nextSequence++;
+        queue.push(event);
+    }
+    available.notify_one();
+}
+
+void InjectionQueue::DropMacro(int macroId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<InputEvent> kept;
+    kept.reserve(queue.size());
+    const std::uint64_t now = NowTick();
+    while (!queue.empty()) {
+        InputEvent event = queue.top();
+        queue.pop();
+        if (event.macroId != macroId) {
+            kept.push_back(std::move(event));
+        } else if (event.type == InputEvent::Release) {
+            // O que ficou pressionado é solto já, sem esperar os eventos descartados
+            event.dueTick = std::min(event.dueTick, now);
+            kept.push_back(std::move(event));
+        }
+    }
+    for (const auto& event : kept) queue.push(event);
+}
+
+size_t InjectionQueue::Depth() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+namespace {
+
+const char* InjectionSpanName(InputEvent::Type type) {
+    switch (type) {
+        case InputEvent::Key: return "injetar tecla";
+        case InputEvent::Click: return "injetar clique";
+        case InputEvent::Move: return "injetar movimento";
+        case InputEvent::Wheel: return "injetar rolagem";
+        case InputEvent::Text: return "injetar texto";
+        case InputEvent::Release: return "soltar presos";
+    }
+    return "injetar";
+}
+
+} // namespace
+
+void InjectionQueue::ThreadMain() {
+    TraceRecorder::Global().SetThreadName("injeção");
+    TelemetryRing& telemetry = TelemetryRing::Global();
+    AppMetrics& metrics = AppMetrics::Get();
+    size_t publishedDepth = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (queue.empty()) {
+            available.wait(lock);
+            continue;
+        }
+        if (queue.top().dueTick > NowTick()) {
+            available.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::milliseconds(queue.top().dueTick)));
+            continue;
+        }
+        InputEvent event = queue.top();
+        queue.pop();
+        const size_t depth = queue.size();
+        lock.unlock();
+
+        ScopedTraceSpan span(InjectionSpanName(event.type), "injeção");
+        switch (event.type) {
+            case InputEvent::Key:
+                output.OnKey(event.key, event.pressed);
+                break;
+            case InputEvent::Click:
+                output.OnMouseClick(event.key, event.pressed, event.x, event.y, event.monitorIndex);
+                break;
+            case InputEvent::Move:
+                output.OnMouseMove(event.x, event.y, event.monitorIndex);
+                break;
+            case InputEvent::Wheel:
+                output.OnMouseWheel(event.key, event.delta, event.monitorIndex);
+                break;
+            case InputEvent::Text:
+                output.OnText(event.text);
+                break;
+            case InputEvent::Release:
+                ReleaseHeld(event.macroId, static_cast<std::uint8_t>(event.key));
+                break;
+        }
+        Track(event);
+        // Atraso em relação ao instante previsto (resolução do instante: 1 ms)
+        const std::int64_t lateMicros = TelemetryRing::NowMicros() - static_cast<std::int64_t>(event.dueTick) * 1000;
+        telemetry.Publish(TelemetryKind::Injected, event.type, event.macroId, lateMicros);
+        metrics.injectedEvents.Add();
+        metrics.injectionLatency.Record(lateMicros);
+        if (depth != publishedDepth) {
+            telemetry.Publish(TelemetryKind::QueueDepth, 0, -1, static_cast<std::int64_t>(depth));
+            metrics.injectionQueueDepth.Set(static_cast<std::int64_t>(depth));
+            publishedDepth = depth;
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    // Encerramento (aplicativo fechando): nada fica pressionado
+    HeldInputs all;
+    for (const auto& entry : held) {
+        all.keys |= entry.second.keys;
+        all.buttons |= entry.second.buttons;
+    }
+    held.clear();
+    if (all.Any()) output.OnReleaseInputs(all);
+}
+
+void InjectionQueue::Track(const InputEvent& event) {
+    if (event.type != InputEvent::Key && event.type != InputEvent::Click) return;
+    HeldInputs& inputs = held[event.macroId];
+    if (event.type == InputEvent::Key && event.key < inputs.keys.size()) inputs.keys.set(event.key, event.pressed);
+    if (event.type == InputEvent::Click && event.key < inputs.buttons.size()) inputs.buttons.set(event.key, event.pressed);
+    if (!inputs.Any()) held.erase(event.macroId);
+}
+
+void InjectionQueue::ReleaseHeld(int macroId, std::uint8_t scope) {
+    auto it = held.find(macroId);
+    if (it == held.end()) return;
+    HeldInputs release = it->second;
+    if (scope != RELEASE_ALL) {
+        release.keys &= HeldInputs::ModifierKeys();
+        release.buttons.reset();
+    }
+    it->second.keys &= ~release.keys;
+    it->second.buttons &= ~release.buttons;
+    if (!it->second.Any()) held.erase(it);
+    // Uma tecla que outra macro também segura continua pressionada
+    for (const auto& other : held) {
+        if (other.first == macroId) continue;
+        release.keys &= ~other.second.keys;
+        release.buttons &= ~other.second.buttons;
+    }
+    if (release.Any()) output.OnReleaseInputs(release);
+}
+
+// =============================================
+// THREAD DAS ESPERAS PELA TELA
+// =============================================
+
+CaptureWorker::CaptureWorker() {
+    worker = std::thread(&CaptureWorker::ThreadMain, this);
+}
+
+CaptureWorker::~CaptureWorker() {
+    Shutdown();
+}
+
+void CaptureWorker::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+        jobs.clear();
+    }
+    available.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void CaptureWorker::Post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        jobs.push_back(std::move(job));
+    }
+    available.notify_one();
+}
+
+void CaptureWorker::ThreadMain() {
+    TraceRecorder::Global().SetThreadName("esperas pela tela");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (jobs.empty()) {
+            available.wait(lock);
+            continue;
+        }
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+// =============================================
+// AGENDADOR
+// =============================================
+
+// Coleta os eventos da VM de uma macro e os envia para a fila única.
+// Com humanização, desloca o ponto de cada movimento dentro do raio do perfil
+// e o percorre em curva a partir da posição anterior.
+class MacroScheduler::QueueSink : public MacroSink {
+public:
+    QueueSink(InjectionQueue& queue, int macroId, const MacroOptions& options, Humanizer* humanizer)
+        : queue(queue), macroId(macroId), priority(options.priority), options(options), humanizer(humanizer) {}
+
+    // Nova execução
+    void ResetPosition() {
+        hasPosition = false;
+        repetitions = 0;
+    }
+    // Nova execução: janelas localizadas de novo
+    void SetWindowResolver(std::shared_ptr<WindowResolver> resolver) {
+        windowResolver = std::move(resolver);
+        windows.clear();
+    }
+    // Janela que o último MoveWin esperou (WAIT_WINDOW) e quem a localiza
+    const std::string& PendingWindow() const { return pendingWindow; }
+    std::shared_ptr<WindowResolver> Resolver() const { return windowResolver; }
+    // Resultado da busca (0 = não achada), válido até o fim da repetição
+    void SetWindowHandle(const std::string& window, WindowResolver::Handle handle) {
+        windows[window] = handle;
+        pendingWindow.clear();
+    }
+    // Duração da última digitação, para a espera WAIT_TYPING que a segue
+    std::int64_t TypingMicros() const { return typingMicros; }
+    // Fronteiras de repetição já passadas nesta execução
+    std::uint64_t Repetitions() const { return repetitions; }
+
+    void OnKey(std::uint16_t vk, bool pressed) override {
+        queue.Push({InputEvent::Key, vk, pressed, 0, 0, -1, macroId, priority, NextDue(), 0, 0, {}});
+    }
+    void OnMouseClick(int button, bool pressed, int relX, int relY, int monitorIndex) override {
+        queue.Push({InputEvent::Click, static_cast<std::uint16_t>(button), pressed, relX, relY, monitorIndex,
+                    macroId, priority, NextDue(), 0, 0, {}});
+    }
+    void OnMouseMove(int relX, int relY, int monitorIndex) override {
+        std::uint64_t due = NextDue();
+        if (humanizer) {
+            auto offset = humanizer->ClickOffset();
+            relX += offset.first;
+            relY += offset.second;
+            // Máxima velocidade: sem curva, direto ao ponto
+            if (hasPosition && lastMonitor == monitorIndex && !options.timing.maxThroughput) {
+                // Passo da curva na velocidade da reprodução (frações de ms acumuladas)
+                const double step = std::max(1, humanizer->Profile().pathStepMs) /
+                    std::clamp(options.timing.rate, PlaybackTiming::kMinRate, PlaybackTiming::kMaxRate);
+                const std::uint64_t start = due;
+                double elapsed = 0;
+                for (const auto& point : humanizer->CurvePath(lastX, lastY, relX, relY)) {
+                    queue.Push({InputEvent::Move, 0, false, point.first, point.second, monitorIndex,
+                                macroId, priority, due, 0, 0, {}});
+                    elapsed += step;
+                    due = start + static_cast<std::uint64_t>(elapsed);
+                }
+            }
+        }
+        queue.Push({InputEvent::Move, 0, false, relX, relY, monitorIndex, macroId, priority, due, 0, 0, {}});
+        lastMoveDue = due;
+        lastX = relX;
+        lastY = relY;
+        lastMonitor = monitorIndex;
+        hasPosition = true;
+    }
+    bool OnMouseMoveInWindow(const WindowPointSpec& point) override {
+        int relX = point.x;
+        int relY = point.y;
+        int monitorIndex = point.monitorIndex;
+        if (windowResolver) {
+            // Uma busca por janela a cada repetição; o retângulo fica em cache no resolvedor.
+            // A busca (EnumWindows) fica com o agendador, fora do lock: a VM para
+            // com WAIT_WINDOW e repete o MoveWin depois de SetWindowHandle
+            auto it = windows.find(point.window);
+            if (it == windows.end()) {
+                pendingWindow = point.window;
+                return false;
+            }
+            if (it->second && !windowResolver->ToScreen(it->second, point.offsetX, point.offsetY, relX, relY, monitorIndex)) {
+                // Fechada ou minimizada no meio da repetição: posição gravada, e procura de novo na próxima vez
+                relX = point.x;
+                relY = point.y;
+                monitorIndex = point.monitorIndex;
+                windows.erase(it);
+            }
+        }
+        OnMouseMove(relX, relY, monitorIndex);
+        return true;
+    }
+    void OnMouseWheel(int axis, int delta, int monitorIndex) override {
+        InputEvent event = {InputEvent::Wheel, static_cast<std::uint16_t>(axis), false, lastX, lastY, monitorIndex,
+                            macroId, priority, NextDue(), 0, 0, {}};
+        event.delta = delta;
+        queue.Push(event);
+    }
+    void OnReleaseHeld(std::uint8_t scope) override {
+        if (scope == RELEASE_REPETITION) {
+            windows.clear();
+            ++repetitions;
+        }
+        if (scope == RELEASE_REPETITION && !options.normalizeModifiers) return;
+        queue.Push({InputEvent::Release, scope, false, 0, 0, -1, macroId, priority, NextDue(), 0, 0, {}});
+    }
+    void OnText(const std::string& utf8) override {
+        // Cadência gerada aqui: cada caractere ganha seu instante na fila.
+        // Caracteres com o mesmo instante (cadência 0, máxima velocidade) vão
+        // juntos num único evento, injetado num só SendInput.
+        const std::uint64_t now = NowTick();
+        const std::uint64_t start = NextDue();
+        std::int64_t offset = 0;
+        std::uint64_t chunkDue = start;
+        std::string chunk;
+        auto flush = [&]() {
+            if (chunk.empty()) return;
+            InputEvent event = {InputEvent::Text, 0, false, 0, 0, -1, macroId, priority, chunkDue, 0, 0, {}};
+            event.text = std::move(chunk);
+            queue.Push(std::move(event));
+            chunk.clear();
+        };
+        for (size_t i = 0; i < utf8.size();) {
+            size_t next = i + 1;
+            while (next < utf8.size() && (static_cast<unsigned char>(utf8[next]) & 0xC0) == 0x80) ++next;
+            const std::uint64_t due = start + static_cast<std::uint64_t>(offset / 1000);
+            if (due != chunkDue) flush();
+            chunkDue = due;
+            chunk.append(utf8, i, next - i);
+            std::int64_t step = options.typeCharMicros;
+            if (humanizer && step > 0) step = humanizer->Delay(step, 0);
+            offset += options.timing.Apply(step, WAIT_HUMANIZE);
+            i = next;
+        }
+        flush();
+        // A espera WAIT_TYPING conta também o resto da curva antes do texto
+        typingMicros = offset + static_cast<std::int64_t>(start - now) * 1000;
+    }
+
+private:
+    // Sem espera entre um Move e o evento seguinte (clique de script, máxima
+    // velocidade, velocidades altas): o evento vai depois do fim da curva
+    std::uint64_t NextDue() const { return std::max(NowTick(), lastMoveDue); }
+
+    InjectionQueue& queue;
+    int macroId;
+    int priority;
+    const MacroOptions& options;
+    Humanizer* humanizer;   // nulo sem humanização
+    bool hasPosition = false;
+    int lastX = 0;
+    int lastY = 0;
+    int lastMonitor = -1;
+    std::uint64_t lastMoveDue = 0;
+    std::int64_t typingMicros = 0;
+    std::uint64_t repetitions = 0;
+    std::shared_ptr<WindowResolver> windowResolver;
+    std::unordered_map<std::string, WindowResolver::Handle> windows;   // da repetição atual (0 = não achada)
+    std::string pendingWindow;
+};
+
+struct MacroScheduler::Macro {
+    MacroId id = 0;
+    MacroProgram program;
+    MacroOptions options;
+    MacroVM vm;
+    std::unique_ptr<QueueSink> sink;
+    bool running = false;
+    bool queued = false;
+    std::uint64_t runs = 0;
+    TimerWheel::Clock::time_point startedAt;
+    TimerWheel::Clock::time_point finishedAt;
+    std::uint64_t generation = 0;     // invalida fatias agendadas de execuções anteriores
+    std::uint64_t queuedOrder = 0;
+    TimerWheel::TimerId sliceTimer = 0;
+    TimerWheel::TimerId triggerTimer = 0;
+    // Prazo da fatia atual: as esperas somam a partir dele (e não do instante em
+    // que a fatia rodou), então atrasos de tick não se acumulam ao longo da macro
+    TimerWheel::Clock::time_point deadline;
+    std::int64_t waitingSince = 0;    // rastreamento: início da espera pela próxima fatia (us)
+    Humanizer humanizer;
+    // Espera pela tela em andamento; o observador fica fora da macro durante a captura
+    std::int64_t region = -1;
+    TimerWheel::Clock::time_point regionTimeout;
+    std::unique_ptr<ScreenWatcher> regionWatcher;
+    std::vector<std::shared_ptr<const PixelImage>> references;   // por região do programa, carregadas no primeiro uso
+};
+
+MacroScheduler::MacroScheduler(TimerWheel& wheel, MacroSink& output)
+    : wheel(wheel), injection(output) {
+}
+
+MacroScheduler::~MacroScheduler() {
+    // Uma captura em andamento ainda agenda o resultado (sob o lock), que é cancelado abaixo
+    captureWorker.Shutdown();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : macros) {
+        CancelTimersLocked(*entry.second);
+    }
+    macros.clear();
+}
+
+void MacroScheduler::SetStateCallback(StateCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stateCallback = std::move(callback);
+}
+
+void MacroScheduler::SetCaptureBackend(std::shared_ptr<CaptureBackend> backend) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capture = std::move(backend);
+}
+
+void MacroScheduler::SetWindowResolver(std::shared_ptr<WindowResolver> resolver) {
+    std::lock_guard<std::mutex> lock(mutex);
+    windowResolver = std::move(resolver);
+}
+
+MacroScheduler::MacroId MacroScheduler::Add(MacroProgram program, MacroOptions options) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto macro = std::make_unique<Macro>();
+    macro->id = nextId++;
+    macro->program = std::move(program);
+    macro->options = std::move(options);
+    macro->sink = std::make_unique<QueueSink>(injection, macro->id, macro->options,
+                                              macro->options.humanize ? &macro->humanizer : nullptr);
+    Macro& ref = *macro;
+    macros.emplace(ref.id, std::move(macro));
+    ArmTrigger(ref);
+    return ref.id;
+}
+
+void MacroScheduler::Replace(MacroId id, MacroProgram program, MacroOptions options) {
+    Stop(id);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    if (it == macros.end()) return;
+    Macro& macro = *it->second;
+    CancelTimersLocked(macro);
+    macro.program = std::move(program);
+    macro.options = std::move(options);
+    macro.references.clear();
+    macro.sink = std::make_unique<QueueSink>(injection, macro.id, macro.options,
+                                             macro.options.humanize ? &macro.humanizer : nullptr);
+    ArmTrigger(macro);
+}
+
+void MacroScheduler::Remove(MacroId id) {
+    Stop(id);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    if (it == macros.end()) return;
+    CancelTimersLocked(*it->second);
+    macros.erase(it);
+}
+
+void MacroScheduler::CancelTimersLocked(Macro& macro) {
+    if (macro.sliceTimer) wheel.Cancel(macro.sliceTimer);
+    if (macro.triggerTimer) wheel.Cancel(macro.triggerTimer);
+    macro.sliceTimer = 0;
+    macro.triggerTimer = 0;
+}
+
+void MacroScheduler::ArmTrigger(Macro& macro) {
+    const MacroId id = macro.id;
+    const MacroTrigger& trigger = macro.options.trigger;
+
+    if (trigger.type == TriggerType::Interval && trigger.interval.count() > 0) {
+        macro.triggerTimer = wheel.ScheduleAfter(trigger.interval, [this, id]() { Fire(id); });
+    } else if (trigger.type == TriggerType::Cron) {
+        auto now = std::chrono::system_clock::now();
+        auto next = trigger.cron.Next(now);
+        if (next != std::chrono::system_clock::time_point::max()) {
+            macro.triggerTimer = wheel.ScheduleAfter(next - now, [this, id]() { Fire(id); });
+        }
+    }
+}
+
+void MacroScheduler::Fire(MacroId id) {
+    std::vector<std::function<void()>> notifications;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = macros.find(id);
+        if (it == macros.end()) return;
+        Macro& macro = *it->second;
+        macro.triggerTimer = 0;
+        ArmTrigger(macro);
+
+        if (macro.running || macro.queued) {
+            // Disparo enquanto a execução anterior ainda não terminou
+            AppMetrics::Get().runsSkipped.Add();
+            if (stateCallback) {
+                auto callback = stateCallback;
+                notifications.push_back([callback, id]() { callback(id, RunEvent::Skipped, "execução anterior em andamento"); });
+            }
+        } else {
+            TryStartLocked(macro, std::chrono::milliseconds(0));
+        }
+    }
+    for (auto& notify : notifications) notify();
+}
+
+bool MacroScheduler::Start(MacroId id, std::chrono::milliseconds initialDelay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    if (it == macros.end()) return false;
+    Macro& macro = *it->second;
+    if (macro.running || macro.queued) return false;
+    return TryStartLocked(macro, initialDelay);
+}
+
+bool MacroScheduler::TryStartLocked(Macro& macro, std::chrono::milliseconds initialDelay) {
+    const std::string& group = macro.options.exclusionGroup;
+    if (!group.empty()) {
+        auto active = activeGroups.find(group);
+        if (active != activeGroups.end() && active->second != macro.id) {
+            // Grupo ocupado: espera na fila do grupo (ordem por prioridade)
+            macro.queued = true;
+            macro.queuedOrder = ++queueCounter;
+            return true;
+        }
+        activeGroups[group] = macro.id;
+    }
+
+    macro.queued = false;
+    macro.running = true;
+    macro.runs++;
+    AppMetrics::Get().runsStarted.Add();
+    macro.startedAt = TimerWheel::Clock::now() + initialDelay;
+    macro.generation++;
+    macro.vm.SetProgram(&macro.program);
+    // Uma semente por execução: repetida via options.seed, reproduz a execução inteira
+    const std::uint64_t seed = macro.options.seed ? macro.options.seed : Humanizer::RandomSeed();
+    macro.humanizer.SetProfile(macro.options.profile);
+    macro.humanizer.Reset(seed);
+    macro.sink->ResetPosition();
+    macro.sink->SetWindowResolver(windowResolver);
+
+    const MacroId id = macro.id;
+    const std::uint64_t generation = macro.generation;
+    macro.deadline = TimerWheel::Clock::now() + initialDelay;
+    macro.sliceTimer = wheel.ScheduleAt(macro.deadline, [this, id, generation]() { RunSlice(id, generation); });
+
+    if (stateCallback) {
+        auto callback = stateCallback;
+        // Started é notificado de forma assíncrona para não chamar código externo sob o lock
+        wheel.ScheduleAfter(std::chrono::milliseconds(0), [callback, id, seed]() {
+            callback(id, RunEvent::Started, std::to_string(seed));
+        });
+    }
+    return true;
+}
+
+void MacroScheduler::StartQueuedLocked(const std::string& group) {
+    Macro* best = nullptr;
+    for (auto& entry : macros) {
+        Macro& candidate = *entry.second;
+        if (!candidate.queued || candidate.options.exclusionGroup != group) continue;
+        if (!best || candidate.options.priority > best->options.priority ||
+            (candidate.options.priority == best->options.priority && candidate.queuedOrder < best->queuedOrder)) {
+            best = &candidate;
+        }
+    }
+    if (best) {
+        best->queued = false;
+        TryStartLocked(*best, std::chrono::milliseconds(0));
+    }
+}
+
+std::int64_t MacroScheduler::TransformWait(Macro& macro, const VMResult& wait) {
+    // Digitação: a fila já recebeu os caracteres espaçados pela cadência
+    // (humanizada e escalada); a VM só espera o texto terminar
+    if (wait.waitFlags & WAIT_TYPING) return macro.sink->TypingMicros();
+    std::int64_t micros = wait.waitMicros;
+    if (macro.options.humanize) {
+        if (wait.waitFlags & WAIT_DWELL) {
+            micros = macro.humanizer.Dwell(micros);
+        } else if (wait.waitFlags & WAIT_HUMANIZE) {
+            micros = macro.humanizer.Delay(micros, static_cast<std::int64_t>(macro.options.variationMax * 1e6));
+        }
+    }
+    // Velocidade e modos de tempo por cima da humanização (a semente continua
+    // reproduzindo a mesma sequência em qualquer velocidade)
+    return macro.options.timing.Apply(micros, wait.waitFlags);
+}
+
+void MacroScheduler::RunSlice(MacroId id, std::uint64_t generation) {
+    std::vector<std::function<void()>> notifications;
+    // MoveWin parado em WAIT_WINDOW: a janela é localizada depois do lock
+    std::string window;
+    std::shared_ptr<WindowResolver> resolver;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = macros.find(id);
+        if (it == macros.end()) return;
+        Macro& macro = *it->second;
+        if (!macro.running || macro.generation != generation) return;
+        macro.sliceTimer = 0;
+        TraceRecorder& tracer = TraceRecorder::Global();
+        if (macro.waitingSince && tracer.ShouldSample()) {
+            tracer.Record("espera", "agendador", macro.waitingSince, TraceRecorder::NowMicros() - macro.waitingSince, id);
+        }
+        macro.waitingSince = 0;
+        ScopedTraceSpan span("fatia", "agendador");
+        const std::int64_t lateMicros =
+            std::chrono::duration_cast<std::chrono::microseconds>(TimerWheel::Clock::now() - macro.deadline).count();
+        TelemetryRing::Global().Publish(TelemetryKind::SchedulerLate, 0, id, lateMicros);
+        AppMetrics::Get().schedulerLateness.Record(lateMicros);
+
+        VMResult result = macro.vm.Run(*macro.sink, kSliceBudget);
+        // Esperas zeradas (máxima velocidade) seguem na mesma fatia, sem volta pela roda
+        std::int64_t micros = result.status == VMStatus::Waiting ? TransformWait(macro, result) : 0;
+        for (int resumed = 0; result.status == VMStatus::Waiting && !(result.waitFlags & (WAIT_REGION | WAIT_WINDOW)) &&
+                              micros <= 0 && resumed < kZeroWaitResumes; ++resumed) {
+            result = macro.vm.Run(*macro.sink, kSliceBudget);
+            micros = result.status == VMStatus::Waiting ? TransformWait(macro, result) : 0;
+        }
+        switch (result.status) {
+            case VMStatus::Waiting: {
+                if (result.waitFlags & WAIT_REGION) {
+                    BeginRegionWaitLocked(macro, result.waitMicros);
+                    break;
+                }
+                if (result.waitFlags & WAIT_WINDOW) {
+                    window = macro.sink->PendingWindow();
+                    resolver = macro.sink->Resolver();
+                    break;
+                }
+                auto now = TimerWheel::Clock::now();
+                macro.deadline += std::chrono::microseconds(micros);
+                if (macro.deadline < now - kMaxTimingDebt) {
+                    // Muito atrasada (máquina ocupada, depurador): recomeça do agora
+                    macro.deadline = now;
+                    AppMetrics::Get().schedulerOverruns.Add();
+                }
+                macro.sliceTimer = wheel.ScheduleAt(macro.deadline,
+                    [this, id, generation]() { RunSlice(id, generation); });
+                if (tracer.IsActive()) macro.waitingSince = TraceRecorder::NowMicros();
+                break;
+            }
+            case VMStatus::BudgetExhausted:
+                // Cede a vez: as outras macros rodam antes da próxima fatia
+                macro.deadline = TimerWheel::Clock::now();
+                macro.sliceTimer = wheel.ScheduleAt(macro.deadline,
+                    [this, id, generation]() { RunSlice(id, generation); });
+                break;
+            case VMStatus::Halted:
+                FinishLocked(macro, RunEvent::Finished, "", notifications);
+                break;
+            case VMStatus::Error:
+                FinishLocked(macro, RunEvent::Failed, macro.vm.LastError(), notifications);
+                break;
+        }
+    }
+    for (auto& notify : notifications) notify();
+    if (resolver) ResolveWindow(id, generation, window, *resolver);
+}
+
+void MacroScheduler::ResolveWindow(MacroId id, std::uint64_t generation, const std::string& window,
+                                   WindowResolver& resolver) {
+    // EnumWindows pode demorar e o lock também é tomado por OnHotkey, na thread
+    // dos hooks: segurá-lo aqui atrasaria a entrada do sistema inteiro
+    WindowTarget target;
+    WindowResolver::Handle handle = 0;
+    if (WindowTarget::Decode(window, target)) handle = resolver.Find(target);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    if (it == macros.end()) return;
+    Macro& macro = *it->second;
+    if (!macro.running || macro.generation != generation) return;
+    macro.sink->SetWindowHandle(window, handle);
+    // Pela roda, e não direto: uma janela por repetição não aprofunda a pilha
+    macro.sliceTimer = wheel.ScheduleAt(macro.deadline, [this, id, generation]() { RunSlice(id, generation); });
+}
+
+void MacroScheduler::BeginRegionWaitLocked(Macro& macro, std::int64_t region) {
+    if (macro.references.size() != macro.program.regions.size()) {
+        macro.references.assign(macro.program.regions.size(), nullptr);
+    }
+    // A primeira captura sai no prazo da espera (as entradas anteriores já
+    // foram injetadas); o tempo limite conta a partir dele
+    auto now = TimerWheel::Clock::now();
+    if (macro.deadline < now - kMaxTimingDebt) macro.deadline = now;
+    macro.region = region;
+    macro.regionTimeout = macro.deadline + std::chrono::microseconds(macro.program.regions[region].timeoutMicros);
+    macro.regionWatcher.reset();
+    const MacroId id = macro.id;
+    const std::uint64_t generation = macro.generation;
+    macro.sliceTimer = wheel.ScheduleAt(macro.deadline, [this, id, generation]() { PollRegion(id, generation); });
+}
+
+// Uma consulta de espera pela tela: o que a roda separou sob o lock, o
+// observador (que guarda o estado entre consultas) e o resultado
+struct MacroScheduler::RegionPoll {
+    MacroId id;
+    std::uint64_t generation;
+    RegionWaitSpec spec;
+    std::shared_ptr<CaptureBackend> backend;
+    std::shared_ptr<const PixelImage> reference;
+    std::unique_ptr<ScreenWatcher> watcher;
+    bool ok = false;
+    bool matched = false;
+    std::string error;
+};
+
+void MacroScheduler::PollRegion(MacroId id, std::uint64_t generation) {
+    auto poll = std::make_shared<RegionPoll>();
+    poll->id = id;
+    poll->generation = generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = macros.find(id);
+        if (it == macros.end()) return;
+        Macro& macro = *it->second;
+        if (!macro.running || macro.generation != generation) return;
+        macro.sliceTimer = 0;
+        poll->backend = capture;
+        poll->spec = macro.program.regions[macro.region];
+        poll->reference = macro.references[macro.region];
+        poll->watcher = std::move(macro.regionWatcher);
+    }
+    captureWorker.Post([this, poll]() { CaptureRegion(poll); });
+}
+
+void MacroScheduler::CaptureRegion(const std::shared_ptr<RegionPoll>& poll) {
+    // Leitura da referência, captura e comparação fora da roda e sem o lock:
+    // as outras macros continuam no tempo delas
+    const RegionWaitSpec& spec = poll->spec;
+    bool ok = poll->backend != nullptr;
+    if (!ok) poll->error = "captura de tela indisponível";
+    if (ok && !poll->reference) {
+        auto image = std::make_shared<PixelImage>();
+        ok = LoadPixelImage(spec.reference, *image, poll->error);
+        poll->reference = std::move(image);
+    }
+    if (ok && !poll->watcher && spec.anchor) {
+        const PixelImage& reference = *poll->reference;
+        poll->watcher = std::make_unique<AnchorWatcher>(reference, spec.monitorIndex, spec.x, spec.y,
+                                                        spec.offsetX >= 0 ? spec.offsetX : reference.width / 2,
+                                                        spec.offsetY >= 0 ? spec.offsetY : reference.height / 2,
+                                                        spec.searchRadius, spec.minScorePerMille / 1000.0);
+    } else if (ok && !poll->watcher) {
+        const size_t pixels = static_cast<size_t>(poll->reference->width) * static_cast<size_t>(poll->reference->height);
+        poll->watcher = std::make_unique<RegionWatcher>(poll->reference, spec.monitorIndex, spec.x, spec.y, spec.tolerance,
+                                                        pixels * static_cast<size_t>(spec.mismatchPerMille) / 1000);
+    }
+    if (ok) ok = poll->watcher->Poll(*poll->backend, poll->matched, poll->error);
+    poll->ok = ok;
+
+    // O resultado volta para a roda como a próxima fatia da macro (parar a
+    // macro cancela o temporizador como cancelaria o de uma espera)
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(poll->id);
+    if (it == macros.end()) return;
+    Macro& macro = *it->second;
+    if (!macro.running || macro.generation != poll->generation) return;
+    macro.sliceTimer = wheel.ScheduleAfter(std::chrono::milliseconds(0), [this, poll]() { FinishRegionPoll(*poll); });
+}
+
+void MacroScheduler::FinishRegionPoll(RegionPoll& poll) {
+    const MacroId id = poll.id;
+    const std::uint64_t generation = poll.generation;
+    const RegionWaitSpec& spec = poll.spec;
+    std::vector<std::function<void()>> notifications;
+    bool resume = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = macros.find(id);
+        if (it == macros.end()) return;
+        Macro& macro = *it->second;
+        if (!macro.running || macro.generation != generation) return;
+        macro.sliceTimer = 0;
+        if (poll.ok) macro.references[macro.region] = poll.reference;
+
+        auto now = TimerWheel::Clock::now();
+        if (!poll.ok) {
+            FinishLocked(macro, RunEvent::Failed, "espera pela tela: " + poll.error, notifications);
+        } else if (poll.matched || now >= macro.regionTimeout) {
+            if (!poll.matched && spec.failOnTimeout) {
+                FinishLocked(macro, RunEvent::Failed, (spec.anchor ? "imagem não encontrada na tela ('"
+                                                                   : "tempo esgotado esperando a tela ('") +
+                             spec.reference + "', " + poll.watcher->LastResult() + ")", notifications);
+            } else {
+                // Âncora: o cursor vai até a imagem (ou, não achada, à posição
+                // gravada) antes do clique que vem a seguir no programa
+                if (spec.anchor) {
+                    const auto& anchor = static_cast<const AnchorWatcher&>(*poll.watcher);
+                    if (poll.matched) macro.sink->OnMouseMove(anchor.ClickX(), anchor.ClickY(), anchor.ClickMonitor());
+                    else macro.sink->OnMouseMove(spec.x, spec.y, spec.monitorIndex);
+                }
+                // Segue no instante em que a tela ficou pronta
+                macro.region = -1;
+                macro.deadline = now;
+                resume = true;
+            }
+        } else {
+            auto next = std::min(macro.regionTimeout, now + std::chrono::microseconds(poll.watcher->NextIntervalMicros()));
+            macro.regionWatcher = std::move(poll.watcher);
+            macro.sliceTimer = wheel.ScheduleAt(next, [this, id, generation]() { PollRegion(id, generation); });
+        }
+    }
+    for (auto& notify : notifications) notify();
+    if (resume) RunSlice(id, generation);
+}
+
+void MacroScheduler::FinishLocked(Macro& macro, RunEvent event, const std::string& detail,
+                                  std::vector<std::function<void()>>& notifications) {
+    macro.running = false;
+    macro.finishedAt = TimerWheel::Clock::now();
+    AppMetrics& metrics = AppMetrics::Get();
+    switch (event) {
+        case RunEvent::Finished: metrics.runsFinished.Add(); break;
+        case RunEvent::Stopped: metrics.runsStopped.Add(); break;
+        case RunEvent::Failed: metrics.runsFailed.Add(); break;
+        default: break;
+    }
+    macro.generation++;
+    if (macro.sliceTimer) {
+        wheel.Cancel(macro.sliceTimer);
+        macro.sliceTimer = 0;
+    }
+    // Nenhuma tecla ou botão fica preso, termine a macro como terminar
+    injection.ReleaseMacro(macro.id, macro.options.priority);
+
+    const std::string& group = macro.options.exclusionGroup;
+    if (!group.empty()) {
+        auto active = activeGroups.find(group);
+        if (active != activeGroups.end() && active->second == macro.id) {
+            activeGroups.erase(active);
+            StartQueuedLocked(group);
+        }
+    }
+
+    if (stateCallback) {
+        auto callback = stateCallback;
+        const MacroId id = macro.id;
+        notifications.push_back([callback, id, event, detail]() { callback(id, event, detail); });
+    }
+}
+
+void MacroScheduler::Stop(MacroId id) {
+    std::vector<std::function<void()>> notifications;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = macros.find(id);
+        if (it == macros.end()) return;
+        Macro& macro = *it->second;
+        macro.queued = false;
+        if (macro.running) {
+            FinishLocked(macro, RunEvent::Stopped, "", notifications);
+        }
+    }
+    injection.DropMacro(id);
+    for (auto& notify : notifications) notify();
+}
+
+void MacroScheduler::StopAll() {
+    std::vector<MacroId> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : macros) ids.push_back(entry.first);
+    }
+    for (MacroId id : ids) Stop(id);
+}
+
+bool MacroScheduler::OnHotkey(std::uint16_t vk, std::uint16_t modifiers) {
+    std::vector<MacroId> matches;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : macros) {
+            const MacroTrigger& trigger = entry.second->options.trigger;
+            if (trigger.type == TriggerType::Hotkey && trigger.hotkeyVk == vk && trigger.hotkeyModifiers == modifiers) {
+                matches.push_back(entry.first);
+            }
+        }
+    }
+    // O hook não pode esperar: o disparo em si acontece na thread da roda
+    for (MacroId id : matches) {
+        wheel.ScheduleAfter(std::chrono::milliseconds(0), [this, id]() { Fire(id); });
+    }
+    return !matches.empty();
+}
+
+bool MacroScheduler::IsRunning(MacroId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    return it != macros.end() && (it->second->running || it->second->queued);
+}
+
+std::uint64_t MacroScheduler::LastSeed(MacroId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = macros.find(id);
+    return it != macros.end() ? it->second->humanizer.Seed() : 0;
+}
+
+size_t MacroScheduler::RunningCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (auto& entry : macros) {
+        if (entry.second->running) ++count;
+    }
+    return count;
+}
+
+MacroScheduler::RunStatus MacroScheduler::Status(MacroId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    RunStatus status;
+    auto it = macros.find(id);
+    if (it == macros.end()) return status;
+    const Macro& macro = *it->second;
+    status.exists = true;
+    status.running = macro.running;
+    status.queued = macro.queued;
+    status.runs = macro.runs;
+    if (macro.runs > 0) {
+        status.repetition = macro.sink->Repetitions() + 1;
+        // Ainda no atraso inicial: zero
+        const auto end = macro.running ? TimerWheel::Clock::now() : macro.finishedAt;
+        status.elapsedMicros = std::max<std::int64_t>(0,
+            std::chrono::duration_cast<std::chrono::microseconds>(end - macro.startedAt).count());
+        status.seed = macro.humanizer.Seed();
+    }
+    return status;
+}
+
+std::vector<std::pair<MacroScheduler::MacroId, MacroOptions>> MacroScheduler::List() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<MacroId, MacroOptions>> result;
+    for (auto& entry : macros) {
+        result.emplace_back(entry.first, entry.second->options);
+    }
+    return result;
+}
@@ -0,0 +1,267 @@
+#ifndef MACROSCHEDULER_H
+#define MACROSCHEDULER_H
+
+#include "humanizer.h"
+#include "macrovm.h"
+#include "timerwheel.h"
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Expressão cron de 5 campos: "minuto hora dia-do-mês mês dia-da-semana"
+struct CronSpec {
+    std::bitset<60> minutes;
+    std::bitset<24> hours;
+    std::bitset<32> days;       // 1..31
+    std::bitset<13> months;     // 1..12
+    std::bitset<7> weekdays;    // 0 = domingo
+    bool anyDay = true;
+    bool anyWeekday = true;
+
+    static bool Parse(const std::string& text, CronSpec& out, std::string& error);
+    // Próximo disparo estritamente depois de 'after' (hora local)
+    std::chrono::system_clock::time_point Next(std::chrono::system_clock::time_point after) const;
+};
+
+enum class TriggerType {
+    Manual,     // só por Start() (botão de reprodução, controle externo)
+    Interval,
+    Cron,
+    Hotkey
+};
+
+struct MacroTrigger {
+    TriggerType type = TriggerType::Manual;
+    std::chrono::milliseconds interval{0};
+    CronSpec cron;
+    std::uint16_t hotkeyVk = 0;
+    std::uint16_t hotkeyModifiers = 0;   // HOTKEY_* abaixo
+};
+
+enum HotkeyModifiers : std::uint16_t {
+    HOTKEY_CTRL = 1 << 0,
+    HOTKEY_SHIFT = 1 << 1,
+    HOTKEY_ALT = 1 << 2
+};
+
+// Modos de tempo aplicados às esperas na reprodução, sem alterar o programa.
+// Esperas WAIT_REQUIRED ficam de fora de todos eles.
+struct PlaybackTiming {
+    static constexpr double kMinRate = 0.1;
+    static constexpr double kMaxRate = 100.0;
+
+    double rate = 1.0;                  // 2.0 = duas vezes mais rápido
+    std::int64_t idleCapMicros = 0;     // > 0: nenhuma espera passa disso ("comprimir pausas")
+    bool maxThroughput = false;         // remove as esperas: entrada tão rápida quanto aceita
+
+    std::int64_t Apply(std::int64_t micros, std::uint8_t waitFlags) const;
+};
+
+struct MacroOptions {
+    std::string name;
+    int priority = 0;               // maior = injetado primeiro em caso de empate
+    std::string exclusionGroup;     // macros do mesmo grupo nunca rodam juntas
+    MacroTrigger trigger;
+    bool humanize = false;
+    double variationMax = 0.0;      // segundos: desvio máximo das esperas WAIT_HUMANIZE (0 = sem limite)
+    HumanizeProfile profile;
+    PlaybackTiming timing;
+    std::uint64_t seed = 0;         // 0 = semente nova a cada execução (informada em Started)
+    std::int64_t typeCharMicros = 30000;   // cadência dos textos digitados (0 = texto inteiro de uma vez)
+    bool normalizeModifiers = false;       // solta Shift/Ctrl/Alt/Win presos antes de cada repetição
+};
+
+// "every 30s prio=5 group=teclado", "cron */5 * * * *", "at 14:30", "hotkey ctrl+F6", "seed=42",
+// "rate=4", "idlecap=2s", "throughput", "cadence=40ms", "normalize"
+bool ParseMacroOptions(const std::string& spec, MacroOptions& out, std::string& error);
+
+// Evento pronto para injeção, vindo de qualquer macro em execução
+struct InputEvent {
+    enum Type : std::uint8_t { Key, Click, Move, Wheel, Text, Release } type;
+    std::uint16_t key;          // tecla, botão, eixo da roda ou ReleaseScope
+    bool pressed;
+    int x;
+    int y;
+    int monitorIndex;
+    int macroId;
+    int priority;
+    std::uint64_t dueTick;    // milissegundo a partir do qual pode ser injetado
+    std::uint64_t sequence;
+    int delta = 0;            // só Wheel
+    std::string text;         // só Text (UTF-8)
+};
+
+// Fila única de injeção: uma thread consome os eventos de todas as macros na
+// ordem (instante, prioridade, chegada) e os entrega ao destino final.
+// Eventos com instante no futuro (pontos de uma curva do mouse) esperam na fila.
+// Guarda, por macro, as teclas e botões injetados e ainda não soltos: ao fim da
+// macro (parada, erro ou término) eles são soltos numa única injeção, exceto o
+// que outra macro em execução também mantém pressionado.
+class InjectionQueue {
+public:
+    explicit InjectionQueue(MacroSink& output);
+    ~InjectionQueue();
+
+    void Push(InputEvent event);
+    // Descarta os eventos pendentes da macro (os pedidos de Release ficam)
+    void DropMacro(int macroId);
+    // Solta tudo que a macro mantém pressionado, depois dos eventos já na fila
+    void ReleaseMacro(int macroId, int priority);
+    size_t Depth() const;
+    void Shutdown();
+
+private:
+    struct Later {
+        bool operator()(const InputEvent& a, const InputEvent& b) const {
+            if (a.dueTick != b.dueTick) return a.dueTick > b.dueTick;
+            if (a.priority != b.priority) return a.priority < b.priority;
+            return a.sequence > b.sequence;
+        }
+    };
+
+    void ThreadMain();
+    void Track(const InputEvent& event);
+    void ReleaseHeld(int macroId, std::uint8_t scope);
+
+    MacroSink& output;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::priority_queue<InputEvent, std::vector<InputEvent>, Later> queue;
+    std::uint64_t nextSequence = 0;
+    bool running = true;
+    std::thread worker;
+    std::map<int, HeldInputs> held;     // só na thread da fila
+};
+
+class CaptureBackend;
+class WindowResolver;
+
+// Thread das esperas pela tela. Captura, leitura da referência e busca da
+// âncora levam de milissegundos a dezenas deles (4K, várias telas): na thread
+// da roda atrasariam as fatias das outras macros, os atalhos e o autosave.
+// Os trabalhos rodam em ordem, um por vez.
+class CaptureWorker {
+public:
+    CaptureWorker();
+    ~CaptureWorker();
+
+    void Post(std::function<void()> job);
+    // Espera o trabalho em andamento; os que não começaram são descartados
+    void Shutdown();
+
+private:
+    void ThreadMain();
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<std::function<void()>> jobs;
+    bool running = true;
+    std::thread worker;
+};
+
+// Agendador de várias macros sobre uma única roda de temporizadores: cada macro
+// em execução é uma VM retomada pelo temporizador da sua próxima espera, sem
+// thread própria. Macros ociosas custam apenas uma entrada na roda.
+// Esperas pela tela (WAIT_REGION) também são temporizadores: cada um manda uma
+// captura para o CaptureWorker, recebe o resultado de volta na roda e reagenda
+// a si mesmo até a região coincidir (ou, nos cliques por imagem, até a âncora
+// aparecer; o cursor então vai até ela).
+// A roda deve ser parada (Shutdown) antes de destruir o agendador, para que
+// nenhum callback em andamento alcance um objeto destruído.
+class MacroScheduler {
+public:
+    using MacroId = int;
+
+    enum class RunEvent { Started, Finished, Stopped, Failed, Skipped };   // Started: detail = semente
+    // Chamado na thread da roda; quem precisa da GUI deve reencaminhar
+    using StateCallback = std::function<void(MacroId id, RunEvent event, const std::string& detail)>;
+
+    MacroScheduler(TimerWheel& wheel, MacroSink& output);
+    ~MacroScheduler();
+
+    MacroId Add(MacroProgram program, MacroOptions options);
+    void Replace(MacroId id, MacroProgram program, MacroOptions options);
+    void Remove(MacroId id);
+
+    // Disparo manual; false se a macro não existe ou já está em execução/fila
+    bool Start(MacroId id, std::chrono::milliseconds initialDelay = std::chrono::milliseconds(0));
+    void Stop(MacroId id);
+    void StopAll();
+
+    // Chamado pelo hook global; true se alguma macro usa essa combinação
+    bool OnHotkey(std::uint16_t vk, std::uint16_t modifiers);
+
+    bool IsRunning(MacroId id) const;
+    // Semente da última execução (para repetir uma execução com falha)
+    std::uint64_t LastSeed(MacroId id) const;
+    size_t RunningCount() const;
+    size_t QueueDepth() const { return injection.Depth(); }
+    std::vector<std::pair<MacroId, MacroOptions>> List() const;
+
+    // Andamento da execução atual (ou da última, se parada)
+    struct RunStatus {
+        bool exists = false;
+        bool running = false;
+        bool queued = false;
+        std::uint64_t runs = 0;             // execuções iniciadas
+        std::uint64_t repetition = 0;       // repetição em andamento (1 = primeira; 0 = nunca rodou)
+        std::int64_t elapsedMicros = 0;     // desde o início; parada: duração da última execução
+        std::uint64_t seed = 0;
+    };
+    RunStatus Status(MacroId id) const;
+
+    void SetStateCallback(StateCallback callback);
+    // Origem das capturas das esperas pela tela (sem ela, essas esperas falham)
+    void SetCaptureBackend(std::shared_ptr<CaptureBackend> backend);
+    // Localização das janelas dos cliques gravados com a janela de destino
+    // (sem ela, esses cliques vão à posição gravada). Vale a partir da próxima execução.
+    void SetWindowResolver(std::shared_ptr<WindowResolver> resolver);
+
+private:
+    struct Macro;
+    class QueueSink;
+
+    void ArmTrigger(Macro& macro);
+    void Fire(MacroId id);
+    bool TryStartLocked(Macro& macro, std::chrono::milliseconds initialDelay);
+    void StartQueuedLocked(const std::string& group);
+    void RunSlice(MacroId id, std::uint64_t generation);
+    // MoveWin em WAIT_WINDOW: localiza a janela sem o lock e agenda a fatia de novo
+    void ResolveWindow(MacroId id, std::uint64_t generation, const std::string& window, WindowResolver& resolver);
+    struct RegionPoll;
+    void BeginRegionWaitLocked(Macro& macro, std::int64_t region);
+    // Roda: separa o que a consulta precisa e a manda para o CaptureWorker
+    void PollRegion(MacroId id, std::uint64_t generation);
+    // CaptureWorker: captura e compara sem o lock, e agenda o resultado na roda
+    void CaptureRegion(const std::shared_ptr<RegionPoll>& poll);
+    // Roda: aplica o resultado (segue a macro, falha ou reagenda a consulta)
+    void FinishRegionPoll(RegionPoll& poll);
+    void FinishLocked(Macro& macro, RunEvent event, const std::string& detail,
+                      std::vector<std::function<void()>>& notifications);
+    void CancelTimersLocked(Macro& macro);
+    std::int64_t TransformWait(Macro& macro, const VMResult& wait);
+
+    TimerWheel& wheel;
+    InjectionQueue injection;
+    CaptureWorker captureWorker;
+    mutable std::mutex mutex;
+    std::map<MacroId, std::unique_ptr<Macro>> macros;
+    std::map<std::string, MacroId> activeGroups;
+    MacroId nextId = 1;
+    std::uint64_t queueCounter = 0;
+    StateCallback stateCallback;
+    std::shared_ptr<CaptureBackend> capture;
+    std::shared_ptr<WindowResolver> windowResolver;
+};
+
+#endif // MACROSCHEDULER_H
@@ -0,0 +1,1141 @@
+#include "macrovm.h"
+#include "actionstream.h"
+#include "actiontable.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+namespace {
+
+const char* kOpNames[] = {
+    "halt", "nop", "key", "click", "move", "wait", "waitr", "loadi", "addi",
+    "add", "sub", "mov", "jmp", "jz", "jnz", "jlt", "djnz", "call", "ret", "wheel", "text",
+    "release", "movewin"
+};
+static_assert(sizeof(kOpNames) / sizeof(kOpNames[0]) == static_cast<size_t>(OpCode::Count),
+              "kOpNames desatualizado");
+
+inline std::int32_t PackPoint(int x, int y) {
+    x = std::max(0, std::min(0xFFFF, x));
+    y = std::max(0, std::min(0xFFFF, y));
+    return static_cast<std::int32_t>((static_cast<std::uint32_t>(x) << 16) | static_cast<std::uint32_t>(y));
+}
+
+inline int PointX(std::int32_t imm) { return static_cast<int>((static_cast<std::uint32_t>(imm) >> 16) & 0xFFFF); }
+inline int PointY(std::int32_t imm) { return static_cast<int>(static_cast<std::uint32_t>(imm) & 0xFFFF); }
+inline int MonitorFromField(std::uint8_t c) { return static_cast<int>(c) - 1; }
+inline std::uint8_t MonitorToField(int monitorIndex) {
+    return static_cast<std::uint8_t>(std::max(-1, std::min(254, monitorIndex)) + 1);
+}
+
+// Caracteres (pontos de código) de um texto UTF-8
+std::int32_t CountCodePoints(const std::string& utf8) {
+    std::int32_t count = 0;
+    for (unsigned char byte : utf8) count += (byte & 0xC0) != 0x80;
+    return count;
+}
+
+// Aritmética dos registradores com volta (complemento de dois), como o
+// hardware: estouro num script não pode ser comportamento indefinido
+inline std::int32_t WrapAdd(std::int32_t a, std::int32_t b) {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) + static_cast<std::uint32_t>(b));
+}
+inline std::int32_t WrapSub(std::int32_t a, std::int32_t b) {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) - static_cast<std::uint32_t>(b));
+}
+
+bool IsJump(OpCode op) {
+    return op == OpCode::Jmp || op == OpCode::Jz || op == OpCode::Jnz ||
+           op == OpCode::Jlt || op == OpCode::Djnz || op == OpCode::Call;
+}
+
+// Verifica uma única vez o que o interpretador assume sem checar no laço
+// quente: opcodes válidos, registradores e alvos de salto dentro dos limites e
+// Halt como última instrução.
+bool ValidateProgram(const MacroProgram& program, std::string& error) {
+    if (program.code.empty() || program.code.back().op != OpCode::Halt) {
+        error = "programa não termina com halt";
+        return false;
+    }
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        const Instruction& ins = program.code[i];
+        if (ins.op >= OpCode::Count) {
+            error = "opcode inválido na instrução " + std::to_string(i);
+            return false;
+        }
+        bool usesRegA = ins.op == OpCode::WaitReg || ins.op == OpCode::LoadI || ins.op == OpCode::AddI ||
+                        ins.op == OpCode::Add || ins.op == OpCode::Sub || ins.op == OpCode::Mov ||
+                        ins.op == OpCode::Jz || ins.op == OpCode::Jnz || ins.op == OpCode::Jlt ||
+                        ins.op == OpCode::Djnz;
+        bool usesRegB = ins.op == OpCode::Add || ins.op == OpCode::Sub || ins.op == OpCode::Mov || ins.op == OpCode::Jlt;
+        bool usesRegC = ins.op == OpCode::Add || ins.op == OpCode::Sub;
+        if ((usesRegA && ins.a >= MacroVM::kRegisterCount) ||
+            (usesRegB && ins.b >= MacroVM::kRegisterCount) ||
+            (usesRegC && ins.c >= MacroVM::kRegisterCount)) {
+            error = "registrador inválido na instrução " + std::to_string(i);
+            return false;
+        }
+        if (IsJump(ins.op) && (ins.imm < 0 || static_cast<size_t>(ins.imm) >= program.code.size())) {
+            error = "salto fora do programa na instrução " + std::to_string(i);
+            return false;
+        }
+        if (ins.op == OpCode::Text && (ins.imm < 0 || static_cast<size_t>(ins.imm) >= program.texts.size())) {
+            error = "texto inexistente na instrução " + std::to_string(i);
+            return false;
+        }
+        if (ins.op == OpCode::MoveWin && (ins.imm < 0 || static_cast<size_t>(ins.imm) >= program.windows.size())) {
+            error = "janela inexistente na instrução " + std::to_string(i);
+            return false;
+        }
+        if (ins.op == OpCode::Wait && (ins.a & WAIT_REGION) &&
+            (ins.imm < 0 || static_cast<size_t>(ins.imm) >= program.regions.size())) {
+            error = "região inexistente na instrução " + std::to_string(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const std::bitset<256>& HeldInputs::ModifierKeys() {
+    // Shift, Ctrl, Alt (genéricos e lados esquerdo/direito) e as teclas Windows
+    static const std::bitset<256> modifiers = [] {
+        std::bitset<256> bits;
+        for (int vk : {0x10, 0x11, 0x12, 0x5B, 0x5C, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5}) bits.set(vk);
+        return bits;
+    }();
+    return modifiers;
+}
+
+void MacroSink::OnReleaseInputs(const HeldInputs& held) {
+    for (size_t vk = 0; vk < held.keys.size(); ++vk) {
+        if (held.keys[vk]) OnKey(static_cast<std::uint16_t>(vk), false);
+    }
+    for (size_t button = 0; button < held.buttons.size(); ++button) {
+        if (held.buttons[button]) OnMouseClick(static_cast<int>(button), false, 0, 0, -1);
+    }
+}
+
+std::vector<std::string> MacroProgram::Disassemble() const {
+    std::vector<std::string> lines;
+    lines.reserve(code.size());
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Instruction& ins = code[i];
+        std::ostringstream out;
+        out << i << ": " << (ins.op < OpCode::Count ? kOpNames[static_cast<int>(ins.op)] : "???");
+        switch (ins.op) {
+            case OpCode::Key:
+                out << " " << ins.imm << (ins.a ? " down" : " up");
+                break;
+            case OpCode::Click:
+                out << " btn" << int(ins.a) << (ins.b ? " down" : " up")
+                    << " (" << PointX(ins.imm) << "," << PointY(ins.imm) << ") mon " << MonitorFromField(ins.c);
+                break;
+            case OpCode::Move:
+                out << " (" << PointX(ins.imm) << "," << PointY(ins.imm) << ") mon " << MonitorFromField(ins.c);
+                break;
+            case OpCode::MoveWin:
+                if (ins.imm >= 0 && static_cast<size_t>(ins.imm) < windows.size()) {
+                    const WindowPointSpec& point = windows[ins.imm];
+                    out << " \"" << point.window << "\" +" << point.offsetX << ",+" << point.offsetY
+                        << " (" << point.x << "," << point.y << ") mon " << point.monitorIndex;
+                }
+                break;
+            case OpCode::Wheel:
+                out << (ins.a == kWheelHorizontal ? " h " : " v ") << ins.imm << " mon " << MonitorFromField(ins.c);
+                break;
+            case OpCode::Wait:
+                if ((ins.a & WAIT_REGION) && ins.imm >= 0 && static_cast<size_t>(ins.imm) < regions.size() &&
+                    regions[ins.imm].anchor) {
+                    const RegionWaitSpec& anchor = regions[ins.imm];
+                    out << " anchor \"" << anchor.reference << "\" (" << anchor.x << "," << anchor.y << ") mon "
+                        << anchor.monitorIndex << " at " << anchor.offsetX << "," << anchor.offsetY
+                        << " radius " << anchor.searchRadius << " score " << anchor.minScorePerMille
+                        << " timeout " << anchor.timeoutMicros << "us" << (anchor.failOnTimeout ? " !" : "");
+                    break;
+                }
+                if ((ins.a & WAIT_REGION) && ins.imm >= 0 && static_cast<size_t>(ins.imm) < regions.size()) {
+                    const RegionWaitSpec& region = regions[ins.imm];
+                    out << " screen \"" << region.reference << "\" (" << region.x << "," << region.y << ") mon "
+                        << region.monitorIndex << " tol " << region.tolerance << " diff " << region.mismatchPerMille
+                        << " timeout " << region.timeoutMicros << "us" << (region.failOnTimeout ? " !" : "");
+                    break;
+                }
+                out << " " << ins.imm << ((ins.a & WAIT_TYPING) ? " chars typing" : "us")
+                    << ((ins.a & WAIT_HUMANIZE) ? " ~" : "") << ((ins.a & WAIT_DWELL) ? " dwell" : "")
+                    << ((ins.a & WAIT_REQUIRED) ? " !" : "");
+                break;
+            case OpCode::Text:
+                if (ins.imm >= 0 && static_cast<size_t>(ins.imm) < texts.size()) out << " \"" << texts[ins.imm] << "\"";
+                break;
+            case OpCode::Release:
+                out << (ins.a == RELEASE_MODIFIERS ? " mods" : ins.a == RELEASE_REPETITION ? " rep" : " all");
+                break;
+            case OpCode::WaitReg:
+                out << " r" << int(ins.a);
+                break;
+            case OpCode::LoadI:
+            case OpCode::AddI:
+                out << " r" << int(ins.a) << ", " << ins.imm;
+                break;
+            case OpCode::Add:
+            case OpCode::Sub:
+                out << " r" << int(ins.a) << ", r" << int(ins.b) << ", r" << int(ins.c);
+                break;
+            case OpCode::Mov:
+                out << " r" << int(ins.a) << ", r" << int(ins.b);
+                break;
+            case OpCode::Jmp:
+            case OpCode::Call:
+                out << " " << ins.imm;
+                break;
+            case OpCode::Jz:
+            case OpCode::Jnz:
+            case OpCode::Djnz:
+                out << " r" << int(ins.a) << ", " << ins.imm;
+                break;
+            case OpCode::Jlt:
+                out << " r" << int(ins.a) << ", r" << int(ins.b) << ", " << ins.imm;
+                break;
+            default:
+                break;
+        }
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+// =============================================
+// INTERPRETADOR
+// =============================================
+
+MacroVM::MacroVM(const MacroProgram* program) {
+    SetProgram(program);
+}
+
+void MacroVM::SetProgram(const MacroProgram* newProgram) {
+    program = newProgram;
+    Reset();
+    if (program && !ValidateProgram(*program, lastError)) {
+        program = nullptr;
+    }
+}
+
+void MacroVM::Reset() {
+    std::fill(std::begin(regs), std::end(regs), 0);
+    sp = 0;
+    pc = 0;
+    executed = 0;
+    lastError.clear();
+}
+
+VMResult MacroVM::Fail(const std::string& message) {
+    lastError = message;
+    return {VMStatus::Error, 0, 0};
+}
+
+VMResult MacroVM::Run(MacroSink& sink, std::uint64_t maxInstructions) {
+#if MACROVM_COMPUTED_GOTO
+    return RunThreaded(sink, maxInstructions);
+#else
+    return RunSwitch(sink, maxInstructions);
+#endif
+}
+
+VMResult MacroVM::RunSwitch(MacroSink& sink, std::uint64_t maxInstructions) {
+    if (!program) {
+        return Fail(lastError.empty() ? "nenhum programa carregado" : lastError);
+    }
+
+    const Instruction* code = program->code.data();
+    std::uint32_t ip = pc;
+    std::uint64_t n = 0;
+
+    for (;;) {
+        const Instruction& ins = code[ip++];
+        ++n;
+        switch (ins.op) {
+            case OpCode::Halt:
+                pc = ip - 1;
+                executed += n;
+                return {VMStatus::Halted, 0, 0};
+            case OpCode::Nop:
+                break;
+            case OpCode::Key:
+                sink.OnKey(static_cast<std::uint16_t>(ins.imm), ins.a != 0);
+                break;
+            case OpCode::Click:
+                sink.OnMouseClick(ins.a, ins.b != 0, PointX(ins.imm), PointY(ins.imm), MonitorFromField(ins.c));
+                break;
+            case OpCode::Move:
+                sink.OnMouseMove(PointX(ins.imm), PointY(ins.imm), MonitorFromField(ins.c));
+                break;
+            case OpCode::MoveWin:
+                if (!sink.OnMouseMoveInWindow(program->windows[ins.imm])) {
+                    pc = ip - 1;
+                    executed += n;
+                    return {VMStatus::Waiting, 0, WAIT_WINDOW};
+                }
+                break;
+            case OpCode::Wheel:
+                sink.OnMouseWheel(ins.a, ins.imm, MonitorFromField(ins.c));
+                break;
+            case OpCode::Text:
+                sink.OnText(program->texts[ins.imm]);
+                break;
+            case OpCode::Release:
+                sink.OnReleaseHeld(ins.a);
+                break;
+            case OpCode::Wait:
+                pc = ip;
+                executed += n;
+                return {VMStatus::Waiting, ins.imm, ins.a};
+            case OpCode::WaitReg:
+                pc = ip;
+                executed += n;
+                return {VMStatus::Waiting, std::max<std::int64_t>(0, regs[ins.a]) * 1000, ins.b};
+            case OpCode::LoadI:
+                regs[ins.a] = ins.imm;
+                break;
+            case OpCode::AddI:
+                regs[ins.a] = WrapAdd(regs[ins.a], ins.imm);
+                break;
+            case OpCode::Add:
+                regs[ins.a] = WrapAdd(regs[ins.b], regs[ins.c]);
+                break;
+            case OpCode::Sub:
+                regs[ins.a] = WrapSub(regs[ins.b], regs[ins.c]);
+                break;
+            case OpCode::Mov:
+                regs[ins.a] = regs[ins.b];
+                break;
+            case OpCode::Jmp:
+                ip = ins.imm;
+                break;
+            case OpCode::Jz:
+                if (regs[ins.a] == 0) ip = ins.imm;
+                break;
+            case OpCode::Jnz:
+                if (regs[ins.a] != 0) ip = ins.imm;
+                break;
+            case OpCode::Jlt:
+                if (regs[ins.a] < regs[ins.b]) ip = ins.imm;
+                break;
+            case OpCode::Djnz:
+                regs[ins.a] = WrapSub(regs[ins.a], 1);
+                if (regs[ins.a] != 0) ip = ins.imm;
+                break;
+            case OpCode::Call:
+                if (sp >= kStackDepth) {
+                    pc = ip - 1;
+                    executed += n;
+                    return Fail("estouro da pilha de chamadas");
+                }
+                stack[sp++] = ip;
+                ip = ins.imm;
+                break;
+            case OpCode::Ret:
+                if (sp == 0) {
+                    pc = ip - 1;
+                    executed += n;
+                    return Fail("ret sem call correspondente");
+                }
+                ip = stack[--sp];
+                break;
+            default:
+                pc = ip - 1;
+                executed += n;
+                return Fail("opcode inválido");
+        }
+        // O limite só é verificado após saltos: código linear sempre termina
+        if (IsJump(ins.op) && n >= maxInstructions) {
+            pc = ip;
+            executed += n;
+            return {VMStatus::BudgetExhausted, 0, 0};
+        }
+    }
+}
+
+#if MACROVM_COMPUTED_GOTO
+VMResult MacroVM::RunThreaded(MacroSink& sink, std::uint64_t maxInstructions) {
+    if (!program) {
+        return Fail(lastError.empty() ? "nenhum programa carregado" : lastError);
+    }
+
+    // Mesma ordem do enum OpCode
+    static const void* const dispatch[] = {
+        &&op_halt, &&op_nop, &&op_key, &&op_click, &&op_move, &&op_wait, &&op_waitreg,
+        &&op_loadi, &&op_addi, &&op_add, &&op_sub, &&op_mov, &&op_jmp, &&op_jz,
+        &&op_jnz, &&op_jlt, &&op_djnz, &&op_call, &&op_ret, &&op_wheel, &&op_text,
+        &&op_release, &&op_movewin
+    };
+    static_assert(sizeof(dispatch) / sizeof(dispatch[0]) == static_cast<size_t>(OpCode::Count),
+                  "tabela de despacho desatualizada");
+
+    const Instruction* code = program->code.data();
+    const Instruction* ins = nullptr;
+    std::uint32_t ip = pc;
+    std::uint64_t n = 0;
+
+#define VM_NEXT() do { ins = &code[ip++]; ++n; goto *dispatch[static_cast<std::uint8_t>(ins->op)]; } while (0)
+#define VM_BRANCH() do { if (n >= maxInstructions) goto budget_exhausted; VM_NEXT(); } while (0)
+
+    VM_NEXT();
+
+op_halt:
+    pc = ip - 1;
+    executed += n;
+    return {VMStatus::Halted, 0, 0};
+op_nop:
+    VM_NEXT();
+op_key:
+    sink.OnKey(static_cast<std::uint16_t>(ins->imm), ins->a != 0);
+    VM_NEXT();
+op_click:
+    sink.OnMouseClick(ins->a, ins->b != 0, PointX(ins->imm), PointY(ins->imm), MonitorFromField(ins->c));
+    VM_NEXT();
+op_move:
+    sink.OnMouseMove(PointX(ins->imm), PointY(ins->imm), MonitorFromField(ins->c));
+    VM_NEXT();
+op_movewin:
+    if (!sink.OnMouseMoveInWindow(program->windows[ins->imm])) {
+        pc = ip - 1;
+        executed += n;
+        return {VMStatus::Waiting, 0, WAIT_WINDOW};
+    }
+    VM_NEXT();
+op_wheel:
+    sink.OnMouseWheel(ins->a, ins->imm, MonitorFromField(ins->c));
+    VM_NEXT();
+op_text:
+    sink.OnText(program->texts[ins->imm]);
+    VM_NEXT();
+op_release:
+    sink.OnReleaseHeld(ins->a);
+    VM_NEXT();
+op_wait:
+    pc = ip;
+    executed += n;
+    return {VMStatus::Waiting, ins->imm, ins->a};
+op_waitreg:
+    pc = ip;
+    executed += n;
+    return {VMStatus::Waiting, std::max<std::int64_t>(0, regs[ins->a]) * 1000, ins->b};
+op_loadi:
+    regs[ins->a] = ins->imm;
+    VM_NEXT();
+op_addi:
+    regs[ins->a] = WrapAdd(regs[ins->a], ins->imm);
+    VM_NEXT();
+op_add:
+    regs[ins->a] = WrapAdd(regs[ins->b], regs[ins->c]);
+    VM_NEXT();
+op_sub:
+    regs[ins->a] = WrapSub(regs[ins->b], regs[ins->c]);
+    VM_NEXT();
+op_mov:
+    regs[ins->a] = regs[ins->b];
+    VM_NEXT();
+op_jmp:
+    ip = ins->imm;
+    VM_BRANCH();
+op_jz:
+    if (regs[ins->a] == 0) ip = ins->imm;
+    VM_BRANCH();
+op_jnz:
+    if (regs[ins->a] != 0) ip = ins->imm;
+    VM_BRANCH();
+op_jlt:
+    if (regs[ins->a] < regs[ins->b]) ip = ins->imm;
+    VM_BRANCH();
+op_djnz:
+    regs[ins->a] = WrapSub(regs[ins->a], 1);
+    if (regs[ins->a] != 0) ip = ins->imm;
+    VM_BRANCH();
+op_call:
+    if (sp >= kStackDepth) {
+        pc = ip - 1;
+        executed += n;
+        return Fail("estouro da pilha de chamadas");
+    }
+    stack[sp++] = ip;
+    ip = ins->imm;
+    VM_BRANCH();
+op_ret:
+    if (sp == 0) {
+        pc = ip - 1;
+        executed += n;
+        return Fail("ret sem call correspondente");
+    }
+    ip = stack[--sp];
+    VM_NEXT();
+
+budget_exhausted:
+    pc = ip;
+    executed += n;
+    return {VMStatus::BudgetExhausted, 0, 0};
+
+#undef VM_BRANCH
+#undef VM_NEXT
+}
+#endif
+
+// =============================================
+// COMPILADOR
+// =============================================
+
+namespace {
+
+// Compila uma gravação ação por ação, sem olhar adiante: serve tanto para o
+// vetor de ações quanto para o fluxo codificado decodificado bloco a bloco.
+class RecordingEmitter {
+public:
+    RecordingEmitter(MacroProgram& program, int repetitions, size_t startAction, int startRepetition)
+        : program(program), startAction(startAction) {
+        repetitions = std::max(1, repetitions);
+        program.Emit({OpCode::LoadI, kRep, 0, 0, std::max(1, repetitions - std::max(0, startRepetition))});
+        if (startAction > 0) {
+            // Entrada no meio da gravação; corrigido quando a ação aparecer
+            entryJump = program.size();
+            program.Emit({OpCode::Jmp, 0, 0, 0, 0});
+        }
+        top = static_cast<std::int32_t>(program.size());
+    }
+
+    void Add(const Action& action, std::int32_t source) {
+        if (entryJump && static_cast<size_t>(source) == startAction) {
+            program.code[entryJump].imm = static_cast<std::int32_t>(program.size());
+        }
+        const ActionKind kind = ActionKindFromString(action.type);
+        switch (kind) {
+            case ActionKind::KeyPress:
+                program.Emit({OpCode::Key, std::uint8_t(action.pressed), 0, 0, action.key}, source);
+                break;
+            case ActionKind::MouseClick:
+                // Movimento + espera de estabilidade + clique + pequena espera;
+                // com a janela de destino gravada, o movimento é até o ponto dela
+                if (!action.text.empty()) {
+                    WindowPointSpec point;
+                    point.window = action.text;
+                    point.offsetX = WindowOffsetX(action.delta);
+                    point.offsetY = WindowOffsetY(action.delta);
+                    point.x = action.x;
+                    point.y = action.y;
+                    point.monitorIndex = action.monitorIndex;
+                    program.Emit({OpCode::MoveWin, 0, 0, 0, static_cast<std::int32_t>(program.windows.size())}, source);
+                    program.windows.push_back(std::move(point));
+                } else {
+                    program.Emit({OpCode::Move, 0, 0, MonitorToField(action.monitorIndex), PackPoint(action.x, action.y)}, source);
+                }
+                program.Emit({OpCode::Wait, 0, 0, 0, MacroCompiler::kMoveSettleMicros + 150000}, source);
+                program.Emit({OpCode::Click, std::uint8_t(action.key), std::uint8_t(action.pressed),
+                              MonitorToField(action.monitorIndex), PackPoint(action.x, action.y)}, source);
+                program.Emit({OpCode::Wait, 0, 0, 0, 50000}, source);
+                break;
+            case ActionKind::MouseMove:
+                program.Emit({OpCode::Move, 0, 0, MonitorToField(action.monitorIndex), PackPoint(action.x, action.y)}, source);
+                program.Emit({OpCode::Wait, 0, 0, 0, MacroCompiler::kMoveSettleMicros}, source);
+                break;
+            case ActionKind::MouseWheel:
+                // Rolagem onde foi gravada: sem a espera de estabilidade, para
+                // que uma sequência de rolagens mantenha o ritmo gravado
+                program.Emit({OpCode::Move, 0, 0, MonitorToField(action.monitorIndex), PackPoint(action.x, action.y)}, source);
+                program.Emit({OpCode::Wheel, std::uint8_t(action.key == kWheelHorizontal ? kWheelHorizontal : kWheelVertical),
+                              0, MonitorToField(action.monitorIndex), action.delta}, source);
+                break;
+            case ActionKind::TypeText:
+                if (action.text.empty()) break;
+                program.Emit({OpCode::Text, 0, 0, 0, static_cast<std::int32_t>(program.texts.size())}, source);
+                program.texts.push_back(action.text);
+                program.Emit({OpCode::Wait, WAIT_TYPING, 0, 0, CountCodePoints(action.text)}, source);
+                break;
+            case ActionKind::WaitRegion: {
+                if (action.text.empty()) break;
+                RegionWaitSpec region;
+                region.reference = action.text;
+                region.x = action.x;
+                region.y = action.y;
+                region.monitorIndex = std::max(0, action.monitorIndex);
+                region.tolerance = std::min<int>(action.key, 255);
+                region.mismatchPerMille = std::max(0, std::min(1000, action.delta));
+                region.timeoutMicros = action.frequency > 0 ? static_cast<std::int64_t>(action.frequency) * 1000
+                                                            : MacroCompiler::kDefaultRegionTimeoutMicros;
+                region.failOnTimeout = action.required;
+                program.Emit({OpCode::Wait, WAIT_REGION, 0, 0, static_cast<std::int32_t>(program.regions.size())}, source);
+                program.regions.push_back(std::move(region));
+                break;
+            }
+            case ActionKind::AnchorClick: {
+                if (action.text.empty()) break;
+                // A espera leva o cursor até a imagem (ou à posição gravada);
+                // o clique sai onde o cursor está, como num clique gravado
+                RegionWaitSpec anchor;
+                anchor.anchor = true;
+                anchor.reference = action.text;
+                anchor.x = action.x;
+                anchor.y = action.y;
+                anchor.monitorIndex = std::max(0, action.monitorIndex);
+                anchor.offsetX = AnchorOffsetX(action.delta);
+                anchor.offsetY = AnchorOffsetY(action.delta);
+                anchor.searchRadius = MacroCompiler::kDefaultAnchorRadius;
+                anchor.minScorePerMille = MacroCompiler::kDefaultAnchorScorePerMille;
+                anchor.timeoutMicros = action.frequency > 0 ? static_cast<std::int64_t>(action.frequency) * 1000
+                                                            : MacroCompiler::kDefaultRegionTimeoutMicros;
+                anchor.failOnTimeout = action.required;
+                const std::uint8_t button = static_cast<std::uint8_t>(action.key);
+                const std::uint8_t mon = MonitorToField(anchor.monitorIndex);
+                const std::int32_t point = PackPoint(action.x, action.y);
+                program.Emit({OpCode::Wait, WAIT_REGION, 0, 0, static_cast<std::int32_t>(program.regions.size())}, source);
+                program.regions.push_back(std::move(anchor));
+                program.Emit({OpCode::Wait, 0, 0, 0, MacroCompiler::kMoveSettleMicros + 150000}, source);
+                program.Emit({OpCode::Click, button, 1, mon, point}, source);
+                program.Emit({OpCode::Wait, 0, 0, 0, 50000}, source);
+                program.Emit({OpCode::Click, button, 0, mon, point}, source);
+                program.Emit({OpCode::Wait, 0, 0, 0, 50000}, source);
+                break;
+            }
+            default:
+                break;
+        }
+
+        // Esperas entre o down e o up da mesma tecla viram tempo de pressão,
+        // marcado quando o up chega
+        if (kind == ActionKind::KeyPress) {
+            if (!action.pressed && action.key == heldKey) {
+                for (size_t index : heldWaits) program.code[index].a |= WAIT_DWELL;
+            }
+            heldKey = action.pressed ? action.key : -1;
+            heldWaits.clear();
+        } else if (kind != ActionKind::Delay) {
+            heldKey = -1;
+            heldWaits.clear();
+        }
+
+        if (action.delay > 0) {
+            double micros = std::min(action.delay * 1e6, 2147483647.0);
+            std::uint8_t flags = WAIT_HUMANIZE;
+            // Em "wait_region" e "anchor_click", 'required' é o que fazer no tempo limite
+            if (action.required && kind != ActionKind::WaitRegion && kind != ActionKind::AnchorClick) flags |= WAIT_REQUIRED;
+            if (heldKey >= 0) heldWaits.push_back(program.size());
+            program.Emit({OpCode::Wait, flags, 0, 0, static_cast<std::int32_t>(micros)}, source);
+        }
+    }
+
+    void Finish(int repetitionGapMs) {
+        // --rep; se zero, fim; senão espera entre repetições e volta ao topo
+        const size_t exitJump = program.size() + 1;
+        program.Emit({OpCode::AddI, kRep, 0, 0, -1});
+        program.Emit({OpCode::Jz, kRep, 0, 0, 0});
+        if (repetitionGapMs > 0) {
+            program.Emit({OpCode::Wait, 0, 0, 0, repetitionGapMs * 1000});
+        }
+        // Cada repetição começa sem modificadores presos da anterior (se o
+        // destino normaliza; ver MacroOptions::normalizeModifiers)
+        program.Emit({OpCode::Release, RELEASE_REPETITION, 0, 0, 0});
+        program.Emit({OpCode::Jmp, 0, 0, 0, top});
+        program.code[exitJump].imm = static_cast<std::int32_t>(program.size());
+        program.Emit({OpCode::Halt, 0, 0, 0, 0});
+    }
+
+private:
+    static constexpr std::uint8_t kRep = MacroCompiler::kRepetitionRegister;
+
+    MacroProgram& program;
+    const size_t startAction;
+    size_t entryJump = 0;             // 0 = começa do topo (a instrução 0 é o LoadI)
+    std::int32_t top = 0;
+    int heldKey = -1;                 // tecla pressionada pela última ação de teclado
+    std::vector<size_t> heldWaits;    // esperas emitidas desde o down dessa tecla
+};
+
+} // namespace
+
+MacroProgram MacroCompiler::FromActions(const std::vector<Action>& actions, int repetitions, int repetitionGapMs,
+                                        size_t startAction, int startRepetition) {
+    MacroProgram program;
+    program.code.reserve(actions.size() * 2 + 8);
+    program.sourceIndex.reserve(actions.size() * 2 + 8);
+
+    RecordingEmitter emitter(program, repetitions, startAction < actions.size() ? startAction : 0, startRepetition);
+    for (size_t i = 0; i < actions.size(); ++i) {
+        emitter.Add(actions[i], static_cast<std::int32_t>(i));
+    }
+    emitter.Finish(repetitionGapMs);
+    return program;
+}
+
+MacroProgram MacroCompiler::FromStream(const ActionStream& stream, int repetitions, int repetitionGapMs,
+                                       size_t startAction, int startRepetition) {
+    MacroProgram program;
+    program.code.reserve(stream.size() * 2 + 8);
+    program.sourceIndex.reserve(stream.size() * 2 + 8);
+
+    RecordingEmitter emitter(program, repetitions, startAction < stream.size() ? startAction : 0, startRepetition);
+    std::int32_t index = 0;
+    stream.ForEach([&emitter, &index](const Action& action) { emitter.Add(action, index++); });
+    emitter.Finish(repetitionGapMs);
+    return program;
+}
+
+MacroProgram MacroCompiler::FromTable(const ActionTable& table, int repetitions, int repetitionGapMs,
+                                      size_t startAction, int startRepetition) {
+    MacroProgram program;
+    program.code.reserve(table.size() * 2 + 8);
+    program.sourceIndex.reserve(table.size() * 2 + 8);
+
+    RecordingEmitter emitter(program, repetitions, startAction < table.size() ? startAction : 0, startRepetition);
+    std::int32_t index = 0;
+    table.ForEach([&emitter, &index](const Action& action) { emitter.Add(action, index++); });
+    emitter.Finish(repetitionGapMs);
+    return program;
+}
+
+namespace {
+
+// Registradores r12..r15 são reservados para os contadores de "loop"
+constexpr int kUserRegisters = MacroVM::kRegisterCount - 4;
+
+std::string ToLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+bool ParseInt(const std::string& token, std::int64_t& value) {
+    if (token.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoll(token.c_str(), &end, 0);
+    return end && *end == '\0' && errno != ERANGE;
+}
+
+// Imediato de 32 bits das instruções (set, add, sub)
+bool FitsImmediate(std::int64_t value) {
+    return value >= -INT32_MAX && value <= INT32_MAX;
+}
+
+bool ParseRegister(const std::string& token, std::uint8_t& reg) {
+    if (token.size() < 2 || (token[0] != 'r' && token[0] != 'R')) return false;
+    std::int64_t value;
+    if (!ParseInt(token.substr(1), value) || value < 0 || value >= kUserRegisters) return false;
+    reg = static_cast<std::uint8_t>(value);
+    return true;
+}
+
+bool ParseButton(const std::string& token, std::uint8_t& button) {
+    std::string t = ToLower(token);
+    if (t == "left") button = 0;
+    else if (t == "right") button = 1;
+    else if (t == "middle") button = 2;
+    else if (t == "x1") button = 3;
+    else if (t == "x2") button = 4;
+    else return false;
+    return true;
+}
+
+// "150ms", "1.5s", "200us" ou número puro (milissegundos)
+bool ParseDuration(const std::string& token, std::int64_t& micros) {
+    std::string t = ToLower(token);
+    double scale = 1000.0;
+    if (t.size() > 2 && t.compare(t.size() - 2, 2, "us") == 0) { scale = 1.0; t.resize(t.size() - 2); }
+    else if (t.size() > 2 && t.compare(t.size() - 2, 2, "ms") == 0) { t.resize(t.size() - 2); }
+    else if (t.size() > 1 && t.back() == 's') { scale = 1e6; t.pop_back(); }
+    char* end = nullptr;
+    double value = std::strtod(t.c_str(), &end);
+    if (t.empty() || !end || *end != '\0' || value < 0) return false;
+    // Antes da conversão: 1e36s (ou inf) não cabe em int64
+    const double scaled = value * scale;
+    if (!(scaled <= 2147483647.0)) return false;
+    micros = static_cast<std::int64_t>(scaled);
+    return true;
+}
+
+} // namespace
+
+bool ParseKeyName(const std::string& token, std::int32_t& vk) {
+    static const std::map<std::string, int> names = {
+        {"ENTER", 0x0D}, {"SPACE", 0x20}, {"ESC", 0x1B}, {"SHIFT", 0x10}, {"CTRL", 0x11},
+        {"ALT", 0x12}, {"TAB", 0x09}, {"BACKSPACE", 0x08}, {"UP", 0x26}, {"DOWN", 0x28},
+        {"LEFT", 0x25}, {"RIGHT", 0x27}, {"DELETE", 0x2E}, {"HOME", 0x24}, {"END", 0x23},
+        {"INSERT", 0x2D}, {"PGUP", 0x21}, {"PGDN", 0x22}
+    };
+    std::string upper = token;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+    if (upper.size() == 1 && std::isalnum(static_cast<unsigned char>(upper[0]))) {
+        vk = upper[0];
+        return true;
+    }
+    if (upper.size() >= 2 && upper[0] == 'F' && std::isdigit(static_cast<unsigned char>(upper[1]))) {
+        int f = std::atoi(upper.c_str() + 1);
+        if (f >= 1 && f <= 24) {
+            vk = 0x70 + f - 1;
+            return true;
+        }
+    }
+    auto it = names.find(upper);
+    if (it != names.end()) {
+        vk = it->second;
+        return true;
+    }
+    std::int64_t value;
+    if (ParseInt(token, value) && value > 0 && value < 256) {
+        vk = static_cast<std::int32_t>(value);
+        return true;
+    }
+    return false;
+}
+
+bool MacroCompiler::FromScript(const std::string& source, MacroProgram& out, std::string& error) {
+    MacroProgram program;
+    std::map<std::string, std::int32_t> labels;
+    std::vector<std::pair<size_t, std::string>> fixups;   // instrução -> rótulo
+    std::vector<std::pair<size_t, int>> fixupLines;
+    // skipNegative: salto do contador negativo ('loop rN'); SIZE_MAX se não há
+    struct OpenLoop { std::uint8_t reg; std::int32_t top; size_t skipJump; size_t skipNegative; };
+    std::vector<OpenLoop> loops;
+
+    std::istringstream input(source);
+    std::string line;
+    int lineNumber = 0;
+
+    auto fail = [&](const std::string& message) {
+        error = "linha " + std::to_string(lineNumber) + ": " + message;
+        return false;
+    };
+    auto emitJump = [&](Instruction ins, const std::string& label) {
+        fixups.emplace_back(program.size(), label);
+        fixupLines.emplace_back(program.size(), lineNumber);
+        program.Emit(ins, lineNumber);
+    };
+
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        // '#' dentro de aspas faz parte do texto de "type"
+        bool quoted = false;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] == '"') quoted = !quoted;
+            else if (line[i] == '#' && !quoted) { line.resize(i); break; }
+        }
+
+        std::istringstream words(line);
+        std::vector<std::string> t;
+        for (std::string w; words >> w;) t.push_back(w);
+        if (t.empty()) continue;
+
+        const std::string op = ToLower(t[0]);
+        const std::int32_t here = static_cast<std::int32_t>(program.size());
+
+        if (t.size() == 1 && op.size() > 1 && op.back() == ':') {
+            std::string name = op.substr(0, op.size() - 1);
+            if (!labels.emplace(name, here).second) return fail("rótulo duplicado '" + name + "'");
+        }
+        else if (op == "key" && t.size() == 3) {
+            std::int32_t vk;
+            if (!ParseKeyName(t[1], vk)) return fail("tecla desconhecida '" + t[1] + "'");
+            std::string state = ToLower(t[2]);
+            if (state == "down" || state == "tap") program.Emit({OpCode::Key, 1, 0, 0, vk}, lineNumber);
+            // Toque: tempo de pressão só existe com humanização (duração do perfil)
+            if (state == "tap") program.Emit({OpCode::Wait, WAIT_DWELL, 0, 0, 0}, lineNumber);
+            if (state == "up" || state == "tap") program.Emit({OpCode::Key, 0, 0, 0, vk}, lineNumber);
+            if (state != "down" && state != "up" && state != "tap") return fail("esperado down, up ou tap");
+        }
+        else if (op == "click" && (t.size() == 5 || t.size() == 6)) {
+            std::uint8_t button;
+            std::int64_t x, y, monitor = -1;
+            if (!ParseButton(t[1], button)) return fail("botão desconhecido '" + t[1] + "'");
+            if (!ParseInt(t[3], x) || !ParseInt(t[4], y) || (t.size() == 6 && !ParseInt(t[5], monitor)))
+                return fail("coordenadas inválidas");
+            std::string state = ToLower(t[2]);
+            std::uint8_t mon = MonitorToField(static_cast<int>(monitor));
+            std::int32_t point = PackPoint(static_cast<int>(x), static_cast<int>(y));
+            program.Emit({OpCode::Move, 0, 0, mon, point}, lineNumber);
+            if (state == "down" || state == "tap") program.Emit({OpCode::Click, button, 1, mon, point}, lineNumber);
+            if (state == "up" || state == "tap") program.Emit({OpCode::Click, button, 0, mon, point}, lineNumber);
+            if (state != "down" && state != "up" && state != "tap") return fail("esperado down, up ou tap");
+        }
+        else if (op == "type" && t.size() >= 2) {
+            // 'type "Olá, mundo"' ou 'type palavra': digitado como texto Unicode
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            std::string text;
+            if (first != std::string::npos) {
+                if (last == first) return fail("aspas sem fechamento");
+                text = line.substr(first + 1, last - first - 1);
+            } else {
+                size_t start = line.find(t[0]) + t[0].size();
+                text = line.substr(line.find_first_not_of(" \t", start));
+                text.erase(text.find_last_not_of(" \t\r") + 1);
+            }
+            if (text.empty()) return fail("texto vazio");
+            program.Emit({OpCode::Text, 0, 0, 0, static_cast<std::int32_t>(program.texts.size())}, lineNumber);
+            program.texts.push_back(text);
+            program.Emit({OpCode::Wait, WAIT_TYPING, 0, 0, CountCodePoints(text)}, lineNumber);
+        }
+        else if (op == "waitscreen" && t.size() >= 4) {
+            // 'waitscreen "botao.png" x y [tela] [tol=16] [diff=5] [timeout=10s] [optional]'
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            if (first == std::string::npos || last == first) return fail("uso: waitscreen \"imagem\" x y [tela] [opções]");
+            RegionWaitSpec region;
+            region.reference = line.substr(first + 1, last - first - 1);
+            region.timeoutMicros = kDefaultRegionTimeoutMicros;
+            std::istringstream rest(line.substr(last + 1));
+            std::vector<std::string> args;
+            for (std::string w; rest >> w;) args.push_back(w);
+            std::int64_t x, y, monitor = 0;
+            if (args.size() < 2 || !ParseInt(args[0], x) || !ParseInt(args[1], y)) return fail("coordenadas inválidas");
+            size_t next = 2;
+            if (next < args.size() && ParseInt(args[next], monitor)) ++next;
+            region.x = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(10000, x)));
+            region.y = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(10000, y)));
+            region.monitorIndex = static_cast<int>(std::max<std::int64_t>(0, monitor));
+            for (; next < args.size(); ++next) {
+                const std::string option = ToLower(args[next]);
+                const size_t equals = option.find('=');
+                const std::string name = option.substr(0, equals);
+                const std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+                std::int64_t number;
+                if (name == "optional" && value.empty()) region.failOnTimeout = false;
+                else if (name == "tol" && ParseInt(value, number) && number >= 0 && number <= 255) region.tolerance = static_cast<int>(number);
+                else if (name == "diff" && ParseInt(value, number) && number >= 0 && number <= 1000) region.mismatchPerMille = static_cast<int>(number);
+                else if (name == "timeout" && ParseDuration(value, number) && number > 0) region.timeoutMicros = number;
+                else return fail("opção inválida '" + args[next] + "'");
+            }
+            program.Emit({OpCode::Wait, WAIT_REGION, 0, 0, static_cast<std::int32_t>(program.regions.size())}, lineNumber);
+            program.regions.push_back(std::move(region));
+        }
+        else if (op == "clickimage" && t.size() >= 5) {
+            // 'clickimage "botao.png" left x y [tela] [dx=32] [dy=20] [radius=200] [score=85] [timeout=10s] [optional]'
+            size_t first = line.find('"');
+            size_t last = line.rfind('"');
+            if (first == std::string::npos || last == first) return fail("uso: clickimage \"imagem\" botão x y [tela] [opções]");
+            RegionWaitSpec anchor;
+            anchor.anchor = true;
+            anchor.reference = line.substr(first + 1, last - first - 1);
+            anchor.timeoutMicros = kDefaultRegionTimeoutMicros;
+            anchor.searchRadius = kDefaultAnchorRadius;
+            anchor.minScorePerMille = kDefaultAnchorScorePerMille;
+            std::istringstream rest(line.substr(last + 1));
+            std::vector<std::string> args;
+            for (std::string w; rest >> w;) args.push_back(w);
+            std::uint8_t button;
+            std::int64_t x, y, monitor = 0;
+            if (args.empty() || !ParseButton(args[0], button)) return fail("botão desconhecido");
+            if (args.size() < 3 || !ParseInt(args[1], x) || !ParseInt(args[2], y)) return fail("coordenadas inválidas");
+            size_t next = 3;
+            if (next < args.size() && ParseInt(args[next], monitor)) ++next;
+            anchor.x = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(10000, x)));
+            anchor.y = static_cast<int>(std::max<std::int64_t>(0, std::min<std::int64_t>(10000, y)));
+            anchor.monitorIndex = static_cast<int>(std::max<std::int64_t>(0, monitor));
+            for (; next < args.size(); ++next) {
+                const std::string option = ToLower(args[next]);
+                const size_t equals = option.find('=');
+                const std::string name = option.substr(0, equals);
+                const std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+                std::int64_t number;
+                if (name == "optional" && value.empty()) anchor.failOnTimeout = false;
+                else if (name == "dx" && ParseInt(value, number) && number >= 0 && number < 4096) anchor.offsetX = static_cast<int>(number);
+                else if (name == "dy" && ParseInt(value, number) && number >= 0 && number < 4096) anchor.offsetY = static_cast<int>(number);
+                else if (name == "radius" && ParseInt(value, number) && number >= 0 && number <= 10000) anchor.searchRadius = static_cast<int>(number);
+                else if (name == "score" && ParseInt(value, number) && number > 0 && number <= 100) anchor.minScorePerMille = static_cast<int>(number * 10);
+                else if (name == "timeout" && ParseDuration(value, number) && number > 0) anchor.timeoutMicros = number;
+                else return fail("opção inválida '" + args[next] + "'");
+            }
+            const std::uint8_t mon = MonitorToField(anchor.monitorIndex);
+            const std::int32_t point = PackPoint(anchor.x, anchor.y);
+            program.Emit({OpCode::Wait, WAIT_REGION, 0, 0, static_cast<std::int32_t>(program.regions.size())}, lineNumber);
+            program.regions.push_back(std::move(anchor));
+            program.Emit({OpCode::Click, button, 1, mon, point}, lineNumber);
+            program.Emit({OpCode::Click, button, 0, mon, point}, lineNumber);
+        }
+        else if (op == "release" && (t.size() == 1 || (t.size() == 2 && (ToLower(t[1]) == "all" || ToLower(t[1]) == "mods")))) {
+            // "release" / "release all": tudo que o script segura; "release mods": só modificadores
+            std::uint8_t scope = t.size() == 2 && ToLower(t[1]) == "mods" ? RELEASE_MODIFIERS : RELEASE_ALL;
+            program.Emit({OpCode::Release, scope, 0, 0, 0}, lineNumber);
+        }
+        else if (op == "wheel" && (t.size() == 3 || t.size() == 5 || t.size() == 6)) {
+            // "wheel v -120", "wheel h 240 50 50 [tela]": eixo, delta e posição opcional
+            std::string axis = ToLower(t[1]);
+            std::int64_t delta, x, y, monitor = -1;
+            if (axis != "v" && axis != "h") return fail("eixo da roda deve ser v ou h");
+            if (!ParseInt(t[2], delta) || delta < INT16_MIN || delta > INT16_MAX) return fail("delta inválido '" + t[2] + "'");
+            std::uint8_t mon = MonitorToField(-1);
+            if (t.size() >= 5) {
+                if (!ParseInt(t[3], x) || !ParseInt(t[4], y) || (t.size() == 6 && !ParseInt(t[5], monitor)))
+                    return fail("coordenadas inválidas");
+                mon = MonitorToField(static_cast<int>(monitor));
+                program.Emit({OpCode::Move, 0, 0, mon, PackPoint(static_cast<int>(x), static_cast<int>(y))}, lineNumber);
+            }
+            program.Emit({OpCode::Wheel, std::uint8_t(axis == "h" ? kWheelHorizontal : kWheelVertical), 0, mon,
+                          static_cast<std::int32_t>(delta)}, lineNumber);
+        }
+        else if (op == "move" && (t.size() == 3 || t.size() == 4)) {
+            std::int64_t x, y, monitor = -1;
+            if (!ParseInt(t[1], x) || !ParseInt(t[2], y) || (t.size() == 4 && !ParseInt(t[3], monitor)))
+                return fail("coordenadas inválidas");
+            program.Emit({OpCode::Move, 0, 0, MonitorToField(static_cast<int>(monitor)),
+                          PackPoint(static_cast<int>(x), static_cast<int>(y))}, lineNumber);
+        }
+        else if (op == "wait" && (t.size() == 2 || (t.size() == 3 && (t[2] == "~" || t[2] == "!")))) {
+            // "wait 150ms ~": sujeita à humanização; "wait 150ms !": obrigatória
+            std::uint8_t reg;
+            std::int64_t micros;
+            std::uint8_t flags = t.size() == 2 ? 0 : (t[2] == "~" ? WAIT_HUMANIZE : WAIT_REQUIRED);
+            if (ParseRegister(t[1], reg)) program.Emit({OpCode::WaitReg, reg, flags, 0, 0}, lineNumber);
+            else if (ParseDuration(t[1], micros)) program.Emit({OpCode::Wait, flags, 0, 0, static_cast<std::int32_t>(micros)}, lineNumber);
+            else return fail("duração inválida '" + t[1] + "'");
+        }
+        else if (op == "set" && t.size() == 3) {
+            std::uint8_t reg;
+            std::int64_t value;
+            if (!ParseRegister(t[1], reg) || !ParseInt(t[2], value)) return fail("uso: set rN valor");
+            if (!FitsImmediate(value)) return fail("valor fora do intervalo '" + t[2] + "'");
+            program.Emit({OpCode::LoadI, reg, 0, 0, static_cast<std::int32_t>(value)}, lineNumber);
+        }
+        else if ((op == "add" || op == "sub") && t.size() == 3) {
+            std::uint8_t reg, other;
+            std::int64_t value;
+            if (!ParseRegister(t[1], reg)) return fail("registrador inválido '" + t[1] + "'");
+            if (ParseRegister(t[2], other)) {
+                program.Emit({op == "add" ? OpCode::Add : OpCode::Sub, reg, reg, other, 0}, lineNumber);
+            } else if (ParseInt(t[2], value)) {
+                if (!FitsImmediate(value)) return fail("operando fora do intervalo '" + t[2] + "'");
+                program.Emit({OpCode::AddI, reg, 0, 0, static_cast<std::int32_t>(op == "add" ? value : -value)}, lineNumber);
+            } else {
+                return fail("operando inválido '" + t[2] + "'");
+            }
+        }
+        else if (op == "mov" && t.size() == 3) {
+            std::uint8_t reg, other;
+            if (!ParseRegister(t[1], reg) || !ParseRegister(t[2], other)) return fail("uso: mov rN rM");
+            program.Emit({OpCode::Mov, reg, other, 0, 0}, lineNumber);
+        }
+        else if (op == "loop" && t.size() == 2) {
+            if (loops.size() >= MacroVM::kRegisterCount - kUserRegisters) return fail("loops aninhados demais");
+            std::uint8_t counter = static_cast<std::uint8_t>(MacroVM::kRegisterCount - 1 - loops.size());
+            std::uint8_t reg;
+            std::int64_t count;
+            size_t skipNegative = SIZE_MAX;
+            if (ParseRegister(t[1], reg)) {
+                // Registrador negativo pula o laço como o zero (o djnz não terminaria)
+                program.Emit({OpCode::LoadI, counter, 0, 0, 0}, lineNumber);
+                skipNegative = program.size();
+                program.Emit({OpCode::Jlt, reg, counter, 0, 0}, lineNumber);
+                program.Emit({OpCode::Mov, counter, reg, 0, 0}, lineNumber);
+            }
+            else if (ParseInt(t[1], count) && count >= 1 && count <= INT32_MAX)
+                program.Emit({OpCode::LoadI, counter, 0, 0, static_cast<std::int32_t>(count)}, lineNumber);
+            else return fail("contador inválido '" + t[1] + "' (de 1 a 2147483647)");
+            size_t skip = program.size();
+            program.Emit({OpCode::Jz, counter, 0, 0, 0}, lineNumber);
+            loops.push_back({counter, static_cast<std::int32_t>(program.size()), skip, skipNegative});
+        }
+        else if (op == "end" && t.size() == 1) {
+            if (loops.empty()) return fail("'end' sem 'loop'");
+            OpenLoop loop = loops.back();
+            loops.pop_back();
+            program.Emit({OpCode::Djnz, loop.reg, 0, 0, loop.top}, lineNumber);
+            program.code[loop.skipJump].imm = static_cast<std::int32_t>(program.size());
+            if (loop.skipNegative != SIZE_MAX) program.code[loop.skipNegative].imm = static_cast<std::int32_t>(program.size());
+        }
+        else if ((op == "jmp" || op == "call") && t.size() == 2) {
+            emitJump({op == "jmp" ? OpCode::Jmp : OpCode::Call, 0, 0, 0, 0}, ToLower(t[1]));
+        }
+        else if ((op == "jz" || op == "jnz") && t.size() == 3) {
+            std::uint8_t reg;
+            if (!ParseRegister(t[1], reg)) return fail("registrador inválido '" + t[1] + "'");
+            emitJump({op == "jz" ? OpCode::Jz : OpCode::Jnz, reg, 0, 0, 0}, ToLower(t[2]));
+        }
+        else if (op == "jlt" && t.size() == 4) {
+            std::uint8_t a, b;
+            if (!ParseRegister(t[1], a) || !ParseRegister(t[2], b)) return fail("uso: jlt rN rM rótulo");
+            emitJump({OpCode::Jlt, a, b, 0, 0}, ToLower(t[3]));
+        }
+        else if (op == "ret" && t.size() == 1) {
+            program.Emit({OpCode::Ret, 0, 0, 0, 0}, lineNumber);
+        }
+        else if (op == "halt" && t.size() == 1) {
+            program.Emit({OpCode::Halt, 0, 0, 0, 0}, lineNumber);
+        }
+        else {
+            return fail("instrução inválida '" + t[0] + "'");
+        }
+    }
+
+    if (!loops.empty()) {
+        error = "fim do arquivo com 'loop' sem 'end'";
+        return false;
+    }
+    program.Emit({OpCode::Halt, 0, 0, 0, 0});
+
+    for (size_t i = 0; i < fixups.size(); ++i) {
+        auto it = labels.find(fixups[i].second);
+        if (it == labels.end()) {
+            error = "linha " + std::to_string(fixupLines[i].second) + ": rótulo indefinido '" + fixups[i].second + "'";
+            return false;
+        }
+        program.code[fixups[i].first].imm = it->second;
+    }
+
+    if (!ValidateProgram(program, error)) return false;
+    out = std::move(program);
+    return true;
+}
+
+// =============================================
+// BENCHMARK DO DESPACHO
+// =============================================
+
+namespace {
+
+class NullSink : public MacroSink {
+public:
+    void OnKey(std::uint16_t vk, bool pressed) override { events += vk + pressed; }
+    void OnMouseClick(int button, bool pressed, int relX, int relY, int) override { events += button + pressed + relX + relY; }
+    void OnMouseMove(int relX, int relY, int) override { events += relX + relY; }
+    void OnMouseWheel(int axis, int delta, int) override { events += axis + delta; }
+    void OnText(const std::string& utf8) override { events += utf8.size(); }
+    std::uint64_t events = 0;
+};
+
+} // namespace
+
+VMBenchmarkResult BenchmarkMacroVM(std::uint64_t instructions) {
+    // Corpo de 8 instruções sem esperas: aritmética, eventos e um salto
+    MacroProgram program;
+    const std::int32_t iterations = static_cast<std::int32_t>(std::max<std::uint64_t>(1, instructions / 8));
+    program.Emit({OpCode::LoadI, 0, 0, 0, iterations});
+    program.Emit({OpCode::LoadI, 2, 0, 0, 3});
+    const std::int32_t top = static_cast<std::int32_t>(program.size());
+    program.Emit({OpCode::AddI, 1, 0, 0, 1});
+    program.Emit({OpCode::Add, 3, 1, 2, 0});
+    program.Emit({OpCode::Key, 1, 0, 0, 0x41});
+    program.Emit({OpCode::Key, 0, 0, 0, 0x41});
+    program.Emit({OpCode::Move, 0, 0, 1, PackPoint(5000, 5000)});
+    program.Emit({OpCode::Sub, 4, 3, 2, 0});
+    program.Emit({OpCode::Mov, 5, 4, 0, 0});
+    program.Emit({OpCode::Djnz, 0, 0, 0, top});
+    program.Emit({OpCode::Halt, 0, 0, 0, 0});
+
+    VMBenchmarkResult result = {0, 0.0, -1.0};
+    NullSink sink;
+    MacroVM vm(&program);
+
+    auto start = std::chrono::steady_clock::now();
+    vm.RunSwitch(sink);
+    result.switchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.instructions = vm.ExecutedInstructions();
+
+#if MACROVM_COMPUTED_GOTO
+    vm.Reset();
+    start = std::chrono::steady_clock::now();
+    vm.RunThreaded(sink);
+    result.threadedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+#endif
+    return result;
+}
@@ -0,0 +1,254 @@
+#ifndef MACROVM_H
+#define MACROVM_H
+
+#include "action.h"
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ActionStream;
+class ActionTable;
+
+// Despacho por "computed goto" (extensão GNU, disponível no MinGW/GCC/Clang).
+// Defina MACROVM_NO_COMPUTED_GOTO para forçar o laço com switch.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(MACROVM_NO_COMPUTED_GOTO)
+#define MACROVM_COMPUTED_GOTO 1
+#else
+#define MACROVM_COMPUTED_GOTO 0
+#endif
+
+// Instruções da máquina virtual de macros. A ordem define a tabela de despacho
+// do interpretador: ao adicionar um opcode, atualizar também macrovm.cpp.
+enum class OpCode : std::uint8_t {
+    Halt = 0,   // fim do programa
+    Nop,
+    Key,        // a = pressionado, imm = código virtual da tecla
+    Click,      // a = botão, b = pressionado, c = monitor + 1, imm = (x << 16) | y
+    Move,       // c = monitor + 1, imm = (x << 16) | y
+    Wait,       // a = flags (WaitFlags), imm = microssegundos
+    WaitReg,    // a = registrador (milissegundos), b = flags
+    LoadI,      // r[a] = imm
+    AddI,       // r[a] += imm
+    Add,        // r[a] = r[b] + r[c]
+    Sub,        // r[a] = r[b] - r[c]
+    Mov,        // r[a] = r[b]
+    Jmp,        // pc = imm
+    Jz,         // se r[a] == 0: pc = imm
+    Jnz,        // se r[a] != 0: pc = imm
+    Jlt,        // se r[a] < r[b]: pc = imm
+    Djnz,       // --r[a]; se r[a] != 0: pc = imm
+    Call,       // empilha pc, pc = imm
+    Ret,
+    Wheel,      // a = eixo (WheelAxis), c = monitor + 1, imm = delta (120 = um dente)
+    Text,       // imm = índice em MacroProgram::texts
+    Release,    // a = ReleaseScope: solta o que a macro ainda mantém pressionado
+    MoveWin,    // imm = índice em MacroProgram::windows (ponto dentro de uma janela)
+    Count
+};
+
+enum WaitFlags : std::uint8_t {
+    WAIT_HUMANIZE = 1 << 0,  // espera gravada, sujeita à humanização
+    WAIT_DWELL = 1 << 1,     // tecla pressionada entre down e up (0 = duração típica do perfil)
+    WAIT_REQUIRED = 1 << 2,  // não é escalada nem removida pelos modos de tempo
+    WAIT_TYPING = 1 << 3,    // digitação do Text anterior: imm = caracteres; a duração vem da cadência do destino
+    WAIT_REGION = 1 << 4,    // até a tela coincidir (ou a âncora aparecer): imm = índice em MacroProgram::regions
+    WAIT_WINDOW = 1 << 5     // só no retorno de Run(): o MoveWin aguarda o destino localizar a janela e é repetido
+};
+
+enum ReleaseScope : std::uint8_t {
+    RELEASE_ALL = 0,
+    RELEASE_MODIFIERS = 1,   // só Shift/Ctrl/Alt/Win
+    RELEASE_REPETITION = 2   // início de repetição: modificadores, se o destino normaliza
+};
+
+// 8 bytes por instrução: o programa inteiro de uma macro grande cabe em cache
+struct Instruction {
+    OpCode op;
+    std::uint8_t a;
+    std::uint8_t b;
+    std::uint8_t c;
+    std::int32_t imm;
+};
+static_assert(sizeof(Instruction) == 8, "Instruction deve ocupar 8 bytes");
+
+// Espera pela tela (ação "wait_region", comando "waitscreen"): a região com
+// canto superior esquerdo em (x, y) e o tamanho da referência precisa coincidir.
+// Âncora (ação "anchor_click", comando "clickimage"): a referência é procurada
+// em volta de (x, y), a posição gravada do clique, e o cursor vai até ela; o
+// Click seguinte sai ali.
+struct RegionWaitSpec {
+    std::string reference;              // arquivo da imagem de referência
+    int x = 0;                          // centésimos de % da tela
+    int y = 0;
+    int monitorIndex = 0;
+    int tolerance = 0;                  // diferença máxima por canal (0-255)
+    int mismatchPerMille = 0;           // pixels diferentes aceitos, em milésimos da região
+    std::int64_t timeoutMicros = 0;
+    bool failOnTimeout = true;          // false: esgotado o tempo, a macro segue
+    bool anchor = false;
+    int offsetX = -1;                   // âncora: ponto do clique dentro da imagem, pixels (-1 = centro)
+    int offsetY = -1;
+    int searchRadius = 0;               // âncora: pixels em volta da posição gravada procurados antes das telas inteiras
+    int minScorePerMille = 0;           // âncora: correlação mínima, em milésimos
+};
+
+// Movimento até um ponto de uma janela (clique gravado com a janela de
+// destino): quem executa localiza a janela e converte o ponto; sem ela, usa a
+// posição gravada
+struct WindowPointSpec {
+    std::string window;                 // WindowTarget codificado ("processo|classe|título")
+    int offsetX = 0;                    // pixels a partir do canto superior esquerdo da janela
+    int offsetY = 0;
+    int x = 0;                          // posição gravada, centésimos de % da tela
+    int y = 0;
+    int monitorIndex = 0;
+};
+
+struct MacroProgram {
+    std::vector<Instruction> code;
+    // Ação (ou linha do script) de origem de cada instrução; -1 = gerada pelo compilador
+    std::vector<std::int32_t> sourceIndex;
+    // Textos das instruções Text (UTF-8), fora do fluxo de 8 bytes
+    std::vector<std::string> texts;
+    // Esperas pela tela (Wait com WAIT_REGION)
+    std::vector<RegionWaitSpec> regions;
+    // Pontos dentro de janelas (MoveWin)
+    std::vector<WindowPointSpec> windows;
+
+    bool empty() const { return code.empty(); }
+    size_t size() const { return code.size(); }
+
+    void Emit(const Instruction& ins, std::int32_t source = -1) {
+        code.push_back(ins);
+        sourceIndex.push_back(source);
+    }
+
+    std::vector<std::string> Disassemble() const;
+};
+
+// Teclas (código virtual) e botões do mouse injetados e ainda não soltos
+struct HeldInputs {
+    std::bitset<256> keys;
+    std::bitset<8> buttons;
+
+    bool Any() const { return keys.any() || buttons.any(); }
+    static const std::bitset<256>& ModifierKeys();
+};
+
+// Destino dos eventos produzidos pela VM (motor de reprodução, testes, benchmark)
+class MacroSink {
+public:
+    virtual ~MacroSink() = default;
+    virtual void OnKey(std::uint16_t vk, bool pressed) = 0;
+    virtual void OnMouseClick(int button, bool pressed, int relX, int relY, int monitorIndex) = 0;
+    virtual void OnMouseMove(int relX, int relY, int monitorIndex) = 0;
+    // OpCode::MoveWin: quem sabe localizar janelas converte o ponto; o padrão
+    // vai até a posição gravada. false = a janela ainda precisa ser localizada:
+    // Run() para com WAIT_WINDOW e repete a instrução na volta
+    virtual bool OnMouseMoveInWindow(const WindowPointSpec& point) {
+        OnMouseMove(point.x, point.y, point.monitorIndex);
+        return true;
+    }
+    // Roda na posição atual do cursor (o Move anterior já o posicionou)
+    virtual void OnMouseWheel(int axis, int delta, int monitorIndex) = 0;
+    // Texto digitado como caracteres Unicode, independente do layout do teclado
+    virtual void OnText(const std::string& utf8) = 0;
+    // OpCode::Release: quem rastreia o que está pressionado solta (os demais ignoram)
+    virtual void OnReleaseHeld(std::uint8_t scope) { (void)scope; }
+    // Solta tudo de uma vez (parada, erro, fim); o padrão manda um up por item
+    virtual void OnReleaseInputs(const HeldInputs& held);
+};
+
+enum class VMStatus {
+    Waiting,          // parou numa espera: retomar com Run() após waitMicros
+    Halted,
+    BudgetExhausted,  // limite de instruções atingido (laço sem esperas)
+    Error
+};
+
+struct VMResult {
+    VMStatus status;
+    std::int64_t waitMicros;
+    std::uint8_t waitFlags;
+};
+
+// Interpretador baseado em registradores. É retomável: Run() executa até a
+// próxima espera e devolve o controle, de modo que quem chama decide como
+// esperar (sleep, timer, agendador).
+class MacroVM {
+public:
+    static constexpr int kRegisterCount = 16;
+    static constexpr int kStackDepth = 32;
+
+    explicit MacroVM(const MacroProgram* program = nullptr);
+
+    void SetProgram(const MacroProgram* program);
+    void Reset();
+
+    VMResult Run(MacroSink& sink, std::uint64_t maxInstructions = UINT64_MAX);
+    VMResult RunSwitch(MacroSink& sink, std::uint64_t maxInstructions = UINT64_MAX);
+#if MACROVM_COMPUTED_GOTO
+    VMResult RunThreaded(MacroSink& sink, std::uint64_t maxInstructions = UINT64_MAX);
+#endif
+
+    std::int32_t Register(int index) const { return regs[index]; }
+    void SetRegister(int index, std::int32_t value) { regs[index] = value; }
+    std::uint32_t ProgramCounter() const { return pc; }
+    void SetProgramCounter(std::uint32_t value) { pc = value; }
+    std::uint64_t ExecutedInstructions() const { return executed; }
+    const std::string& LastError() const { return lastError; }
+
+private:
+    VMResult Fail(const std::string& message);
+
+    const MacroProgram* program = nullptr;
+    std::int32_t regs[kRegisterCount];
+    std::uint32_t stack[kStackDepth];
+    int sp = 0;
+    std::uint32_t pc = 0;
+    std::uint64_t executed = 0;
+    std::string lastError;
+};
+
+class MacroCompiler {
+public:
+    // Registrador usado pelo laço de repetições de FromActions
+    static constexpr int kRepetitionRegister = MacroVM::kRegisterCount - 1;
+    // Espera de estabilidade após cada movimento do mouse (antes um sleep dentro de SendMouseMove)
+    static constexpr std::int32_t kMoveSettleMicros = 50000;
+    // Tempo limite de uma espera pela tela sem limite definido
+    static constexpr std::int64_t kDefaultRegionTimeoutMicros = 30000000;
+    // Clique por imagem: busca em volta da posição gravada e correlação mínima
+    static constexpr int kDefaultAnchorRadius = 200;
+    static constexpr int kDefaultAnchorScorePerMille = 850;
+
+    // Uma gravação é um programa linear, envolvido no laço de repetições.
+    // startAction/startRepetition: a primeira passada começa nessa ação e pula as
+    // repetições anteriores; as seguintes começam do início da gravação.
+    static MacroProgram FromActions(const std::vector<Action>& actions, int repetitions, int repetitionGapMs,
+                                    size_t startAction = 0, int startRepetition = 0);
+    // Mesmo programa, decodificando o fluxo bloco a bloco (sem vetor intermediário)
+    static MacroProgram FromStream(const ActionStream& stream, int repetitions, int repetitionGapMs,
+                                   size_t startAction = 0, int startRepetition = 0);
+    // Lista editável (piece table): percorre os trechos em ordem
+    static MacroProgram FromTable(const ActionTable& table, int repetitions, int repetitionGapMs,
+                                  size_t startAction = 0, int startRepetition = 0);
+
+    // Linguagem de script (.mscript). Retorna false e preenche error com a linha
+    // do problema em caso de falha.
+    static bool FromScript(const std::string& source, MacroProgram& out, std::string& error);
+};
+
+// Nome de tecla ("A", "F6", "ENTER", "0x41") para código virtual
+bool ParseKeyName(const std::string& token, std::int32_t& vk);
+
+struct VMBenchmarkResult {
+    std::uint64_t instructions;
+    double switchMs;
+    double threadedMs;   // < 0 quando o compilador não suporta computed goto
+};
+
+VMBenchmarkResult BenchmarkMacroVM(std::uint64_t instructions);
+
+#endif // MACROVM_H
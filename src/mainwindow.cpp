@@ -1,5 +1,9 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "actionstream.h"
+#include "macrosaver.h"
+#include "metrics.h"
+#include "tracing.h"
 #include <QPushButton>
 #include <QDateTime>
 #include <QDir>
@@ -11,6 +15,7 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QInputDialog>
+#include <QComboBox>
 #include <QDebug>
 #include <QShortcut>
 #include <QSystemTrayIcon>
@@ -23,13 +28,29 @@
 #include <QCloseEvent>
 #include <QPainter>
 #include <QFile>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QSettings>
+#include <QStandardPaths>
 #include <map>
+#include <mutex>
 #include <random>
 #include <thread>
 #include <chrono>
 
 MainWindow* MainWindow::instance = nullptr;
 
+static QString FormatMicros(std::int64_t micros) {
+    qint64 ms = micros / 1000;
+    QString text = QString("%1:%2.%3")
+        .arg((ms / 60000) % 60, 2, 10, QChar('0'))
+        .arg((ms / 1000) % 60, 2, 10, QChar('0'))
+        .arg(ms % 1000, 3, 10, QChar('0'));
+    return ms >= 3600000 ? QString("%1:%2").arg(ms / 3600000).arg(text) : text;
+}
+
 std::map<WORD, std::string> keyMap = {
     {0x41, "A"}, {0x42, "B"}, {0x43, "C"}, {0x44, "D"}, {0x45, "E"}, {0x46, "F"}, {0x47, "G"}, {0x48, "H"},
     {0x49, "I"}, {0x4A, "J"}, {0x4B, "K"}, {0x4C, "L"}, {0x4D, "M"}, {0x4E, "N"}, {0x4F, "O"}, {0x50, "P"},
@@ -42,6 +63,283 @@ std::map<WORD, std::string> keyMap = {
     {VK_F10, "F10"}, {VK_F11, "F11"}, {VK_F12, "F12"}
 };
 
+// Adaptador entre a VM de macros e as funções de input da janela
+class PlaybackSink : public MacroSink {
+public:
+    explicit PlaybackSink(MainWindow* window) : window(window) {}
+    
+    void OnKey(std::uint16_t vk, bool pressed) override {
+        window->SendKey(vk, pressed);
+    }
+    
+    void OnMouseClick(int button, bool pressed, int relX, int relY, int monitorIndex) override {
+        Q_UNUSED(relX) Q_UNUSED(relY) Q_UNUSED(monitorIndex)
+        // O programa já posicionou o cursor (Move + espera de estabilidade)
+        POINT cursorPos;
+        GetCursorPos(&cursorPos);
+        qDebug() << "Posição do cursor antes do clique:" << cursorPos.x << "," << cursorPos.y;
+        window->SendMouseClick(button, pressed);
+    }
+    
+    void OnMouseMove(int relX, int relY, int monitorIndex) override {
+        window->SendMouseMove(relX, relY, monitorIndex, *Monitors());
+    }
+    
+    void OnMouseWheel(int axis, int delta, int monitorIndex) override {
+        Q_UNUSED(monitorIndex)
+        window->SendMouseWheel(axis, delta);
+    }
+    
+    void OnText(const std::string& utf8) override {
+        window->SendText(utf8);
+    }
+    
+    void OnReleaseInputs(const HeldInputs& held) override {
+        window->SendRelease(held);
+    }
+    
+    // Interface, após DetectMonitors. A fila de injeção usa esta cópia e nunca
+    // MainWindow::monitors, que a interface reescreve enquanto macros tocam
+    void SetMonitors(std::vector<MonitorInfo> value) {
+        auto snapshot = std::make_shared<const std::vector<MonitorInfo>>(std::move(value));
+        std::lock_guard<std::mutex> lock(mutex);
+        monitors = std::move(snapshot);
+    }
+    
+private:
+    std::shared_ptr<const std::vector<MonitorInfo>> Monitors() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return monitors;
+    }
+    
+    MainWindow* window;
+    mutable std::mutex mutex;
+    std::shared_ptr<const std::vector<MonitorInfo>> monitors = std::make_shared<const std::vector<MonitorInfo>>();
+};
+
+// Benchmarks dos componentes de reprodução (mesmo esquema do TestPrecision:
+// resultados em arquivo de log no diretório atual)
+void MainWindow::RunBenchmarks() {
+    QFile logFile("benchmark.log");
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        showNotification("Erro", "Não foi possível criar arquivo de log.", true);
+        return;
+    }
+    
+    QTextStream out(&logFile);
+    out << "=== BENCHMARK MACROAPP ===\n";
+    out << "Data: " << QDateTime::currentDateTime().toString() << "\n";
+    
+    // VM: despacho por switch vs computed goto, macro sem esperas
+    out << "\n--- VM de macros ---\n";
+    for (std::uint64_t size : {1000000ULL, 10000000ULL}) {
+        VMBenchmarkResult vm = BenchmarkMacroVM(size);
+        out << "Instruções: " << vm.instructions
+            << " | switch: " << QString::number(vm.switchMs, 'f', 2) << " ms";
+        if (vm.threadedMs >= 0) {
+            out << " | computed goto: " << QString::number(vm.threadedMs, 'f', 2) << " ms";
+        } else {
+            out << " | computed goto: indisponível";
+        }
+        out << "\n";
+    }
+    
+    // Roda de temporizadores: custo de inserção/cancelamento e atraso de disparo
+    out << "\n--- Roda de temporizadores ---\n";
+    TimerBenchmarkResult timers = BenchmarkTimerWheel(100000);
+    out << "Temporizadores pendentes: " << timers.timers
+        << " | inserção: " << QString::number(timers.insertNs, 'f', 1) << " ns"
+        << " | cancelamento: " << QString::number(timers.cancelNs, 'f', 1) << " ns\n";
+    out << "Atraso de disparo (" << timers.accuracySamples << " amostras): média "
+        << QString::number(timers.lateMeanUs, 'f', 0) << " us | p99 "
+        << QString::number(timers.lateP99Us, 'f', 0) << " us | máx "
+        << QString::number(timers.lateMaxUs, 'f', 0) << " us\n";
+    
+    // Fluxo codificado: tamanho em relação ao vetor e ao JSON, vazão de codificação,
+    // decodificação e compilação direta para a VM
+    out << "\n--- Fluxo de ações codificado ---\n";
+    for (const StreamBenchmarkResult& r : BenchmarkActionStream(1000000)) {
+        out << "Rastro " << QString::fromStdString(r.trace) << " (" << r.actions << " ações): "
+            << r.encodedBytes << " bytes (" << QString::number(double(r.encodedBytes) / r.actions, 'f', 2) << " B/ação)"
+            << " | vetor: " << QString::number(double(r.structBytes) / r.encodedBytes, 'f', 1) << "x"
+            << " | JSON: " << QString::number(double(r.jsonBytes) / r.encodedBytes, 'f', 1) << "x\n";
+        out << "  codificação: " << QString::number(r.encodeMActionsPerSec, 'f', 1) << " M ações/s"
+            << " | decodificação: " << QString::number(r.decodeMActionsPerSec, 'f', 1) << " M ações/s"
+            << " | compilação: " << QString::number(r.compileMActionsPerSec, 'f', 1) << " M ações/s\n";
+    }
+    
+    // Salvamento: tempo que a thread da interface fica ocupada, antes (JSON e
+    // escrita direto no destino) e agora (cópia + fila da thread de gravação)
+    out << "\n--- Salvamento ---\n";
+    SaveBenchmarkResult save = BenchmarkMacroSaver(200000, QDir::tempPath());
+    out << "Ações: " << save.actions << " (JSON: " << save.jsonBytes / 1024 << " KB)\n";
+    out << "  antes: " << QString::number(save.syncUiMs, 'f', 1) << " ms na interface\n";
+    out << "  agora: " << QString::number(save.asyncUiMs, 'f', 2) << " ms na interface"
+        << " | " << QString::number(save.asyncTotalMs, 'f', 1) << " ms até o disco\n";
+    out << "  autosave após uma edição: " << QString::number(save.autosaveUiMs, 'f', 2) << " ms na interface"
+        << " | registro no diário: " << save.journalRecordBytes << " bytes\n";
+    
+    // Piece table contra std::vector nas mesmas edições aleatórias
+    out << "\n--- Lista editável (piece table) ---\n";
+    TableBenchmarkResult table = BenchmarkActionTable(1000000, 1000);
+    out << "Ações: " << table.actions << " | edições aleatórias: " << table.edits << "\n";
+    out << "  std::vector: " << QString::number(table.vectorMs, 'f', 1) << " ms"
+        << " | piece table: " << QString::number(table.tableMs, 'f', 2) << " ms"
+        << " (" << table.pieces << " trechos)\n";
+    out << "  acesso por índice: " << QString::number(table.vectorIndexNs, 'f', 0) << " ns (vector) vs "
+        << QString::number(table.tableIndexNs, 'f', 0) << " ns (tabela)\n";
+    out << "  instantâneo: " << QString::number(table.snapshotUs, 'f', 2) << " us"
+        << " | percorrer tudo: " << QString::number(table.iterateMs, 'f', 1) << " ms\n";
+    
+    // Edição: um comando guarda só os parâmetros, contra copiar a lista
+    // inteira antes de cada edição para poder desfazer
+    out << "\n--- Desfazer/Refazer ---\n";
+    EditBenchmarkResult edit = BenchmarkEditJournal(500000);
+    out << "Ações: " << edit.actions << "\n";
+    out << "  escalar todos os delays: " << QString::number(edit.scaleMs, 'f', 2) << " ms"
+        << " | desfazer: " << QString::number(edit.undoMs, 'f', 2) << " ms"
+        << " | refazer: " << QString::number(edit.redoMs, 'f', 2) << " ms\n";
+    out << "  memória no histórico: " << edit.commandBytes << " bytes"
+        << " (cópia da lista: " << edit.snapshotBytes / 1024 << " KB em "
+        << QString::number(edit.snapshotMs, 'f', 2) << " ms)\n";
+    out << "  edições de campo: " << QString::number(edit.fieldEditsPerSec, 'f', 0) << " /s\n";
+    
+    // Linha do tempo: custo por quadro limitado pela largura, não pela gravação
+    out << "\n--- Linha do tempo ---\n";
+    TimelineBenchmarkResult tl = BenchmarkTimeline(1000000, 1600, 160);
+    out << "Ações: " << tl.actions << " | resumo: " << QString::number(tl.buildMs, 'f', 1) << " ms, "
+        << tl.summaryBytes / 1024 << " KB\n";
+    out << "  quadro 1600x160: " << QString::number(tl.fitFrameMs, 'f', 2) << " ms (tudo)"
+        << " | " << QString::number(tl.zoomFrameMs, 'f', 2) << " ms (zoom médio)"
+        << " | " << QString::number(tl.closeFrameMs, 'f', 2) << " ms (zoom máximo)\n";
+    
+    // Busca: índices por coluna contra percorrer a lista inteira
+    out << "\n--- Busca na lista ---\n";
+    IndexBenchmarkResult search = BenchmarkActionIndex(1000000);
+    out << "Ações: " << search.actions << " | índice: " << QString::number(search.buildMs, 'f', 1) << " ms, "
+        << search.indexBytes / 1024 << " KB | gravação: " << QString::number(search.appendNs, 'f', 0) << " ns/ação\n";
+    for (const IndexQueryResult& q : search.queries) {
+        out << "  \"" << q.query << "\": " << q.matches << " resultados em "
+            << QString::number(q.indexMs, 'f', 3) << " ms (percorrendo: " << QString::number(q.scanMs, 'f', 1) << " ms)\n";
+    }
+    
+    // Arquivo indexado: abertura e busca não devem crescer com o tamanho da gravação
+    out << "\n--- Arquivo indexado (abrir e buscar) ---\n";
+    const std::string seekPath = QDir::temp().absoluteFilePath("macroapp_seek.mstream").toLocal8Bit().toStdString();
+    for (size_t actions : {100000, 10000000}) {
+        SeekBenchmarkResult seek = BenchmarkStreamSeek(actions, seekPath);
+        out << "Ações: " << seek.actions << " (" << seek.fileBytes / 1024 << " KB)"
+            << " | abrir: " << QString::number(seek.openUs, 'f', 1) << " us"
+            << " | buscar tempo + ler 50 ações: " << QString::number(seek.seekUs, 'f', 1) << " us\n";
+    }
+    
+    // Espera pela tela: comparação vetorizada contra a escalar e a sequência de
+    // quadros em disco (FileCaptureBackend) até o botão esperado aparecer
+    out << "\n--- Espera pela tela ---\n";
+    const std::string framesPath = QDir::temp().absoluteFilePath("macroapp_frames").toStdString();
+    QDir().mkpath(QString::fromStdString(framesPath));
+    for (int side : {64, 256, 1024}) {
+        PixelMatchBenchmarkResult pm = BenchmarkPixelMatch(side, side, 24, side == 256 ? framesPath : std::string());
+        out << "Região " << pm.width << "x" << pm.height << " (" << pm.instructionSet << "): "
+            << QString::number(pm.simdMPixelsPerSec, 'f', 0) << " Mpixels/s"
+            << " | escalar: " << QString::number(pm.scalarMPixelsPerSec, 'f', 0) << " Mpixels/s\n";
+        out << "  " << pm.frames << " quadros: " << pm.polls << " capturas, "
+            << QString::number(pm.pollUs, 'f', 1) << " us por captura | espera simulada: "
+            << QString::number(pm.simulatedWaitMs, 'f', 0) << " ms\n";
+    }
+    
+    // Clique por imagem: pirâmide + correlação normalizada num quadro 4K,
+    // em volta da posição gravada e em várias telas (uma thread por tela)
+    out << "\n--- Clique por imagem ---\n";
+    for (int side : {32, 64}) {
+        TemplateMatchBenchmarkResult tm = BenchmarkTemplateMatch(side, 3);
+        out << "Âncora " << tm.templateSize << "x" << tm.templateSize << " em " << tm.frameWidth << "x" << tm.frameHeight
+            << " (" << tm.instructionSet << ", " << tm.levels << " níveis): "
+            << QString::number(tm.fullFrameMs, 'f', 2) << " ms a tela inteira | "
+            << QString::number(tm.hintMs, 'f', 2) << " ms perto da posição gravada"
+            << (tm.found ? "" : " [NÃO ACHOU]") << "\n";
+        out << "  exaustiva 512x512: " << QString::number(tm.exhaustiveMs, 'f', 1) << " ms | "
+            << tm.monitors << " telas (captura + busca): " << QString::number(tm.multiMonitorMs, 'f', 1) << " ms\n";
+    }
+    
+    // Mudanças na tela: hashes de blocos 32x32 por quadro contra a comparação
+    // do quadro inteiro, de 1 a 4 telas; depois a sequência gravada da espera pela tela
+    out << "\n--- Mudanças na tela (blocos 32x32) ---\n";
+    std::vector<ScreenChangeBenchmarkResult> changes;
+    for (int monitors = 1; monitors <= 4; ++monitors) changes.push_back(BenchmarkScreenChanges(monitors, 48, std::string()));
+    changes.push_back(BenchmarkScreenChanges(1, 48, framesPath));
+    for (const ScreenChangeBenchmarkResult& sc : changes) {
+        out << (sc.recorded ? "Gravada " : "Sintética ") << sc.monitors << " tela(s) " << sc.width << "x" << sc.height
+            << " (" << sc.instructionSet << "): " << QString::number(sc.trackMsPerFrame, 'f', 2) << " ms por quadro"
+            << " | comparar o quadro inteiro: " << QString::number(sc.compareMsPerFrame, 'f', 2) << " ms\n";
+        out << "  " << QString::number(sc.dirtyTilesPerFrame, 'f', 1) << " blocos sujos em "
+            << QString::number(sc.rectsPerFrame, 'f', 1) << " retângulos por quadro | esperas reavaliadas: "
+            << sc.evaluations << " de " << sc.polls << "\n";
+    }
+    
+    // Controle externo: pedidos e eventos pelo pipe, sem a thread da interface
+    out << "\n--- Controle externo ---\n";
+    ControlBenchmarkResult control = BenchmarkControlServer(5000);
+    out << "Pedidos: " << control.requests << " | ida e volta: média "
+        << QString::number(control.roundTripMeanUs, 'f', 1) << " us, p99 "
+        << QString::number(control.roundTripP99Us, 'f', 1) << " us\n";
+    out << "  em sequência: " << QString::number(control.pipelinedPerSec, 'f', 0) << " pedidos/s"
+        << " | eventos: " << QString::number(control.eventsPerSec, 'f', 0) << " /s\n";
+    
+    // Telemetria: custo de publicar no anel (o que os pontos de medição pagam)
+    out << "\n--- Telemetria ---\n";
+    TelemetryBenchmarkResult telemetry = BenchmarkTelemetry(4000000);
+    out << "Registros: " << telemetry.records << " | publicar: " << QString::number(telemetry.publishNs, 'f', 1) << " ns"
+        << " | 4 threads: " << QString::number(telemetry.publishContendedNs, 'f', 1) << " ns\n";
+    out << "  leitura: " << QString::number(telemetry.readMRecordsPerSec, 'f', 1) << " M registros/s"
+        << " | leitor atrasado perdeu " << telemetry.droppedSlowReader << " (anel guarda a última volta)\n";
+    
+    // Métricas: custo por medição e da exportação
+    out << "\n--- Métricas ---\n";
+    MetricsBenchmarkResult metricsBench = BenchmarkMetrics(4000000);
+    out << "Operações: " << metricsBench.operations << " | contador: " << QString::number(metricsBench.counterNs, 'f', 1) << " ns"
+        << " | histograma: " << QString::number(metricsBench.histogramNs, 'f', 1) << " ns\n";
+    out << "  4 threads: contador em fatias " << QString::number(metricsBench.counterContendedNs, 'f', 1) << " ns"
+        << " vs. atômico único " << QString::number(metricsBench.sharedAtomicNs, 'f', 1) << " ns"
+        << " | exposição: " << QString::number(metricsBench.expositionMs, 'f', 2) << " ms\n";
+    
+    // Vigia dos hooks: custo por callback e uma falha simulada
+    out << "\n--- Vigia dos hooks ---\n";
+    HookWatchdogBenchmarkResult watchdog = BenchmarkHookWatchdog(10000000);
+    out << "Callbacks: " << watchdog.callbacks << " | registro: " << QString::number(watchdog.callbackNs, 'f', 2) << " ns\n";
+    out << "  falha simulada: detectada em " << watchdog.detectionMs << " ms | perdidos " << watchdog.lostActual
+        << " (estimados " << watchdog.lostEstimated << ") | alarmes falsos na trava de 250 ms: " << watchdog.falseAlarms << "\n";
+    
+    // Thread dos hooks: eventos injetados enquanto esta thread (a interface)
+    // fica travada; com os hooks nela, cada um esperaria o fim da trava
+    out << "\n--- Thread dos hooks ---\n";
+    if (isRecording) {
+        out << "Ignorado durante a gravação\n";
+    } else {
+        HookThreadBenchmarkResult hooks = BenchmarkHookThread(*hookThread, 200, 5);
+        out << "Eventos: " << hooks.received << "/" << hooks.sent << " com a interface travada por "
+            << QString::number(hooks.blockedMs, 'f', 0) << " ms\n";
+        out << "  até o hook: p50 " << QString::number(hooks.p50Micros, 'f', 0) << " us | p99 "
+            << QString::number(hooks.p99Micros, 'f', 0) << " us | máx " << QString::number(hooks.maxMicros, 'f', 0) << " us\n";
+    }
+    
+    // Rastreamento: custo de um trecho desligado, ligado e com amostragem
+    out << "\n--- Rastreamento ---\n";
+    TracingBenchmarkResult tracing = BenchmarkTracing(4000000);
+    out << "Trechos: " << tracing.spans << " | desligado: " << QString::number(tracing.disabledNs, 'f', 1) << " ns"
+        << " | ligado: " << QString::number(tracing.enabledNs, 'f', 1) << " ns"
+        << " | amostragem 1/16: " << QString::number(tracing.sampledNs, 'f', 1) << " ns\n";
+    out << "  exportação: " << QString::number(tracing.exportMs, 'f', 2) << " ms ("
+        << tracing.exportedBytes / 1024 << " KB)\n";
+    
+    out << "\n=== FIM DO BENCHMARK ===\n";
+    logFile.close();
+    
+    showNotification("Benchmark Concluído", 
+        QString("Resultados salvos em:\n%1").arg(QDir::current().absoluteFilePath("benchmark.log")), 
+        false);
+}
+
 // CORREÇÃO COMPLETA: Callback para enumeração de monitores
 BOOL CALLBACK MainWindow::MonitorEnumProc(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMonitor, LPARAM dwData) {
     Q_UNUSED(hdcMonitor)
@@ -74,8 +372,57 @@ MainWindow::MainWindow(QWidget *parent)
     
     instance = this;
     
+    // Rastreamento desde o início com MACROAPP_TRACE=N (um a cada N trechos);
+    // o trace é escrito ao fechar ou no Ctrl+Shift+T
+    TraceRecorder::Global().SetThreadName("interface");
+    bool traceFromEnvironment = false;
+    const int traceSampling = qEnvironmentVariableIntValue("MACROAPP_TRACE", &traceFromEnvironment);
+    if (traceFromEnvironment && traceSampling > 0) {
+        TraceRecorder::Global().Start(static_cast<std::uint32_t>(traceSampling));
+    }
+    
     // CORREÇÃO: Detectar monitores ANTES de qualquer operação
     DetectMonitors();
+    
+    // Telemetria antes das threads do motor, que publicam nela
+    QString telemetryError;
+    if (!TelemetryRing::Global().Create(TelemetryRing::kDefaultKey, TelemetryRing::kDefaultCapacity, telemetryError)) {
+        qDebug() << "⚠️ Telemetria indisponível:" << telemetryError;
+    }
+    
+    // Vigia dos hooks de gravação: o limite do sistema vem do registro (sem a
+    // chave, um valor conservador)
+    HookWatchdog::Config hookConfig;
+    const int hookTimeoutMs = QSettings("HKEY_CURRENT_USER\\Control Panel\\Desktop", QSettings::NativeFormat)
+        .value("LowLevelHooksTimeout", 300).toInt();
+    hookConfig.timeoutMicros = std::int64_t(std::max(50, hookTimeoutMs)) * 1000;
+    hookWatchdog = std::make_unique<HookWatchdog>(hookConfig);
+    
+    // Motor de reprodução: uma roda de temporizadores para todas as macros
+    timerWheel = std::make_unique<TimerWheel>();
+    playbackSink = std::make_unique<PlaybackSink>(this);
+    playbackSink->SetMonitors(monitors);
+    scheduler = std::make_unique<MacroScheduler>(*timerWheel, *playbackSink);
+    // Controle externo: thread própria, pedidos vão direto ao agendador
+    controlServer = std::make_unique<ControlServer>(*scheduler);
+    scheduler->SetStateCallback([this](MacroScheduler::MacroId id, MacroScheduler::RunEvent event, const std::string& detail) {
+        controlServer->Publish(id, event, detail);
+        QString text = QString::fromStdString(detail);
+        QMetaObject::invokeMethod(this, [this, id, event, text]() {
+            OnSchedulerEvent(id, static_cast<int>(event), text);
+        }, Qt::QueuedConnection);
+    });
+    QString controlError;
+    if (controlServer->Start(ControlServer::kDefaultName, controlError)) {
+        qDebug() << "Controle externo em" << controlServer->FullServerName();
+    } else {
+        qDebug() << "⚠️ Controle externo indisponível:" << controlError;
+    }
+    screenCapture = std::make_shared<GdiCaptureBackend>(CaptureMonitors());
+    // Esperas pela tela dividem as capturas e só reavaliam o que mudou
+    scheduler->SetCaptureBackend(std::make_shared<TrackedCaptureBackend>(screenCapture));
+    windowResolver = std::make_shared<Win32WindowResolver>(CaptureMonitors());
+    scheduler->SetWindowResolver(windowResolver);
     /*
     // 🔧 BOTÃO DE TESTE VISÍVEL - SEM FALHAS
     QPushButton *testButton = new QPushButton("🧪 TESTAR PRECISÃO", this);
@@ -116,6 +463,41 @@ MainWindow::MainWindow(QWidget *parent)
     RegisterGlobalShortcuts();
     
     connect(ui->actionList, &QListWidget::itemDoubleClicked, this, &MainWindow::on_actionList_itemDoubleClicked);
+    ui->actionList->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    ui->actionList->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->actionList, &QListWidget::customContextMenuRequested, this, &MainWindow::ShowActionListMenu);
+    
+    // Linha do tempo acima da lista: clique seleciona, duplo clique define o início
+    timeline = new TimelineWidget(ui->actionsGroup);
+    timeline->setMinimumHeight(140);
+    ui->verticalLayout_2->insertWidget(0, timeline);
+    connect(timeline, &TimelineWidget::actionSelected, this, [this](qulonglong action) {
+        SelectTimelineAction(static_cast<size_t>(action));
+    });
+    connect(timeline, &TimelineWidget::rangeSelected, this, [this](qulonglong first, qulonglong count) {
+        SelectTimelineRange(static_cast<size_t>(first), static_cast<size_t>(count));
+    });
+    connect(timeline, &TimelineWidget::seekRequested, this, [this](qint64 micros) {
+        SeekFromTimeline(micros);
+    });
+    
+    // Busca entre a linha do tempo e a lista: esconde as linhas que não casam
+    filterEdit = new QLineEdit(ui->actionsGroup);
+    filterEdit->setPlaceholderText("Filtrar (Ctrl+F): clique tela:2 esquerda · tecla:A down · delay:>0.5 · tempo:1:00-2:30");
+    filterEdit->setClearButtonEnabled(true);
+    filterLabel = new QLabel(ui->actionsGroup);
+    QHBoxLayout* filterLayout = new QHBoxLayout();
+    filterLayout->addWidget(filterEdit, 1);
+    filterLayout->addWidget(filterLabel);
+    ui->verticalLayout_2->insertLayout(1, filterLayout);
+    connect(filterEdit, &QLineEdit::textChanged, this, [this]() { ScheduleFilterUpdate(); });
+    connect(filterEdit, &QLineEdit::returnPressed, this, [this]() { JumpToMatch(1); });
+    
+    // Limite de pausa só vale para o modo "Comprimir pausas"
+    ui->idleCapEdit->setEnabled(false);
+    connect(ui->timingModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        ui->idleCapEdit->setEnabled(index == 1);
+    });
     
     lastActionTime = std::chrono::steady_clock::now();
     
@@ -126,15 +508,53 @@ MainWindow::MainWindow(QWidget *parent)
         .arg(monitors.size()),
         false
     );
+    
+    // Salvamentos e autosave numa thread própria; o que ficou sem salvar na
+    // sessão anterior (queda, falta de energia) pode ser recuperado
+    saver = std::make_unique<MacroSaver>(
+        QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("autosave"));
+    if (saver->HasRecovery()) {
+        std::vector<Action> recovered;
+        QString error;
+        if (saver->Recover(recovered, error) && !recovered.empty() &&
+            QMessageBox::question(this, "Recuperar Macro",
+                QString("Há %1 ações não salvas da última sessão. Recuperar?").arg(recovered.size()))
+                == QMessageBox::Yes) {
+            recorded_actions = ActionTable(std::move(recovered));
+            editJournal.Reset();
+            ++actionsRevision;
+            UpdateActionList();
+        } else {
+            if (!error.isEmpty()) qDebug() << "Autosave: recuperação falhou:" << error;
+            saver->DiscardAutosave();
+        }
+    }
+    ScheduleAutosave();
+    
+    metricsPath = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("metrics.prom");
+    ScheduleMetricsExport();
+    ScheduleHookWatchdog();
 }
 
 MainWindow::~MainWindow() {
     StopRecording();
     UnregisterGlobalShortcuts();
+    if (TraceRecorder::Global().IsActive()) WriteTrace();
+    
+    // A roda para antes do agendador (nenhum callback pode alcançá-lo depois)
+    timerWheel->Shutdown();
+    controlServer.reset();
+    // Último autosave; o destrutor do saver espera a fila esvaziar
+    AutosaveNow();
+    saver.reset();
+    scheduler.reset();
+    playbackSink.reset();
+    timerWheel.reset();
     delete ui;
 }
 
 void MainWindow::DetectMonitors() {
+    ScopedTraceSpan span("detectar monitores", "monitores");
     monitors.clear();
     EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, reinterpret_cast<LPARAM>(&monitors));
     
@@ -158,21 +578,55 @@ void MainWindow::DetectMonitors() {
         }
     }
     qDebug() << "=====================================";
+    if (playbackSink) playbackSink->SetMonitors(monitors);
+    if (screenCapture) screenCapture->SetMonitors(CaptureMonitors());
+    if (windowResolver) windowResolver->SetMonitors(CaptureMonitors());
 }
 
-int MainWindow::GetMonitorFromPoint(int x, int y) {
-    //POINT pt = {x, y};
-    
-    // CORREÇÃO: Usar detecção mais precisa
+std::vector<CaptureMonitor> MainWindow::CaptureMonitors() const {
+    std::vector<CaptureMonitor> result;
+    for (const auto& monitor : monitors) {
+        result.push_back({monitor.left, monitor.top, monitor.width, monitor.height});
+    }
+    return result;
+}
+
+namespace {
+
+// Sem log e sem MainWindow::monitors: também rodam na thread de injeção,
+// sobre a cópia dos monitores do PlaybackSink
+
+// Monitor que contém o ponto; -1 se nenhum
+int MonitorAtPoint(const std::vector<MonitorInfo>& monitors, int x, int y) {
     for (int i = 0; i < (int)monitors.size(); i++) {
         const auto& monitor = monitors[i];
         if (x >= monitor.left && x <= monitor.right && 
             y >= monitor.top && y <= monitor.bottom) {
-            qDebug() << "Ponto (" << x << "," << y << ") detectado no monitor" << i;
             return i;
         }
     }
-    
+    return -1;
+}
+
+// Posição relativa (0-10000) no monitor -> coordenadas absolutas dentro dele
+std::pair<int, int> MonitorToScreen(const MonitorInfo& monitor, int relX, int relY) {
+    double width = static_cast<double>(monitor.width);
+    double height = static_cast<double>(monitor.height);
+    int absX = monitor.left + static_cast<int>((relX * width) / 10000.0);
+    int absY = monitor.top + static_cast<int>((relY * height) / 10000.0);
+    absX = std::max(monitor.left, std::min(monitor.right - 1, absX));
+    absY = std::max(monitor.top, std::min(monitor.bottom - 1, absY));
+    return std::make_pair(absX, absY);
+}
+
+} // namespace
+
+int MainWindow::GetMonitorFromPoint(int x, int y) {
+    const int index = MonitorAtPoint(monitors, x, y);
+    if (index >= 0) {
+        qDebug() << "Ponto (" << x << "," << y << ") detectado no monitor" << index;
+        return index;
+    }
     qDebug() << "Ponto (" << x << "," << y << ") não encontrado em nenhum monitor, usando primário";
     return 0; // Fallback para monitor primário
 }
@@ -210,18 +664,9 @@ std::pair<int, int> MainWindow::RelativeToAbsolute(int relX, int relY, int monit
     }
     
     const auto& monitor = monitors[monitorIndex];
-    
-    // 🔧 CORREÇÃO: Usar cálculo mais preciso com double
-    double width = static_cast<double>(monitor.width);
-    double height = static_cast<double>(monitor.height);
-    
-    // Converter porcentagem (0-10000) para coordenadas absolutas
-    int absX = monitor.left + static_cast<int>((relX * width) / 10000.0);
-    int absY = monitor.top + static_cast<int>((relY * height) / 10000.0);
-    
-    // 🔧 CORREÇÃO: Garantir que está dentro dos limites VISÍVEIS do monitor
-    absX = std::max(monitor.left, std::min(monitor.right - 1, absX));
-    absY = std::max(monitor.top, std::min(monitor.bottom - 1, absY));
+    auto absPos = MonitorToScreen(monitor, relX, relY);
+    int absX = absPos.first;
+    int absY = absPos.second;
     
     qDebug() << "RelToAbs - Monitor" << monitorIndex << ":" 
              << "Rel(" << relX << "," << relY << ")" 
@@ -326,6 +771,50 @@ void MainWindow::setupShortcuts() {
     
     QShortcut *stopShortcut = new QShortcut(QKeySequence("Ctrl+P"), this);
     connect(stopShortcut, &QShortcut::activated, this, &MainWindow::stopRecordingShortcut);
+    
+    // Benchmarks internos (gera benchmark.log)
+    QShortcut *benchmarkShortcut = new QShortcut(QKeySequence("Ctrl+Shift+B"), this);
+    connect(benchmarkShortcut, &QShortcut::activated, this, &MainWindow::RunBenchmarks);
+    
+    // Rastreamento (trace do Chrome/Perfetto): liga e, na segunda vez, escreve o arquivo
+    QShortcut *traceShortcut = new QShortcut(QKeySequence("Ctrl+Shift+T"), this);
+    connect(traceShortcut, &QShortcut::activated, this, &MainWindow::ToggleTracing);
+    
+    // Posição de início da reprodução
+    QShortcut *jumpShortcut = new QShortcut(QKeySequence("Ctrl+G"), this);
+    connect(jumpShortcut, &QShortcut::activated, this, &MainWindow::on_jumpButton_clicked);
+    
+    // Edição da lista
+    QShortcut *undoShortcut = new QShortcut(QKeySequence::Undo, this);
+    connect(undoShortcut, &QShortcut::activated, this, &MainWindow::UndoEdit);
+    QShortcut *redoShortcut = new QShortcut(QKeySequence("Ctrl+Y"), this);
+    connect(redoShortcut, &QShortcut::activated, this, &MainWindow::RedoEdit);
+    QShortcut *redoAltShortcut = new QShortcut(QKeySequence("Ctrl+Shift+Z"), this);
+    connect(redoAltShortcut, &QShortcut::activated, this, &MainWindow::RedoEdit);
+    // Atalhos que só valem com a lista em foco (Delete não pode apagar ações
+    // enquanto se digita num campo)
+    QShortcut *removeShortcut = new QShortcut(QKeySequence::Delete, ui->actionList);
+    connect(removeShortcut, &QShortcut::activated, this, &MainWindow::RemoveSelectedActions);
+    QShortcut *upShortcut = new QShortcut(QKeySequence("Alt+Up"), ui->actionList);
+    connect(upShortcut, &QShortcut::activated, this, [this]() { MoveSelectedActions(-1); });
+    QShortcut *downShortcut = new QShortcut(QKeySequence("Alt+Down"), ui->actionList);
+    connect(downShortcut, &QShortcut::activated, this, [this]() { MoveSelectedActions(1); });
+    QShortcut *duplicateShortcut = new QShortcut(QKeySequence("Ctrl+D"), ui->actionList);
+    connect(duplicateShortcut, &QShortcut::activated, this, &MainWindow::DuplicateSelectedActions);
+    for (QShortcut *shortcut : {removeShortcut, upShortcut, downShortcut, duplicateShortcut}) {
+        shortcut->setContext(Qt::WidgetShortcut);
+    }
+    
+    // Busca: Ctrl+F vai para o filtro, F3 / Shift+F3 percorrem os resultados
+    QShortcut *findShortcut = new QShortcut(QKeySequence::Find, this);
+    connect(findShortcut, &QShortcut::activated, this, [this]() {
+        filterEdit->setFocus();
+        filterEdit->selectAll();
+    });
+    QShortcut *nextShortcut = new QShortcut(QKeySequence("F3"), this);
+    connect(nextShortcut, &QShortcut::activated, this, [this]() { JumpToMatch(1); });
+    QShortcut *previousShortcut = new QShortcut(QKeySequence("Shift+F3"), this);
+    connect(previousShortcut, &QShortcut::activated, this, [this]() { JumpToMatch(-1); });
 }
 
 void MainWindow::setupTrayIcon() {
@@ -403,37 +892,6 @@ void MainWindow::showNotification(const QString &title, const QString &message,
     }
 }
 
-// Hook para atalhos globais (F9, F10, F11)
-LRESULT CALLBACK MainWindow::GlobalShortcutHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && MainWindow::instance) {
-        KBDLLHOOKSTRUCT* kbStruct = (KBDLLHOOKSTRUCT*)lParam;
-        bool isKeyDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
-        
-        if (isKeyDown) {
-            // F9 para iniciar gravação
-            if (kbStruct->vkCode == VK_F9) {
-                MainWindow::instance->HandleGlobalShortcut(VK_F9);
-                return 1;
-            }
-            // F10 para parar gravação
-            else if (kbStruct->vkCode == VK_F10) {
-                MainWindow::instance->HandleGlobalShortcut(VK_F10);
-                return 1;
-            }
-            // F11 para mostrar/ocultar
-            else if (kbStruct->vkCode == VK_F11) {
-                if (MainWindow::instance->isHidden()) {
-                    MainWindow::instance->showWindow();
-                } else {
-                    MainWindow::instance->hideWindow();
-                }
-                return 1;
-            }
-        }
-    }
-    return CallNextHookEx(NULL, nCode, wParam, lParam);
-}
-
 void MainWindow::HandleGlobalShortcut(WORD vkCode) {
     if (vkCode == VK_F9 && !isRecording) {
         StartRecording();
@@ -441,63 +899,97 @@ void MainWindow::HandleGlobalShortcut(WORD vkCode) {
     else if (vkCode == VK_F10 && isRecording) {
         StopRecording();
     }
+    else if (vkCode == VK_F10) {
+        // Fora da gravação, F10 interrompe todas as macros em execução
+        scheduler->StopAll();
+    }
+    else if (vkCode == VK_F11) {
+        if (isHidden()) {
+            showWindow();
+        } else {
+            hideWindow();
+        }
+    }
 }
 
 void MainWindow::RegisterGlobalShortcuts() {
-    globalShortcutHook = SetWindowsHookEx(WH_KEYBOARD_LL, GlobalShortcutHookProc, GetModuleHandle(NULL), 0);
-    if (!globalShortcutHook) {
+    // Os hooks ficam numa thread própria: a interface ocupada não atrasa a
+    // entrada do sistema. Os atalhos das macros são atendidos lá mesmo (o
+    // agendador é seguro entre threads); o resto chega pela fila.
+    hookThread = std::make_unique<HookThread>(hookWatchdog.get(),
+        [this]() {
+            QMetaObject::invokeMethod(this, [this]() { DrainCapturedInput(); }, Qt::QueuedConnection);
+        },
+        [this](std::uint16_t vkCode, std::uint16_t modifiers) {
+            return scheduler->OnHotkey(vkCode, modifiers);
+        });
+    if (!hookThread->Start()) {
         showNotification("Aviso", "Não foi possível registrar atalhos globais. Use os botões da interface.", true);
     }
 }
 
 void MainWindow::UnregisterGlobalShortcuts() {
-    if (globalShortcutHook) {
-        UnhookWindowsHookEx(globalShortcutHook);
-        globalShortcutHook = nullptr;
-    }
+    hookThread.reset();
 }
 
-// Hooks para gravação
-LRESULT CALLBACK MainWindow::KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && MainWindow::instance && MainWindow::instance->isRecording && MainWindow::instance->recordingKeyboard) {
-        KBDLLHOOKSTRUCT* kbStruct = (KBDLLHOOKSTRUCT*)lParam;
-        bool isKeyDown = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
-        
-        // Ignorar atalhos globais durante gravação
-        bool ctrlPressed = (GetAsyncKeyState(VK_CONTROL) & 0x8000) != 0;
-        bool altPressed = (GetAsyncKeyState(VK_MENU) & 0x8000) != 0;
-        if (ctrlPressed && altPressed && (kbStruct->vkCode == 'S' || kbStruct->vkCode == 'P')) {
-            return CallNextHookEx(NULL, nCode, wParam, lParam);
+void MainWindow::DrainCapturedInput() {
+    AppMetrics& metrics = AppMetrics::Get();
+    hookThread->Drain([this, &metrics](const CapturedInput& input) {
+        if (input.kind == CapturedInput::Kind::Shortcut) {
+            HandleGlobalShortcut(input.vkCode);
+            return;
         }
+        // Capturado antes do fim da gravação e convertido depois
+        if (!isRecording) return;
+        captureTime = input.captured;
+        metrics.captureDelay.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - input.captured).count());
         
-        MainWindow::instance->RecordKeyEvent(kbStruct->vkCode, isKeyDown);
-    }
-    return CallNextHookEx(NULL, nCode, wParam, lParam);
-}
-
-LRESULT CALLBACK MainWindow::MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode >= 0 && MainWindow::instance && MainWindow::instance->isRecording && MainWindow::instance->recordingMouse) {
-        MSLLHOOKSTRUCT* mouseStruct = (MSLLHOOKSTRUCT*)lParam;
+        if (input.kind == CapturedInput::Kind::Key) {
+            bool isKeyDown = (input.message == WM_KEYDOWN || input.message == WM_SYSKEYDOWN);
+            if (!RecordTypedKey(input.vkCode, input.scanCode, isKeyDown, input.modifiers)) {
+                RecordKeyEvent(input.vkCode, isKeyDown);
+            }
+            return;
+        }
         
-        switch (wParam) {
+        switch (input.message) {
             case WM_LBUTTONDOWN:
-                MainWindow::instance->RecordMouseEvent(mouseStruct->pt.x, mouseStruct->pt.y, 0, true);
+                RecordMouseEvent(input.x, input.y, 0, true);
                 break;
             case WM_LBUTTONUP:
-                MainWindow::instance->RecordMouseEvent(mouseStruct->pt.x, mouseStruct->pt.y, 0, false);
+                RecordMouseEvent(input.x, input.y, 0, false);
                 break;
             case WM_RBUTTONDOWN:
-                MainWindow::instance->RecordMouseEvent(mouseStruct->pt.x, mouseStruct->pt.y, 1, true);
+                RecordMouseEvent(input.x, input.y, 1, true);
                 break;
             case WM_RBUTTONUP:
-                MainWindow::instance->RecordMouseEvent(mouseStruct->pt.x, mouseStruct->pt.y, 1, false);
+                RecordMouseEvent(input.x, input.y, 1, false);
+                break;
+            case WM_MBUTTONDOWN:
+                RecordMouseEvent(input.x, input.y, kMouseMiddle, true);
+                break;
+            case WM_MBUTTONUP:
+                RecordMouseEvent(input.x, input.y, kMouseMiddle, false);
+                break;
+            case WM_XBUTTONDOWN:
+            case WM_XBUTTONUP:
+                // O botão lateral vem na palavra alta de mouseData
+                RecordMouseEvent(input.x, input.y,
+                    HIWORD(input.mouseData) == XBUTTON1 ? kMouseX1 : kMouseX2, input.message == WM_XBUTTONDOWN);
+                break;
+            case WM_MOUSEWHEEL:
+            case WM_MOUSEHWHEEL:
+                // Delta com sinal na palavra alta; touchpads de alta resolução mandam frações de 120
+                RecordMouseWheel(input.x, input.y,
+                    input.message == WM_MOUSEHWHEEL ? kWheelHorizontal : kWheelVertical,
+                    static_cast<short>(HIWORD(input.mouseData)));
                 break;
             case WM_MOUSEMOVE:
-                MainWindow::instance->RecordMouseMove(mouseStruct->pt.x, mouseStruct->pt.y);
+                RecordMouseMove(input.x, input.y);
                 break;
         }
-    }
-    return CallNextHookEx(NULL, nCode, wParam, lParam);
+    });
 }
 
 void MainWindow::StartRecording() {
@@ -505,14 +997,30 @@ void MainWindow::StartRecording() {
     DetectMonitors();
     
     // Instalar hooks de gravação
-    keyboardHook = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardHookProc, GetModuleHandle(NULL), 0);
-    mouseHook = SetWindowsHookEx(WH_MOUSE_LL, MouseHookProc, GetModuleHandle(NULL), 0);
+    const bool keyboard = ui->recordKeyboardCheckbox->isChecked();
+    const bool mouse = ui->recordMouseCheckbox->isChecked();
     
-    if (keyboardHook && mouseHook) {
+    if (hookThread->StartRecording(keyboard, mouse)) {
+        hookWatchdog->Arm(GetTickCount());
         isRecording = true;
-        recordingKeyboard = ui->recordKeyboardCheckbox->isChecked();
-        recordingMouse = ui->recordMouseCheckbox->isChecked();
+        recordingKeyboard = keyboard;
+        recordingMouse = mouse;
         recorded_actions.clear();
+        ++actionsRevision;
+        wheelBatchAction = SIZE_MAX;
+        recordingText = recordingKeyboard && ui->typeTextCheckbox->isChecked();
+        recordingWindows = ui->windowTargetCheckbox->isChecked();
+        typeBatchAction = SIZE_MAX;
+        typedKeys.reset();
+        afterDeadKey = false;
+        heldShiftVk = 0;
+        heldShiftRecorded = false;
+        editJournal.Reset();
+        actionIndex.Truncate(0);
+        scriptProgram = MacroProgram();
+        scriptName.clear();
+        largeFile.reset();
+        playStart = PlaybackPosition();
         ui->actionList->clear();
         lastActionTime = std::chrono::steady_clock::now();
         
@@ -533,14 +1041,10 @@ void MainWindow::StartRecording() {
 }
 
 void MainWindow::StopRecording() {
-    if (keyboardHook) {
-        UnhookWindowsHookEx(keyboardHook);
-        keyboardHook = nullptr;
-    }
-    if (mouseHook) {
-        UnhookWindowsHookEx(mouseHook);
-        mouseHook = nullptr;
-    }
+    hookWatchdog->Disarm();
+    hookThread->StopRecording();
+    // O que os hooks capturaram antes de sair ainda entra na gravação
+    if (isRecording) DrainCapturedInput();
     
     isRecording = false;
     ui->recordButton->setEnabled(true);
@@ -558,28 +1062,32 @@ void MainWindow::StopRecording() {
 }
 
 void MainWindow::RecordKeyEvent(WORD vkCode, bool isKeyDown) {
-    auto now = std::chrono::steady_clock::now();
+    ScopedTraceSpan span("converter tecla", "gravação");
+    RecordHeldShift();
+    auto now = captureTime;
     double delay = std::chrono::duration<double>(now - lastActionTime).count();
     lastActionTime = now;
     
     if (delay > 0.01) {
-        Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1};
+        Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1, false, 0, {}};
         recorded_actions.push_back(delayAction);
     }
     
-    Action keyAction = {"key_press", 0, 0, vkCode, isKeyDown, 0.0, 0, -1};
+    Action keyAction = {"key_press", 0, 0, vkCode, isKeyDown, 0.0, 0, -1, false, 0, {}};
     recorded_actions.push_back(keyAction);
     
-    UpdateActionList();
+    ScheduleActionListUpdate();
 }
 
 void MainWindow::RecordMouseEvent(int x, int y, int button, bool isButtonDown) {
-    auto now = std::chrono::steady_clock::now();
+    ScopedTraceSpan span("converter clique", "gravação");
+    RecordHeldShift();
+    auto now = captureTime;
     double delay = std::chrono::duration<double>(now - lastActionTime).count();
     lastActionTime = now;
     
     if (delay > 0.01) {
-        Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1};
+        Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1, false, 0, {}};
         recorded_actions.push_back(delayAction);
     }
     
@@ -590,15 +1098,23 @@ void MainWindow::RecordMouseEvent(int x, int y, int button, bool isButtonDown) {
     auto relativePos = AbsoluteToRelative(x, y, monitorIndex);
     
     Action mouseAction = {"mouse_click", relativePos.first, relativePos.second, 
-                         (WORD)button, isButtonDown, 0.0, 0, monitorIndex};
+                         (WORD)button, isButtonDown, 0.0, 0, monitorIndex, false, 0, {}};
+    // Janela sob o cursor: a reprodução clica no mesmo ponto dela, onde ela estiver
+    WindowTarget target;
+    int windowX = 0, windowY = 0;
+    if (recordingWindows && WindowTargetAt(x, y, target, windowX, windowY)) {
+        mouseAction.text = target.Encode();
+        mouseAction.delta = PackWindowOffset(windowX, windowY);
+    }
     recorded_actions.push_back(mouseAction);
     
     qDebug() << "Mouse click gravado - Monitor:" << monitorIndex << "Pos:" << relativePos.first << "," << relativePos.second;
     
-    UpdateActionList();
+    ScheduleActionListUpdate();
 }
 
 void MainWindow::RecordMouseMove(int x, int y) {
+    ScopedTraceSpan span("converter movimento", "gravação");
     static int lastX = -1, lastY = -1;
     if (lastX != -1 && lastY != -1) {
         int deltaX = abs(x - lastX);
@@ -606,12 +1122,12 @@ void MainWindow::RecordMouseMove(int x, int y) {
         
         // Gravar movimento apenas se for significativo
         if (deltaX > 5 || deltaY > 5) {
-            auto now = std::chrono::steady_clock::now();
+            auto now = captureTime;
             double delay = std::chrono::duration<double>(now - lastActionTime).count();
             lastActionTime = now;
             
             if (delay > 0.01) {
-                Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1};
+                Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1, false, 0, {}};
                 recorded_actions.push_back(delayAction);
             }
             
@@ -619,18 +1135,164 @@ void MainWindow::RecordMouseMove(int x, int y) {
             int monitorIndex = GetMonitorFromPoint(x, y);
             auto relativePos = AbsoluteToRelative(x, y, monitorIndex);
             
-            Action moveAction = {"mouse_move", relativePos.first, relativePos.second, 0, false, 0.0, 0, monitorIndex};
+            Action moveAction = {"mouse_move", relativePos.first, relativePos.second, 0, false, 0.0, 0, monitorIndex, false, 0, {}};
             recorded_actions.push_back(moveAction);
             
             qDebug() << "Mouse move gravado - Monitor:" << monitorIndex << "Pos:" << relativePos.first << "," << relativePos.second;
             
-            UpdateActionList();
+            ScheduleActionListUpdate();
+        } else {
+            AppMetrics::Get().droppedEvents.Add();
         }
     }
     lastX = x;
     lastY = y;
 }
 
+void MainWindow::RecordMouseWheel(int x, int y, int axis, int delta) {
+    ScopedTraceSpan span("converter rolagem", "gravação");
+    if (delta == 0) return;
+    RecordHeldShift();
+    auto now = captureTime;
+    int monitorIndex = GetMonitorFromPoint(x, y);
+    auto relativePos = AbsoluteToRelative(x, y, monitorIndex);
+    
+    // Continuação da rolagem atual: mesma ação ainda no fim da lista, mesmo
+    // eixo e sentido, cursor parado (até 1% da tela) e dentro da janela do lote.
+    // lastActionTime continua no início do lote, então a duração do lote entra
+    // na espera antes da próxima ação e o tempo total da gravação se mantém.
+    if (wheelBatchAction != SIZE_MAX && wheelBatchAction + 1 == recorded_actions.size() &&
+        now - wheelBatchStart < std::chrono::milliseconds(kWheelBatchMs)) {
+        Action batch = recorded_actions[wheelBatchAction];
+        if (batch.type == "mouse_wheel" && batch.key == axis && batch.monitorIndex == monitorIndex &&
+            (batch.delta > 0) == (delta > 0) && abs(batch.x - relativePos.first) <= 100 &&
+            abs(batch.y - relativePos.second) <= 100 && abs(batch.delta + delta) <= INT16_MAX) {
+            batch.delta += delta;
+            recorded_actions.Set(wheelBatchAction, batch);
+            ScheduleActionListUpdate();
+            return;
+        }
+    }
+    
+    double delay = std::chrono::duration<double>(now - lastActionTime).count();
+    lastActionTime = now;
+    
+    if (delay > 0.01) {
+        Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1, false, 0, {}};
+        recorded_actions.push_back(delayAction);
+    }
+    
+    Action wheelAction = {"mouse_wheel", relativePos.first, relativePos.second,
+                          (WORD)axis, false, 0.0, 0, monitorIndex, false, 0, {}};
+    wheelAction.delta = delta;
+    recorded_actions.push_back(wheelAction);
+    wheelBatchAction = recorded_actions.size() - 1;
+    wheelBatchStart = now;
+    
+    qDebug() << "Roda gravada - Monitor:" << monitorIndex << "Eixo:" << axis << "Delta:" << delta;
+    
+    ScheduleActionListUpdate();
+}
+
+bool MainWindow::RecordTypedKey(WORD vkCode, DWORD scanCode, bool isKeyDown, std::uint8_t modifiers) {
+    ScopedTraceSpan span("converter texto", "gravação");
+    if (!recordingText) return false;
+    
+    if (vkCode == VK_SHIFT || vkCode == VK_LSHIFT || vkCode == VK_RSHIFT) {
+        if (isKeyDown) {
+            // Adiado: vira maiúscula no texto ou é gravado antes da próxima ação
+            if (heldShiftVk == 0) {
+                heldShiftVk = vkCode;
+                heldShiftRecorded = false;
+                return true;
+            }
+            return !heldShiftRecorded;   // repetição automática
+        }
+        bool recorded = heldShiftRecorded;
+        heldShiftVk = 0;
+        heldShiftRecorded = false;
+        return !recorded;
+    }
+    
+    if (!isKeyDown) {
+        if (vkCode < typedKeys.size() && typedKeys[vkCode]) {
+            typedKeys.reset(vkCode);
+            return true;
+        }
+        return false;
+    }
+    
+    // Tecla depois de uma tecla morta (´ e depois a, no ABNT2): as duas vão como
+    // key_press e o layout compõe o caractere na reprodução. Como texto Unicode,
+    // a letra chegaria depois do ´ virtual e o acento se perderia
+    if (afterDeadKey) {
+        afterDeadKey = false;
+        return false;
+    }
+    
+    // Combinações com Ctrl, Alt (inclui AltGr) ou Windows são atalhos, não texto
+    if (modifiers & (CapturedInput::kCtrl | CapturedInput::kAlt | CapturedInput::kWin)) {
+        return false;
+    }
+    
+    wchar_t chars[4];
+    int count;
+    if (vkCode == VK_PACKET) {
+        // Caractere injetado como Unicode por outro programa: vem no scanCode
+        chars[0] = static_cast<wchar_t>(scanCode);
+        count = 1;
+    } else {
+        // Layout da janela que recebe a digitação; flag 0x4 não mexe no estado
+        // das teclas mortas, que continuam funcionando para o usuário
+        BYTE state[256] = {};
+        if (heldShiftVk) state[VK_SHIFT] = 0x80;
+        if (GetKeyState(VK_CAPITAL) & 1) state[VK_CAPITAL] = 0x01;
+        HKL layout = GetKeyboardLayout(GetWindowThreadProcessId(GetForegroundWindow(), nullptr));
+        count = ToUnicodeEx(vkCode, scanCode, state, chars, 4, 0x4, layout);
+    }
+    if (count < 0) {
+        // Tecla morta: gravada como key_press, e a seguinte também
+        afterDeadKey = true;
+        return false;
+    }
+    if (count == 0) return false;
+    for (int i = 0; i < count; ++i) {
+        if (chars[i] < 0x20 || chars[i] == 0x7F) return false;   // Enter, Tab, Backspace...
+    }
+    
+    std::string typed = QString::fromWCharArray(chars, count).toStdString();
+    auto now = captureTime;
+    if (typeBatchAction != SIZE_MAX && typeBatchAction + 1 == recorded_actions.size() &&
+        now - typeBatchLast < std::chrono::milliseconds(kTypeBatchGapMs)) {
+        Action batch = recorded_actions[typeBatchAction];
+        batch.text += typed;
+        recorded_actions.Set(typeBatchAction, batch);
+    } else {
+        double delay = std::chrono::duration<double>(now - lastActionTime).count();
+        if (delay > 0.01) {
+            Action delayAction = {"delay", 0, 0, 0, false, delay, 0, -1, false, 0, {}};
+            recorded_actions.push_back(delayAction);
+        }
+        Action textAction = {"type_text", 0, 0, 0, false, 0.0, 0, -1, false, 0, {}};
+        textAction.text = typed;
+        recorded_actions.push_back(textAction);
+        typeBatchAction = recorded_actions.size() - 1;
+    }
+    // As pausas entre caracteres são descartadas: a cadência é da reprodução
+    lastActionTime = now;
+    typeBatchLast = now;
+    if (vkCode < typedKeys.size()) typedKeys.set(vkCode);
+    
+    ScheduleActionListUpdate();
+    return true;
+}
+
+void MainWindow::RecordHeldShift() {
+    if (heldShiftVk == 0 || heldShiftRecorded) return;
+    heldShiftRecorded = true;
+    RecordKeyEvent(heldShiftVk, true);
+}
+
 std::string MainWindow::KeyCodeToString(WORD vkCode) {
     auto it = keyMap.find(vkCode);
     if (it != keyMap.end()) {
@@ -644,59 +1306,294 @@ std::string MainWindow::MouseButtonToString(int button) {
         case 0: return "LEFT";
         case 1: return "RIGHT";
         case 2: return "MIDDLE";
+        case 3: return "X1";
+        case 4: return "X2";
         default: return "BUTTON_" + std::to_string(button);
     }
 }
 
+void MainWindow::ScheduleActionListUpdate() {
+    // Chamado a cada ação gravada
+    ++actionsRevision;
+    if (actionListUpdatePending.exchange(true)) return;
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kActionListCoalesceMs), [this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            actionListUpdatePending = false;
+            UpdateActionList();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::ScheduleAutosave() {
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kAutosaveIntervalMs), [this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            AutosaveNow();
+            ScheduleAutosave();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::ScheduleHookWatchdog() {
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kHookWatchdogIntervalMs), [this]() {
+        CheckHooks();
+        ScheduleHookWatchdog();
+    });
+}
+
+void MainWindow::CheckHooks() {
+    // Thread da roda: não depende da interface, que pode ser justamente a travada
+    AppMetrics& metrics = AppMetrics::Get();
+    const std::uint64_t slow = hookWatchdog->SlowCallbacks();
+    metrics.hookSlowCallbacks.Add(slow - reportedSlowCallbacks);
+    reportedSlowCallbacks = slow;
+
+    LASTINPUTINFO lastInput = {};
+    lastInput.cbSize = sizeof(lastInput);
+    if (!GetLastInputInfo(&lastInput)) return;
+    const HookWatchdog::Verdict verdict = hookWatchdog->Check(lastInput.dwTime, GetTickCount());
+    if (verdict == HookWatchdog::Verdict::Healthy || hookReinstallPending.exchange(true)) return;
+    QMetaObject::invokeMethod(this, [this, verdict]() { ReinstallHooks(verdict); }, Qt::QueuedConnection);
+}
+
+void MainWindow::ReinstallHooks(HookWatchdog::Verdict verdict) {
+    hookReinstallPending = false;
+    if (!isRecording) return;
+    // Todos, inclusive o de atalhos: roda na mesma thread e a mesma trava o derrubou também
+    const bool reinstalled = hookThread->Reinstall();
+
+    const std::uint32_t gapMs = hookWatchdog->OnReinstalled(GetTickCount());
+    const std::uint64_t lost = hookWatchdog->LostEvents();
+    AppMetrics& metrics = AppMetrics::Get();
+    metrics.hookReinstalls.Add();
+    metrics.hookLostEvents.Add(lost - reportedLostEvents);
+    metrics.hookGap.Record(std::int64_t(gapMs) * 1000);
+    const std::uint64_t lostNow = lost - reportedLostEvents;
+    reportedLostEvents = lost;
+
+    qDebug() << "⚠️ Hooks reinstalados:" << (verdict == HookWatchdog::Verdict::TimedOut ? "callback lento demais" : "sem eventos")
+             << "| falha de" << gapMs << "ms | ~" << lostNow << "eventos perdidos";
+    if (!reinstalled) {
+        showNotification("Erro", "Os hooks de gravação caíram e não puderam ser reinstalados.", true);
+        StopRecording();
+        return;
+    }
+    showNotification("⚠️ Gravação Interrompida e Retomada",
+        QString("O sistema desligou os hooks por %1 ms; cerca de %2 eventos não foram gravados.")
+        .arg(gapMs).arg(lostNow), true);
+}
+
+void MainWindow::ToggleTracing() {
+    TraceRecorder& tracer = TraceRecorder::Global();
+    if (tracer.IsActive()) {
+        WriteTrace();
+        return;
+    }
+    tracer.Start();
+    showNotification("⏺️ Rastreamento Iniciado",
+        "Gravação, reprodução e interface estão sendo rastreadas.\n\nCtrl+Shift+T de novo para salvar o trace.", false);
+}
+
+void MainWindow::WriteTrace() {
+    QDir dir(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("traces"));
+    dir.mkpath(".");
+    const QString path = dir.absoluteFilePath(
+        QString("trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    QString error;
+    size_t spans = 0;
+    if (!TraceRecorder::Global().Stop(path, error, &spans)) {
+        showNotification("Erro", QString("Não foi possível salvar o trace:\n%1").arg(error), true);
+        return;
+    }
+    qDebug() << "Trace salvo:" << path << spans << "trechos";
+    showNotification("⏹️ Rastreamento Salvo",
+        QString("%1 trechos em:\n%2\n\nAbra em ui.perfetto.dev ou chrome://tracing").arg(spans).arg(path), false);
+}
+
+void MainWindow::ScheduleMetricsExport() {
+    // Direto da roda: a escrita vai para a thread de gravação
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kMetricsIntervalMs), [this]() {
+        saver->WriteMetrics(metricsPath);
+        ScheduleMetricsExport();
+    });
+}
+
+void MainWindow::AutosaveNow() {
+    if (actionsRevision == autosavedRevision) return;
+    autosavedRevision = actionsRevision;
+    // A thread da interface só copia; diferença e escrita ficam na thread de gravação
+    if (recorded_actions.empty()) {
+        saver->DiscardAutosave();
+    } else {
+        saver->Autosave(actionsRevision, recorded_actions);
+    }
+}
+
+void MainWindow::MarkLoaded() {
+    // A lista agora é a do disco: nada a salvar, e o autosave anterior
+    // (de outra macro) não deve voltar como recuperação
+    autosavedRevision = ++actionsRevision;
+    saver->MarkSaved(actionsRevision);
+}
+
 void MainWindow::UpdateActionList() {
+    ScopedTraceSpan span("atualizar lista", "interface");
+    // Só redesenha: quem muda recorded_actions avança actionsRevision (rolar a
+    // janela do arquivo grande ou carregar um arquivo não é edição)
     ui->actionList->clear();
+    RefreshTimeline();
+    // Gravando, a lista só cresce e o índice é completado; fora disso ela
+    // pode ter sido trocada inteira (o arquivo grande tem índice próprio)
+    if (!isRecording && !largeFile) {
+        actionIndex.Truncate(0);
+        indexedFile = nullptr;
+    }
     
-    for (size_t i = 0; i < recorded_actions.size(); ++i) {
-        const auto& action = recorded_actions[i];
-        QString itemText;
-        
-        if (action.type == "key_press") {
-            QString state = action.pressed ? "DOWN" : "UP";
-            itemText = QString("%1. KEY: %2 [%3]")
-                .arg(i + 1)
-                .arg(QString::fromStdString(KeyCodeToString(action.key)))
-                .arg(state);
-        }
-        else if (action.type == "mouse_click") {
-            QString state = action.pressed ? "DOWN" : "UP";
-            QString monitorInfo = action.monitorIndex >= 0 ? 
-                QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
-            itemText = QString("%1. MOUSE: %2 [%3] at (%4%%, %5%%) [%6]")
-                .arg(i + 1)
-                .arg(QString::fromStdString(MouseButtonToString(action.key)))
-                .arg(state)
-                .arg(action.x / 100.0, 0, 'f', 1)
-                .arg(action.y / 100.0, 0, 'f', 1)
-                .arg(monitorInfo);
-        }
-        else if (action.type == "mouse_move") {
-            QString monitorInfo = action.monitorIndex >= 0 ? 
-                QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
-            itemText = QString("%1. MOUSE MOVE to (%2%%, %3%%) [%4]")
-                .arg(i + 1)
-                .arg(action.x / 100.0, 0, 'f', 1)
-                .arg(action.y / 100.0, 0, 'f', 1)
-                .arg(monitorInfo);
+    // Script carregado: mostrar o programa compilado
+    if (recorded_actions.empty() && !scriptProgram.empty()) {
+        ui->actionList->addItem(QString("SCRIPT: %1").arg(scriptName));
+        for (const auto& line : scriptProgram.Disassemble()) {
+            ui->actionList->addItem(QString::fromStdString(line));
         }
-        else if (action.type == "delay") {
-            itemText = QString("%1. DELAY: %2s")
-                .arg(i + 1)
-                .arg(action.delay, 0, 'f', 3);
+        return;
+    }
+    
+    // Arquivo grande: só a janela visível, lida direto dos blocos do arquivo
+    if (largeFile) {
+        std::vector<Action> window = largeFile->Read(viewOffset, kViewWindow);
+        ui->actionList->addItem(QString("ARQUIVO: %1 — %2 ações, %3 (mostrando %4–%5, Ctrl+G para navegar)")
+            .arg(largeFileName)
+            .arg(largeFile->size())
+            .arg(FormatMicros(largeFile->DurationMicros()))
+            .arg(viewOffset + 1)
+            .arg(viewOffset + window.size()));
+        for (size_t i = 0; i < window.size(); ++i) {
+            ui->actionList->addItem(FormatAction(viewOffset + i, window[i]));
         }
-        
-        ui->actionList->addItem(itemText);
+        if (filterActive) ApplyFilter();
+        return;
     }
     
+    size_t index = 0;
+    recorded_actions.ForEach([this, &index](const Action& action) {
+        ui->actionList->addItem(FormatAction(index++, action));
+    });
+    
     if (recorded_actions.size() > 0) {
         ui->actionList->scrollToBottom();
     }
+    if (filterActive) ApplyFilter();
+}
+
+QString MainWindow::FormatAction(size_t index, const Action& action) {
+    QString itemText;
+    
+    if (action.type == "key_press") {
+        QString state = action.pressed ? "DOWN" : "UP";
+        itemText = QString("%1. KEY: %2 [%3]")
+            .arg(index + 1)
+            .arg(QString::fromStdString(KeyCodeToString(action.key)))
+            .arg(state);
+    }
+    else if (action.type == "mouse_click") {
+        QString state = action.pressed ? "DOWN" : "UP";
+        QString monitorInfo = action.monitorIndex >= 0 ? 
+            QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
+        itemText = QString("%1. MOUSE: %2 [%3] at (%4%%, %5%%) [%6]")
+            .arg(index + 1)
+            .arg(QString::fromStdString(MouseButtonToString(action.key)))
+            .arg(state)
+            .arg(action.x / 100.0, 0, 'f', 1)
+            .arg(action.y / 100.0, 0, 'f', 1)
+            .arg(monitorInfo);
+        WindowTarget target;
+        if (!action.text.empty() && WindowTarget::Decode(action.text, target)) {
+            QString window = QString::fromStdString(target.title.empty() ? target.process : target.title);
+            itemText += QString(" [janela: %1 +%2,+%3]")
+                .arg(window)
+                .arg(WindowOffsetX(action.delta))
+                .arg(WindowOffsetY(action.delta));
+        }
+    }
+    else if (action.type == "mouse_move") {
+        QString monitorInfo = action.monitorIndex >= 0 ? 
+            QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
+        itemText = QString("%1. MOUSE MOVE to (%2%%, %3%%) [%4]")
+            .arg(index + 1)
+            .arg(action.x / 100.0, 0, 'f', 1)
+            .arg(action.y / 100.0, 0, 'f', 1)
+            .arg(monitorInfo);
+    }
+    else if (action.type == "mouse_wheel") {
+        QString monitorInfo = action.monitorIndex >= 0 ? 
+            QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
+        QString direction = action.key == kWheelHorizontal ? (action.delta > 0 ? "RIGHT" : "LEFT")
+                                                           : (action.delta > 0 ? "UP" : "DOWN");
+        itemText = QString("%1. MOUSE WHEEL: %2 %3 at (%4%%, %5%%) [%6]")
+            .arg(index + 1)
+            .arg(direction)
+            .arg(abs(action.delta) / double(WHEEL_DELTA), 0, 'f', 2)
+            .arg(action.x / 100.0, 0, 'f', 1)
+            .arg(action.y / 100.0, 0, 'f', 1)
+            .arg(monitorInfo);
+    }
+    else if (action.type == "type_text") {
+        QString text = QString::fromStdString(action.text);
+        if (text.size() > 60) text = text.left(57) + "...";
+        itemText = QString("%1. TEXT: \"%2\" (%3 caracteres)")
+            .arg(index + 1)
+            .arg(text)
+            .arg(QString::fromStdString(action.text).size());
+    }
+    else if (action.type == "wait_region") {
+        QString monitorInfo = action.monitorIndex >= 0 ? 
+            QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
+        itemText = QString("%1. WAIT SCREEN: %2 at (%3%%, %4%%) [%5] tol %6, até %7s%8")
+            .arg(index + 1)
+            .arg(QFileInfo(QString::fromStdString(action.text)).fileName())
+            .arg(action.x / 100.0, 0, 'f', 1)
+            .arg(action.y / 100.0, 0, 'f', 1)
+            .arg(monitorInfo)
+            .arg(action.key)
+            .arg(action.frequency / 1000.0, 0, 'f', 1)
+            .arg(action.required ? "" : " [opcional]");
+    }
+    else if (action.type == "anchor_click") {
+        QString monitorInfo = action.monitorIndex >= 0 ? 
+            QString("Tela %1").arg(action.monitorIndex + 1) : "Tela ?";
+        itemText = QString("%1. CLICK IMAGE: %2 %3 near (%4%%, %5%%) [%6], até %7s%8")
+            .arg(index + 1)
+            .arg(QString::fromStdString(MouseButtonToString(action.key)))
+            .arg(QFileInfo(QString::fromStdString(action.text)).fileName())
+            .arg(action.x / 100.0, 0, 'f', 1)
+            .arg(action.y / 100.0, 0, 'f', 1)
+            .arg(monitorInfo)
+            .arg(action.frequency / 1000.0, 0, 'f', 1)
+            .arg(action.required ? "" : " [opcional]");
+    }
+    else if (action.type == "delay") {
+        itemText = QString("%1. DELAY: %2s%3")
+            .arg(index + 1)
+            .arg(action.delay, 0, 'f', 3)
+            .arg(action.required ? " [obrigatório]" : "");
+    }
+    
+    if (index == playStart.action && (playStart.action > 0 || playStart.repetition > 0)) {
+        itemText += "  ◀ início";
+    }
+    return itemText;
+}
+
+namespace {
+
+// SendInput contando as injeções incompletas (UIPI bloqueou, outra área de trabalho)
+UINT SendInputs(UINT count, INPUT* inputs) {
+    const UINT sent = SendInput(count, inputs, sizeof(INPUT));
+    if (sent < count) AppMetrics::Get().injectionFailures.Add();
+    return sent;
 }
 
+} // namespace
+
 void MainWindow::SendKey(WORD vk, bool press) {
     INPUT input = {};
     input.type = INPUT_KEYBOARD;
@@ -705,13 +1602,13 @@ void MainWindow::SendKey(WORD vk, bool press) {
     input.ki.dwFlags = press ? 0 : KEYEVENTF_KEYUP;
     input.ki.time = 0;
     input.ki.dwExtraInfo = 0;
-    SendInput(1, &input, sizeof(INPUT));
+    SendInputs(1, &input);
 }
 
-void MainWindow::SendMouseClick(int button, bool press) {
-    INPUT input = {};
+namespace {
+
+void FillMouseButton(INPUT& input, int button, bool press) {
     input.type = INPUT_MOUSE;
-    
     switch (button) {
         case 0: // Left
             input.mi.dwFlags = press ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
@@ -722,92 +1619,106 @@ void MainWindow::SendMouseClick(int button, bool press) {
         case 2: // Middle
             input.mi.dwFlags = press ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
             break;
+        case 3: // Laterais (voltar/avançar)
+        case 4:
+            input.mi.dwFlags = press ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+            input.mi.mouseData = button == 3 ? XBUTTON1 : XBUTTON2;
+            break;
     }
-    
-    SendInput(1, &input, sizeof(INPUT));
 }
 
-void MainWindow::SendMouseMove(int relX, int relY, int monitorIndex) {
-    // 🔧 CORREÇÃO CRÍTICA: Validar índice do monitor
-    if (monitorIndex < 0 || monitorIndex >= (int)monitors.size()) {
-        qDebug() << "❌ Índice de monitor inválido:" << monitorIndex << ", usando monitor 0";
-        monitorIndex = 0;
+} // namespace
+
+void MainWindow::SendMouseClick(int button, bool press) {
+    INPUT input = {};
+    FillMouseButton(input, button, press);
+    SendInputs(1, &input);
+}
+
+void MainWindow::SendRelease(const HeldInputs& held) {
+    // Todos os "up" num único SendInput: nada se intercala com a entrada do usuário
+    std::vector<INPUT> inputs;
+    for (size_t vk = 0; vk < held.keys.size(); ++vk) {
+        if (!held.keys[vk]) continue;
+        INPUT input = {};
+        input.type = INPUT_KEYBOARD;
+        input.ki.wVk = static_cast<WORD>(vk);
+        input.ki.dwFlags = KEYEVENTF_KEYUP;
+        inputs.push_back(input);
     }
-    
-    // 🔧 CORREÇÃO: Remover variável não utilizada 'monitor'
-    // const auto& monitor = monitors[monitorIndex]; // REMOVIDO
-    
-    qDebug() << "=== ENVIANDO MOVIMENTO DO MOUSE ===";
-    qDebug() << "Monitor destino:" << monitorIndex;
-    qDebug() << "Coordenadas relativas:" << relX << "," << relY;
-    
-    // 🔧 CORREÇÃO: Converter para coordenadas absolutas
-    auto absPos = RelativeToAbsolute(relX, relY, monitorIndex);
-    int absX = absPos.first;
-    int absY = absPos.second;
-    
-    qDebug() << "Coordenadas absolutas calculadas:" << absX << "," << absY;
-    
-    // 🔧 NOVA VERIFICAÇÃO: Confirmar que está no monitor correto
-    int detectedMonitor = GetMonitorFromPoint(absX, absY);
-    if (detectedMonitor != monitorIndex) {
-        qDebug() << "⚠️  AVISO: Ponto caiu no monitor" << detectedMonitor << "em vez de" << monitorIndex;
-        // Recalcular para o monitor correto
-        absPos = RelativeToAbsolute(relX, relY, detectedMonitor);
-        absX = absPos.first;
-        absY = absPos.second;
-        qDebug() << "Coordenadas recalculadas:" << absX << "," << absY;
+    for (size_t button = 0; button < held.buttons.size(); ++button) {
+        if (!held.buttons[button]) continue;
+        INPUT input = {};
+        FillMouseButton(input, static_cast<int>(button), false);
+        inputs.push_back(input);
+    }
+    if (inputs.empty()) return;
+    qDebug() << "Soltando" << inputs.size() << "teclas/botões presos";
+    SendInputs(static_cast<UINT>(inputs.size()), inputs.data());
+}
+
+void MainWindow::SendText(const std::string& utf8) {
+    // Um par down/up KEYEVENTF_UNICODE por unidade UTF-16, todos num único
+    // SendInput: não depende do layout do teclado nem de teclas virtuais
+    std::wstring text = QString::fromStdString(utf8).toStdWString();
+    std::vector<INPUT> inputs(text.size() * 2);
+    for (size_t i = 0; i < text.size(); ++i) {
+        for (int up = 0; up < 2; ++up) {
+            INPUT& input = inputs[i * 2 + up];
+            input.type = INPUT_KEYBOARD;
+            input.ki.wVk = 0;
+            input.ki.wScan = static_cast<WORD>(text[i]);
+            input.ki.dwFlags = KEYEVENTF_UNICODE | (up ? KEYEVENTF_KEYUP : 0);
+        }
+    }
+    if (!inputs.empty()) SendInputs(static_cast<UINT>(inputs.size()), inputs.data());
+}
+
+void MainWindow::SendMouseWheel(int axis, int delta) {
+    // O cursor já está na posição gravada (Move anterior); o delta vai inteiro,
+    // sem arredondar para dentes de 120, como a rolagem suave foi gravada
+    INPUT input = {};
+    input.type = INPUT_MOUSE;
+    input.mi.dwFlags = axis == kWheelHorizontal ? MOUSEEVENTF_HWHEEL : MOUSEEVENTF_WHEEL;
+    input.mi.mouseData = static_cast<DWORD>(delta);
+    SendInputs(1, &input);
+}
+
+void MainWindow::SendMouseMove(int relX, int relY, int monitorIndex, const std::vector<MonitorInfo>& screens) {
+    // Thread de injeção, a cada ponto das curvas: sem log e só com 'screens'
+    // (a cópia do PlaybackSink), nunca com 'monitors'
+    if (screens.empty()) return;
+    if (monitorIndex < 0 || monitorIndex >= (int)screens.size()) monitorIndex = 0;
+    
+    auto absPos = MonitorToScreen(screens[monitorIndex], relX, relY);
+    // Ponto que caiu em outro monitor (bordas compartilhadas): recalcula para ele
+    const int detectedMonitor = MonitorAtPoint(screens, absPos.first, absPos.second);
+    if (detectedMonitor >= 0 && detectedMonitor != monitorIndex) {
+        absPos = MonitorToScreen(screens[detectedMonitor], relX, relY);
     }
     
-    // Obter informações do desktop virtual
+    // Coordenadas normalizadas no desktop virtual (0-65535)
     int virtualWidth = GetSystemMetrics(SM_CXVIRTUALSCREEN);
     int virtualHeight = GetSystemMetrics(SM_CYVIRTUALSCREEN);
     int virtualLeft = GetSystemMetrics(SM_XVIRTUALSCREEN);
     int virtualTop = GetSystemMetrics(SM_YVIRTUALSCREEN);
-    
-    qDebug() << "Desktop virtual:" << virtualLeft << "," << virtualTop 
-             << "->" << virtualWidth << "x" << virtualHeight;
-    
-    // 🔧 CORREÇÃO: Evitar divisão por zero
     int effectiveVirtualWidth = std::max(1, virtualWidth);
     int effectiveVirtualHeight = std::max(1, virtualHeight);
 
-    double normalizedX = ((absX - virtualLeft) * 65535.0) / effectiveVirtualWidth;
-    double normalizedY = ((absY - virtualTop) * 65535.0) / effectiveVirtualHeight;
+    double normalizedX = ((absPos.first - virtualLeft) * 65535.0) / effectiveVirtualWidth;
+    double normalizedY = ((absPos.second - virtualTop) * 65535.0) / effectiveVirtualHeight;
 
-    int finalX = std::max(0, std::min(65535, (int)normalizedX));
-    int finalY = std::max(0, std::min(65535, (int)normalizedY));
-    
-    qDebug() << "Coordenadas normalizadas:" << finalX << "," << finalY;
-    
-    // Enviar movimento do mouse
     INPUT input = {};
     input.type = INPUT_MOUSE;
-    input.mi.dx = finalX;
-    input.mi.dy = finalY;
+    input.mi.dx = std::max(0, std::min(65535, (int)normalizedX));
+    input.mi.dy = std::max(0, std::min(65535, (int)normalizedY));
     input.mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE | MOUSEEVENTF_VIRTUALDESK;
     input.mi.time = 0;
     input.mi.dwExtraInfo = 0;
+    // Falhas entram em injectionFailures (SendInputs)
+    SendInputs(1, &input);
     
-    if (SendInput(1, &input, sizeof(INPUT))) {
-        qDebug() << "✅ Movimento do mouse enviado com sucesso!";
-        
-        // 🔧 CORREÇÃO: Verificar posição final real
-        POINT actualPos;
-        GetCursorPos(&actualPos);
-        qDebug() << "Posição real do cursor:" << actualPos.x << "," << actualPos.y;
-        
-        int actualMonitor = GetMonitorFromPoint(actualPos.x, actualPos.y);
-        qDebug() << "Monitor real:" << actualMonitor;
-        
-    } else {
-        qDebug() << "❌ Falha ao enviar movimento do mouse!";
-    }
-    
-    qDebug() << "=====================================";
-    
-    // Delay para estabilidade
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // A espera de estabilidade faz parte do programa (Wait após o Move)
 }
 
 void MainWindow::TestPrecision() {
@@ -881,7 +1792,7 @@ void MainWindow::TestPrecision() {
 }
 
 void MainWindow::on_playButton_clicked() {
-    if (recorded_actions.empty()) {
+    if (recorded_actions.empty() && scriptProgram.empty() && !largeFile) {
         showNotification("Aviso", "Nenhuma ação para reproduzir.", true);
         return;
     }
@@ -889,6 +1800,16 @@ void MainWindow::on_playButton_clicked() {
     // 🔧 CORREÇÃO 1: Adicionar esta linha - detectar monitores antes de reproduzir
     DetectMonitors();
     
+    if (monitors.empty()) {
+        showNotification("Erro", "Nenhum monitor detectado. Não é possível reproduzir ações de mouse.", true);
+        return;
+    }
+    
+    if (mainMacroId && scheduler->IsRunning(mainMacroId)) {
+        showNotification("Aviso", "A reprodução já está em andamento. Pressione F10 para parar.", true);
+        return;
+    }
+    
     bool ok;
     int reps = ui->repsEdit->text().toInt(&ok);
     if (!ok || reps <= 0) reps = 1;
@@ -898,71 +1819,146 @@ void MainWindow::on_playButton_clicked() {
     
     bool humanize = ui->humanizeCheckbox->isChecked();
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-var_max, var_max);
+    // Semente vazia = nova a cada execução; a usada aparece ao final
+    std::uint64_t seed = 0;
+    if (!ui->seedEdit->text().trimmed().isEmpty()) {
+        seed = ui->seedEdit->text().trimmed().toULongLong(&ok);
+        if (!ok) {
+            showNotification("Erro", "Semente inválida: use um número inteiro.", true);
+            return;
+        }
+    }
+    
+    // A gravação vira um programa linear dentro do laço de repetições;
+    // scripts já trazem seus próprios laços e são executados uma vez
+    MacroProgram program;
+    if (!scriptProgram.empty()) {
+        program = scriptProgram;
+    } else if (largeFile) {
+        // Blocos do arquivo compilados direto, sem passar pela lista
+        ActionStream stream;
+        std::string error;
+        if (!largeFile->LoadStream(stream, error)) {
+            showNotification("Erro", QString("Falha ao ler o arquivo:\n%1").arg(QString::fromStdString(error)), true);
+            return;
+        }
+        program = MacroCompiler::FromStream(stream, reps, kRepetitionGapMs, playStart.action, playStart.repetition);
+    } else {
+        program = MacroCompiler::FromTable(recorded_actions, reps, kRepetitionGapMs, playStart.action, playStart.repetition);
+    }
+    
+    MacroOptions options;
+    options.name = scriptProgram.empty() ? "Gravação" : scriptName.toStdString();
+    options.priority = 10;
+    options.humanize = humanize;
+    options.variationMax = var_max;
+    options.seed = seed;
+    
+    double rate = ui->rateEdit->text().toDouble(&ok);
+    if (!ok || rate < PlaybackTiming::kMinRate || rate > PlaybackTiming::kMaxRate) {
+        showNotification("Erro", "Velocidade inválida: use um valor entre 0.1 e 100.", true);
+        return;
+    }
+    options.timing.rate = rate;
+    if (ui->timingModeCombo->currentIndex() == 1) {
+        double cap = ui->idleCapEdit->text().toDouble(&ok);
+        if (!ok || cap <= 0) cap = 1.0;
+        options.timing.idleCapMicros = static_cast<std::int64_t>(cap * 1e6);
+    } else if (ui->timingModeCombo->currentIndex() == 2) {
+        options.timing.maxThroughput = true;
+    }
+    options.normalizeModifiers = ui->normalizeModifiersCheckbox->isChecked();
+    int cadence = ui->typeCadenceEdit->text().toInt(&ok);
+    options.typeCharMicros = ok && cadence >= 0 ? cadence * 1000LL : 30000;
+    
+    if (mainMacroId) {
+        scheduler->Replace(mainMacroId, std::move(program), options);
+    } else {
+        mainMacroId = scheduler->Add(std::move(program), options);
+    }
     
     showNotification(
         "▶️ Reprodução Iniciada", 
-        QString("Reproduzindo %1 vezes%2\nAções em %3 monitor(es) diferentes")
-        .arg(reps)
+        QString("Reproduzindo %1 vezes%2%3%4\nAções em %5 monitor(es) diferentes")
+        .arg(scriptProgram.empty() ? reps : 1)
         .arg(humanize ? " com humanização" : "")
+        .arg(options.timing.maxThroughput ? " em velocidade máxima"
+             : (rate != 1.0 ? QString(" a %1x").arg(rate) : QString()))
+        .arg(scriptProgram.empty() && (playStart.action > 0 || playStart.repetition > 0)
+             ? QString("\nInício: repetição %1, ação %2").arg(playStart.repetition + 1).arg(playStart.action + 1)
+             : QString())
         .arg(monitors.size()),
         false
     );
     
-    // Pequeno delay antes de começar
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Pequeno delay antes de começar (agora não bloqueia a interface)
+    scheduler->Start(mainMacroId, std::chrono::milliseconds(500));
+}
 
-    if (monitors.empty()) {
-    showNotification("Erro", "Nenhum monitor detectado. Não é possível reproduzir ações de mouse.", true);
-    return;
-    }
-    
-    for (int rep = 0; rep < reps; ++rep) {
-        for (const auto& action : recorded_actions) {
-            if (action.type == "key_press") {
-                SendKey(action.key, action.pressed);
-            } 
-            else if (action.type == "mouse_click") {
-                // 🔧 CORREÇÃO: Movimento + Delay aumentado + Clique
-                qDebug() << "🎯 Preparando clique do mouse...";
-                SendMouseMove(action.x, action.y, action.monitorIndex);
-                
-                // 🔧 AUMENTAR DELAY para garantir estabilidade
-                std::this_thread::sleep_for(std::chrono::milliseconds(150));
-                
-                // Verificar posição atual do cursor
-                POINT cursorPos;
-                GetCursorPos(&cursorPos);
-                qDebug() << "Posição do cursor antes do clique:" << cursorPos.x << "," << cursorPos.y;
-                
-                SendMouseClick(action.key, action.pressed);
-                
-                // Pequeno delay após o clique
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            }
-            else if (action.type == "mouse_move") {
-                SendMouseMove(action.x, action.y, action.monitorIndex);
-            }
-            
-            if (action.delay > 0) {
-                double actualDelay = action.delay;
-                if (humanize) {
-                    double variation = dis(gen);
-                    actualDelay += variation;
-                    actualDelay = std::max(0.01, actualDelay);
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds((int)(actualDelay * 1000)));
-            }
-        }
-        
-        if (rep < reps - 1) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+void MainWindow::OnSchedulerEvent(int macroId, int event, const QString &detail) {
+    auto runEvent = static_cast<MacroScheduler::RunEvent>(event);
+    
+    if (macroId == mainMacroId) {
+        QString seedInfo = QString("\nSemente: %1").arg(scheduler->LastSeed(mainMacroId));
+        if (runEvent == MacroScheduler::RunEvent::Started) {
+            qDebug() << "Reprodução iniciada com semente" << detail;
+        } else if (runEvent == MacroScheduler::RunEvent::Finished) {
+            showNotification("✅ Reprodução Concluída", "Todas as ações foram executadas com sucesso!" + seedInfo, false);
+        } else if (runEvent == MacroScheduler::RunEvent::Stopped) {
+            showNotification("⏹️ Reprodução Interrompida", "A reprodução foi parada." + seedInfo, false);
+        } else if (runEvent == MacroScheduler::RunEvent::Failed) {
+            showNotification("Erro", QString("Falha na reprodução:\n%1%2").arg(detail).arg(seedInfo), true);
         }
+        return;
+    }
+    
+    // Macros agendadas: apenas log, para não inundar a bandeja com avisos
+    qDebug() << "Macro agendada" << macroId << "evento" << event << detail;
+    if (runEvent == MacroScheduler::RunEvent::Failed) {
+        showNotification("Erro", QString("Macro agendada falhou:\n%1").arg(detail), true);
+    }
+}
+
+void MainWindow::on_scheduleButton_clicked() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Agendar Macro", "",
+        "Macros (*.json *.mstream *.mscript);;JSON Files (*.json);;Macro binária (*.mstream);;Macro Script (*.mscript)");
+    if (fileName.isEmpty()) {
+        return;
     }
     
-    showNotification("✅ Reprodução Concluída", "Todas as ações foram executadas com sucesso!", false);
+    MacroProgram program;
+    std::string error;
+    if (!LoadMacroProgram(fileName, program, error)) {
+        showNotification("Erro", QString::fromStdString(error), true);
+        return;
+    }
+    
+    bool ok;
+    QString spec = QInputDialog::getText(this, "Agendar Macro",
+        "Gatilho e opções:\n"
+        "  every 30s | cron */5 * * * * | at 14:30 | hotkey ctrl+F6 | manual\n"
+        "  prio=N  group=nome  humanize=0.1  seed=N  rate=2  idlecap=1s  throughput",
+        QLineEdit::Normal, "every 60s", &ok);
+    if (!ok) {
+        return;
+    }
+    
+    MacroOptions options;
+    options.name = QFileInfo(fileName).fileName().toStdString();
+    if (!ParseMacroOptions(spec.toStdString(), options, error)) {
+        showNotification("Erro", QString("Agendamento inválido:\n%1").arg(QString::fromStdString(error)), true);
+        return;
+    }
+    
+    scheduler->Add(std::move(program), options);
+    showNotification(
+        "⏰ Macro Agendada", 
+        QString("%1\n%2\n\n%3 macro(s) agendada(s)")
+            .arg(QString::fromStdString(options.name))
+            .arg(spec)
+            .arg(scheduler->List().size() - (mainMacroId ? 1 : 0)),
+        false
+    );
 }
 
 void MainWindow::on_recordButton_clicked() {
@@ -974,40 +1970,69 @@ void MainWindow::on_stopButton_clicked() {
 }
 
 void MainWindow::on_saveButton_clicked() {
-    if (recorded_actions.empty()) {
+    if (recorded_actions.empty() && !largeFile) {
         showNotification("Aviso", "Nenhuma ação para salvar.", true);
         return;
     }
     
-    QString fileName = QFileDialog::getSaveFileName(this, "Salvar Macro", "", "JSON Files (*.json)");
-    if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            QJsonArray array;
-            for (const auto& act : recorded_actions) {
-                QJsonObject obj;
-                obj["type"] = QString::fromStdString(act.type);
-                obj["x"] = act.x;
-                obj["y"] = act.y;
-                obj["key"] = (int)act.key;
-                obj["pressed"] = act.pressed;
-                obj["delay"] = act.delay;
-                obj["frequency"] = act.frequency;
-                obj["monitorIndex"] = act.monitorIndex;
-                array.append(obj);
+    QString fileName = QFileDialog::getSaveFileName(this, "Salvar Macro", "",
+        "JSON Files (*.json);;Macro binária (*.mstream)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (largeFile && QFileInfo(fileName).absoluteFilePath() == QFileInfo(largeFilePath).absoluteFilePath()) {
+        showNotification("Aviso", "Este arquivo está aberto para leitura; salve com outro nome.", true);
+        return;
+    }
+    
+    const MacroSaver::Format format = fileName.endsWith(".mstream", Qt::CaseInsensitive)
+        ? MacroSaver::Format::Stream : MacroSaver::Format::Json;
+    RepetitionLayout layout;
+    layout.count = std::max(1, ui->repsEdit->text().toInt());
+    layout.gapMs = kRepetitionGapMs;
+    
+    // A interface só copia as ações e enfileira; serialização, escrita no
+    // temporário, sincronização e rename ficam na thread de gravação
+    const std::uint64_t revision = actionsRevision;
+    const bool fromFile = static_cast<bool>(largeFile);
+    auto uiStart = std::chrono::steady_clock::now();
+    auto done = [this, revision, fromFile](const SaveResult& result) {
+        QMetaObject::invokeMethod(this, [this, result, revision, fromFile]() {
+            if (!result.ok) {
+                showNotification("Erro", QString("Não foi possível salvar o arquivo:\n%1").arg(result.error), true);
+                return;
             }
-            file.write(QJsonDocument(array).toJson());
-            file.close();
-            showNotification("💾 Macro Salvo", "Arquivo salvo com sucesso!", false);
-        } else {
-            showNotification("Erro", "Não foi possível salvar o arquivo.", true);
-        }
+            if (!fromFile) {
+                saver->MarkSaved(revision);
+            }
+            showNotification("💾 Macro Salvo",
+                QString("Arquivo salvo com sucesso! (%1 KB em %2 ms)")
+                    .arg(result.bytes / 1024).arg(result.workMs, 0, 'f', 0),
+                false);
+        }, Qt::QueuedConnection);
+    };
+    if (fromFile) {
+        saver->SaveFromFile(fileName, format, largeFilePath, layout, done);
+    } else {
+        saver->Save(fileName, format, recorded_actions, layout, done);
     }
+    qDebug() << "Salvamento enfileirado:" << std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - uiStart).count() << "ms na thread da interface";
 }
 
 void MainWindow::on_loadButton_clicked() {
-    QString fileName = QFileDialog::getOpenFileName(this, "Carregar Macro", "", "JSON Files (*.json)");
+    QString fileName = QFileDialog::getOpenFileName(this, "Carregar Macro", "",
+        "Macros (*.json *.mstream *.mscript);;JSON Files (*.json);;Macro binária (*.mstream);;Macro Script (*.mscript)");
+    if (fileName.endsWith(".mscript", Qt::CaseInsensitive)) {
+        LoadScript(fileName);
+        return;
+    }
+    if (fileName.endsWith(".mstream", Qt::CaseInsensitive)) {
+        LoadStream(fileName);
+        return;
+    }
     if (!fileName.isEmpty()) {
+        ScopedMetricTimer loadTimer(AppMetrics::Get().loadDuration);
         QFile file(fileName);
         if (file.open(QIODevice::ReadOnly)) {
             QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
@@ -1016,23 +2041,14 @@ void MainWindow::on_loadButton_clicked() {
                 return;
             }
             
-            recorded_actions.clear();
-            QJsonArray array = doc.array();
-            for (const auto& obj : array) {
-                QJsonObject o = obj.toObject();
-                Action act = {
-                    o["type"].toString().toStdString(),
-                    o["x"].toInt(),
-                    o["y"].toInt(),
-                    (WORD)o["key"].toInt(),
-                    o["pressed"].toBool(),
-                    o["delay"].toDouble(),
-                    o["frequency"].toInt(),
-                    o["monitorIndex"].toInt(-1) // -1 para arquivos antigos
-                };
-                recorded_actions.push_back(act);
-            }
+            recorded_actions = ActionTable(ActionsFromJson(doc.array()));
+            editJournal.Reset();
+            scriptProgram = MacroProgram();
+            scriptName.clear();
+            largeFile.reset();
+            playStart = PlaybackPosition();
             file.close();
+            MarkLoaded();
             UpdateActionList();
             showNotification(
                 "📂 Macro Carregado", 
@@ -1045,34 +2061,736 @@ void MainWindow::on_loadButton_clicked() {
     }
 }
 
+void MainWindow::LoadScript(const QString &fileName) {
+    ScopedMetricTimer loadTimer(AppMetrics::Get().loadDuration);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        showNotification("Erro", "Não foi possível abrir o arquivo.", true);
+        return;
+    }
+    
+    MacroProgram program;
+    std::string error;
+    if (!MacroCompiler::FromScript(file.readAll().toStdString(), program, error)) {
+        showNotification("Erro", QString("Script inválido:\n%1").arg(QString::fromStdString(error)), true);
+        return;
+    }
+    
+    recorded_actions.clear();
+    editJournal.Reset();
+    largeFile.reset();
+    playStart = PlaybackPosition();
+    scriptProgram = std::move(program);
+    scriptName = QFileInfo(fileName).fileName();
+    MarkLoaded();
+    UpdateActionList();
+    showNotification(
+        "📂 Script Carregado", 
+        QString("%1 compilado: %2 instruções").arg(scriptName).arg(scriptProgram.size()),
+        false
+    );
+}
+
+void MainWindow::LoadStream(const QString &fileName) {
+    // Só cabeçalho e índice são lidos aqui; os blocos vêm sob demanda
+    ScopedMetricTimer loadTimer(AppMetrics::Get().loadDuration);
+    auto file = std::make_unique<ActionStreamFile>();
+    std::string error;
+    ActionStream stream;
+    RepetitionLayout layout;
+    if (file->Open(fileName.toLocal8Bit().toStdString(), error)) {
+        layout = file->Layout();
+        if (file->size() <= kEagerLoadActions && !file->LoadStream(stream, error)) {
+            showNotification("Erro", QString("Arquivo de macro inválido:\n%1").arg(QString::fromStdString(error)), true);
+            return;
+        }
+    } else {
+        // Versão 1 (sem índice): leitura completa
+        QFile legacy(fileName);
+        if (!legacy.open(QIODevice::ReadOnly)) {
+            showNotification("Erro", "Não foi possível abrir o arquivo.", true);
+            return;
+        }
+        QByteArray data = legacy.readAll();
+        if (!ActionStream::Deserialize(reinterpret_cast<const std::uint8_t*>(data.constData()), data.size(), stream, error, &layout)) {
+            showNotification("Erro", QString("Arquivo de macro inválido:\n%1").arg(QString::fromStdString(error)), true);
+            return;
+        }
+        file.reset();
+    }
+    
+    scriptProgram = MacroProgram();
+    scriptName.clear();
+    playStart = PlaybackPosition();
+    viewOffset = 0;
+    editJournal.Reset();
+    
+    if (file && file->size() > kEagerLoadActions) {
+        // Gravação longa: a lista mostra só a janela visível
+        recorded_actions.clear();
+        largeFile = std::move(file);
+        largeFileName = QFileInfo(fileName).fileName();
+        largeFilePath = fileName;
+    } else {
+        recorded_actions = ActionTable(stream.DecodeAll());
+        largeFile.reset();
+    }
+    ui->repsEdit->setText(QString::number(layout.count));
+    MarkLoaded();
+    UpdateActionList();
+    
+    showNotification(
+        "📂 Macro Carregado", 
+        largeFile
+            ? QString("%1 ações (%2) abertas do arquivo\nCtrl+G para navegar")
+                  .arg(largeFile->size()).arg(FormatMicros(largeFile->DurationMicros()))
+            : QString("%1 ações carregadas com sucesso!").arg(recorded_actions.size()),
+        false
+    );
+}
+
+void MainWindow::on_jumpButton_clicked() {
+    if (recorded_actions.empty() && !largeFile) {
+        showNotification("Aviso", "Nenhuma gravação para navegar.", true);
+        return;
+    }
+    
+    bool ok;
+    QString spec = QInputDialog::getText(this, "Ir Para",
+        "Início da reprodução:\n"
+        "  tempo: 90  |  1:30  |  1:02:03.5  (na linha do tempo com as repetições)\n"
+        "  ação: #1500\n"
+        "  repetição: r3  |  r3 1:30  |  r3 #1500",
+        QLineEdit::Normal, "", &ok).trimmed();
+    if (!ok || spec.isEmpty()) {
+        return;
+    }
+    
+    RepetitionLayout layout;
+    layout.count = std::max(1, ui->repsEdit->text().toInt());
+    layout.gapMs = kRepetitionGapMs;
+    const size_t total = largeFile ? largeFile->size() : recorded_actions.size();
+    ActionStream stream;
+    if (!largeFile) {
+        recorded_actions.ForEach([&stream](const Action& action) { stream.Append(action); });
+    }
+    
+    // Repetição explícita: "rN" no começo
+    int repetition = -1;
+    QStringList parts = spec.split(' ', Qt::SkipEmptyParts);
+    if (parts.front().startsWith('r', Qt::CaseInsensitive)) {
+        repetition = parts.front().mid(1).toInt(&ok) - 1;
+        if (!ok || repetition < 0 || repetition >= layout.count) {
+            showNotification("Erro", QString("Repetição inválida: use de 1 a %1.").arg(layout.count), true);
+            return;
+        }
+        parts.removeFirst();
+    }
+    QString target = parts.join(' ');
+    
+    PlaybackPosition position;
+    if (target.startsWith('#')) {
+        qulonglong index = target.mid(1).toULongLong(&ok);
+        if (!ok || index == 0 || index > total) {
+            showNotification("Erro", QString("Ação inválida: use de 1 a %1.").arg(total), true);
+            return;
+        }
+        position.action = static_cast<size_t>(index - 1);
+        position.repetition = std::max(0, repetition);
+    } else if (target.isEmpty()) {
+        position.repetition = std::max(0, repetition);
+    } else {
+        std::int64_t micros;
+        if (!ParseTimeSpec(target, micros)) {
+            showNotification("Erro", "Tempo inválido.", true);
+            return;
+        }
+        if (repetition >= 0) {
+            // Tempo dentro da repetição escolhida
+            position.repetition = repetition;
+            position.action = largeFile ? largeFile->ActionAtMicros(micros) : stream.ActionAtMicros(micros);
+        } else {
+            position = largeFile ? largeFile->Locate(micros) : stream.Locate(micros, layout);
+            position.repetition = std::min(position.repetition, layout.count - 1);
+        }
+    }
+    playStart = position;
+    
+    // Arquivo grande: desloca a janela visível para a posição
+    int row = static_cast<int>(position.action);
+    if (largeFile) {
+        viewOffset = position.action - std::min(position.action, kViewWindow / 4);
+        row = static_cast<int>(position.action - viewOffset) + 1;   // linha 0 = cabeçalho
+    }
+    UpdateActionList();
+    ui->actionList->setCurrentRow(row);
+    
+    const std::int64_t offset = largeFile ? largeFile->MicrosAt(position.action) : stream.MicrosAt(position.action);
+    timeline->SetPlayhead(offset);
+    timeline->ShowAction(position.action);
+    showNotification(
+        "⏭️ Posição de Início",
+        QString("Repetição %1 de %2, ação %3 (%4 na gravação)")
+            .arg(position.repetition + 1).arg(layout.count)
+            .arg(position.action + 1).arg(FormatMicros(offset)),
+        false
+    );
+}
+
 void MainWindow::on_clearButton_clicked() {
     if (QMessageBox::question(this, "Limpar", "Tem certeza que deseja limpar todas as ações?") == QMessageBox::Yes) {
-        recorded_actions.clear();
-        ui->actionList->clear();
-        showNotification("🗑️ Ações Limpas", "Todas as ações foram removidas.", false);
+        // A lista gravada sai pelo histórico (Ctrl+Z devolve); script e
+        // arquivo grande não são editáveis e só são fechados
+        const bool undoable = CanEditActions() && !recorded_actions.empty();
+        if (undoable) {
+            editJournal.Clear();
+            ++actionsRevision;
+        } else {
+            recorded_actions.clear();
+            editJournal.Reset();
+        }
+        scriptProgram = MacroProgram();
+        scriptName.clear();
+        largeFile.reset();
+        playStart = PlaybackPosition();
+        UpdateActionList();
+        showNotification("🗑️ Ações Limpas",
+            undoable ? "Todas as ações foram removidas (Ctrl+Z desfaz)." : "Todas as ações foram removidas.", false);
     }
 }
 
 void MainWindow::on_actionList_itemDoubleClicked(QListWidgetItem *item) {
     int index = ui->actionList->row(item);
-    if (index >= 0 && index < (int)recorded_actions.size()) {
-        Action& action = recorded_actions[index];
+    if (CanEditActions() && index >= 0 && index < (int)recorded_actions.size()) {
+        const Action& action = recorded_actions[index];
         
         if (action.type == "delay") {
             bool ok;
             double newDelay = QInputDialog::getDouble(this, "Editar Delay", 
                 "Novo delay (segundos):", action.delay, 0.0, 10.0, 3, &ok);
             if (ok) {
-                action.delay = newDelay;
-                UpdateActionList();
+                // Esperas obrigatórias resistem à velocidade e aos modos de tempo
+                bool required = QMessageBox::question(this, "Editar Delay",
+                    "Manter este delay mesmo em velocidade alterada ou no modo de máxima velocidade?")
+                    == QMessageBox::Yes;
+                editJournal.BeginGroup(QString("Editar delay %1").arg(index + 1));
+                EditRange range = editJournal.SetField(index, ActionField::Delay, newDelay);
+                range = MergeEditRanges(range, editJournal.SetField(index, ActionField::Required, required ? 1 : 0));
+                editJournal.EndGroup();
+                ApplyEdit(range);
             }
         }
     }
 }
 
+bool MainWindow::CanEditActions() const {
+    // Arquivo grande e script não passam por recorded_actions
+    return !isRecording && !largeFile && scriptProgram.empty();
+}
+
+void MainWindow::ApplyEdit(const EditRange& range) {
+    if (!range.structural && range.count == 0) return;
+    ++actionsRevision;
+    if (playStart.action >= recorded_actions.size()) {
+        playStart = PlaybackPosition();
+    }
+    RefreshTimeline();
+    actionIndex.Truncate(range.first);
+    
+    // Só as linhas afetadas são reescritas; inserir, remover ou mover
+    // renumera a partir de range.first
+    QListWidget* list = ui->actionList;
+    const size_t total = recorded_actions.size();
+    const size_t end = range.structural ? total : std::min(total, range.first + range.count);
+    list->setUpdatesEnabled(false);
+    while (static_cast<size_t>(list->count()) > total) {
+        delete list->takeItem(list->count() - 1);
+    }
+    size_t i = range.first;
+    recorded_actions.ForEachIn(range.first, end - std::min(end, range.first), [&](const Action& action) {
+        QString text = FormatAction(i, action);
+        if (i < static_cast<size_t>(list->count())) {
+            list->item(static_cast<int>(i))->setText(text);
+        } else {
+            list->addItem(text);
+        }
+        ++i;
+    });
+    list->setUpdatesEnabled(true);
+    if (filterActive) ApplyFilter();
+}
+
+std::vector<std::pair<size_t, size_t>> MainWindow::SelectedActionRuns() const {
+    // Linhas selecionadas agrupadas em trechos contíguos (início, quantidade)
+    std::vector<size_t> rows;
+    for (const QModelIndex& index : ui->actionList->selectionModel()->selectedRows()) {
+        if (index.row() < (int)recorded_actions.size()) rows.push_back(index.row());
+    }
+    std::sort(rows.begin(), rows.end());
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t row : rows) {
+        if (!runs.empty() && runs.back().first + runs.back().second == row) {
+            ++runs.back().second;
+        } else {
+            runs.push_back({row, 1});
+        }
+    }
+    return runs;
+}
+
+void MainWindow::ShowActionListMenu(const QPoint& pos) {
+    const bool editable = CanEditActions();
+    const bool hasSelection = editable && !SelectedActionRuns().empty();
+    QMenu menu(this);
+    
+    QAction* undo = menu.addAction(editJournal.CanUndo() ? "Desfazer: " + editJournal.UndoText() : "Desfazer", this, &MainWindow::UndoEdit);
+    undo->setShortcut(QKeySequence::Undo);
+    undo->setEnabled(editable && editJournal.CanUndo());
+    QAction* redo = menu.addAction(editJournal.CanRedo() ? "Refazer: " + editJournal.RedoText() : "Refazer", this, &MainWindow::RedoEdit);
+    redo->setShortcut(QKeySequence::Redo);
+    redo->setEnabled(editable && editJournal.CanRedo());
+    menu.addSeparator();
+    
+    QAction* up = menu.addAction("Mover para cima", this, [this]() { MoveSelectedActions(-1); });
+    up->setShortcut(QKeySequence("Alt+Up"));
+    up->setEnabled(hasSelection);
+    QAction* down = menu.addAction("Mover para baixo", this, [this]() { MoveSelectedActions(1); });
+    down->setShortcut(QKeySequence("Alt+Down"));
+    down->setEnabled(hasSelection);
+    QAction* duplicate = menu.addAction("Duplicar", this, &MainWindow::DuplicateSelectedActions);
+    duplicate->setShortcut(QKeySequence("Ctrl+D"));
+    duplicate->setEnabled(hasSelection);
+    QAction* remove = menu.addAction("Remover", this, &MainWindow::RemoveSelectedActions);
+    remove->setShortcut(QKeySequence::Delete);
+    remove->setEnabled(hasSelection);
+    menu.addSeparator();
+    
+    QAction* scale = menu.addAction(hasSelection ? "Escalar delays da seleção..." : "Escalar todos os delays...",
+        this, &MainWindow::ScaleSelectedDelays);
+    scale->setEnabled(editable && !recorded_actions.empty());
+    QAction* region = menu.addAction("Inserir espera pela tela...", this, &MainWindow::InsertRegionWait);
+    region->setEnabled(editable);
+    const int row = ui->actionList->currentRow();
+    QAction* anchor = menu.addAction("Clicar pela imagem...", this, &MainWindow::ConvertToAnchorClick);
+    anchor->setEnabled(editable && row >= 0 && row < (int)recorded_actions.size() &&
+                       recorded_actions[row].type == "mouse_click" && recorded_actions[row].pressed);
+    
+    menu.exec(ui->actionList->viewport()->mapToGlobal(pos));
+}
+
+void MainWindow::InsertRegionWait() {
+    if (!CanEditActions()) return;
+    bool ok;
+    QString spec = QInputDialog::getText(this, "Esperar pela Tela",
+        "Região a esperar, em pixels da tela: tela x y largura altura\n"
+        "A imagem de referência é capturada 3 s depois de confirmar:\n"
+        "deixe a tela como a macro deve encontrá-la.",
+        QLineEdit::Normal, "1 100 100 200 50", &ok);
+    if (!ok) return;
+    
+    QStringList parts = spec.split(' ', Qt::SkipEmptyParts);
+    std::vector<int> values;
+    for (const QString& part : parts) {
+        int value = part.toInt(&ok);
+        if (!ok) break;
+        values.push_back(value);
+    }
+    if (!ok || values.size() != 5 || values[0] < 1 || values[0] > (int)monitors.size() || values[3] <= 0 || values[4] <= 0) {
+        showNotification("Erro", "Região inválida: use \"tela x y largura altura\".", true);
+        return;
+    }
+    CaptureRect rect;
+    rect.monitorIndex = values[0] - 1;
+    rect.x = values[1];
+    rect.y = values[2];
+    rect.width = values[3];
+    rect.height = values[4];
+    
+    // Depois da ação atual (ou no fim)
+    const int row = ui->actionList->currentRow();
+    const size_t position = row >= 0 ? std::min<size_t>(row + 1, recorded_actions.size()) : recorded_actions.size();
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kRegionCaptureDelayMs), [this, position, rect]() {
+        QMetaObject::invokeMethod(this, [this, position, rect]() {
+            CaptureRegionWait(position, rect);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::CaptureRegionWait(size_t position, CaptureRect rect) {
+    if (!CanEditActions()) return;
+    PixelImage reference;
+    std::string error;
+    if (!screenCapture->Capture(rect, reference, error)) {
+        showNotification("Erro", QString("Captura falhou:\n%1").arg(QString::fromStdString(error)), true);
+        return;
+    }
+    QDir dir(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("referencias"));
+    dir.mkpath(".");
+    const QString path = dir.absoluteFilePath(
+        QString("tela_%1.png").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz")));
+    if (!SavePixelImage(path.toStdString(), reference, error)) {
+        showNotification("Erro", QString::fromStdString(error), true);
+        return;
+    }
+    
+    const MonitorInfo& monitor = monitors[rect.monitorIndex];
+    Action action = {"wait_region", PixelToRelative(rect.x, monitor.width), PixelToRelative(rect.y, monitor.height),
+                     16, false, 0.0, 10000, rect.monitorIndex, false, 0, {}};
+    action.required = true;
+    action.delta = 5;
+    action.text = path.toStdString();
+    ApplyEdit(editJournal.Insert(std::min(position, recorded_actions.size()), std::vector<Action>{action}));
+    qDebug() << "Espera pela tela inserida:" << path << rect.width << "x" << rect.height;
+}
+
+void MainWindow::ConvertToAnchorClick() {
+    if (!CanEditActions()) return;
+    const int row = ui->actionList->currentRow();
+    if (row < 0 || row >= (int)recorded_actions.size()) return;
+    Action click = recorded_actions[row];
+    if (click.type != "mouse_click" || !click.pressed || click.monitorIndex < 0 || click.monitorIndex >= (int)monitors.size()) {
+        showNotification("Erro", "Selecione o DOWN de um clique gravado.", true);
+        return;
+    }
+    // O up do mesmo botão, com no máximo esperas entre os dois (um arrasto não serve)
+    size_t up = row + 1;
+    while (up < recorded_actions.size() && recorded_actions[up].type == "delay") ++up;
+    if (up >= recorded_actions.size() || recorded_actions[up].type != "mouse_click" ||
+        recorded_actions[up].pressed || recorded_actions[up].key != click.key) {
+        showNotification("Erro", "O clique selecionado não tem o UP logo depois (arrasto?).", true);
+        return;
+    }
+    click.delay = recorded_actions[up].delay;
+    const size_t first = row;
+    const size_t count = up - row + 1;
+    const std::uint64_t revision = actionsRevision;
+    showNotification("Clique por imagem",
+        QString("A imagem em volta do clique é capturada em %1 s:\ndeixe a tela como a macro deve encontrá-la.")
+            .arg(kRegionCaptureDelayMs / 1000));
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kRegionCaptureDelayMs), [this, first, count, click, revision]() {
+        QMetaObject::invokeMethod(this, [this, first, count, click, revision]() {
+            CaptureAnchorClick(first, count, click, revision);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::CaptureAnchorClick(size_t first, size_t count, Action click, std::uint64_t revision) {
+    if (!CanEditActions()) return;
+    // Em kRegionCaptureDelayMs a lista pode ter sido editada, desfeita ou
+    // trocada: [first, first + count) já não seria o mesmo clique
+    if (revision != actionsRevision || first + count > recorded_actions.size() ||
+        click.monitorIndex >= (int)monitors.size()) {
+        showNotification("Erro", "A lista mudou durante a captura; o clique não foi convertido.", true);
+        return;
+    }
+    // Quadrado de kAnchorSize em volta do clique, sem sair da tela
+    const MonitorInfo& monitor = monitors[click.monitorIndex];
+    const int px = RelativeToPixel(click.x, monitor.width);
+    const int py = RelativeToPixel(click.y, monitor.height);
+    CaptureRect rect;
+    rect.monitorIndex = click.monitorIndex;
+    rect.width = std::min(kAnchorSize, monitor.width);
+    rect.height = std::min(kAnchorSize, monitor.height);
+    rect.x = std::max(0, std::min(monitor.width - rect.width, px - rect.width / 2));
+    rect.y = std::max(0, std::min(monitor.height - rect.height, py - rect.height / 2));
+    PixelImage image;
+    std::string error;
+    if (!screenCapture->Capture(rect, image, error)) {
+        showNotification("Erro", QString("Captura falhou:\n%1").arg(QString::fromStdString(error)), true);
+        return;
+    }
+    AnchorTemplate anchor(image);
+    if (!anchor.Valid()) {
+        showNotification("Erro", QString::fromStdString(anchor.Error()), true);
+        return;
+    }
+    QDir dir(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("referencias"));
+    dir.mkpath(".");
+    const QString path = dir.absoluteFilePath(
+        QString("ancora_%1.png").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz")));
+    if (!SavePixelImage(path.toStdString(), image, error)) {
+        showNotification("Erro", QString::fromStdString(error), true);
+        return;
+    }
+    
+    Action action = click;
+    action.type = "anchor_click";
+    action.delta = PackAnchorOffset(px - rect.x, py - rect.y);
+    action.frequency = 10000;
+    action.required = true;
+    action.text = path.toStdString();
+    editJournal.BeginGroup("Clicar pela imagem");
+    editJournal.Remove(first, count);
+    editJournal.Insert(first, std::vector<Action>{action});
+    editJournal.EndGroup();
+    ApplyEdit(EditRange{first, 0, true});
+    ui->actionList->setCurrentRow(static_cast<int>(first));
+    qDebug() << "Clique por imagem:" << path << "ponto" << (px - rect.x) << (py - rect.y);
+}
+
+void MainWindow::UndoEdit() {
+    if (!CanEditActions() || !editJournal.CanUndo()) return;
+    QString text = editJournal.UndoText();
+    ApplyEdit(editJournal.Undo());
+    qDebug() << "Desfeito:" << text;
+}
+
+void MainWindow::RedoEdit() {
+    if (!CanEditActions() || !editJournal.CanRedo()) return;
+    QString text = editJournal.RedoText();
+    ApplyEdit(editJournal.Redo());
+    qDebug() << "Refeito:" << text;
+}
+
+void MainWindow::RemoveSelectedActions() {
+    auto runs = SelectedActionRuns();
+    if (!CanEditActions() || runs.empty()) return;
+    size_t total = 0;
+    for (const auto& run : runs) total += run.second;
+    
+    // Do fim para o início: os índices dos trechos anteriores não mudam
+    editJournal.BeginGroup(QString("Remover %1 ações").arg(total));
+    for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+        editJournal.Remove(it->first, it->second);
+    }
+    editJournal.EndGroup();
+    ApplyEdit(EditRange{runs.front().first, 0, true});
+    ui->actionList->setCurrentRow(std::min<int>(runs.front().first, (int)recorded_actions.size() - 1));
+}
+
+void MainWindow::MoveSelectedActions(int direction) {
+    auto runs = SelectedActionRuns();
+    if (!CanEditActions() || runs.empty()) return;
+    // Seleção não contígua: move o trecho do primeiro ao último selecionado
+    const size_t first = runs.front().first;
+    const size_t count = runs.back().first + runs.back().second - first;
+    if (direction < 0 && first == 0) return;
+    if (direction > 0 && first + count >= recorded_actions.size()) return;
+    
+    const size_t to = direction < 0 ? first - 1 : first + count + 1;
+    ApplyEdit(editJournal.Move(first, count, to));
+    
+    const size_t moved = direction < 0 ? first - 1 : first + 1;
+    ui->actionList->clearSelection();
+    for (size_t i = moved; i < moved + count; ++i) {
+        ui->actionList->item(static_cast<int>(i))->setSelected(true);
+    }
+    ui->actionList->setCurrentRow(static_cast<int>(moved), QItemSelectionModel::NoUpdate);
+}
+
+void MainWindow::DuplicateSelectedActions() {
+    auto runs = SelectedActionRuns();
+    if (!CanEditActions() || runs.empty()) return;
+    const size_t first = runs.front().first;
+    const size_t end = runs.back().first + runs.back().second;
+    ApplyEdit(editJournal.Insert(end, recorded_actions.Slice(first, end - first)));
+}
+
+void MainWindow::ScaleSelectedDelays() {
+    if (!CanEditActions() || recorded_actions.empty()) return;
+    auto runs = SelectedActionRuns();
+    bool ok;
+    double factor = QInputDialog::getDouble(this, "Escalar Delays",
+        runs.empty() ? "Multiplicar todos os delays por:" : "Multiplicar os delays selecionados por:",
+        1.0, 0.01, 100.0, 2, &ok);
+    if (!ok) return;
+    
+    // Um comando por trecho, desfeitos juntos; cada um guarda só o fator
+    if (runs.empty()) runs.push_back({0, recorded_actions.size()});
+    editJournal.BeginGroup(QString("Escalar delays (%1x)").arg(factor, 0, 'g', 3));
+    EditRange range = editJournal.ScaleDelays(runs.front().first, runs.front().second, factor);
+    for (size_t i = 1; i < runs.size(); ++i) {
+        range = MergeEditRanges(range, editJournal.ScaleDelays(runs[i].first, runs[i].second, factor));
+    }
+    editJournal.EndGroup();
+    ApplyEdit(range);
+}
+
 void MainWindow::on_humanizeCheckbox_stateChanged(int state) {
     ui->varMaxEdit->setEnabled(state == Qt::Checked);
     ui->varMaxLabel->setEnabled(state == Qt::Checked);
+    ui->seedEdit->setEnabled(state == Qt::Checked);
+    ui->seedLabel->setEnabled(state == Qt::Checked);
+}
+
+void MainWindow::RefreshTimeline() {
+    if (playStart.action == 0 && playStart.repetition == 0) timeline->SetPlayhead(-1);
+    
+    // O resumo é montado na thread da linha do tempo a partir de um
+    // instantâneo: a interface não espera nem por gravações de milhões de ações
+    if (largeFile) {
+        // Rolar a janela do arquivo não muda o conteúdo: resumo só ao abrir
+        if (timelineFile == largeFile.get()) return;
+        timelineFile = largeFile.get();
+        const std::string path = largeFilePath.toLocal8Bit().toStdString();
+        timeline->SetSource([path]() {
+            ActionStreamFile file;
+            ActionStream stream;
+            std::string error;
+            if (!file.Open(path, error) || !file.LoadStream(stream, error)) {
+                qDebug() << "Linha do tempo: falha ao ler o arquivo:" << QString::fromStdString(error);
+                return TimelineSummary::Build(ActionStream());
+            }
+            return TimelineSummary::Build(stream);
+        });
+    } else {
+        timelineFile = nullptr;
+        ActionTable snapshot = recorded_actions;
+        timeline->SetSource([snapshot]() { return TimelineSummary::Build(snapshot); });
+    }
+}
+
+void MainWindow::SelectTimelineAction(size_t action) {
+    int row = static_cast<int>(action);
+    if (largeFile) {
+        // Fora da janela visível: desloca a janela até a ação
+        if (action < viewOffset || action >= viewOffset + kViewWindow) {
+            viewOffset = action - std::min(action, kViewWindow / 4);
+            UpdateActionList();
+        }
+        row = static_cast<int>(action - viewOffset) + 1;   // linha 0 = cabeçalho
+    }
+    if (row >= ui->actionList->count()) return;
+    ui->actionList->setCurrentRow(row, QItemSelectionModel::ClearAndSelect);
+    ui->actionList->scrollToItem(ui->actionList->item(row), QAbstractItemView::PositionAtCenter);
+}
+
+void MainWindow::SelectTimelineRange(size_t first, size_t count) {
+    if (largeFile || !scriptProgram.empty() || count == 0) {
+        SelectTimelineAction(first);
+        return;
+    }
+    const size_t end = std::min(first + count, static_cast<size_t>(ui->actionList->count()));
+    QListWidget* list = ui->actionList;
+    list->setUpdatesEnabled(false);
+    list->clearSelection();
+    for (size_t i = first; i < end; ++i) {
+        list->item(static_cast<int>(i))->setSelected(true);
+    }
+    list->setUpdatesEnabled(true);
+    if (first < end) list->scrollToItem(list->item(static_cast<int>(first)), QAbstractItemView::PositionAtTop);
+}
+
+void MainWindow::SeekFromTimeline(std::int64_t micros) {
+    if (!scriptProgram.empty()) return;
+    auto summary = timeline->Summary();
+    if (summary->ActionCount() == 0) return;
+    
+    // Mesmo efeito do Ctrl+G com uma ação na primeira repetição
+    const size_t action = summary->ActionAtMicros(micros);
+    const size_t previous = playStart.action;
+    playStart = PlaybackPosition();
+    playStart.action = action;
+    if (largeFile) {
+        viewOffset = action - std::min(action, kViewWindow / 4);
+        UpdateActionList();
+    } else {
+        // Só as duas linhas com o marcador de início mudam
+        for (size_t row : {previous, action}) {
+            if (row < recorded_actions.size() && row < static_cast<size_t>(ui->actionList->count())) {
+                ui->actionList->item(static_cast<int>(row))->setText(FormatAction(row, recorded_actions[row]));
+            }
+        }
+    }
+    SelectTimelineAction(action);
+    timeline->SetPlayhead(summary->MicrosAt(action));
+    qDebug() << "Início da reprodução pela linha do tempo: ação" << action + 1 << "(" << FormatMicros(summary->MicrosAt(action)) << ")";
+}
+
+void MainWindow::ScheduleFilterUpdate() {
+    // Digitação rápida: só o último texto é aplicado
+    if (filterUpdatePending.exchange(true)) return;
+    timerWheel->ScheduleAfter(std::chrono::milliseconds(kFilterCoalesceMs), [this]() {
+        QMetaObject::invokeMethod(this, [this]() {
+            filterUpdatePending = false;
+            ApplyFilter();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::ApplyFilter() {
+    ActionQuery query;
+    QString error;
+    auto keyCode = [](const QString& name) {
+        for (const auto& entry : keyMap) {
+            if (name == QString::fromStdString(entry.second)) return static_cast<int>(entry.first);
+        }
+        return -1;
+    };
+    if (!ParseActionQuery(filterEdit->text(), query, error, keyCode)) {
+        filterLabel->setText(error);
+        return;
+    }
+    
+    QListWidget* list = ui->actionList;
+    const bool wasActive = filterActive;
+    filterActive = !query.Empty() && scriptProgram.empty();
+    if (!filterActive) {
+        filterMatches.clear();
+        filterLabel->setText(query.Empty() || scriptProgram.empty() ? "" : "Scripts não são filtrados");
+        if (wasActive) {
+            list->setUpdatesEnabled(false);
+            for (int row = 0; row < list->count(); ++row) list->setRowHidden(row, false);
+            list->setUpdatesEnabled(true);
+        }
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    if (largeFile) {
+        // Arquivo grande: indexado uma vez, na primeira busca
+        if (indexedFile != largeFile.get()) {
+            ActionStream stream;
+            std::string loadError;
+            if (!largeFile->LoadStream(stream, loadError)) {
+                filterLabel->setText("Erro ao ler o arquivo");
+                qDebug() << "Filtro: falha ao ler o arquivo:" << QString::fromStdString(loadError);
+                return;
+            }
+            actionIndex.Build(stream);
+            indexedFile = largeFile.get();
+        }
+    } else {
+        actionIndex.Sync(recorded_actions);
+    }
+    filterMatches = actionIndex.Find(query);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    // Linhas visíveis: tudo na lista normal, a janela no arquivo grande
+    // (a linha 0 é o cabeçalho)
+    const size_t firstAction = largeFile ? viewOffset : 0;
+    const int firstRow = largeFile ? 1 : 0;
+    auto match = std::lower_bound(filterMatches.begin(), filterMatches.end(), firstAction);
+    list->setUpdatesEnabled(false);
+    for (int row = firstRow; row < list->count(); ++row) {
+        const size_t action = firstAction + (row - firstRow);
+        while (match != filterMatches.end() && *match < action) ++match;
+        list->setRowHidden(row, match == filterMatches.end() || *match != action);
+    }
+    list->setUpdatesEnabled(true);
+    
+    filterLabel->setText(QString("%1 de %2 (%3 ms) · F3").arg(filterMatches.size()).arg(actionIndex.size())
+        .arg(ms, 0, 'f', 1));
+}
+
+void MainWindow::JumpToMatch(int direction) {
+    if (!filterActive || filterMatches.empty()) return;
+    
+    // Próximo resultado depois (ou antes) da linha atual, dando a volta
+    const int row = ui->actionList->currentRow();
+    const size_t current = row < 0 ? SIZE_MAX : (largeFile ? viewOffset + std::max(0, row - 1) : static_cast<size_t>(row));
+    size_t target;
+    if (direction > 0) {
+        auto it = current == SIZE_MAX ? filterMatches.begin()
+                                      : std::upper_bound(filterMatches.begin(), filterMatches.end(), current);
+        target = it == filterMatches.end() ? filterMatches.front() : *it;
+    } else {
+        auto it = current == SIZE_MAX ? filterMatches.end()
+                                      : std::lower_bound(filterMatches.begin(), filterMatches.end(), current);
+        target = it == filterMatches.begin() ? filterMatches.back() : *(it - 1);
+    }
+    SelectTimelineAction(target);
+    timeline->ShowAction(target);
 }
 
 void MainWindow::on_trayIcon_activated(QSystemTrayIcon::ActivationReason reason) {
@@ -10,11 +10,37 @@
 #include <windows.h>
 #include <vector>
 #include <string>
+#include "action.h"
+#include "actionindex.h"
+#include "actionstream.h"
+#include "actiontable.h"
+#include "controlserver.h"
+#include "hookthread.h"
+#include "hookwatchdog.h"
+#include "macroedit.h"
+#include "macrosaver.h"
+#include "macrovm.h"
+#include "macroscheduler.h"
+#include "pixelmatch.h"
+#include "screenchanges.h"
+#include "windowtarget.h"
+#include "templatematch.h"
+#include "screencapture.h"
+#include "telemetry.h"
+#include "timeline.h"
+#include "timerwheel.h"
+#include <atomic>
+#include <bitset>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+class PlaybackSink;
+class QLineEdit;
+class QLabel;
+
 struct MonitorInfo {
     int index;
     int left;
@@ -27,17 +53,6 @@ struct MonitorInfo {
     RECT rect;
 };
 
-struct Action {
-    std::string type;
-    int x;
-    int y;
-    WORD key;
-    bool pressed;
-    double delay;
-    int frequency;
-    int monitorIndex;
-};
-
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -60,16 +75,42 @@ public:
     void RecordKeyEvent(WORD vkCode, bool isKeyDown);
     void RecordMouseEvent(int x, int y, int button, bool isButtonDown);
     void RecordMouseMove(int x, int y);
+    void RecordMouseWheel(int x, int y, int axis, int delta);
+    // Tecla que produz um caractere vira parte de uma ação "type_text";
+    // true = absorvida (não gravar como key_press)
+    // 'modifiers': CapturedInput::kCtrl... no instante da tecla
+    bool RecordTypedKey(WORD vkCode, DWORD scanCode, bool isKeyDown, std::uint8_t modifiers);
+    // Grava o Shift segurado (adiado por RecordTypedKey) antes de uma ação que não é texto
+    void RecordHeldShift();
     
     // Funções de input
     void SendKey(WORD vk, bool press);
     void SendMouseClick(int button, bool press);
-    void SendMouseMove(int relX, int relY, int monitorIndex);
+    // Thread de injeção: 'screens' é a cópia dos monitores do PlaybackSink
+    void SendMouseMove(int relX, int relY, int monitorIndex, const std::vector<MonitorInfo>& screens);
+    void SendMouseWheel(int axis, int delta);
+    void SendText(const std::string& utf8);
+    void SendRelease(const HeldInputs& held);
     
     // Utilitários
     std::string KeyCodeToString(WORD vkCode);
     std::string MouseButtonToString(int button);
     void UpdateActionList();
+    QString FormatAction(size_t index, const Action& action);
+    // Agrupa as atualizações da lista durante a gravação (uma a cada kActionListCoalesceMs)
+    void ScheduleActionListUpdate();
+    void ScheduleAutosave();
+    void AutosaveNow();
+    // Depois de carregar um arquivo: o conteúdo conta como salvo
+    void MarkLoaded();
+    void ScheduleMetricsExport();
+    void ScheduleHookWatchdog();
+    void CheckHooks();
+    void ReinstallHooks(HookWatchdog::Verdict verdict);
+    // Converte em ações os eventos que a thread dos hooks enfileirou
+    void DrainCapturedInput();
+    void ToggleTracing();
+    void WriteTrace();
     void showNotification(const QString &title, const QString &message, bool isWarning = false);
     
     // Funções de interface
@@ -85,11 +126,15 @@ private slots:
     void on_stopButton_clicked();
     void on_saveButton_clicked();
     void on_loadButton_clicked();
+    void on_scheduleButton_clicked();
     void on_clearButton_clicked();
+    void on_jumpButton_clicked();
     void on_actionList_itemDoubleClicked(QListWidgetItem *item);
     void on_humanizeCheckbox_stateChanged(int state);
     void on_trayIcon_activated(QSystemTrayIcon::ActivationReason reason);
     void TestPrecision(); // ✅ ADICIONAR ESTA LINHA
+    void RunBenchmarks();
+    void OnSchedulerEvent(int macroId, int event, const QString &detail);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
@@ -102,16 +147,99 @@ private:
     bool recordingKeyboard = true;
     bool recordingMouse = true;
     std::chrono::steady_clock::time_point lastActionTime;
+    // Instante em que o hook recebeu o evento em conversão (as esperas gravadas
+    // não dependem de quando a interface chegou a ele)
+    std::chrono::steady_clock::time_point captureTime;
+    // Rolagem em andamento: eventos seguidos da roda (touchpads mandam dezenas
+    // por segundo, com deltas pequenos) somam na mesma ação por até kWheelBatchMs
+    static constexpr int kWheelBatchMs = 100;
+    size_t wheelBatchAction = SIZE_MAX;
+    std::chrono::steady_clock::time_point wheelBatchStart;
+    // Digitação agrupada (opção "Agrupar digitação"): caracteres seguidos, sem
+    // pausa maior que kTypeBatchGapMs, somam na mesma ação "type_text". O Shift
+    // só é gravado se for usado por algo além das maiúsculas.
+    static constexpr int kTypeBatchGapMs = 1000;
+    bool recordingText = false;
+    size_t typeBatchAction = SIZE_MAX;
+    std::chrono::steady_clock::time_point typeBatchLast;
+    std::bitset<256> typedKeys;         // teclas absorvidas no texto (o up também é descartado)
+    WORD heldShiftVk = 0;               // Shift pressionado (0 = solto)
+    bool heldShiftRecorded = false;
+    bool afterDeadKey = false;          // última tecla foi morta (´, ~, ^...): a próxima vai como key_press
     
-    // Hooks
-    HHOOK keyboardHook = nullptr;
-    HHOOK mouseHook = nullptr;
-    HHOOK globalShortcutHook = nullptr;
+    // Hooks de gravação e de atalhos, na thread própria deles
+    std::unique_ptr<HookThread> hookThread;
+    // Vigia dos hooks de gravação (o sistema os remove em silêncio quando demoram)
+    std::unique_ptr<HookWatchdog> hookWatchdog;
+    std::atomic<bool> hookReinstallPending{false};
+    std::uint64_t reportedSlowCallbacks = 0;   // só na thread da roda
+    std::uint64_t reportedLostEvents = 0;
+    static constexpr int kHookWatchdogIntervalMs = 100;
     
     // Dados
-    std::vector<Action> recorded_actions;
+    // Piece table: edições O(log n) e cópia O(1) para o autosave e o salvamento
+    ActionTable recorded_actions;
+    // Desfazer/refazer das edições da lista (Ctrl+Z / Ctrl+Y)
+    EditJournal editJournal{recorded_actions};
     std::vector<MonitorInfo> monitors;
     
+    // Script carregado (.mscript); vazio quando a macro vem da gravação
+    MacroProgram scriptProgram;
+    QString scriptName;
+    
+    // Arquivo .mstream grande: fica aberto e só a janela visível é lida
+    // (não entra em recorded_actions, então não é editável pela lista)
+    std::unique_ptr<ActionStreamFile> largeFile;
+    QString largeFileName;
+    QString largeFilePath;
+    size_t viewOffset = 0;
+    static constexpr size_t kEagerLoadActions = 200000;
+    static constexpr size_t kViewWindow = 2000;
+    // Ponto de partida do botão "Reproduzir" (Ctrl+G)
+    PlaybackPosition playStart;
+    static constexpr int kRepetitionGapMs = 500;
+    
+    // Linha do tempo acima da lista (resumo e desenho na thread do widget)
+    TimelineWidget* timeline = nullptr;
+    const ActionStreamFile* timelineFile = nullptr;   // arquivo grande já resumido
+    
+    // Busca/filtro da lista (Ctrl+F): índices por coluna, atualizados no fim
+    // durante a gravação e descartados a partir do ponto editado
+    QLineEdit* filterEdit = nullptr;
+    QLabel* filterLabel = nullptr;
+    ActionIndex actionIndex;
+    const ActionStreamFile* indexedFile = nullptr;    // arquivo grande indexado
+    bool filterActive = false;
+    std::vector<std::uint32_t> filterMatches;
+    std::atomic<bool> filterUpdatePending{false};
+    static constexpr int kFilterCoalesceMs = 150;
+    
+    // Salvamento em segundo plano e autosave incremental
+    std::unique_ptr<MacroSaver> saver;
+    std::uint64_t actionsRevision = 0;      // muda a cada alteração da lista
+    std::uint64_t autosavedRevision = 0;
+    static constexpr int kAutosaveIntervalMs = 15000;
+    // Métricas para o coletor "textfile" do node_exporter
+    QString metricsPath;
+    static constexpr int kMetricsIntervalMs = 10000;
+    
+    // Reprodução: roda de temporizadores + agendador de macros
+    std::unique_ptr<TimerWheel> timerWheel;
+    std::unique_ptr<PlaybackSink> playbackSink;
+    std::unique_ptr<MacroScheduler> scheduler;
+    MacroScheduler::MacroId mainMacroId = 0;   // macro do botão "Reproduzir"
+    // Controle por outros processos (pipe nomeado "MacroApp")
+    std::unique_ptr<ControlServer> controlServer;
+    // Capturas das esperas pela tela (e das imagens de referência)
+    std::shared_ptr<GdiCaptureBackend> screenCapture;
+    // Cliques relativos à janela (opção "Cliques relativos à janela")
+    std::shared_ptr<Win32WindowResolver> windowResolver;
+    bool recordingWindows = false;
+    static constexpr int kRegionCaptureDelayMs = 3000;
+    static constexpr int kAnchorSize = 64;          // lado da imagem capturada em volta do clique
+    std::atomic<bool> actionListUpdatePending{false};
+    static constexpr int kActionListCoalesceMs = 50;
+    
     // Tray
     QSystemTrayIcon *trayIcon = nullptr;
     QMenu *trayMenu = nullptr;
@@ -123,11 +251,40 @@ private:
     void RegisterGlobalShortcuts();
     void UnregisterGlobalShortcuts();
     void HandleGlobalShortcut(WORD vkCode);
+    void LoadScript(const QString &fileName);
+    void LoadStream(const QString &fileName);
+    
+    // Edição da lista de ações
+    bool CanEditActions() const;
+    void ApplyEdit(const EditRange& range);
+    std::vector<std::pair<size_t, size_t>> SelectedActionRuns() const;
+    void ShowActionListMenu(const QPoint& pos);
+    void UndoEdit();
+    void RedoEdit();
+    void RemoveSelectedActions();
+    void MoveSelectedActions(int direction);
+    void DuplicateSelectedActions();
+    void ScaleSelectedDelays();
+    // Espera pela tela: pede a região e captura a referência depois de kRegionCaptureDelayMs
+    void InsertRegionWait();
+    void CaptureRegionWait(size_t position, CaptureRect rect);
+    // Clique por imagem: troca o clique selecionado (down e up) por um
+    // "anchor_click" com a imagem em volta dele, capturada do mesmo jeito;
+    // desiste se a lista mudou desde 'revision'
+    void ConvertToAnchorClick();
+    void CaptureAnchorClick(size_t first, size_t count, Action click, std::uint64_t revision);
+    std::vector<CaptureMonitor> CaptureMonitors() const;
+    
+    // Linha do tempo
+    void RefreshTimeline();
+    void SelectTimelineAction(size_t action);
+    void SelectTimelineRange(size_t first, size_t count);
+    void SeekFromTimeline(std::int64_t micros);
     
-    // Hooks estáticos
-    static LRESULT CALLBACK GlobalShortcutHookProc(int nCode, WPARAM wParam, LPARAM lParam);
-    static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
-    static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam);
+    // Busca
+    void ScheduleFilterUpdate();
+    void ApplyFilter();
+    void JumpToMatch(int direction);
     
     // Função de callback para enumeração de monitores
     static BOOL CALLBACK MonitorEnumProc(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMonitor, LPARAM dwData);
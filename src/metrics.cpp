@@ -0,0 +1,269 @@
+#include "metrics.h"
+#include "macrosaver.h"
+#include <QByteArray>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+int MetricShard() {
+    static std::atomic<int> nextShard{0};
+    thread_local const int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+std::uint64_t MetricCounter::Value() const {
+    std::uint64_t total = 0;
+    for (const Shard& shard : shards) total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+// =============================================
+// HISTOGRAMA
+// =============================================
+
+namespace {
+
+inline int HighestBit(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int n = 63;
+    while (!(value >> n)) --n;
+    return n;
+#endif
+}
+
+} // namespace
+
+int MetricHistogram::BucketOf(std::uint64_t micros) {
+    if (micros < static_cast<std::uint64_t>(kSubBuckets)) return static_cast<int>(micros);
+    micros = std::min<std::uint64_t>(micros, (std::uint64_t(1) << kMaxExponent) - 1);
+    const int exponent = HighestBit(micros);
+    const int mantissa = static_cast<int>(micros >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBits + 1) * kSubBuckets + mantissa;
+}
+
+std::uint64_t MetricHistogram::BucketLow(int bucket) {
+    if (bucket < kSubBuckets) return static_cast<std::uint64_t>(bucket);
+    const int exponent = bucket / kSubBuckets + kSubBits - 1;
+    const std::uint64_t mantissa = static_cast<std::uint64_t>(bucket % kSubBuckets);
+    return (kSubBuckets + mantissa) << (exponent - kSubBits);
+}
+
+std::uint64_t MetricHistogram::BucketHigh(int bucket) {
+    if (bucket < kSubBuckets) return static_cast<std::uint64_t>(bucket);
+    const int exponent = bucket / kSubBuckets + kSubBits - 1;
+    return BucketLow(bucket) + (std::uint64_t(1) << (exponent - kSubBits)) - 1;
+}
+
+void MetricHistogram::Record(std::int64_t micros) {
+    const std::uint64_t value = micros > 0 ? static_cast<std::uint64_t>(micros) : 0;
+    Shard& shard = shards[MetricShard()];
+    shard.counts[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::Take() const {
+    Snapshot snapshot;
+    snapshot.counts.assign(kBuckets, 0);
+    for (const Shard& shard : shards) {
+        for (int i = 0; i < kBuckets; ++i) {
+            const std::uint64_t count = shard.counts[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += count;
+            snapshot.count += count;
+        }
+        snapshot.sumMicros += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+std::int64_t MetricHistogram::Snapshot::Percentile(double q) const {
+    if (count == 0) return 0;
+    const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * count + 0.5));
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return static_cast<std::int64_t>(BucketHigh(static_cast<int>(i)));
+    }
+    return static_cast<std::int64_t>(BucketHigh(kBuckets - 1));
+}
+
+std::uint64_t MetricHistogram::Snapshot::CountAtMost(std::int64_t micros) const {
+    std::uint64_t total = 0;
+    // Bloco que contém o limite entra inteiro (erro de no máximo um bloco)
+    for (size_t i = 0; i < counts.size() && static_cast<std::int64_t>(BucketLow(static_cast<int>(i))) <= micros; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+// =============================================
+// REGISTRO E EXPOSIÇÃO
+// =============================================
+
+MetricsRegistry& MetricsRegistry::Global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void* MetricsRegistry::Find(Type type, const std::string& name, const std::string& labels) const {
+    for (const Entry& entry : entries) {
+        if (entry.type == type && entry.name == name && entry.labels == labels) return entry.metric;
+    }
+    return nullptr;
+}
+
+MetricCounter& MetricsRegistry::Counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (void* existing = Find(Type::Counter, name, labels)) return *static_cast<MetricCounter*>(existing);
+    counters.emplace_back();
+    entries.push_back({Type::Counter, name, help, labels, &counters.back()});
+    return counters.back();
+}
+
+MetricGauge& MetricsRegistry::Gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (void* existing = Find(Type::Gauge, name, std::string())) return *static_cast<MetricGauge*>(existing);
+    gauges.emplace_back();
+    entries.push_back({Type::Gauge, name, help, std::string(), &gauges.back()});
+    return gauges.back();
+}
+
+MetricHistogram& MetricsRegistry::Histogram(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (void* existing = Find(Type::Histogram, name, std::string())) return *static_cast<MetricHistogram*>(existing);
+    histograms.emplace_back();
+    entries.push_back({Type::Histogram, name, help, std::string(), &histograms.back()});
+    return histograms.back();
+}
+
+namespace {
+
+// Limites dos buckets exportados, em us (de 50 us a 10 s)
+const std::int64_t kExpositionBounds[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+std::string Seconds(double micros) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.6g", micros / 1e6);
+    return text;
+}
+
+} // namespace
+
+std::string MetricsRegistry::Exposition() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+    out.reserve(entries.size() * 256);
+    std::string lastName;
+    for (const Entry& entry : entries) {
+        // HELP/TYPE uma vez por nome (contadores com rótulos diferentes dividem)
+        if (entry.name != lastName) {
+            const char* type = entry.type == Type::Counter ? "counter" : entry.type == Type::Gauge ? "gauge" : "histogram";
+            out += "# HELP " + entry.name + " " + entry.help + "\n";
+            out += "# TYPE " + entry.name + " " + type + "\n";
+            lastName = entry.name;
+        }
+        const std::string labels = entry.labels.empty() ? std::string() : "{" + entry.labels + "}";
+        switch (entry.type) {
+            case Type::Counter:
+                out += entry.name + labels + " " + std::to_string(static_cast<const MetricCounter*>(entry.metric)->Value()) + "\n";
+                break;
+            case Type::Gauge:
+                out += entry.name + labels + " " + std::to_string(static_cast<const MetricGauge*>(entry.metric)->Value()) + "\n";
+                break;
+            case Type::Histogram: {
+                const MetricHistogram::Snapshot snapshot = static_cast<const MetricHistogram*>(entry.metric)->Take();
+                for (std::int64_t bound : kExpositionBounds) {
+                    out += entry.name + "_bucket{le=\"" + Seconds(static_cast<double>(bound)) + "\"} " +
+                           std::to_string(snapshot.CountAtMost(bound)) + "\n";
+                }
+                out += entry.name + "_bucket{le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+                out += entry.name + "_sum " + Seconds(static_cast<double>(snapshot.sumMicros)) + "\n";
+                out += entry.name + "_count " + std::to_string(snapshot.count) + "\n";
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+bool MetricsRegistry::WriteExposition(const QString& path, QString& error) const {
+    const std::string text = Exposition();
+    return WriteFileAtomic(path, QByteArray(text.data(), static_cast<int>(text.size())), error);
+}
+
+AppMetrics& AppMetrics::Get() {
+    MetricsRegistry& r = MetricsRegistry::Global();
+    static AppMetrics metrics = {
+        r.Counter("macroapp_captured_events_total", "Eventos recebidos pelos hooks durante a gravação"),
+        r.Counter("macroapp_captured_events_dropped_total", "Eventos capturados e não gravados (movimentos abaixo do limiar)"),
+        r.Counter("macroapp_playback_runs_total", "Execuções de macros por resultado", "result=\"started\""),
+        r.Counter("macroapp_playback_runs_total", "Execuções de macros por resultado", "result=\"finished\""),
+        r.Counter("macroapp_playback_runs_total", "Execuções de macros por resultado", "result=\"stopped\""),
+        r.Counter("macroapp_playback_runs_total", "Execuções de macros por resultado", "result=\"failed\""),
+        r.Counter("macroapp_playback_runs_total", "Execuções de macros por resultado", "result=\"skipped\""),
+        r.Counter("macroapp_scheduler_overruns_total", "Fatias tão atrasadas que o prazo da macro recomeçou do agora"),
+        r.Counter("macroapp_injected_events_total", "Eventos entregues pela fila de injeção"),
+        r.Counter("macroapp_injection_failures_total", "Chamadas de SendInput que injetaram menos eventos que o pedido"),
+        r.Counter("macroapp_hook_slow_callbacks_total", "Callbacks de hook acima do orçamento de tempo"),
+        r.Counter("macroapp_hook_reinstalls_total", "Hooks removidos pelo sistema e reinstalados pelo vigia"),
+        r.Counter("macroapp_hook_lost_events_total", "Eventos de entrada estimados como perdidos enquanto os hooks estavam fora"),
+        r.Counter("macroapp_capture_overflows_total", "Eventos descartados com a fila da thread dos hooks cheia"),
+        r.Gauge("macroapp_injection_queue_depth", "Eventos aguardando na fila de injeção"),
+        r.Histogram("macroapp_injection_latency_seconds", "Atraso de cada evento injetado em relação ao instante previsto"),
+        r.Histogram("macroapp_scheduler_lateness_seconds", "Atraso do temporizador em relação ao prazo de cada fatia"),
+        r.Histogram("macroapp_hook_duration_seconds", "Tempo dentro dos hooks de teclado e mouse"),
+        r.Histogram("macroapp_hook_gap_seconds", "Duração das falhas dos hooks até a reinstalação"),
+        r.Histogram("macroapp_capture_delay_seconds", "Espera dos eventos capturados na fila até a interface gravá-los"),
+        r.Histogram("macroapp_load_duration_seconds", "Tempo para carregar uma macro"),
+        r.Histogram("macroapp_save_duration_seconds", "Tempo para serializar e gravar uma macro"),
+    };
+    return metrics;
+}
+
+// =============================================
+// BENCHMARK DAS MÉTRICAS
+// =============================================
+
+MetricsBenchmarkResult BenchmarkMetrics(size_t operations) {
+    using Clock = std::chrono::steady_clock;
+    MetricsBenchmarkResult result = {operations, 0, 0, 0, 0, 0};
+    if (operations == 0) return result;
+
+    auto counter = std::make_unique<MetricCounter>();
+    auto start = Clock::now();
+    for (size_t i = 0; i < operations; ++i) counter->Add();
+    result.counterNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+
+    // Mesmo trabalho em 4 threads: fatias contra um único atômico disputado
+    const size_t perThread = std::max<size_t>(1, operations / 4);
+    auto runThreads = [perThread](auto&& body) {
+        std::vector<std::thread> threads;
+        auto begin = Clock::now();
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&body, perThread]() {
+                for (size_t i = 0; i < perThread; ++i) body();
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        return std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / perThread;
+    };
+    result.counterContendedNs = runThreads([&counter]() { counter->Add(); });
+    std::atomic<std::uint64_t> shared{0};
+    result.sharedAtomicNs = runThreads([&shared]() { shared.fetch_add(1, std::memory_order_relaxed); });
+
+    auto histogram = std::make_unique<MetricHistogram>();
+    start = Clock::now();
+    for (size_t i = 0; i < operations; ++i) histogram->Record(static_cast<std::int64_t>((i * 2654435761u) & 0xFFFFF));
+    result.histogramNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+
+    AppMetrics::Get();
+    start = Clock::now();
+    const std::string text = MetricsRegistry::Global().Exposition();
+    result.expositionMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
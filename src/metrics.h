@@ -0,0 +1,173 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Métricas do aplicativo no formato de exposição de texto do Prometheus.
+// Contadores e histogramas são divididos em fatias por thread (cada thread
+// escreve na sua linha de cache, sem lock e sem disputa); a soma só acontece
+// na exportação. O registro é feito uma vez, na inicialização; quem mede
+// guarda a referência.
+
+constexpr int kMetricShards = 8;
+
+// Fatia da thread atual (fixa durante a vida da thread)
+int MetricShard();
+
+class MetricCounter {
+public:
+    void Add(std::uint64_t n = 1) {
+        shards[MetricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    std::uint64_t Value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    Shard shards[kMetricShards];
+};
+
+class MetricGauge {
+public:
+    void Set(std::int64_t v) { value.store(v, std::memory_order_relaxed); }
+    std::int64_t Value() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> value{0};
+};
+
+// Histograma log-linear no estilo HDR, em microssegundos: 16 blocos por
+// potência de 2 (erro relativo de no máximo 1/16), de 0 a ~2^40 us.
+class MetricHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBuckets = (kMaxExponent - kSubBits + 1) * kSubBuckets;
+
+    void Record(std::int64_t micros);
+
+    struct Snapshot {
+        std::vector<std::uint64_t> counts;     // por bloco
+        std::uint64_t count = 0;
+        std::uint64_t sumMicros = 0;
+        // Valor (us) abaixo do qual fica a fração 'q' das amostras
+        std::int64_t Percentile(double q) const;
+        // Amostras com valor até 'micros' (aproximado ao bloco)
+        std::uint64_t CountAtMost(std::int64_t micros) const;
+    };
+    Snapshot Take() const;
+
+    static int BucketOf(std::uint64_t micros);
+    static std::uint64_t BucketLow(int bucket);
+    static std::uint64_t BucketHigh(int bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> counts[kBuckets];
+        std::atomic<std::uint64_t> sum{0};
+        Shard() {
+            for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+        }
+    };
+    Shard shards[kMetricShards];
+};
+
+// Mede o tempo até o fim do escopo
+class ScopedMetricTimer {
+public:
+    explicit ScopedMetricTimer(MetricHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedMetricTimer() {
+        histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    MetricHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+class MetricsRegistry {
+public:
+    // 'labels' no formato do Prometheus, sem chaves: result="finished".
+    // Mesmo nome e rótulos devolvem a mesma métrica.
+    MetricCounter& Counter(const std::string& name, const std::string& help, const std::string& labels = std::string());
+    MetricGauge& Gauge(const std::string& name, const std::string& help);
+    MetricHistogram& Histogram(const std::string& name, const std::string& help);
+
+    // Texto de exposição (histogramas em segundos, como é o padrão)
+    std::string Exposition() const;
+    // Troca atômica do arquivo (para o coletor "textfile" do node_exporter)
+    bool WriteExposition(const QString& path, QString& error) const;
+
+    static MetricsRegistry& Global();
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+    struct Entry {
+        Type type;
+        std::string name;
+        std::string help;
+        std::string labels;
+        void* metric;
+    };
+
+    void* Find(Type type, const std::string& name, const std::string& labels) const;
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;             // ordem de registro
+    std::deque<MetricCounter> counters;     // endereços estáveis
+    std::deque<MetricGauge> gauges;
+    std::deque<MetricHistogram> histograms;
+};
+
+// Métricas do aplicativo, registradas no primeiro uso
+struct AppMetrics {
+    MetricCounter& capturedEvents;
+    MetricCounter& droppedEvents;         // capturados e não gravados (movimentos pequenos demais)
+    MetricCounter& runsStarted;
+    MetricCounter& runsFinished;
+    MetricCounter& runsStopped;
+    MetricCounter& runsFailed;
+    MetricCounter& runsSkipped;
+    MetricCounter& schedulerOverruns;     // macro tão atrasada que o prazo recomeçou do agora
+    MetricCounter& injectedEvents;
+    MetricCounter& injectionFailures;     // SendInput injetou menos eventos que o pedido
+    MetricCounter& hookSlowCallbacks;     // callbacks de hook acima do orçamento
+    MetricCounter& hookReinstalls;        // hooks removidos pelo sistema e reinstalados pelo vigia
+    MetricCounter& hookLostEvents;        // estimativa dos eventos perdidos enquanto os hooks estavam fora
+    MetricCounter& captureOverflows;      // eventos descartados com a fila dos hooks cheia
+    MetricGauge& injectionQueueDepth;
+    MetricHistogram& injectionLatency;    // atraso do evento em relação ao instante previsto
+    MetricHistogram& schedulerLateness;   // atraso do temporizador em relação ao prazo da fatia
+    MetricHistogram& hookDuration;        // tempo dentro dos hooks de teclado e mouse
+    MetricHistogram& hookGap;             // duração das falhas dos hooks (último evento visto até a reinstalação)
+    MetricHistogram& captureDelay;        // do hook até a interface converter o evento em ação
+    MetricHistogram& loadDuration;
+    MetricHistogram& saveDuration;
+
+    static AppMetrics& Get();
+};
+
+struct MetricsBenchmarkResult {
+    size_t operations;
+    double counterNs;               // uma thread
+    double counterContendedNs;      // 4 threads, contador com fatias
+    double sharedAtomicNs;          // 4 threads, um único atômico (referência)
+    double histogramNs;
+    double expositionMs;            // métricas do aplicativo
+};
+
+MetricsBenchmarkResult BenchmarkMetrics(size_t operations);
+
+#endif // METRICS_H
@@ -0,0 +1,318 @@
+#include "pixelmatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// SSE2 faz parte do x86-64; AVX2 é compilado à parte (atributo target do
+// GCC/Clang) e escolhido em tempo de execução
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELMATCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define PIXELMATCH_SSE2 0
+#endif
+
+#if PIXELMATCH_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define PIXELMATCH_AVX2 1
+#include <immintrin.h>
+#else
+#define PIXELMATCH_AVX2 0
+#endif
+
+namespace {
+
+using MismatchKernel = size_t (*)(const std::uint32_t*, const std::uint32_t*, size_t, int);
+
+inline bool PixelDiffers(std::uint32_t a, std::uint32_t b, int tolerance) {
+    for (int shift = 0; shift < 24; shift += 8) {
+        int d = static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF);
+        if (d > tolerance || -d > tolerance) return true;
+    }
+    return false;
+}
+
+#if PIXELMATCH_SSE2
+// |a - b| por byte com subtração saturada nos dois sentidos; o que passa da
+// tolerância sobra depois de subtrair 'tolerance' (saturado). Conta os pixels
+// iguais (-1 do cmpeq por pixel) e devolve o complemento.
+size_t CountSse2(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance) {
+    const __m128i tol = _mm_set1_epi8(static_cast<char>(tolerance));
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i equal0 = zero;
+    __m128i equal1 = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 4));
+        __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 4));
+        __m128i d0 = _mm_or_si128(_mm_subs_epu8(x0, y0), _mm_subs_epu8(y0, x0));
+        __m128i d1 = _mm_or_si128(_mm_subs_epu8(x1, y1), _mm_subs_epu8(y1, x1));
+        d0 = _mm_and_si128(_mm_subs_epu8(d0, tol), rgb);
+        d1 = _mm_and_si128(_mm_subs_epu8(d1, tol), rgb);
+        equal0 = _mm_sub_epi32(equal0, _mm_cmpeq_epi32(d0, zero));
+        equal1 = _mm_sub_epi32(equal1, _mm_cmpeq_epi32(d1, zero));
+    }
+    alignas(16) std::uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi32(equal0, equal1));
+    size_t mismatches = i - (static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3]);
+    for (; i < count; ++i) mismatches += PixelDiffers(a[i], b[i], tolerance);
+    return mismatches;
+}
+#endif
+
+#if PIXELMATCH_AVX2
+__attribute__((target("avx2")))
+size_t CountAvx2(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance) {
+    const __m256i tol = _mm256_set1_epi8(static_cast<char>(tolerance));
+    const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i equal0 = zero;
+    __m256i equal1 = zero;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 8));
+        __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 8));
+        __m256i d0 = _mm256_or_si256(_mm256_subs_epu8(x0, y0), _mm256_subs_epu8(y0, x0));
+        __m256i d1 = _mm256_or_si256(_mm256_subs_epu8(x1, y1), _mm256_subs_epu8(y1, x1));
+        d0 = _mm256_and_si256(_mm256_subs_epu8(d0, tol), rgb);
+        d1 = _mm256_and_si256(_mm256_subs_epu8(d1, tol), rgb);
+        equal0 = _mm256_sub_epi32(equal0, _mm256_cmpeq_epi32(d0, zero));
+        equal1 = _mm256_sub_epi32(equal1, _mm256_cmpeq_epi32(d1, zero));
+    }
+    alignas(32) std::uint32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi32(equal0, equal1));
+    size_t equal = 0;
+    for (std::uint32_t lane : lanes) equal += lane;
+    return i - equal + CountSse2(a + i, b + i, count - i, tolerance);
+}
+#endif
+
+struct Kernel {
+    MismatchKernel count;
+    const char* name;
+};
+
+Kernel SelectKernel() {
+#if PIXELMATCH_AVX2
+    if (__builtin_cpu_supports("avx2")) return {CountAvx2, "avx2"};
+#endif
+#if PIXELMATCH_SSE2
+    return {CountSse2, "sse2"};
+#else
+    return {CountPixelMismatchesScalar, "escalar"};
+#endif
+}
+
+const Kernel& ActiveKernel() {
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+} // namespace
+
+size_t CountPixelMismatchesScalar(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance) {
+    tolerance = std::max(0, std::min(255, tolerance));
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) mismatches += PixelDiffers(a[i], b[i], tolerance);
+    return mismatches;
+}
+
+size_t CountPixelMismatches(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance) {
+    return ActiveKernel().count(a, b, count, std::max(0, std::min(255, tolerance)));
+}
+
+const char* PixelMatchInstructionSet() {
+    return ActiveKernel().name;
+}
+
+size_t CountImageMismatches(const PixelImage& a, const PixelImage& b, int tolerance, size_t limit) {
+    if (a.width != b.width || a.height != b.height) return SIZE_MAX;
+    // Em trechos, para desistir cedo de uma região que claramente não coincide
+    constexpr size_t kChunk = 4096;
+    const size_t total = a.pixels.size();
+    size_t mismatches = 0;
+    for (size_t first = 0; first < total; first += kChunk) {
+        mismatches += CountPixelMismatches(a.pixels.data() + first, b.pixels.data() + first,
+                                           std::min(kChunk, total - first), tolerance);
+        if (mismatches > limit) break;
+    }
+    return mismatches;
+}
+
+// =============================================
+// ESPERA POR REGIÃO
+// =============================================
+
+RegionWatcher::RegionWatcher(std::shared_ptr<const PixelImage> reference, int monitorIndex, int x, int y,
+                             int tolerance, size_t maxMismatches)
+    : reference(std::move(reference)), monitorIndex(monitorIndex), relX(x), relY(y),
+      tolerance(tolerance), maxMismatches(maxMismatches) {
+}
+
+bool RegionWatcher::Poll(CaptureBackend& backend, bool& matched, std::string& error) {
+    using Clock = std::chrono::steady_clock;
+    matched = false;
+    if (!reference || reference->empty()) {
+        error = "imagem de referência vazia";
+        return false;
+    }
+    int screenWidth, screenHeight;
+    if (!backend.MonitorSize(monitorIndex, screenWidth, screenHeight)) {
+        error = "tela " + std::to_string(monitorIndex + 1) + " não encontrada";
+        return false;
+    }
+    if (reference->width > screenWidth || reference->height > screenHeight) {
+        error = "referência maior que a tela " + std::to_string(monitorIndex + 1);
+        return false;
+    }
+    // Dentro da tela: o arredondamento da posição relativa (ou uma resolução
+    // menor que a da gravação) não pode empurrar a região para fora dela
+    CaptureRect rect;
+    rect.monitorIndex = monitorIndex;
+    rect.width = reference->width;
+    rect.height = reference->height;
+    rect.x = std::max(0, std::min(screenWidth - rect.width, RelativeToPixel(relX, screenWidth)));
+    rect.y = std::max(0, std::min(screenHeight - rect.height, RelativeToPixel(relY, screenHeight)));
+
+    // Backend com detecção de mudanças e nada mudou na região desde a última
+    // comparação: o resultado seria o mesmo, só espaça a próxima consulta
+    const bool regionChanged = backend.RegionChanged(rect, seenChange);
+    if (polls > 0 && !regionChanged) {
+        interval = std::min(kMaxIntervalMicros, interval * 3 / 2);
+        ++polls;
+        return true;
+    }
+
+    auto start = Clock::now();
+    PixelImage& frame = frames[current];
+    if (!backend.Capture(rect, frame, error)) return false;
+    lastMismatches = CountImageMismatches(frame, *reference, tolerance, maxMismatches);
+    matched = lastMismatches <= maxMismatches;
+    // Mudou desde a captura anterior? (mesma tolerância: ruído não conta)
+    const bool changed = polls == 0 || CountImageMismatches(frame, frames[current ^ 1], tolerance, 0) > 0;
+    const std::int64_t cost = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+    interval = changed ? kMinIntervalMicros : std::min(kMaxIntervalMicros, interval * 3 / 2);
+    interval = std::max(interval, 4 * cost);
+    current ^= 1;
+    ++polls;
+    ++evaluations;
+    return true;
+}
+
+std::string RegionWatcher::LastResult() const {
+    return std::to_string(lastMismatches) + " pixels diferentes";
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+PixelMatchBenchmarkResult BenchmarkPixelMatch(int width, int height, size_t frameCount, const std::string& directory) {
+    using Clock = std::chrono::steady_clock;
+    PixelMatchBenchmarkResult result = {};
+    result.instructionSet = PixelMatchInstructionSet();
+    result.width = width;
+    result.height = height;
+
+    // Vazão da comparação: referência contra uma captura com ruído leve
+    std::mt19937 rng(7);
+    PixelImage reference, captured;
+    reference.Resize(width, height);
+    captured.Resize(width, height);
+    for (size_t i = 0; i < reference.pixels.size(); ++i) {
+        std::uint32_t pixel = rng() | 0xFF000000u;
+        reference.pixels[i] = pixel;
+        std::uint32_t noise = rng() & 0x00070707u;
+        captured.pixels[i] = (rng() & 7) == 0 ? (pixel ^ noise) : pixel;
+    }
+    const int rounds = std::max(1, static_cast<int>(200000000 / std::max<size_t>(1, reference.pixels.size())));
+    const double pixels = static_cast<double>(reference.pixels.size()) * rounds;
+    volatile size_t sink = 0;
+
+    auto start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        sink = sink + CountPixelMismatchesScalar(captured.pixels.data(), reference.pixels.data(), captured.pixels.size(), 4 + (r & 1));
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.scalarMPixelsPerSec = pixels / seconds / 1e6;
+
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        sink = sink + CountPixelMismatches(captured.pixels.data(), reference.pixels.data(), captured.pixels.size(), 4 + (r & 1));
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.simdMPixelsPerSec = pixels / seconds / 1e6;
+
+    // Sequência: tela parada, depois um indicador girando sobre a região e,
+    // no último quadro, o botão esperado
+    constexpr int kScreenWidth = 1920;
+    constexpr int kScreenHeight = 1080;
+    width = std::min(width, kScreenWidth);
+    height = std::min(height, kScreenHeight);
+    frameCount = std::max<size_t>(frameCount, 2);
+    const int regionX = (kScreenWidth - width) / 2;
+    const int regionY = (kScreenHeight - height) / 2;
+    std::vector<PixelImage> frames(frameCount);
+    for (size_t f = 0; f < frameCount; ++f) {
+        PixelImage& frame = frames[f];
+        frame.Resize(kScreenWidth, kScreenHeight);
+        for (int y = 0; y < kScreenHeight; ++y) {
+            std::uint32_t* row = frame.Row(y);
+            for (int x = 0; x < kScreenWidth; ++x) {
+                row[x] = 0xFF000000u | static_cast<std::uint32_t>((x * 255 / kScreenWidth) << 16) | static_cast<std::uint32_t>(y & 0xFF);
+            }
+        }
+        const bool last = f + 1 == frameCount;
+        const bool spinning = f >= frameCount / 2;
+        for (int y = 0; y < height; ++y) {
+            std::uint32_t* row = frame.Row(regionY + y) + regionX;
+            for (int x = 0; x < width; ++x) {
+                if (last) row[x] = ((x / 8 + y / 8) & 1) ? 0xFF2E7D32u : 0xFFFFFFFFu;
+                else if (spinning && ((x + y + static_cast<int>(f) * 16) / 32) % 4 == 0) row[x] = 0xFF606060u;
+            }
+        }
+    }
+    PixelImage target;
+    std::string error;
+    CaptureRect targetRect;
+    targetRect.x = regionX;
+    targetRect.y = regionY;
+    targetRect.width = width;
+    targetRect.height = height;
+    CropPixelImage(frames.back(), targetRect, target, error);
+
+    FileCaptureBackend backend;
+    bool loaded = false;
+    if (!directory.empty()) {
+        char name[64];
+        bool saved = true;
+        for (size_t f = 0; f < frames.size() && saved; ++f) {
+            std::snprintf(name, sizeof(name), "/quadro_%04zu.png", f);
+            saved = SavePixelImage(directory + name, frames[f], error);
+        }
+        loaded = saved && backend.OpenDirectory(directory, error);
+    }
+    result.frames = frames.size();
+    if (!loaded) backend.SetFrames(std::move(frames));
+
+    RegionWatcher watcher(std::make_shared<const PixelImage>(std::move(target)), 0,
+                          PixelToRelative(regionX, kScreenWidth), PixelToRelative(regionY, kScreenHeight), 8, 0);
+    bool matched = false;
+    double waitMicros = 0;
+    start = Clock::now();
+    while (!matched && watcher.Polls() <= result.frames) {
+        if (!watcher.Poll(backend, matched, error)) break;
+        if (!matched) waitMicros += static_cast<double>(watcher.NextIntervalMicros());
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.polls = watcher.Polls();
+    result.pollUs = result.polls ? seconds * 1e6 / result.polls : 0;
+    result.simulatedWaitMs = waitMicros / 1000.0;
+    return result;
+}
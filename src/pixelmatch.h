@@ -0,0 +1,90 @@
+#ifndef PIXELMATCH_H
+#define PIXELMATCH_H
+
+#include "screencapture.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Compara 'count' pixels de 'a' e 'b': um pixel difere quando R, G ou B (o alfa
+// é ignorado) difere mais que 'tolerance' (0-255). Usa AVX2 ou SSE2 conforme o
+// processador; a versão escalar é a referência para verificação e benchmark.
+size_t CountPixelMismatches(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance);
+size_t CountPixelMismatchesScalar(const std::uint32_t* a, const std::uint32_t* b, size_t count, int tolerance);
+// "avx2", "sse2" ou "escalar"
+const char* PixelMatchInstructionSet();
+
+// Imagens do mesmo tamanho; para de contar ao passar de 'limit' (o resultado é
+// então > limit, mas não necessariamente o total). Tamanhos diferentes: SIZE_MAX.
+size_t CountImageMismatches(const PixelImage& a, const PixelImage& b, int tolerance, size_t limit = SIZE_MAX);
+
+// Espera por algo na tela, consultada pelo agendador a cada temporizador
+class ScreenWatcher {
+public:
+    virtual ~ScreenWatcher() = default;
+    // false se a captura falhou ('error'); senão 'matched' diz se já apareceu
+    virtual bool Poll(CaptureBackend& backend, bool& matched, std::string& error) = 0;
+    virtual std::int64_t NextIntervalMicros() const = 0;
+    // Situação da última consulta, para a mensagem de tempo esgotado
+    virtual std::string LastResult() const = 0;
+};
+
+// Espera "até a região ficar igual à referência". Cada Poll captura a região e
+// compara; o intervalo até a próxima captura se adapta à tela: enquanto ela
+// muda entre capturas (a interface está reagindo), o mínimo; parada, cresce
+// 1,5x até o máximo. Nunca fica abaixo de 4x o custo da própria captura. Com
+// um backend que detecta mudanças (TrackedCaptureBackend), só compara de novo
+// quando algum bloco da região mudou.
+class RegionWatcher : public ScreenWatcher {
+public:
+    static constexpr std::int64_t kMinIntervalMicros = 8000;
+    static constexpr std::int64_t kMaxIntervalMicros = 250000;
+
+    // (x, y): canto superior esquerdo em centésimos de % da tela; o tamanho é o da referência
+    RegionWatcher(std::shared_ptr<const PixelImage> reference, int monitorIndex, int x, int y,
+                  int tolerance, size_t maxMismatches);
+
+    bool Poll(CaptureBackend& backend, bool& matched, std::string& error) override;
+    std::int64_t NextIntervalMicros() const override { return interval; }
+    std::string LastResult() const override;
+
+    size_t LastMismatches() const { return lastMismatches; }
+    size_t Polls() const { return polls; }
+    // Consultas que compararam (as outras acharam a região igual à anterior)
+    size_t Evaluations() const { return evaluations; }
+
+private:
+    std::shared_ptr<const PixelImage> reference;
+    int monitorIndex;
+    int relX;
+    int relY;
+    int tolerance;
+    size_t maxMismatches;
+    PixelImage frames[2];       // captura atual e anterior (alternam)
+    int current = 0;
+    std::int64_t interval = kMinIntervalMicros;
+    size_t lastMismatches = 0;
+    size_t polls = 0;
+    size_t evaluations = 0;
+    std::uint64_t seenChange = 0;
+};
+
+struct PixelMatchBenchmarkResult {
+    const char* instructionSet;
+    int width;                  // região comparada
+    int height;
+    double scalarMPixelsPerSec;
+    double simdMPixelsPerSec;
+    // Sequência de quadros (tela 1920x1080 com um indicador de carregamento até
+    // o botão esperado aparecer) lida do disco pelo FileCaptureBackend
+    size_t frames;
+    size_t polls;               // capturas até a região coincidir
+    double pollUs;              // captura (recorte do quadro) + comparação, média
+    double simulatedWaitMs;     // soma dos intervalos adaptativos até seguir
+};
+
+// 'directory': onde gravar a sequência de quadros (vazio = só em memória)
+PixelMatchBenchmarkResult BenchmarkPixelMatch(int width, int height, size_t frames, const std::string& directory);
+
+#endif // PIXELMATCH_H
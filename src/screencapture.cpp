@@ -0,0 +1,266 @@
+#include "screencapture.h"
+#include <QDir>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// =============================================
+// IMAGENS
+// =============================================
+
+bool LoadPixelImage(const std::string& path, PixelImage& out, std::string& error) {
+    QImage image;
+    if (!image.load(QString::fromStdString(path))) {
+        error = "não foi possível ler a imagem '" + path + "'";
+        return false;
+    }
+    image = image.convertToFormat(QImage::Format_ARGB32);
+    out.Resize(image.width(), image.height());
+    for (int y = 0; y < out.height; ++y) {
+        std::memcpy(out.Row(y), image.constScanLine(y), static_cast<size_t>(out.width) * sizeof(std::uint32_t));
+    }
+    return true;
+}
+
+bool SavePixelImage(const std::string& path, const PixelImage& image, std::string& error) {
+    if (image.empty()) {
+        error = "imagem vazia";
+        return false;
+    }
+    QImage copy(image.width, image.height, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height; ++y) {
+        std::memcpy(copy.scanLine(y), image.Row(y), static_cast<size_t>(image.width) * sizeof(std::uint32_t));
+    }
+    if (!copy.save(QString::fromStdString(path))) {
+        error = "não foi possível salvar a imagem '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+bool CropPixelImage(const PixelImage& source, const CaptureRect& rect, PixelImage& out, std::string& error) {
+    if (rect.width <= 0 || rect.height <= 0 || rect.x < 0 || rect.y < 0 ||
+        rect.x + rect.width > source.width || rect.y + rect.height > source.height) {
+        error = "região fora da tela";
+        return false;
+    }
+    out.Resize(rect.width, rect.height);
+    for (int y = 0; y < rect.height; ++y) {
+        std::memcpy(out.Row(y), source.Row(rect.y + y) + rect.x, static_cast<size_t>(rect.width) * sizeof(std::uint32_t));
+    }
+    return true;
+}
+
+// =============================================
+// CAPTURA PELO GDI
+// =============================================
+
+#ifdef _WIN32
+
+struct GdiCaptureBackend::Surface {
+    HDC memoryDC = nullptr;
+    HBITMAP bitmap = nullptr;
+    HGDIOBJ previous = nullptr;
+    std::uint32_t* bits = nullptr;
+    int width = 0;
+    int height = 0;
+
+    ~Surface() { Free(); }
+
+    void Free() {
+        if (memoryDC && previous) SelectObject(memoryDC, previous);
+        if (bitmap) DeleteObject(bitmap);
+        if (memoryDC) DeleteDC(memoryDC);
+        memoryDC = nullptr;
+        bitmap = nullptr;
+        previous = nullptr;
+        bits = nullptr;
+        width = height = 0;
+    }
+
+    // DIB top-down de 32 bits: linhas de 'width' pixels, sem preenchimento
+    bool Ensure(HDC screen, int w, int h) {
+        if (bitmap && w <= width && h <= height) return true;
+        w = std::max(w, width);
+        h = std::max(h, height);
+        Free();
+        memoryDC = CreateCompatibleDC(screen);
+        if (!memoryDC) return false;
+        BITMAPINFO info = {};
+        info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        info.bmiHeader.biWidth = w;
+        info.bmiHeader.biHeight = -h;
+        info.bmiHeader.biPlanes = 1;
+        info.bmiHeader.biBitCount = 32;
+        info.bmiHeader.biCompression = BI_RGB;
+        void* pixels = nullptr;
+        bitmap = CreateDIBSection(screen, &info, DIB_RGB_COLORS, &pixels, nullptr, 0);
+        if (!bitmap) {
+            Free();
+            return false;
+        }
+        previous = SelectObject(memoryDC, bitmap);
+        bits = static_cast<std::uint32_t*>(pixels);
+        width = w;
+        height = h;
+        return true;
+    }
+};
+
+GdiCaptureBackend::GdiCaptureBackend(std::vector<CaptureMonitor> monitors)
+    : monitors(std::move(monitors)), surface(new Surface) {
+}
+
+GdiCaptureBackend::~GdiCaptureBackend() = default;
+
+void GdiCaptureBackend::SetMonitors(std::vector<CaptureMonitor> value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    monitors = std::move(value);
+}
+
+int GdiCaptureBackend::MonitorCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(monitors.size());
+}
+
+bool GdiCaptureBackend::MonitorSize(int monitorIndex, int& width, int& height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (monitorIndex < 0 || monitorIndex >= static_cast<int>(monitors.size())) return false;
+    width = monitors[monitorIndex].width;
+    height = monitors[monitorIndex].height;
+    return true;
+}
+
+bool GdiCaptureBackend::Capture(const CaptureRect& rect, PixelImage& out, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rect.monitorIndex < 0 || rect.monitorIndex >= static_cast<int>(monitors.size())) {
+        error = "tela " + std::to_string(rect.monitorIndex + 1) + " não encontrada";
+        return false;
+    }
+    const CaptureMonitor& monitor = monitors[rect.monitorIndex];
+    if (rect.width <= 0 || rect.height <= 0 || rect.x < 0 || rect.y < 0 ||
+        rect.x + rect.width > monitor.width || rect.y + rect.height > monitor.height) {
+        error = "região fora da tela";
+        return false;
+    }
+
+    HDC screen = GetDC(nullptr);
+    if (!screen) {
+        error = "GetDC da tela falhou";
+        return false;
+    }
+    bool ok = surface->Ensure(screen, rect.width, rect.height) &&
+              BitBlt(surface->memoryDC, 0, 0, rect.width, rect.height, screen,
+                     monitor.left + rect.x, monitor.top + rect.y, SRCCOPY | CAPTUREBLT);
+    ReleaseDC(nullptr, screen);
+    if (!ok) {
+        error = "BitBlt falhou (código " + std::to_string(GetLastError()) + ")";
+        return false;
+    }
+    GdiFlush();
+
+    // O GDI deixa o alfa zerado: opaco, para a imagem salva como referência
+    out.Resize(rect.width, rect.height);
+    for (int y = 0; y < rect.height; ++y) {
+        const std::uint32_t* source = surface->bits + static_cast<size_t>(y) * surface->width;
+        std::uint32_t* target = out.Row(y);
+        for (int x = 0; x < rect.width; ++x) target[x] = source[x] | 0xFF000000u;
+    }
+    return true;
+}
+
+#endif
+
+// =============================================
+// CAPTURA DE ARQUIVOS
+// =============================================
+
+bool FileCaptureBackend::OpenDirectory(const std::string& directory, std::string& error) {
+    QDir dir(QString::fromStdString(directory));
+    if (!dir.exists()) {
+        error = "diretório '" + directory + "' não encontrado";
+        return false;
+    }
+    QStringList names = dir.entryList(QStringList() << "*.png" << "*.bmp" << "*.ppm" << "*.jpg",
+                                      QDir::Files, QDir::Name);
+    if (names.isEmpty()) {
+        error = "nenhuma imagem em '" + directory + "'";
+        return false;
+    }
+    std::vector<PixelImage> loaded;
+    loaded.reserve(names.size());
+    for (const QString& name : names) {
+        PixelImage frame;
+        if (!LoadPixelImage(dir.filePath(name).toStdString(), frame, error)) return false;
+        if (!loaded.empty() && (frame.width != loaded[0].width || frame.height != loaded[0].height)) {
+            error = "quadros de tamanhos diferentes em '" + directory + "'";
+            return false;
+        }
+        loaded.push_back(std::move(frame));
+    }
+    SetFrames(std::move(loaded));
+    return true;
+}
+
+void FileCaptureBackend::SetFrames(std::vector<PixelImage> value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frames = std::move(value);
+    next = 0;
+    captures = 0;
+}
+
+size_t FileCaptureBackend::FrameCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames.size();
+}
+
+size_t FileCaptureBackend::Captures() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return captures;
+}
+
+void FileCaptureBackend::Rewind() {
+    std::lock_guard<std::mutex> lock(mutex);
+    next = 0;
+    captures = 0;
+}
+
+void FileCaptureBackend::SetMonitorCount(int count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    monitorCount = std::max(1, count);
+}
+
+int FileCaptureBackend::MonitorCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return monitorCount;
+}
+
+bool FileCaptureBackend::MonitorSize(int monitorIndex, int& width, int& height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frames.empty() || monitorIndex < 0 || monitorIndex >= monitorCount) return false;
+    width = frames[0].width;
+    height = frames[0].height;
+    return true;
+}
+
+bool FileCaptureBackend::Capture(const CaptureRect& rect, PixelImage& out, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frames.empty()) {
+        error = "nenhum quadro carregado";
+        return false;
+    }
+    if (rect.monitorIndex < 0 || rect.monitorIndex >= monitorCount) {
+        error = "tela " + std::to_string(rect.monitorIndex + 1) + " não encontrada";
+        return false;
+    }
+    const PixelImage& frame = frames[next];
+    if (next + 1 < frames.size()) ++next;
+    ++captures;
+    return CropPixelImage(frame, rect, out, error);
+}
@@ -0,0 +1,128 @@
+#ifndef SCREENCAPTURE_H
+#define SCREENCAPTURE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Imagem de 32 bits por pixel (0xAARRGGBB: mesma ordem do QImage::Format_ARGB32
+// e da DIB do GDI), linhas contíguas, sem preenchimento
+struct PixelImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint32_t> pixels;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    void Resize(int w, int h) {
+        width = w;
+        height = h;
+        pixels.resize(static_cast<size_t>(w) * static_cast<size_t>(h));
+    }
+    const std::uint32_t* Row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+    std::uint32_t* Row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+};
+
+// .png, .bmp, .ppm... (formatos do QImage)
+bool LoadPixelImage(const std::string& path, PixelImage& out, std::string& error);
+bool SavePixelImage(const std::string& path, const PixelImage& image, std::string& error);
+
+// Coordenada relativa (centésimos de %, como nas ações) <-> pixel da tela.
+// PixelToRelative arredonda para cima, então a volta cai no mesmo pixel.
+inline int RelativeToPixel(int relative, int size) {
+    return static_cast<int>(static_cast<std::int64_t>(relative) * size / 10000);
+}
+inline int PixelToRelative(int pixel, int size) {
+    return size > 0 ? static_cast<int>((static_cast<std::int64_t>(pixel) * 10000 + size - 1) / size) : 0;
+}
+
+// Retângulo da captura, em pixels a partir do canto superior esquerdo da tela
+struct CaptureRect {
+    int monitorIndex = 0;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Origem das imagens da tela usada pelas esperas por região. Seguro para
+// chamadas de qualquer thread.
+class CaptureBackend {
+public:
+    virtual ~CaptureBackend() = default;
+    virtual int MonitorCount() = 0;
+    // Tamanho da tela em pixels; false se a tela não existe
+    virtual bool MonitorSize(int monitorIndex, int& width, int& height) = 0;
+    // 'out' é redimensionada para o retângulo (reaproveita a memória entre chamadas)
+    virtual bool Capture(const CaptureRect& rect, PixelImage& out, std::string& error) = 0;
+    // A região mudou desde a consulta que deixou 'seen'? (atualiza 'seen').
+    // Sem detecção de mudanças (padrão): sempre true.
+    virtual bool RegionChanged(const CaptureRect&, std::uint64_t&) { return true; }
+};
+
+// Posição de uma tela na área de trabalho virtual
+struct CaptureMonitor {
+    int left;
+    int top;
+    int width;
+    int height;
+};
+
+#ifdef _WIN32
+// Captura pelo GDI: BitBlt da tela para uma DIB section reaproveitada entre as
+// capturas (só cresce), sem alocação nem conversão por quadro
+class GdiCaptureBackend : public CaptureBackend {
+public:
+    explicit GdiCaptureBackend(std::vector<CaptureMonitor> monitors);
+    ~GdiCaptureBackend() override;
+
+    // Após uma mudança de telas (mesma ordem de MainWindow::monitors)
+    void SetMonitors(std::vector<CaptureMonitor> monitors);
+
+    int MonitorCount() override;
+    bool MonitorSize(int monitorIndex, int& width, int& height) override;
+    bool Capture(const CaptureRect& rect, PixelImage& out, std::string& error) override;
+
+private:
+    struct Surface;
+
+    std::mutex mutex;
+    std::vector<CaptureMonitor> monitors;
+    std::unique_ptr<Surface> surface;
+};
+#endif
+
+// Sequência de imagens no lugar da tela, para testar e medir as esperas sem
+// tela (inclusive fora do Windows): cada Capture recorta o quadro atual e
+// avança para o próximo; o último se repete. Todas as telas têm o tamanho do
+// primeiro quadro e mostram o mesmo conteúdo (a captura de cada tela também
+// avança o quadro).
+class FileCaptureBackend : public CaptureBackend {
+public:
+    // Imagens do diretório em ordem alfabética (quadro_0001.png, quadro_0002.png...)
+    bool OpenDirectory(const std::string& directory, std::string& error);
+    void SetFrames(std::vector<PixelImage> frames);
+    // Quantas telas simular (padrão: 1)
+    void SetMonitorCount(int count);
+
+    size_t FrameCount() const;
+    size_t Captures() const;
+    void Rewind();
+
+    int MonitorCount() override;
+    bool MonitorSize(int monitorIndex, int& width, int& height) override;
+    bool Capture(const CaptureRect& rect, PixelImage& out, std::string& error) override;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<PixelImage> frames;
+    int monitorCount = 1;
+    size_t next = 0;
+    size_t captures = 0;
+};
+
+// Recorta 'rect' (x, y, largura e altura; a tela é ignorada) de uma imagem
+bool CropPixelImage(const PixelImage& source, const CaptureRect& rect, PixelImage& out, std::string& error);
+
+#endif // SCREENCAPTURE_H
@@ -0,0 +1,548 @@
+#include "screenchanges.h"
+#include "pixelmatch.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCREENCHANGES_SSE2 1
+#include <emmintrin.h>
+#else
+#define SCREENCHANGES_SSE2 0
+#endif
+
+namespace {
+
+// =============================================
+// HASH DOS BLOCOS
+// =============================================
+
+// Acumulação no estilo do XXH3: por trecho de 4 pixels (2 palavras de 64
+// bits), acc += lo32(d ^ chave) * hi32(d ^ chave) + d com as palavras
+// trocadas. A chave depende da linha e da coluna do trecho dentro do bloco,
+// então a ordem das linhas e das colunas conta; a cada kScrambleRows linhas os
+// acumuladores são embaralhados (acc ^= acc >> 47; acc ^= chave; acc *= primo).
+// A versão escalar faz exatamente as mesmas contas (mesmo hash), como referência.
+constexpr int kChunkPixels = 4;
+constexpr int kRowChunks = ScreenChangeTracker::kTileSize / kChunkPixels;
+constexpr int kScrambleRows = 8;
+constexpr std::uint64_t kPrime32 = 0x9E3779B1u;
+
+std::uint64_t SplitMix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+struct HashKeys {
+    // Duas palavras por trecho (uma por metade do registrador)
+    alignas(16) std::uint64_t chunk[ScreenChangeTracker::kTileSize][kRowChunks][2];
+    alignas(16) std::uint64_t scramble[2];
+    HashKeys() {
+        std::uint64_t seed = 1;
+        for (auto& row : chunk) {
+            for (auto& pair : row) {
+                pair[0] = SplitMix(seed++);
+                pair[1] = SplitMix(seed++);
+            }
+        }
+        scramble[0] = SplitMix(seed++);
+        scramble[1] = SplitMix(seed++);
+    }
+};
+
+const HashKeys& Keys() {
+    static const HashKeys keys;
+    return keys;
+}
+
+// Os 4 acumuladores -> 64 bits
+std::uint64_t Finish(const std::uint64_t acc[4], int width, int height) {
+    std::uint64_t hash = SplitMix(static_cast<std::uint64_t>(width) << 32 | static_cast<std::uint32_t>(height));
+    for (int i = 0; i < 4; ++i) hash = SplitMix(hash ^ acc[i]);
+    return hash;
+}
+
+#if SCREENCHANGES_SSE2
+inline __m128i Accumulate(__m128i acc, __m128i data, __m128i key) {
+    const __m128i mixed = _mm_xor_si128(data, key);
+    const __m128i swapped = _mm_shuffle_epi32(mixed, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m128i product = _mm_mul_epu32(mixed, swapped);
+    return _mm_add_epi64(acc, _mm_add_epi64(product, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+inline __m128i Scramble(__m128i acc, __m128i key, __m128i prime) {
+    acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+    acc = _mm_xor_si128(acc, key);
+    const __m128i low = _mm_mul_epu32(acc, prime);
+    const __m128i high = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+    return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+}
+
+std::uint64_t HashSse2(const std::uint32_t* pixels, int stride, int width, int height) {
+    const HashKeys& keys = Keys();
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32));
+    const __m128i scrambleKey = _mm_load_si128(reinterpret_cast<const __m128i*>(keys.scramble));
+    // Dois acumuladores (trechos pares e ímpares), em registradores, para as
+    // somas não esperarem umas pelas outras
+    __m128i even = _mm_set_epi64x(static_cast<long long>(SplitMix(2)), static_cast<long long>(SplitMix(1)));
+    __m128i odd = _mm_set_epi64x(static_cast<long long>(SplitMix(4)), static_cast<long long>(SplitMix(3)));
+    const int chunks = std::min(kRowChunks, (width + kChunkPixels - 1) / kChunkPixels);
+    const int whole = std::min(width / kChunkPixels, chunks);
+    for (int y = 0; y < height; ++y) {
+        const __m128i* key = reinterpret_cast<const __m128i*>(keys.chunk[y % ScreenChangeTracker::kTileSize]);
+        const __m128i* row = reinterpret_cast<const __m128i*>(pixels + static_cast<size_t>(y) * stride);
+        int c = 0;
+        for (; c + 1 < whole; c += 2) {
+            even = Accumulate(even, _mm_loadu_si128(row + c), _mm_load_si128(key + c));
+            odd = Accumulate(odd, _mm_loadu_si128(row + c + 1), _mm_load_si128(key + c + 1));
+        }
+        if (c < whole) {
+            even = Accumulate(even, _mm_loadu_si128(row + c), _mm_load_si128(key + c));
+            ++c;
+        }
+        if (c < chunks) {
+            // Sobra da borda da tela: completa o trecho com zeros
+            alignas(16) std::uint32_t rest[kChunkPixels] = {};
+            std::memcpy(rest, row + c, (width - c * kChunkPixels) * sizeof(std::uint32_t));
+            const __m128i data = _mm_load_si128(reinterpret_cast<const __m128i*>(rest));
+            if (c & 1) odd = Accumulate(odd, data, _mm_load_si128(key + c));
+            else even = Accumulate(even, data, _mm_load_si128(key + c));
+        }
+        if ((y + 1) % kScrambleRows == 0 || y + 1 == height) {
+            even = Scramble(even, scrambleKey, prime);
+            odd = Scramble(odd, scrambleKey, prime);
+        }
+    }
+    alignas(16) std::uint64_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), even);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes + 2), odd);
+    return Finish(lanes, width, height);
+}
+#endif
+
+// Índice do bloco de cada pixel e vice-versa
+inline int TileOf(int pixel) { return pixel / ScreenChangeTracker::kTileSize; }
+inline int TileStart(int tile) { return tile * ScreenChangeTracker::kTileSize; }
+
+} // namespace
+
+std::uint64_t HashTileScalar(const std::uint32_t* pixels, int stride, int width, int height) {
+    const HashKeys& keys = Keys();
+    std::uint64_t acc[4] = {SplitMix(1), SplitMix(2), SplitMix(3), SplitMix(4)};
+    const int chunks = std::min(kRowChunks, (width + kChunkPixels - 1) / kChunkPixels);
+    for (int y = 0; y < height; ++y) {
+        const std::uint32_t* row = pixels + static_cast<size_t>(y) * stride;
+        for (int c = 0; c < chunks; ++c) {
+            std::uint32_t chunk[kChunkPixels] = {};
+            const int count = std::min(kChunkPixels, width - c * kChunkPixels);
+            std::memcpy(chunk, row + c * kChunkPixels, count * sizeof(std::uint32_t));
+            std::uint64_t* lanes = acc + 2 * (c & 1);
+            const std::uint64_t data[2] = {chunk[0] | static_cast<std::uint64_t>(chunk[1]) << 32,
+                                           chunk[2] | static_cast<std::uint64_t>(chunk[3]) << 32};
+            for (int lane = 0; lane < 2; ++lane) {
+                const std::uint64_t mixed = data[lane] ^ keys.chunk[y % ScreenChangeTracker::kTileSize][c][lane];
+                lanes[lane] += (mixed & 0xFFFFFFFFu) * (mixed >> 32) + data[lane ^ 1];
+            }
+        }
+        if ((y + 1) % kScrambleRows != 0 && y + 1 != height) continue;
+        for (int i = 0; i < 4; ++i) {
+            acc[i] ^= acc[i] >> 47;
+            acc[i] ^= keys.scramble[i & 1];
+            acc[i] *= kPrime32;
+        }
+    }
+    return Finish(acc, width, height);
+}
+
+std::uint64_t HashTile(const std::uint32_t* pixels, int stride, int width, int height) {
+#if SCREENCHANGES_SSE2
+    return HashSse2(pixels, stride, width, height);
+#else
+    return HashTileScalar(pixels, stride, width, height);
+#endif
+}
+
+const char* ScreenHashInstructionSet() {
+    return SCREENCHANGES_SSE2 ? "sse2" : "escalar";
+}
+
+// =============================================
+// BLOCOS SUJOS
+// =============================================
+
+void ScreenChangeTracker::SetMonitorSize(int monitorIndex, int width, int height) {
+    if (monitorIndex < 0) return;
+    if (static_cast<size_t>(monitorIndex) >= monitors.size()) monitors.resize(monitorIndex + 1);
+    Monitor& monitor = monitors[monitorIndex];
+    if (monitor.width == width && monitor.height == height) return;
+    monitor = Monitor();
+    monitor.width = std::max(0, width);
+    monitor.height = std::max(0, height);
+    monitor.tilesX = (monitor.width + kTileSize - 1) / kTileSize;
+    monitor.tilesY = (monitor.height + kTileSize - 1) / kTileSize;
+    const size_t tiles = static_cast<size_t>(monitor.tilesX) * monitor.tilesY;
+    monitor.frame.Resize(monitor.width, monitor.height);
+    monitor.hashes.assign(tiles, 0);
+    monitor.changed.assign(tiles, 0);
+    monitor.captured.assign(tiles, Clock::time_point());
+}
+
+const ScreenChangeTracker::Monitor* ScreenChangeTracker::Find(int monitorIndex) const {
+    if (monitorIndex < 0 || static_cast<size_t>(monitorIndex) >= monitors.size()) return nullptr;
+    const Monitor& monitor = monitors[monitorIndex];
+    return monitor.hashes.empty() ? nullptr : &monitor;
+}
+
+bool ScreenChangeTracker::TileRange(const Monitor& monitor, const CaptureRect& rect,
+                                    int& x0, int& y0, int& x1, int& y1) const {
+    const int left = std::max(0, rect.x);
+    const int top = std::max(0, rect.y);
+    const int right = std::min(monitor.width, rect.x + rect.width);
+    const int bottom = std::min(monitor.height, rect.y + rect.height);
+    if (right <= left || bottom <= top) return false;
+    x0 = TileOf(left);
+    y0 = TileOf(top);
+    x1 = TileOf(right - 1) + 1;
+    y1 = TileOf(bottom - 1) + 1;
+    return true;
+}
+
+CaptureRect ScreenChangeTracker::AlignToTiles(const CaptureRect& rect) const {
+    const Monitor* monitor = Find(rect.monitorIndex);
+    int x0, y0, x1, y1;
+    if (!monitor || !TileRange(*monitor, rect, x0, y0, x1, y1)) return rect;
+    CaptureRect aligned;
+    aligned.monitorIndex = rect.monitorIndex;
+    aligned.x = TileStart(x0);
+    aligned.y = TileStart(y0);
+    aligned.width = std::min(monitor->width, TileStart(x1)) - aligned.x;
+    aligned.height = std::min(monitor->height, TileStart(y1)) - aligned.y;
+    return aligned;
+}
+
+std::vector<CaptureRect> ScreenChangeTracker::Update(const CaptureRect& rect, const PixelImage& pixels,
+                                                     Clock::time_point when) {
+    std::vector<CaptureRect> dirty;
+    const Monitor* found = Find(rect.monitorIndex);
+    int x0, y0, x1, y1;
+    if (!found || pixels.width != rect.width || pixels.height != rect.height ||
+        !TileRange(*found, rect, x0, y0, x1, y1)) {
+        return dirty;
+    }
+    Monitor& monitor = monitors[rect.monitorIndex];
+    // Só blocos inteiros dentro do recorte (as bordas da tela contam como inteiras)
+    if (TileStart(x0) < rect.x) ++x0;
+    if (TileStart(y0) < rect.y) ++y0;
+    if (x1 > x0 && std::min(monitor.width, TileStart(x1)) > rect.x + rect.width) --x1;
+    if (y1 > y0 && std::min(monitor.height, TileStart(y1)) > rect.y + rect.height) --y1;
+    if (x1 <= x0 || y1 <= y0) return dirty;
+    const std::uint64_t update = ++monitor.updates;
+
+    // Sequências de blocos sujos em cada linha de blocos, juntadas com a da
+    // linha de cima quando cobrem as mesmas colunas
+    std::vector<size_t> open, stillOpen;
+    for (int ty = y0; ty < y1; ++ty) {
+        const int top = TileStart(ty);
+        const int tileHeight = std::min(kTileSize, monitor.height - top);
+        stillOpen.clear();
+        int runStart = -1;
+        for (int tx = x0; tx <= x1; ++tx) {
+            bool changed = false;
+            if (tx < x1) {
+                const size_t tile = static_cast<size_t>(ty) * monitor.tilesX + tx;
+                const int left = TileStart(tx);
+                const int tileWidth = std::min(kTileSize, monitor.width - left);
+                const std::uint32_t* source = pixels.Row(top - rect.y) + (left - rect.x);
+                const std::uint64_t hash = HashTile(source, pixels.width, tileWidth, tileHeight);
+                monitor.captured[tile] = when;
+                if (hash != monitor.hashes[tile] || monitor.changed[tile] == 0) {
+                    monitor.hashes[tile] = hash;
+                    monitor.changed[tile] = update;
+                    for (int y = 0; y < tileHeight; ++y) {
+                        std::memcpy(monitor.frame.Row(top + y) + left, source + static_cast<size_t>(y) * pixels.width,
+                                    tileWidth * sizeof(std::uint32_t));
+                    }
+                    changed = true;
+                }
+            }
+            if (changed && runStart < 0) runStart = tx;
+            if (changed || runStart < 0) continue;
+
+            CaptureRect run;
+            run.monitorIndex = rect.monitorIndex;
+            run.x = TileStart(runStart);
+            run.y = top;
+            run.width = std::min(monitor.width, TileStart(tx)) - run.x;
+            run.height = tileHeight;
+            runStart = -1;
+            auto above = std::find_if(open.begin(), open.end(), [&](size_t i) {
+                return dirty[i].x == run.x && dirty[i].width == run.width;
+            });
+            if (above != open.end()) {
+                dirty[*above].height += run.height;
+                stillOpen.push_back(*above);
+            } else {
+                stillOpen.push_back(dirty.size());
+                dirty.push_back(run);
+            }
+        }
+        open.swap(stillOpen);
+    }
+    return dirty;
+}
+
+std::uint64_t ScreenChangeTracker::LastChange(const CaptureRect& rect) const {
+    const Monitor* monitor = Find(rect.monitorIndex);
+    int x0, y0, x1, y1;
+    if (!monitor || !TileRange(*monitor, rect, x0, y0, x1, y1)) return 0;
+    std::uint64_t last = 0;
+    for (int ty = y0; ty < y1; ++ty) {
+        const std::uint64_t* row = monitor->changed.data() + static_cast<size_t>(ty) * monitor->tilesX;
+        for (int tx = x0; tx < x1; ++tx) last = std::max(last, row[tx]);
+    }
+    return last;
+}
+
+std::uint64_t ScreenChangeTracker::Updates(int monitorIndex) const {
+    const Monitor* monitor = Find(monitorIndex);
+    return monitor ? monitor->updates : 0;
+}
+
+bool ScreenChangeTracker::Fresh(const CaptureRect& rect, Clock::time_point now, Clock::duration maxAge) const {
+    const Monitor* monitor = Find(rect.monitorIndex);
+    int x0, y0, x1, y1;
+    if (!monitor || !TileRange(*monitor, rect, x0, y0, x1, y1)) return false;
+    // Pedido que sai da tela: a captura de baixo é quem deve reclamar
+    if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > monitor->width || rect.y + rect.height > monitor->height) {
+        return false;
+    }
+    for (int ty = y0; ty < y1; ++ty) {
+        for (int tx = x0; tx < x1; ++tx) {
+            const size_t tile = static_cast<size_t>(ty) * monitor->tilesX + tx;
+            if (monitor->changed[tile] == 0 || now - monitor->captured[tile] > maxAge) return false;
+        }
+    }
+    return true;
+}
+
+bool ScreenChangeTracker::Crop(const CaptureRect& rect, PixelImage& out, std::string& error) const {
+    const Monitor* monitor = Find(rect.monitorIndex);
+    if (!monitor) {
+        error = "tela " + std::to_string(rect.monitorIndex + 1) + " não encontrada";
+        return false;
+    }
+    return CropPixelImage(monitor->frame, rect, out, error);
+}
+
+// =============================================
+// CAPTURA COM DETECÇÃO DE MUDANÇAS
+// =============================================
+
+TrackedCaptureBackend::TrackedCaptureBackend(std::shared_ptr<CaptureBackend> inner)
+    : inner(std::move(inner)) {
+}
+
+int TrackedCaptureBackend::MonitorCount() {
+    return inner->MonitorCount();
+}
+
+bool TrackedCaptureBackend::MonitorSize(int monitorIndex, int& width, int& height) {
+    return inner->MonitorSize(monitorIndex, width, height);
+}
+
+bool TrackedCaptureBackend::RefreshLocked(const CaptureRect& rect, std::string& error) {
+    int width, height;
+    if (!inner->MonitorSize(rect.monitorIndex, width, height)) {
+        error = "tela " + std::to_string(rect.monitorIndex + 1) + " não encontrada";
+        return false;
+    }
+    tracker.SetMonitorSize(rect.monitorIndex, width, height);
+    const auto now = ScreenChangeTracker::Clock::now();
+    if (tracker.Fresh(rect, now, std::chrono::microseconds(kFrameMicros))) return true;
+    if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > width || rect.y + rect.height > height) {
+        error = "região fora da tela";
+        return false;
+    }
+    const CaptureRect aligned = tracker.AlignToTiles(rect);
+    if (!inner->Capture(aligned, scratch, error)) return false;
+    ++innerCaptures;
+    tracker.Update(aligned, scratch, now);
+    return true;
+}
+
+bool TrackedCaptureBackend::Capture(const CaptureRect& rect, PixelImage& out, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Fora da tela: a captura de baixo decide (e explica o erro)
+    int width, height;
+    if (inner->MonitorSize(rect.monitorIndex, width, height) &&
+        (rect.x < 0 || rect.y < 0 || rect.x + rect.width > width || rect.y + rect.height > height)) {
+        return inner->Capture(rect, out, error);
+    }
+    return RefreshLocked(rect, error) && tracker.Crop(rect, out, error);
+}
+
+bool TrackedCaptureBackend::RegionChanged(const CaptureRect& rect, std::uint64_t& seen) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string error;
+    // Sem como saber: conta como mudança (a captura seguinte mostra o erro)
+    if (!RefreshLocked(rect, error)) return true;
+    const bool changed = tracker.LastChange(rect) > seen;
+    seen = tracker.Updates(rect.monitorIndex);
+    return changed;
+}
+
+size_t TrackedCaptureBackend::InnerCaptures() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return innerCaptures;
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+namespace {
+
+// Área de trabalho sintética: fundo em degradê com "janelas" listradas
+std::uint32_t DesktopPixel(int x, int y) {
+    const bool window = (x / 480) % 2 == 0 && (y / 270) % 2 == 1;
+    if (window) return (y / 3) % 6 == 0 && (x / 7) % 3 != 0 ? 0xFF202020u : 0xFFF0F0F0u;
+    return 0xFF000000u | static_cast<std::uint32_t>((x * 255 / 1920) << 16) | static_cast<std::uint32_t>((y * 255 / 1080) << 8);
+}
+
+template <typename Paint>
+void PaintArea(PixelImage& image, int x0, int y0, int width, int height, Paint paint) {
+    for (int y = std::max(0, y0); y < std::min(image.height, y0 + height); ++y) {
+        std::uint32_t* row = image.Row(y);
+        for (int x = std::max(0, x0); x < std::min(image.width, x0 + width); ++x) row[x] = paint(x - x0, y - y0, x, y);
+    }
+}
+
+// Quadro 'frame' de uma tela parada com o que costuma mudar: cursor de texto
+// piscando, indicador de carregamento girando, relógio a cada 10 quadros e
+// uma caixa de diálogo que abre e fecha
+void PaintSyntheticFrame(PixelImage& image, size_t frame, int phase) {
+    const size_t f = frame + static_cast<size_t>(phase);
+    const bool caret = (f / 2) % 2 == 0;
+    PaintArea(image, 612, 300, 2, 18, [&](int, int, int x, int y) { return caret ? 0xFF000000u : DesktopPixel(x, y); });
+    PaintArea(image, 944, 524, 32, 32, [&](int x, int y, int sx, int sy) {
+        return ((x + y + static_cast<int>(f) * 8) / 8) % 4 == 0 ? 0xFF606060u : DesktopPixel(sx, sy);
+    });
+    const std::uint32_t clock = 0xFF000000u | static_cast<std::uint32_t>((f / 10) * 0x1F3D5B);
+    PaintArea(image, 1820, 1052, 80, 20, [&](int x, int, int, int) { return (x / 6) % 2 ? clock : 0xFF101010u; });
+    const bool dialog = (f / 16) % 2 == 1;
+    PaintArea(image, 760, 390, 400, 300, [&](int x, int y, int sx, int sy) {
+        if (!dialog) return DesktopPixel(sx, sy);
+        return y < 30 ? 0xFF1565C0u : ((x / 40 + y / 40) % 5 == 0 ? 0xFFE0E0E0u : 0xFFFFFFFFu);
+    });
+}
+
+} // namespace
+
+ScreenChangeBenchmarkResult BenchmarkScreenChanges(int monitors, size_t frameCount, const std::string& directory) {
+    using Clock = std::chrono::steady_clock;
+    ScreenChangeBenchmarkResult result = {};
+    result.instructionSet = ScreenHashInstructionSet();
+    monitors = std::max(1, monitors);
+    result.monitors = monitors;
+    frameCount = std::max<size_t>(frameCount, 2);
+
+    // Sequência gravada: cada tela começa num ponto diferente dela
+    std::vector<PixelImage> recorded;
+    std::string error;
+    if (!directory.empty()) {
+        FileCaptureBackend files;
+        CaptureRect all;
+        if (files.OpenDirectory(directory, error) && files.FrameCount() > 1 &&
+            files.MonitorSize(0, all.width, all.height)) {
+            recorded.resize(files.FrameCount());
+            for (PixelImage& frame : recorded) {
+                if (!files.Capture(all, frame, error)) {
+                    recorded.clear();
+                    break;
+                }
+            }
+        }
+    }
+    result.recorded = !recorded.empty();
+    result.width = result.recorded ? recorded[0].width : 1920;
+    result.height = result.recorded ? recorded[0].height : 1080;
+    result.frames = frameCount;
+
+    std::vector<PixelImage> current(monitors), previous(monitors);
+    ScreenChangeTracker tracker;
+    for (int m = 0; m < monitors; ++m) {
+        tracker.SetMonitorSize(m, result.width, result.height);
+        if (!result.recorded) {
+            current[m].Resize(result.width, result.height);
+            PaintArea(current[m], 0, 0, result.width, result.height, [](int, int, int x, int y) { return DesktopPixel(x, y); });
+        }
+    }
+
+    // Esperas simuladas: 8 regiões de 120x40 espalhadas por tela (algumas
+    // sobre o que muda, a maioria sobre o que fica parado)
+    struct Waiter {
+        CaptureRect rect;
+        std::uint64_t seen;
+    };
+    std::vector<Waiter> waiters;
+    for (int m = 0; m < monitors; ++m) {
+        for (int i = 0; i < 8; ++i) {
+            Waiter waiter = {};
+            waiter.rect.monitorIndex = m;
+            waiter.rect.x = (i * 733 + 101) % std::max(1, result.width - 120);
+            waiter.rect.y = (i * 389 + 57) % std::max(1, result.height - 40);
+            waiter.rect.width = std::min(120, result.width);
+            waiter.rect.height = std::min(40, result.height);
+            waiters.push_back(waiter);
+        }
+    }
+
+    double trackSeconds = 0, compareSeconds = 0;
+    size_t dirtyTiles = 0, rects = 0;
+    volatile size_t sink = 0;
+    for (size_t f = 0; f < frameCount; ++f) {
+        for (int m = 0; m < monitors; ++m) {
+            const PixelImage* frame;
+            if (result.recorded) {
+                frame = &recorded[(f + static_cast<size_t>(m) * recorded.size() / monitors) % recorded.size()];
+            } else {
+                PaintSyntheticFrame(current[m], f, m * 7);
+                frame = &current[m];
+            }
+            CaptureRect all;
+            all.monitorIndex = m;
+            all.width = result.width;
+            all.height = result.height;
+
+            auto start = Clock::now();
+            const std::vector<CaptureRect> dirty = tracker.Update(all, *frame, start);
+            trackSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+            // O primeiro quadro suja tudo: a média é dos seguintes
+            if (f > 0) rects += dirty.size();
+            for (const CaptureRect& rect : dirty) {
+                if (f == 0) break;
+                dirtyTiles += static_cast<size_t>((rect.width + ScreenChangeTracker::kTileSize - 1) / ScreenChangeTracker::kTileSize) *
+                              ((rect.height + ScreenChangeTracker::kTileSize - 1) / ScreenChangeTracker::kTileSize);
+            }
+
+            // Referência: comparar o quadro inteiro com o anterior
+            if (f > 0) {
+                start = Clock::now();
+                sink = sink + CountImageMismatches(*frame, previous[m], 0);
+                compareSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+            }
+            previous[m] = *frame;
+        }
+        for (Waiter& waiter : waiters) {
+            ++result.polls;
+            if (tracker.LastChange(waiter.rect) > waiter.seen) ++result.evaluations;
+            waiter.seen = tracker.Updates(waiter.rect.monitorIndex);
+        }
+    }
+    result.trackMsPerFrame = trackSeconds * 1000.0 / frameCount;
+    result.compareMsPerFrame = compareSeconds * 1000.0 / (frameCount - 1);
+    result.dirtyTilesPerFrame = static_cast<double>(dirtyTiles) / (frameCount - 1);
+    result.rectsPerFrame = static_cast<double>(rects) / (frameCount - 1);
+    return result;
+}
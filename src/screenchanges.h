@@ -0,0 +1,116 @@
+#ifndef SCREENCHANGES_H
+#define SCREENCHANGES_H
+
+#include "screencapture.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Hash de um bloco de 'width' x 'height' pixels (linhas a cada 'stride'
+// pixels). Sensível à posição: trocar linhas ou colunas de lugar muda o hash.
+std::uint64_t HashTile(const std::uint32_t* pixels, int stride, int width, int height);
+std::uint64_t HashTileScalar(const std::uint32_t* pixels, int stride, int width, int height);
+// "sse2" ou "escalar"
+const char* ScreenHashInstructionSet();
+
+// Mudanças na tela por blocos de kTileSize x kTileSize: guarda o último
+// conteúdo conhecido de cada tela e o hash de cada bloco. Cada Update recebe
+// um recorte alinhado aos blocos, recalcula só os blocos cobertos e marca os
+// que mudaram com o número da atualização; LastChange diz quando uma região
+// mudou pela última vez. Não é thread-safe (TrackedCaptureBackend serializa).
+class ScreenChangeTracker {
+public:
+    static constexpr int kTileSize = 32;
+    using Clock = std::chrono::steady_clock;
+
+    // Tela de 'width' x 'height' (outro tamanho descarta o que havia)
+    void SetMonitorSize(int monitorIndex, int width, int height);
+    // Retângulo de blocos inteiros que cobre 'rect', dentro da tela
+    CaptureRect AlignToTiles(const CaptureRect& rect) const;
+    // 'pixels' = conteúdo de 'rect' (alinhado com AlignToTiles); devolve os
+    // retângulos sujos (blocos vizinhos que mudaram, juntados)
+    std::vector<CaptureRect> Update(const CaptureRect& rect, const PixelImage& pixels, Clock::time_point when);
+
+    // Número da atualização em que algum bloco de 'rect' mudou por último
+    // (0 = nunca capturado)
+    std::uint64_t LastChange(const CaptureRect& rect) const;
+    std::uint64_t Updates(int monitorIndex) const;
+    // Todos os blocos de 'rect' capturados há no máximo 'maxAge'
+    bool Fresh(const CaptureRect& rect, Clock::time_point now, Clock::duration maxAge) const;
+    // Recorte do último conteúdo conhecido
+    bool Crop(const CaptureRect& rect, PixelImage& out, std::string& error) const;
+
+private:
+    struct Monitor {
+        int width = 0;
+        int height = 0;
+        int tilesX = 0;
+        int tilesY = 0;
+        PixelImage frame;
+        std::vector<std::uint64_t> hashes;
+        std::vector<std::uint64_t> changed;             // número da atualização
+        std::vector<Clock::time_point> captured;
+        std::uint64_t updates = 0;
+    };
+
+    const Monitor* Find(int monitorIndex) const;
+    // Blocos [x0, x1) x [y0, y1) de 'rect' (vazio se fora da tela)
+    bool TileRange(const Monitor& monitor, const CaptureRect& rect, int& x0, int& y0, int& x1, int& y1) const;
+
+    std::vector<Monitor> monitors;
+};
+
+// Captura com detecção de mudanças por cima de outro backend: cada pedido é
+// ampliado para blocos inteiros e servido do último conteúdo se os blocos
+// foram capturados há menos de kFrameMicros (várias esperas no mesmo instante
+// dividem uma captura). RegionChanged diz se a região mudou desde a última
+// consulta de quem pergunta, para a espera reavaliar só quando algo mudou.
+class TrackedCaptureBackend : public CaptureBackend {
+public:
+    static constexpr std::int64_t kFrameMicros = 4000;
+
+    explicit TrackedCaptureBackend(std::shared_ptr<CaptureBackend> inner);
+
+    int MonitorCount() override;
+    bool MonitorSize(int monitorIndex, int& width, int& height) override;
+    bool Capture(const CaptureRect& rect, PixelImage& out, std::string& error) override;
+    bool RegionChanged(const CaptureRect& rect, std::uint64_t& seen) override;
+
+    // Capturas feitas no backend de baixo (para testes e benchmark)
+    size_t InnerCaptures() const;
+
+private:
+    bool RefreshLocked(const CaptureRect& rect, std::string& error);
+
+    std::shared_ptr<CaptureBackend> inner;
+    mutable std::mutex mutex;
+    ScreenChangeTracker tracker;
+    PixelImage scratch;
+    size_t innerCaptures = 0;
+};
+
+struct ScreenChangeBenchmarkResult {
+    const char* instructionSet;
+    int monitors;
+    int width;                  // de cada tela
+    int height;
+    size_t frames;              // quadros da sequência (cada tela começa num ponto diferente)
+    bool recorded;              // sequência lida do disco (senão sintética)
+    double trackMsPerFrame;     // hashes + comparação + retângulos, todas as telas, por quadro
+    double compareMsPerFrame;   // comparação pixel a pixel do quadro inteiro com o anterior (referência)
+    double dirtyTilesPerFrame;  // média, todas as telas
+    double rectsPerFrame;
+    // Esperas simuladas (8 regiões por tela): avaliações necessárias com a
+    // detecção de mudanças contra uma avaliação por quadro sem ela
+    size_t evaluations;
+    size_t polls;
+};
+
+// 'directory': quadros gravados (mesmo formato do FileCaptureBackend); vazio
+// ou sem imagens = sequência sintética de 1920x1080
+ScreenChangeBenchmarkResult BenchmarkScreenChanges(int monitors, size_t frames, const std::string& directory);
+
+#endif // SCREENCHANGES_H
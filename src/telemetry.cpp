@@ -0,0 +1,223 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "o anel em memória compartilhada precisa de atômicos sem lock");
+
+const char* TelemetryKindName(TelemetryKind kind) {
+    switch (kind) {
+        case TelemetryKind::Captured: return "capturados";
+        case TelemetryKind::Injected: return "injetados";
+        case TelemetryKind::SchedulerLate: return "agendador";
+        case TelemetryKind::QueueDepth: return "fila";
+        default: return "?";
+    }
+}
+
+TelemetryRing::~TelemetryRing() {
+    header = nullptr;
+    entries = nullptr;
+    if (shared && shared->isAttached()) shared->detach();
+}
+
+TelemetryRing& TelemetryRing::Global() {
+    static TelemetryRing ring;
+    return ring;
+}
+
+std::int64_t TelemetryRing::NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+namespace {
+
+std::uint32_t RoundCapacity(std::uint32_t capacity) {
+    std::uint32_t rounded = 64;
+    while (rounded < capacity && rounded < (1u << 24)) rounded <<= 1;
+    return rounded;
+}
+
+} // namespace
+
+bool TelemetryRing::Map(void* memory, std::uint32_t capacity, bool initialize) {
+    Header* mapped = static_cast<Header*>(memory);
+    if (initialize) {
+        mapped = new (memory) Header();
+        mapped->magic = kMagic;
+        mapped->capacity = capacity;
+        mapped->recordSize = sizeof(Slot);
+        mapped->head.store(0, std::memory_order_relaxed);
+        Slot* first = reinterpret_cast<Slot*>(static_cast<unsigned char*>(memory) + sizeof(Header));
+        for (std::uint32_t i = 0; i < capacity; ++i) {
+            Slot* slot = new (first + i) Slot();
+            slot->sequence.store(0, std::memory_order_relaxed);
+        }
+    } else if (mapped->magic != kMagic || mapped->recordSize != sizeof(Slot) ||
+               mapped->capacity == 0 || (mapped->capacity & (mapped->capacity - 1)) != 0) {
+        return false;
+    }
+    entries = reinterpret_cast<Slot*>(static_cast<unsigned char*>(memory) + sizeof(Header));
+    mask = mapped->capacity - 1;
+    header = mapped;
+    return true;
+}
+
+bool TelemetryRing::Create(const QString& key, std::uint32_t capacity, QString& error) {
+    capacity = RoundCapacity(capacity);
+    const int size = static_cast<int>(sizeof(Header) + sizeof(Slot) * capacity);
+    shared = std::make_unique<QSharedMemory>();
+    // Chave nativa: o leitor externo acha a memória pelo mesmo nome
+    shared->setNativeKey(key);
+    if (shared->create(size)) return Map(shared->data(), capacity, true);
+
+    if (shared->error() == QSharedMemory::AlreadyExists && shared->attach()) {
+        // Outra instância (ou sobra de uma que caiu, no Linux): se o formato
+        // é o mesmo, as duas publicam no mesmo anel
+        if (shared->size() >= size && Map(shared->data(), capacity, false)) return true;
+        error = "memória de telemetria existente com outro formato";
+        shared->detach();
+        return false;
+    }
+    error = shared->errorString();
+    shared.reset();
+    return false;
+}
+
+bool TelemetryRing::Attach(const QString& key, QString& error) {
+    shared = std::make_unique<QSharedMemory>();
+    shared->setNativeKey(key);
+    if (!shared->attach(QSharedMemory::ReadOnly)) {
+        error = shared->errorString();
+        shared.reset();
+        return false;
+    }
+    if (shared->size() < static_cast<int>(sizeof(Header)) || !Map(const_cast<void*>(shared->constData()), 0, false) ||
+        shared->size() < static_cast<int>(sizeof(Header) + sizeof(Slot) * (mask + 1))) {
+        header = nullptr;
+        error = "formato de telemetria desconhecido";
+        shared->detach();
+        shared.reset();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryRing::CreateLocal(std::uint32_t capacity) {
+    capacity = RoundCapacity(capacity);
+    // Folga para alinhar o cabeçalho em 64 bytes
+    local.reset(new unsigned char[sizeof(Header) + sizeof(Slot) * capacity + 64]);
+    void* memory = local.get();
+    size_t space = sizeof(Header) + sizeof(Slot) * capacity + 64;
+    std::align(64, sizeof(Header) + sizeof(Slot) * capacity, memory, space);
+    Map(memory, capacity, true);
+}
+
+void TelemetryRing::Publish(TelemetryKind kind, std::uint16_t code, std::int32_t macroId, std::int64_t value) {
+    if (!header) return;
+    const std::uint64_t n = header->head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = entries[n & mask];
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.micros.store(NowMicros(), std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.tag.store(static_cast<std::uint64_t>(kind) | static_cast<std::uint64_t>(code) << 16 |
+                   static_cast<std::uint64_t>(static_cast<std::uint32_t>(macroId)) << 32,
+                   std::memory_order_relaxed);
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+}
+
+std::uint64_t TelemetryRing::Head() const {
+    return header ? header->head.load(std::memory_order_acquire) : 0;
+}
+
+size_t TelemetryRing::Read(std::uint64_t& cursor, std::vector<TelemetryEvent>& out, size_t maxEvents,
+                           std::uint64_t& dropped) const {
+    if (!header) return 0;
+    const std::uint64_t head = header->head.load(std::memory_order_acquire);
+    const std::uint64_t capacity = static_cast<std::uint64_t>(mask) + 1;
+    if (cursor > head) {
+        // O aplicativo recriou o anel: recomeça do atual
+        cursor = head;
+    } else if (head - cursor > capacity) {
+        dropped += head - capacity - cursor;
+        cursor = head - capacity;
+    }
+
+    size_t count = 0;
+    while (cursor < head && count < maxEvents) {
+        const Slot& slot = entries[cursor & mask];
+        const std::uint64_t expected = 2 * cursor + 2;
+        const std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        // Ainda sendo escrito: fica para a próxima leitura
+        if (before < expected) break;
+        TelemetryEvent event;
+        event.micros = slot.micros.load(std::memory_order_relaxed);
+        event.value = slot.value.load(std::memory_order_relaxed);
+        const std::uint64_t tag = slot.tag.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before != expected || after != expected) {
+            // Sobrescrito por uma volta seguinte do anel
+            ++dropped;
+            ++cursor;
+            continue;
+        }
+        event.sequence = cursor;
+        event.kind = static_cast<TelemetryKind>(tag & 0xFFFF);
+        event.code = static_cast<std::uint16_t>(tag >> 16);
+        event.macroId = static_cast<std::int32_t>(static_cast<std::uint32_t>(tag >> 32));
+        out.push_back(event);
+        ++cursor;
+        ++count;
+    }
+    return count;
+}
+
+// =============================================
+// BENCHMARK DA TELEMETRIA
+// =============================================
+
+TelemetryBenchmarkResult BenchmarkTelemetry(size_t records) {
+    using Clock = std::chrono::steady_clock;
+    TelemetryBenchmarkResult result = {records, 0, 0, 0, 0};
+    if (records == 0) return result;
+
+    TelemetryRing ring;
+    ring.CreateLocal(TelemetryRing::kDefaultCapacity);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < records; ++i) {
+        ring.Publish(TelemetryKind::Injected, 1, 1, static_cast<std::int64_t>(i & 1023));
+    }
+    result.publishNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / records;
+
+    // Leitor que só chega no fim: fica com a última volta e conta o resto como perdido
+    std::vector<TelemetryEvent> events;
+    events.reserve(ring.Capacity());
+    std::uint64_t cursor = 0;
+    std::uint64_t dropped = 0;
+    start = Clock::now();
+    const size_t read = ring.Read(cursor, events, ring.Capacity(), dropped);
+    const double readSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.readMRecordsPerSec = readSeconds > 0 ? read / readSeconds / 1e6 : 0;
+    result.droppedSlowReader = dropped;
+
+    // Quatro threads publicando juntas (hook, injeção, roda, interface)
+    const size_t perThread = std::max<size_t>(1, records / 4);
+    std::vector<std::thread> threads;
+    start = Clock::now();
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&ring, perThread, t]() {
+            for (size_t i = 0; i < perThread; ++i) {
+                ring.Publish(TelemetryKind::SchedulerLate, 0, t, static_cast<std::int64_t>(i & 255));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    result.publishContendedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / perThread;
+    return result;
+}
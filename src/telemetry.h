@@ -0,0 +1,107 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <QSharedMemory>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Telemetria ao vivo: um anel de registros de tamanho fixo em memória
+// compartilhada, lido por um processo externo (tools/macrotelemetry.cpp).
+// Quem publica nunca espera: cada registro é um fetch_add no contador e quatro
+// escritas; um leitor atrasado perde os registros mais antigos e conta quantos.
+// Cada posição tem um número de sequência (ímpar durante a escrita) para o
+// leitor descartar o que foi sobrescrito enquanto lia.
+
+enum class TelemetryKind : std::uint16_t {
+    Captured = 1,       // evento do hook de gravação: code = mensagem/tecla, value = atraso do hook (us)
+    Injected = 2,       // evento injetado: code = InputEvent::Type, value = atraso em relação ao previsto (us)
+    SchedulerLate = 3,  // fatia de macro: value = atraso do temporizador em relação ao prazo (us)
+    QueueDepth = 4,     // eventos na fila de injeção (publicado quando muda)
+    Count
+};
+
+const char* TelemetryKindName(TelemetryKind kind);
+
+struct TelemetryEvent {
+    std::uint64_t sequence;
+    std::int64_t micros;        // steady_clock (o mesmo relógio nos dois processos)
+    std::int64_t value;
+    TelemetryKind kind;
+    std::uint16_t code;
+    std::int32_t macroId;       // -1 = nenhuma
+};
+
+class TelemetryRing {
+public:
+    static constexpr const char* kDefaultKey = "MacroApp-telemetry";
+    static constexpr std::uint32_t kMagic = 0x4D544C31;   // "MTL1"
+    static constexpr std::uint32_t kDefaultCapacity = 1 << 16;
+
+    TelemetryRing() = default;
+    ~TelemetryRing();
+
+    TelemetryRing(const TelemetryRing&) = delete;
+    TelemetryRing& operator=(const TelemetryRing&) = delete;
+
+    // Lado do aplicativo: cria a memória (ou reaproveita uma compatível de
+    // outra instância). 'capacity' é arredondada para potência de 2.
+    bool Create(const QString& key, std::uint32_t capacity, QString& error);
+    // Lado do leitor: só leitura do que já existe
+    bool Attach(const QString& key, QString& error);
+    // Anel local, sem memória compartilhada (benchmark)
+    void CreateLocal(std::uint32_t capacity);
+    bool IsOpen() const { return header != nullptr; }
+
+    // Qualquer thread, sem lock. Sem anel aberto, não faz nada.
+    void Publish(TelemetryKind kind, std::uint16_t code, std::int32_t macroId, std::int64_t value);
+
+    // Registros a partir de 'cursor' (avançado); registros sobrescritos antes
+    // da leitura somam em 'dropped'. Devolve quantos foram lidos.
+    size_t Read(std::uint64_t& cursor, std::vector<TelemetryEvent>& out, size_t maxEvents, std::uint64_t& dropped) const;
+    // Próximo número de registro (o leitor começa daqui para ver só o novo)
+    std::uint64_t Head() const;
+    std::uint32_t Capacity() const { return mask + 1; }
+
+    // Instância do aplicativo; os pontos de medição publicam nela
+    static TelemetryRing& Global();
+    static std::int64_t NowMicros();
+
+private:
+    struct Header {
+        std::uint32_t magic;
+        std::uint32_t capacity;
+        std::uint32_t recordSize;
+        std::uint32_t reserved;
+        alignas(64) std::atomic<std::uint64_t> head;
+    };
+    struct Slot {
+        std::atomic<std::uint64_t> sequence;   // 2n+1 escrevendo o registro n, 2n+2 pronto
+        std::atomic<std::int64_t> micros;
+        std::atomic<std::int64_t> value;
+        std::atomic<std::uint64_t> tag;        // tipo | code << 16 | macro << 32
+    };
+
+    bool Map(void* memory, std::uint32_t capacity, bool initialize);
+
+    std::unique_ptr<QSharedMemory> shared;
+    std::unique_ptr<unsigned char[]> local;
+    Header* header = nullptr;
+    Slot* entries = nullptr;
+    std::uint32_t mask = 0;
+};
+
+struct TelemetryBenchmarkResult {
+    size_t records;
+    double publishNs;               // por registro, uma thread
+    double publishContendedNs;      // por registro, 4 threads ao mesmo tempo
+    double readMRecordsPerSec;
+    std::uint64_t droppedSlowReader;   // leitor que só lê no fim: o anel guarda a última volta
+};
+
+TelemetryBenchmarkResult BenchmarkTelemetry(size_t records);
+
+#endif // TELEMETRY_H
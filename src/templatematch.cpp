@@ -0,0 +1,802 @@
+#include "templatematch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <thread>
+
+// Mesmo esquema do pixelmatch.cpp: SSE2 sempre (x86-64), AVX2 escolhido em
+// tempo de execução
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEMPLATEMATCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define TEMPLATEMATCH_SSE2 0
+#endif
+
+#if TEMPLATEMATCH_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define TEMPLATEMATCH_AVX2 1
+#include <immintrin.h>
+#else
+#define TEMPLATEMATCH_AVX2 0
+#endif
+
+namespace {
+
+// Luminância inteira (pesos BT.601 em 1/256)
+inline int Luminance(std::uint32_t pixel) {
+    return static_cast<int>((((pixel >> 16) & 0xFF) * 77 + ((pixel >> 8) & 0xFF) * 150 + (pixel & 0xFF) * 29 + 128) >> 8);
+}
+
+// Janela de uma imagem em cinza, sem cópia
+struct GrayView {
+    const std::uint8_t* data;
+    int width;
+    int height;
+    std::ptrdiff_t stride;
+
+    const std::uint8_t* Row(int y) const { return data + y * stride; }
+};
+
+GrayView ViewOf(const GrayImage& image, int x = 0, int y = 0, int width = -1, int height = -1) {
+    return {image.pixels.data() + static_cast<std::ptrdiff_t>(y) * image.width + x,
+            width < 0 ? image.width - x : width, height < 0 ? image.height - y : height, image.width};
+}
+
+// Coeficientes do nível em pares (t[x] | t[x + 1] << 16) para o madd; numa
+// linha de largura ímpar o último par leva só t[x]
+std::vector<std::int32_t> PairCoefficients(const GrayImage& gray) {
+    const int pairs = (gray.width + 1) / 2;
+    std::vector<std::int32_t> coefficients(static_cast<size_t>(pairs) * gray.height);
+    for (int y = 0; y < gray.height; ++y) {
+        const std::uint8_t* row = gray.Row(y);
+        for (int p = 0; p < pairs; ++p) {
+            const int x = 2 * p;
+            coefficients[static_cast<size_t>(y) * pairs + p] = row[x] | (x + 1 < gray.width ? row[x + 1] << 16 : 0);
+        }
+    }
+    return coefficients;
+}
+
+// Soma dos produtos da âncora com a imagem, para 'count' posições seguidas da
+// linha 'y' (a partir da coluna 0 da janela): out[x] = soma T[ty][tx] * I[y + ty][x + tx]
+using DotKernel = void (*)(const GrayView& image, int y, const GrayImage& anchor, const std::int32_t* pairs,
+                           int count, std::int32_t* out);
+
+void DotScalar(const GrayView& image, int y, const GrayImage& anchor, const std::int32_t*, int count, std::int32_t* out) {
+    std::fill(out, out + count, 0);
+    for (int ty = 0; ty < anchor.height; ++ty) {
+        const std::uint8_t* source = image.Row(y + ty);
+        const std::uint8_t* row = anchor.Row(ty);
+        for (int tx = 0; tx < anchor.width; ++tx) {
+            const std::int32_t weight = row[tx];
+            const std::uint8_t* shifted = source + tx;
+            for (int x = 0; x < count; ++x) out[x] += weight * shifted[x];
+        }
+    }
+}
+
+#if TEMPLATEMATCH_SSE2
+// 8 posições por vez nos registradores: cada madd multiplica dois pixels
+// vizinhos da âncora pelos dois pixels correspondentes de 4 posições
+void DotSse2(const GrayView& image, int y, const GrayImage& anchor, const std::int32_t* pairs, int count, std::int32_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const int fullPairs = anchor.width / 2;
+    const bool odd = anchor.width & 1;
+    const int pairsPerRow = (anchor.width + 1) / 2;
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i acc0 = zero;
+        __m128i acc1 = zero;
+        for (int ty = 0; ty < anchor.height; ++ty) {
+            const std::uint8_t* source = image.Row(y + ty) + x;
+            const std::int32_t* weights = pairs + static_cast<size_t>(ty) * pairsPerRow;
+            for (int p = 0; p < fullPairs; ++p) {
+                const __m128i s0 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 2 * p)), zero);
+                const __m128i s1 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 2 * p + 1)), zero);
+                const __m128i weight = _mm_set1_epi32(weights[p]);
+                acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(s0, s1), weight));
+                acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(s0, s1), weight));
+            }
+            if (odd) {
+                const __m128i s0 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 2 * fullPairs)), zero);
+                const __m128i weight = _mm_set1_epi32(weights[fullPairs]);
+                acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(s0, zero), weight));
+                acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(s0, zero), weight));
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), acc0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 4), acc1);
+    }
+    if (x < count) {
+        GrayView rest = image;
+        rest.data += x;
+        DotScalar(rest, y, anchor, pairs, count - x, out + x);
+    }
+}
+#endif
+
+#if TEMPLATEMATCH_AVX2
+// 16 posições por vez; o unpack do AVX2 trabalha por metade de 128 bits, então
+// acc0 fica com as posições 0-3 e 8-11 e acc1 com 4-7 e 12-15
+__attribute__((target("avx2")))
+void DotAvx2(const GrayView& image, int y, const GrayImage& anchor, const std::int32_t* pairs, int count, std::int32_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const int fullPairs = anchor.width / 2;
+    const bool odd = anchor.width & 1;
+    const int pairsPerRow = (anchor.width + 1) / 2;
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i acc0 = zero;
+        __m256i acc1 = zero;
+        for (int ty = 0; ty < anchor.height; ++ty) {
+            const std::uint8_t* source = image.Row(y + ty) + x;
+            const std::int32_t* weights = pairs + static_cast<size_t>(ty) * pairsPerRow;
+            for (int p = 0; p < fullPairs; ++p) {
+                const __m256i s0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * p)));
+                const __m256i s1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * p + 1)));
+                const __m256i weight = _mm256_set1_epi32(weights[p]);
+                acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(s0, s1), weight));
+                acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(s0, s1), weight));
+            }
+            if (odd) {
+                const __m256i s0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * fullPairs)));
+                const __m256i weight = _mm256_set1_epi32(weights[fullPairs]);
+                acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(s0, zero), weight));
+                acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(s0, zero), weight));
+            }
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_permute2x128_si256(acc0, acc1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x + 8), _mm256_permute2x128_si256(acc0, acc1, 0x31));
+    }
+    if (x < count) {
+        GrayView rest = image;
+        rest.data += x;
+        DotSse2(rest, y, anchor, pairs, count - x, out + x);
+    }
+}
+#endif
+
+struct Kernel {
+    DotKernel dot;
+    const char* name;
+};
+
+Kernel SelectKernel() {
+#if TEMPLATEMATCH_AVX2
+    if (__builtin_cpu_supports("avx2")) return {DotAvx2, "avx2"};
+#endif
+#if TEMPLATEMATCH_SSE2
+    return {DotSse2, "sse2"};
+#else
+    return {DotScalar, "escalar"};
+#endif
+}
+
+const Kernel& ActiveKernel() {
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+// Memória reaproveitada entre as chamadas de uma mesma busca
+struct Scratch {
+    std::vector<std::int64_t> sums;         // imagens integrais (largura + 1) x (altura + 1)
+    std::vector<std::int64_t> squares;
+    std::vector<std::int32_t> dots;
+    std::vector<float> scores;
+};
+
+// Correlação cruzada normalizada de todas as posições da janela:
+//   (soma T*I - soma T * soma I / n) / (norma T * raiz(soma I^2 - (soma I)^2 / n))
+// com as somas de I por imagem integral. Janelas lisas (sem variação) e
+// correlações negativas valem 0.
+void Correlate(const GrayView& image, const AnchorTemplate::Level& level, const std::vector<std::int32_t>& pairs,
+               Scratch& scratch, int& outWidth, int& outHeight) {
+    const GrayImage& anchor = level.gray;
+    outWidth = image.width - anchor.width + 1;
+    outHeight = image.height - anchor.height + 1;
+    if (outWidth <= 0 || outHeight <= 0) {
+        outWidth = outHeight = 0;
+        return;
+    }
+    const size_t stride = static_cast<size_t>(image.width) + 1;
+    scratch.sums.assign(stride * (image.height + 1), 0);
+    scratch.squares.assign(stride * (image.height + 1), 0);
+    for (int y = 0; y < image.height; ++y) {
+        const std::uint8_t* row = image.Row(y);
+        std::int64_t rowSum = 0;
+        std::int64_t rowSquares = 0;
+        std::int64_t* sums = scratch.sums.data() + (y + 1) * stride;
+        std::int64_t* squares = scratch.squares.data() + (y + 1) * stride;
+        for (int x = 0; x < image.width; ++x) {
+            rowSum += row[x];
+            rowSquares += row[x] * row[x];
+            sums[x + 1] = sums[x + 1 - stride] + rowSum;
+            squares[x + 1] = squares[x + 1 - stride] + rowSquares;
+        }
+    }
+
+    const double n = static_cast<double>(anchor.width) * anchor.height;
+    const double meanT = level.sum / n;
+    const DotKernel dot = ActiveKernel().dot;
+    scratch.dots.resize(outWidth);
+    scratch.scores.resize(static_cast<size_t>(outWidth) * outHeight);
+    for (int y = 0; y < outHeight; ++y) {
+        dot(image, y, anchor, pairs.data(), outWidth, scratch.dots.data());
+        const std::int64_t* sumTop = scratch.sums.data() + y * stride;
+        const std::int64_t* sumBottom = scratch.sums.data() + (y + anchor.height) * stride;
+        const std::int64_t* squareTop = scratch.squares.data() + y * stride;
+        const std::int64_t* squareBottom = scratch.squares.data() + (y + anchor.height) * stride;
+        float* scores = scratch.scores.data() + static_cast<size_t>(y) * outWidth;
+        for (int x = 0; x < outWidth; ++x) {
+            const int x1 = x + anchor.width;
+            const double sum = static_cast<double>(sumBottom[x1] - sumBottom[x] - sumTop[x1] + sumTop[x]);
+            const double squares = static_cast<double>(squareBottom[x1] - squareBottom[x] - squareTop[x1] + squareTop[x]);
+            const double variance = squares - sum * sum / n;
+            const double numerator = scratch.dots[x] - meanT * sum;
+            // Correlação negativa nunca é candidata: sem a raiz
+            scores[x] = variance < 1.0 || numerator <= 0 ? 0.0f
+                : static_cast<float>(numerator / (level.norm * std::sqrt(variance)));
+        }
+    }
+}
+
+struct Candidate {
+    float score;
+    int x;
+    int y;
+};
+
+// Máximos locais (3x3) acima de 'threshold', do melhor para o pior, sem dois
+// candidatos a menos de meia âncora um do outro
+std::vector<Candidate> PickCandidates(const std::vector<float>& scores, int width, int height, float threshold,
+                                      int minDistanceX, int minDistanceY, size_t limit) {
+    std::vector<Candidate> peaks;
+    for (int y = 0; y < height; ++y) {
+        const float* row = scores.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            const float score = row[x];
+            if (score < threshold) continue;
+            bool peak = true;
+            for (int dy = -1; dy <= 1 && peak; ++dy) {
+                if (y + dy < 0 || y + dy >= height) continue;
+                const float* neighbour = row + static_cast<std::ptrdiff_t>(dy) * width;
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if ((dx || dy) && x + dx >= 0 && x + dx < width && neighbour[x + dx] > score) {
+                        peak = false;
+                        break;
+                    }
+                }
+            }
+            if (peak) peaks.push_back({score, x, y});
+        }
+    }
+    std::sort(peaks.begin(), peaks.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+    std::vector<Candidate> picked;
+    for (const Candidate& peak : peaks) {
+        bool near = false;
+        for (const Candidate& other : picked) {
+            if (std::abs(peak.x - other.x) < minDistanceX && std::abs(peak.y - other.y) < minDistanceY) {
+                near = true;
+                break;
+            }
+        }
+        if (near) continue;
+        picked.push_back(peak);
+        if (picked.size() >= limit) break;
+    }
+    return picked;
+}
+
+// Quanto a correlação no nível mais grosso pode ficar abaixo da final: a
+// redução borra os detalhes que distinguem a âncora
+constexpr float kCoarseSlack = 0.35f;
+constexpr size_t kCandidates = 16;
+// Janela de refinamento em cada nível (+- pixels em volta do dobro da posição anterior)
+constexpr int kRefineRadius = 2;
+
+} // namespace
+
+// =============================================
+// IMAGENS EM CINZA
+// =============================================
+
+void GrayFromPixels(const PixelImage& source, const CaptureRect& rect, GrayImage& out) {
+    out.Resize(rect.width, rect.height);
+    for (int y = 0; y < rect.height; ++y) {
+        const std::uint32_t* row = source.Row(rect.y + y) + rect.x;
+        std::uint8_t* target = out.Row(y);
+        for (int x = 0; x < rect.width; ++x) target[x] = static_cast<std::uint8_t>(Luminance(row[x]));
+    }
+}
+
+void HalfSize(const GrayImage& source, GrayImage& out) {
+    out.Resize(source.width / 2, source.height / 2);
+#if TEMPLATEMATCH_SSE2
+    const __m128i low = _mm_set1_epi16(0x00FF);
+    const __m128i two = _mm_set1_epi16(2);
+#endif
+    for (int y = 0; y < out.height; ++y) {
+        const std::uint8_t* top = source.Row(2 * y);
+        const std::uint8_t* bottom = source.Row(2 * y + 1);
+        std::uint8_t* target = out.Row(y);
+        int x = 0;
+#if TEMPLATEMATCH_SSE2
+        // 16 pixels por vez: pares vizinhos somados em 16 bits (byte par + byte ímpar)
+        for (; x + 16 <= out.width; x += 16) {
+            __m128i sums[2];
+            for (int half = 0; half < 2; ++half) {
+                const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x + 16 * half));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x + 16 * half));
+                sums[half] = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(t, low), _mm_srli_epi16(t, 8)),
+                                           _mm_add_epi16(_mm_and_si128(b, low), _mm_srli_epi16(b, 8)));
+                sums[half] = _mm_srli_epi16(_mm_add_epi16(sums[half], two), 2);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(sums[0], sums[1]));
+        }
+#endif
+        for (; x < out.width; ++x) {
+            target[x] = static_cast<std::uint8_t>((top[2 * x] + top[2 * x + 1] + bottom[2 * x] + bottom[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+void HalfGrayFromPixels(const PixelImage& source, const CaptureRect& rect, GrayImage& out) {
+    out.Resize(rect.width / 2, rect.height / 2);
+#if TEMPLATEMATCH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+    const __m128i round = _mm_set1_epi32(512);
+#endif
+    for (int y = 0; y < out.height; ++y) {
+        const std::uint32_t* top = source.Row(rect.y + 2 * y) + rect.x;
+        const std::uint32_t* bottom = source.Row(rect.y + 2 * y + 1) + rect.x;
+        std::uint8_t* target = out.Row(y);
+        int x = 0;
+#if TEMPLATEMATCH_SSE2
+        // 4 blocos (8 pixels de cada linha) por vez: soma os canais das duas
+        // linhas e dos dois pixels vizinhos em 16 bits, pesa com um madd
+        // (B*29 + G*150 e R*77 por bloco) e junta os pares com shuffle
+        for (; x + 4 <= out.width; x += 4) {
+            const __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x));
+            const __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x + 4));
+            const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x));
+            const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x + 4));
+            __m128i p01 = _mm_add_epi16(_mm_unpacklo_epi8(t0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i p23 = _mm_add_epi16(_mm_unpackhi_epi8(t0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i p45 = _mm_add_epi16(_mm_unpacklo_epi8(t1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i p67 = _mm_add_epi16(_mm_unpackhi_epi8(t1, zero), _mm_unpackhi_epi8(b1, zero));
+            p01 = _mm_add_epi16(p01, _mm_srli_si128(p01, 8));
+            p23 = _mm_add_epi16(p23, _mm_srli_si128(p23, 8));
+            p45 = _mm_add_epi16(p45, _mm_srli_si128(p45, 8));
+            p67 = _mm_add_epi16(p67, _mm_srli_si128(p67, 8));
+            const __m128 blocks01 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi64(p01, p23), weights));
+            const __m128 blocks23 = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi64(p45, p67), weights));
+            __m128i sums = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(blocks01, blocks23, _MM_SHUFFLE(2, 0, 2, 0))),
+                                         _mm_castps_si128(_mm_shuffle_ps(blocks01, blocks23, _MM_SHUFFLE(3, 1, 3, 1))));
+            sums = _mm_srli_epi32(_mm_add_epi32(sums, round), 10);
+            sums = _mm_packs_epi32(sums, zero);
+            const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(sums, zero));
+            std::memcpy(target + x, &packed, 4);
+        }
+#endif
+        for (; x < out.width; ++x) {
+            const std::uint32_t block[4] = {top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1]};
+            int red = 0, green = 0, blue = 0;
+            for (std::uint32_t pixel : block) {
+                red += (pixel >> 16) & 0xFF;
+                green += (pixel >> 8) & 0xFF;
+                blue += pixel & 0xFF;
+            }
+            target[x] = static_cast<std::uint8_t>((red * 77 + green * 150 + blue * 29 + 512) >> 10);
+        }
+    }
+}
+
+// =============================================
+// ÂNCORA
+// =============================================
+
+AnchorTemplate::AnchorTemplate(const PixelImage& image) {
+    if (image.empty()) {
+        error = "imagem da âncora vazia";
+        return;
+    }
+    if (image.width > kMaxSide || image.height > kMaxSide) {
+        error = "imagem da âncora maior que " + std::to_string(kMaxSide) + "x" + std::to_string(kMaxSide);
+        return;
+    }
+    Level base;
+    CaptureRect all;
+    all.width = image.width;
+    all.height = image.height;
+    GrayFromPixels(image, all, base.gray);
+    levels.push_back(std::move(base));
+    // Reduzida como a área da busca: nível 1 da imagem colorida, os demais do anterior
+    while (static_cast<int>(levels.size()) < kMaxLevels &&
+           std::min(levels.back().gray.width, levels.back().gray.height) >= 2 * kMinSide) {
+        Level next;
+        if (levels.size() == 1) HalfGrayFromPixels(image, all, next.gray);
+        else HalfSize(levels.back().gray, next.gray);
+        levels.push_back(std::move(next));
+    }
+    for (Level& level : levels) {
+        double sum = 0;
+        double squares = 0;
+        for (std::uint8_t value : level.gray.pixels) {
+            sum += value;
+            squares += static_cast<double>(value) * value;
+        }
+        level.sum = sum;
+        level.norm = std::sqrt(std::max(0.0, squares - sum * sum / static_cast<double>(level.gray.pixels.size())));
+    }
+    if (levels[0].norm < 1.0) {
+        levels.clear();
+        error = "imagem da âncora sem contraste (uma cor só)";
+    }
+}
+
+// =============================================
+// BUSCA
+// =============================================
+
+const char* TemplateMatchInstructionSet() {
+    return ActiveKernel().name;
+}
+
+AnchorMatch FindTemplate(const PixelImage& frame, const CaptureRect& area, const AnchorTemplate& anchor, double minScore) {
+    AnchorMatch result;
+    if (!anchor.Valid()) return result;
+    CaptureRect rect = area;
+    rect.x = std::max(0, rect.x);
+    rect.y = std::max(0, rect.y);
+    rect.width = std::min(rect.width, frame.width - rect.x);
+    rect.height = std::min(rect.height, frame.height - rect.y);
+    if (rect.width < anchor.Width() || rect.height < anchor.Height()) return result;
+
+    const auto& levels = anchor.Levels();
+    std::vector<std::vector<std::int32_t>> pairs;
+    pairs.reserve(levels.size());
+    for (const auto& level : levels) pairs.push_back(PairCoefficients(level.gray));
+
+    // Pirâmide da área: o nível 1 sai direto da imagem colorida; o nível 0
+    // inteiro só quando a âncora é pequena demais para reduzir
+    const int top = static_cast<int>(levels.size()) - 1;
+    std::vector<GrayImage> pyramid(levels.size());
+    if (top == 0) {
+        GrayFromPixels(frame, rect, pyramid[0]);
+    } else {
+        HalfGrayFromPixels(frame, rect, pyramid[1]);
+        for (int k = 2; k <= top; ++k) HalfSize(pyramid[k - 1], pyramid[k]);
+    }
+
+    Scratch scratch;
+    int outWidth, outHeight;
+    Correlate(ViewOf(pyramid[top]), levels[top], pairs[top], scratch, outWidth, outHeight);
+    const GrayImage& coarse = levels[top].gray;
+    const float threshold = static_cast<float>(minScore) - (top > 0 ? kCoarseSlack : 0.0f);
+    std::vector<Candidate> candidates = PickCandidates(scratch.scores, outWidth, outHeight, threshold,
+                                                       std::max(1, coarse.width / 2), std::max(1, coarse.height / 2),
+                                                       top > 0 ? kCandidates : 1);
+
+    GrayImage window;
+    Candidate best = {-2.0f, 0, 0};
+    for (Candidate candidate : candidates) {
+        for (int k = top - 1; k >= 0 && candidate.score >= threshold; --k) {
+            const GrayImage& anchorLevel = levels[k].gray;
+            // Posições válidas no nível k
+            const int maxX = (k == 0 ? rect.width : pyramid[k].width) - anchorLevel.width;
+            const int maxY = (k == 0 ? rect.height : pyramid[k].height) - anchorLevel.height;
+            const int x0 = std::max(0, std::min(maxX, 2 * candidate.x - kRefineRadius));
+            const int y0 = std::max(0, std::min(maxY, 2 * candidate.y - kRefineRadius));
+            const int x1 = std::max(0, std::min(maxX, 2 * candidate.x + kRefineRadius));
+            const int y1 = std::max(0, std::min(maxY, 2 * candidate.y + kRefineRadius));
+            const int width = x1 - x0 + anchorLevel.width;
+            const int height = y1 - y0 + anchorLevel.height;
+            GrayView view;
+            if (k == 0) {
+                CaptureRect part;
+                part.x = rect.x + x0;
+                part.y = rect.y + y0;
+                part.width = width;
+                part.height = height;
+                GrayFromPixels(frame, part, window);
+                view = ViewOf(window);
+            } else {
+                view = ViewOf(pyramid[k], x0, y0, width, height);
+            }
+            Correlate(view, levels[k], pairs[k], scratch, outWidth, outHeight);
+            Candidate refined = {-2.0f, 0, 0};
+            for (int y = 0; y < outHeight; ++y) {
+                for (int x = 0; x < outWidth; ++x) {
+                    const float score = scratch.scores[static_cast<size_t>(y) * outWidth + x];
+                    if (score > refined.score) refined = {score, x0 + x, y0 + y};
+                }
+            }
+            candidate = refined;
+        }
+        if (candidate.score > best.score) best = candidate;
+    }
+    if (best.score < -1.0f) return result;
+    result.x = rect.x + best.x;
+    result.y = rect.y + best.y;
+    result.score = best.score;
+    result.found = best.score >= minScore;
+    return result;
+}
+
+AnchorMatch FindTemplateExhaustive(const PixelImage& frame, const CaptureRect& rect, const AnchorTemplate& anchor,
+                                   double minScore) {
+    AnchorMatch result;
+    if (!anchor.Valid() || rect.width < anchor.Width() || rect.height < anchor.Height()) return result;
+    GrayImage gray;
+    GrayFromPixels(frame, rect, gray);
+    const auto& level = anchor.Levels()[0];
+    const std::vector<std::int32_t> pairs = PairCoefficients(level.gray);
+    Scratch scratch;
+    int outWidth, outHeight;
+    Correlate(ViewOf(gray), level, pairs, scratch, outWidth, outHeight);
+    float best = -2.0f;
+    for (int y = 0; y < outHeight; ++y) {
+        for (int x = 0; x < outWidth; ++x) {
+            const float score = scratch.scores[static_cast<size_t>(y) * outWidth + x];
+            if (score > best) {
+                best = score;
+                result.x = rect.x + x;
+                result.y = rect.y + y;
+            }
+        }
+    }
+    result.score = best;
+    result.found = best >= minScore;
+    return result;
+}
+
+bool FindTemplateOnMonitors(CaptureBackend& backend, const AnchorTemplate& anchor, double minScore,
+                            AnchorMatch& out, std::string& error) {
+    out = AnchorMatch();
+    const int count = backend.MonitorCount();
+    if (count <= 0) {
+        error = "nenhuma tela encontrada";
+        return false;
+    }
+    // Captura em sequência (o backend serializa), busca em paralelo
+    std::vector<PixelImage> frames(count);
+    std::vector<CaptureRect> rects(count);
+    for (int m = 0; m < count; ++m) {
+        rects[m].monitorIndex = m;
+        if (!backend.MonitorSize(m, rects[m].width, rects[m].height)) {
+            error = "tela " + std::to_string(m + 1) + " não encontrada";
+            return false;
+        }
+        if (!backend.Capture(rects[m], frames[m], error)) return false;
+        rects[m].x = rects[m].y = 0;
+    }
+    std::vector<AnchorMatch> matches(count);
+    auto search = [&](int m) {
+        matches[m] = FindTemplate(frames[m], rects[m], anchor, minScore);
+        matches[m].monitorIndex = m;
+    };
+    std::vector<std::thread> threads;
+    for (int m = 1; m < count; ++m) threads.emplace_back(search, m);
+    search(0);
+    for (std::thread& thread : threads) thread.join();
+
+    for (const AnchorMatch& match : matches) {
+        if (match.score > out.score || out.monitorIndex < 0) out = match;
+    }
+    return true;
+}
+
+// =============================================
+// CLIQUE POR IMAGEM
+// =============================================
+
+AnchorWatcher::AnchorWatcher(const PixelImage& reference, int monitorIndex, int x, int y, int offsetX, int offsetY,
+                             int searchRadius, double minScore)
+    : anchor(reference), monitorIndex(monitorIndex), relX(x), relY(y), offsetX(offsetX), offsetY(offsetY),
+      searchRadius(searchRadius), minScore(minScore) {
+}
+
+bool AnchorWatcher::Poll(CaptureBackend& backend, bool& matched, std::string& error) {
+    using Clock = std::chrono::steady_clock;
+    matched = false;
+    if (!anchor.Valid()) {
+        error = anchor.Error();
+        return false;
+    }
+    auto start = Clock::now();
+    AnchorMatch match;
+    // Primeiro em volta da posição gravada (a âncora costuma estar perto)
+    int screenWidth, screenHeight;
+    if (searchRadius > 0 && backend.MonitorSize(monitorIndex, screenWidth, screenHeight)) {
+        const int expectedX = RelativeToPixel(relX, screenWidth) - offsetX;
+        const int expectedY = RelativeToPixel(relY, screenHeight) - offsetY;
+        CaptureRect hint;
+        hint.monitorIndex = monitorIndex;
+        hint.x = std::max(0, expectedX - searchRadius);
+        hint.y = std::max(0, expectedY - searchRadius);
+        hint.width = std::min(screenWidth, expectedX + anchor.Width() + searchRadius) - hint.x;
+        hint.height = std::min(screenHeight, expectedY + anchor.Height() + searchRadius) - hint.y;
+        if (hint.width >= anchor.Width() && hint.height >= anchor.Height()) {
+            // Região igual à da última busca (backend com detecção de
+            // mudanças): o resultado seria o mesmo
+            if (backend.RegionChanged(hint, seenHint) || polls == 0) {
+                if (!backend.Capture(hint, frame, error)) return false;
+                CaptureRect all;
+                all.width = frame.width;
+                all.height = frame.height;
+                hintMatch = FindTemplate(frame, all, anchor, minScore);
+                hintMatch.monitorIndex = monitorIndex;
+                hintMatch.x += hint.x;
+                hintMatch.y += hint.y;
+                ++searches;
+            }
+            match = hintMatch;
+        }
+    }
+    // Senão, em todas as telas (de novo só se alguma mudou)
+    if (!match.found) {
+        const int count = backend.MonitorCount();
+        bool changed = static_cast<int>(seenMonitors.size()) != count;
+        seenMonitors.resize(std::max(0, count));
+        for (int m = 0; m < count; ++m) {
+            CaptureRect screen;
+            screen.monitorIndex = m;
+            if (!backend.MonitorSize(m, screen.width, screen.height)) {
+                changed = true;
+                continue;
+            }
+            changed = backend.RegionChanged(screen, seenMonitors[m]) || changed;
+        }
+        if (changed) {
+            if (!FindTemplateOnMonitors(backend, anchor, minScore, everywhereMatch, error)) return false;
+            ++searches;
+        }
+        if (everywhereMatch.found || everywhereMatch.score > match.score) match = everywhereMatch;
+    }
+    best = match;
+    if (match.found && backend.MonitorSize(match.monitorIndex, screenWidth, screenHeight)) {
+        clickX = PixelToRelative(match.x + offsetX, screenWidth);
+        clickY = PixelToRelative(match.y + offsetY, screenHeight);
+        clickMonitor = match.monitorIndex;
+        matched = true;
+    }
+    const std::int64_t cost = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    interval = polls == 0 ? kMinIntervalMicros : std::min(kMaxIntervalMicros, interval * 3 / 2);
+    interval = std::max(interval, 4 * cost);
+    ++polls;
+    return true;
+}
+
+std::string AnchorWatcher::LastResult() const {
+    char text[48];
+    std::snprintf(text, sizeof(text), "melhor correlação %.2f", best.score);
+    return text;
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+namespace {
+
+// Tela sintética: fundo em degradê com "janelas" e "botões" de cores e
+// texturas aleatórias; a âncora é recortada de um deles
+void PaintInterface(PixelImage& frame, int width, int height, std::mt19937& rng) {
+    frame.Resize(width, height);
+    for (int y = 0; y < height; ++y) {
+        std::uint32_t* row = frame.Row(y);
+        for (int x = 0; x < width; ++x) {
+            row[x] = 0xFF000000u | static_cast<std::uint32_t>((x * 200 / width + 30) << 16) |
+                     static_cast<std::uint32_t>((y * 200 / height + 30) << 8) | 0x60u;
+        }
+    }
+    for (int i = 0; i < 600; ++i) {
+        const int w = 24 + static_cast<int>(rng() % 200);
+        const int h = 16 + static_cast<int>(rng() % 80);
+        const int left = static_cast<int>(rng() % static_cast<unsigned>(width - w));
+        const int top = static_cast<int>(rng() % static_cast<unsigned>(height - h));
+        const std::uint32_t color = 0xFF000000u | (rng() & 0x00FFFFFFu);
+        const int stripe = 2 + static_cast<int>(rng() % 6);
+        for (int y = 0; y < h; ++y) {
+            std::uint32_t* row = frame.Row(top + y) + left;
+            for (int x = 0; x < w; ++x) {
+                const bool border = x == 0 || y == 0 || x == w - 1 || y == h - 1;
+                row[x] = border ? 0xFF202020u : (((x / stripe) ^ (y / stripe)) & 1) ? color : (color ^ 0x00404040u);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TemplateMatchBenchmarkResult BenchmarkTemplateMatch(int templateSize, int monitors) {
+    using Clock = std::chrono::steady_clock;
+    TemplateMatchBenchmarkResult result = {};
+    result.instructionSet = TemplateMatchInstructionSet();
+    result.frameWidth = 3840;
+    result.frameHeight = 2160;
+    templateSize = std::max(AnchorTemplate::kMinSide, std::min(AnchorTemplate::kMaxSide, templateSize));
+    result.templateSize = templateSize;
+    result.monitors = std::max(1, monitors);
+
+    std::mt19937 rng(42);
+    PixelImage frame;
+    PaintInterface(frame, result.frameWidth, result.frameHeight, rng);
+    // Botão com ícone (círculo) e "texto", recortado como âncora
+    const int buttonX = 2917;
+    const int buttonY = 1661;
+    for (int y = 0; y < templateSize; ++y) {
+        std::uint32_t* row = frame.Row(buttonY + y) + buttonX;
+        for (int x = 0; x < templateSize; ++x) {
+            const int dx = x - templateSize / 3;
+            const int dy = y - templateSize / 2;
+            const bool icon = dx * dx + dy * dy < templateSize * templateSize / 25;
+            const bool text = x > templateSize / 2 && (y / 3) % 3 == 1 && ((x * 7 + y) % 5) < 3;
+            row[x] = icon ? 0xFFD84315u : text ? 0xFF101010u : 0xFFECEFF1u;
+        }
+    }
+    PixelImage image;
+    std::string error;
+    CaptureRect crop;
+    crop.x = buttonX;
+    crop.y = buttonY;
+    crop.width = templateSize;
+    crop.height = templateSize;
+    CropPixelImage(frame, crop, image, error);
+    AnchorTemplate anchor(image);
+    result.levels = static_cast<int>(anchor.Levels().size());
+    constexpr double kMinScore = 0.85;
+
+    CaptureRect all;
+    all.width = frame.width;
+    all.height = frame.height;
+    AnchorMatch match = FindTemplate(frame, all, anchor, kMinScore);   // aquece caches e alocações
+    constexpr int kRounds = 20;
+    auto start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) match = FindTemplate(frame, all, anchor, kMinScore);
+    result.fullFrameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kRounds;
+    result.found = match.found && match.x == buttonX && match.y == buttonY;
+    result.score = match.score;
+
+    // Em volta da posição gravada (o botão andou 37 px para a esquerda)
+    CaptureRect hint;
+    hint.x = buttonX + 37 - 200;
+    hint.y = buttonY - 200;
+    hint.width = templateSize + 400;
+    hint.height = templateSize + 400;
+    start = Clock::now();
+    for (int r = 0; r < kRounds; ++r) {
+        AnchorMatch near = FindTemplate(frame, hint, anchor, kMinScore);
+        result.found = result.found && near.found && near.x == buttonX && near.y == buttonY;
+    }
+    result.hintMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kRounds;
+
+    // Todas as posições no nível 0, só numa região de 512x512 (a tela inteira levaria segundos)
+    CaptureRect region;
+    region.x = buttonX - 256 + templateSize / 2;
+    region.y = buttonY - 256 + templateSize / 2;
+    region.width = 512;
+    region.height = 512;
+    start = Clock::now();
+    AnchorMatch exhaustive = FindTemplateExhaustive(frame, region, anchor, kMinScore);
+    result.exhaustiveMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    result.found = result.found && exhaustive.x == buttonX && exhaustive.y == buttonY;
+
+    // Várias telas 4K com o mesmo conteúdo
+    FileCaptureBackend backend;
+    backend.SetMonitorCount(result.monitors);
+    std::vector<PixelImage> frames;
+    frames.push_back(std::move(frame));
+    backend.SetFrames(std::move(frames));
+    AnchorMatch everywhere;
+    start = Clock::now();
+    for (int r = 0; r < kRounds / 4; ++r) FindTemplateOnMonitors(backend, anchor, kMinScore, everywhere, error);
+    result.multiMonitorMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / (kRounds / 4);
+    result.found = result.found && everywhere.found && everywhere.x == buttonX && everywhere.y == buttonY;
+    return result;
+}
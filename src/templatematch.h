@@ -0,0 +1,157 @@
+#ifndef TEMPLATEMATCH_H
+#define TEMPLATEMATCH_H
+
+#include "pixelmatch.h"
+#include "screencapture.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Imagem em tons de cinza (luminância 0-255), linhas contíguas
+struct GrayImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    void Resize(int w, int h) {
+        width = w;
+        height = h;
+        pixels.resize(static_cast<size_t>(w) * static_cast<size_t>(h));
+    }
+    const std::uint8_t* Row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+    std::uint8_t* Row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+};
+
+// Luminância de um retângulo de 'source' (x, y, largura e altura; a tela é ignorada)
+void GrayFromPixels(const PixelImage& source, const CaptureRect& rect, GrayImage& out);
+// Metade do tamanho: média de cada bloco 2x2 (a última linha/coluna ímpar é descartada)
+void HalfSize(const GrayImage& source, GrayImage& out);
+// Metade do tamanho direto da imagem colorida: luminância da soma dos canais
+// de cada bloco 2x2 (difere de HalfSize(GrayFromPixels) só no arredondamento)
+void HalfGrayFromPixels(const PixelImage& source, const CaptureRect& rect, GrayImage& out);
+
+// Imagem procurada (âncora), em pirâmide: nível 0 = tamanho original, cada
+// nível seguinte tem a metade, até o menor lado ficar com kMinSide pixels
+class AnchorTemplate {
+public:
+    static constexpr int kMinSide = 8;
+    static constexpr int kMaxLevels = 5;
+    // Maior lado aceito: a soma dos produtos de um nível cabe em 32 bits
+    static constexpr int kMaxSide = 128;
+
+    explicit AnchorTemplate(const PixelImage& image);
+
+    // false se a imagem não serve (vazia, grande demais ou sem contraste): ver Error()
+    bool Valid() const { return error.empty(); }
+    const std::string& Error() const { return error; }
+    int Width() const { return levels.empty() ? 0 : levels[0].gray.width; }
+    int Height() const { return levels.empty() ? 0 : levels[0].gray.height; }
+
+    struct Level {
+        GrayImage gray;
+        double sum;         // soma dos pixels
+        double norm;        // raiz da soma dos quadrados dos desvios da média
+    };
+    const std::vector<Level>& Levels() const { return levels; }
+
+private:
+    std::vector<Level> levels;
+    std::string error;
+};
+
+// Melhor posição encontrada (canto superior esquerdo, em pixels da imagem ou da tela)
+struct AnchorMatch {
+    bool found = false;
+    int monitorIndex = -1;
+    int x = 0;
+    int y = 0;
+    double score = 0;       // correlação cruzada normalizada (-1 a 1)
+};
+
+// Correlação cruzada normalizada sobre a pirâmide: busca completa só no nível
+// mais grosso; os melhores candidatos (máximos locais) são refinados nível a
+// nível numa janela de +-2 pixels, e o nível 0 só é convertido para cinza em
+// volta deles. Procura dentro de 'rect' de 'frame'; 'found' se score >= minScore.
+AnchorMatch FindTemplate(const PixelImage& frame, const CaptureRect& rect, const AnchorTemplate& anchor,
+                         double minScore);
+// Todas as posições de 'rect' no nível 0 (referência para verificação e benchmark)
+AnchorMatch FindTemplateExhaustive(const PixelImage& frame, const CaptureRect& rect, const AnchorTemplate& anchor,
+                                   double minScore);
+// "avx2", "sse2" ou "escalar"
+const char* TemplateMatchInstructionSet();
+
+// Captura cada tela inteira e procura em todas ao mesmo tempo (uma thread por
+// tela); 'out' fica com a melhor. false só se uma captura falhou.
+bool FindTemplateOnMonitors(CaptureBackend& backend, const AnchorTemplate& anchor, double minScore,
+                            AnchorMatch& out, std::string& error);
+
+// Clique por imagem: procura a âncora primeiro em volta da posição gravada
+// ('searchRadius' pixels em cada direção) e, não achando, em todas as telas.
+// Enquanto não aparece, tenta de novo a cada kMinIntervalMicros, crescendo
+// 1,5x até kMaxIntervalMicros (e nunca menos que 4x o custo da busca). Com um
+// backend que detecta mudanças, cada busca só é refeita se a região mudou.
+class AnchorWatcher : public ScreenWatcher {
+public:
+    static constexpr std::int64_t kMinIntervalMicros = 50000;
+    static constexpr std::int64_t kMaxIntervalMicros = 500000;
+
+    // (x, y): posição gravada do clique em centésimos de % da tela;
+    // (offsetX, offsetY): ponto do clique dentro da âncora, em pixels
+    AnchorWatcher(const PixelImage& reference, int monitorIndex, int x, int y, int offsetX, int offsetY,
+                  int searchRadius, double minScore);
+
+    bool Poll(CaptureBackend& backend, bool& matched, std::string& error) override;
+    std::int64_t NextIntervalMicros() const override { return interval; }
+    std::string LastResult() const override;
+
+    // Ponto do clique na última busca bem-sucedida, em centésimos de % da tela
+    int ClickX() const { return clickX; }
+    int ClickY() const { return clickY; }
+    int ClickMonitor() const { return clickMonitor; }
+    const AnchorMatch& LastMatch() const { return best; }
+    // Buscas feitas (perto da posição gravada e em todas as telas)
+    size_t Searches() const { return searches; }
+
+private:
+    AnchorTemplate anchor;
+    int monitorIndex;
+    int relX;
+    int relY;
+    int offsetX;
+    int offsetY;
+    int searchRadius;
+    double minScore;
+    PixelImage frame;
+    AnchorMatch best;
+    AnchorMatch hintMatch;
+    AnchorMatch everywhereMatch;
+    std::uint64_t seenHint = 0;
+    std::vector<std::uint64_t> seenMonitors;   // por tela, da última busca completa
+    int clickX = 0;
+    int clickY = 0;
+    int clickMonitor = 0;
+    std::int64_t interval = kMinIntervalMicros;
+    size_t polls = 0;
+    size_t searches = 0;
+};
+
+struct TemplateMatchBenchmarkResult {
+    const char* instructionSet;
+    int frameWidth;             // quadro 3840x2160 (4K) com interface sintética
+    int frameHeight;
+    int templateSize;           // âncora quadrada recortada do quadro
+    int levels;                 // níveis da pirâmide usados
+    double fullFrameMs;         // busca no quadro inteiro, uma thread (média)
+    double hintMs;              // busca só em volta da posição gravada (média)
+    double exhaustiveMs;        // todas as posições no nível 0 numa região de 512x512 (referência)
+    int monitors;               // busca em várias telas (threads)
+    double multiMonitorMs;      // captura + busca em todas as telas (média)
+    bool found;                 // a busca achou a posição certa
+    double score;
+};
+
+TemplateMatchBenchmarkResult BenchmarkTemplateMatch(int templateSize, int monitors);
+
+#endif // TEMPLATEMATCH_H
@@ -0,0 +1,587 @@
+#include "timeline.h"
+#include "actionstream.h"
+#include "actiontable.h"
+#include <QMetaObject>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+constexpr std::uint8_t kNoLane = 255;       // esperas: só avançam o tempo
+constexpr int kRulerHeight = 16;
+constexpr std::int32_t kScreenScale = 10000;    // coordenadas em centésimos de %
+
+const QRgb kBackground = qRgb(0x1e, 0x1e, 0x1e);
+const QRgb kLaneStripe = qRgb(0x25, 0x25, 0x27);
+const QRgb kSeparator = qRgb(0x3f, 0x3f, 0x46);
+const QRgb kKeyColor = qRgb(0xf5, 0x9e, 0x0b);
+const QRgb kClickColor = qRgb(0xef, 0x44, 0x44);
+const QRgb kMoveColor = qRgb(0x2a, 0x82, 0xda);
+
+QString FormatTick(std::int64_t micros, std::int64_t step) {
+    const qint64 ms = micros / 1000;
+    if (step < 1000) return QString("%1 ms").arg(micros / 1000.0, 0, 'f', 2);
+    if (step < 1000000) {
+        return QString("%1:%2.%3").arg(ms / 60000).arg((ms / 1000) % 60, 2, 10, QChar('0')).arg(ms % 1000, 3, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(ms / 60000).arg((ms / 1000) % 60, 2, 10, QChar('0'));
+}
+
+// Passo "redondo" (1, 2, 5 x 10^k µs) com pelo menos minPixels entre marcas
+std::int64_t TickStep(double microsPerPixel, int minPixels) {
+    const double wanted = microsPerPixel * minPixels;
+    std::int64_t step = 1;
+    for (;;) {
+        for (int m : {1, 2, 5}) {
+            if (step * m >= wanted) return step * m;
+        }
+        if (step > INT64_MAX / 100) return step;
+        step *= 10;
+    }
+}
+
+// Linha vertical direto nos pixels (x e y já dentro da imagem)
+void VLine(QImage& image, int x, int y0, int y1, QRgb color) {
+    if (y0 > y1) std::swap(y0, y1);
+    for (int y = y0; y <= y1; ++y) {
+        reinterpret_cast<QRgb*>(image.scanLine(y))[x] = color;
+    }
+}
+
+QRgb Blend(QRgb base, QRgb color, int alpha) {
+    auto mix = [alpha](int a, int b) { return (a * (255 - alpha) + b * alpha) / 255; };
+    return qRgb(mix(qRed(base), qRed(color)), mix(qGreen(base), qGreen(color)), mix(qBlue(base), qBlue(color)));
+}
+
+} // namespace
+
+// =============================================
+// RESUMO
+// =============================================
+
+void TimelineBucket::Add(std::int32_t value, std::uint32_t action) {
+    ++count;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+    firstAction = std::min(firstAction, action);
+}
+
+void TimelineBucket::Add(const TimelineBucket& other) {
+    if (other.count == 0) return;
+    count += other.count;
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+    firstAction = std::min(firstAction, other.firstAction);
+}
+
+void TimelineSummary::Reset(int monitorLanes) {
+    times.clear();
+    actionLanes.clear();
+    values.clear();
+    lanes.assign(kLaneFirstMonitor + std::max(1, monitorLanes), {});
+    duration = 0;
+}
+
+void TimelineSummary::AddAction(const Action& action) {
+    std::uint8_t lane = kNoLane;
+    std::int32_t value = 0;
+    switch (ActionKindFromString(action.type)) {
+        case ActionKind::KeyPress:
+            lane = kLaneKeyboard;
+            value = action.key;
+            break;
+        case ActionKind::TypeText:
+            lane = kLaneKeyboard;
+            value = action.text.empty() ? 0 : static_cast<unsigned char>(action.text[0]);
+            break;
+        case ActionKind::MouseClick:
+        case ActionKind::AnchorClick:
+            lane = kLaneClicks;
+            value = action.key;
+            break;
+        case ActionKind::MouseWheel:
+            // Mesma faixa dos botões, com valores depois dos botões
+            lane = kLaneClicks;
+            value = kMouseX2 + 1 + action.key;
+            break;
+        case ActionKind::MouseMove: {
+            // Telas além das faixas existentes ganham faixa nova (até 250)
+            const int monitor = std::min(std::max(action.monitorIndex, 0), kNoLane - 1 - kLaneFirstMonitor);
+            while (static_cast<int>(lanes.size()) <= kLaneFirstMonitor + monitor) lanes.emplace_back();
+            lane = static_cast<std::uint8_t>(kLaneFirstMonitor + monitor);
+            value = std::min(std::max(action.y, 0), kScreenScale);
+            break;
+        }
+        default:
+            break;
+    }
+    times.push_back(duration);
+    actionLanes.push_back(lane);
+    values.push_back(value);
+    duration += ScheduledMicros(action);
+}
+
+void TimelineSummary::Finish() {
+    // Nível 0 com no máximo kMaxBaseBuckets intervalos (largura potência de 2
+    // em µs, para os níveis seguintes caírem em fronteiras exatas)
+    baseBucketMicros = 1;
+    while (duration / baseBucketMicros >= static_cast<std::int64_t>(kMaxBaseBuckets)) baseBucketMicros <<= 1;
+    const size_t baseCount = static_cast<size_t>(duration / baseBucketMicros) + 1;
+
+    for (auto& levels : lanes) {
+        levels.assign(1, std::vector<TimelineBucket>(baseCount));
+    }
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (actionLanes[i] == kNoLane) continue;
+        lanes[actionLanes[i]][0][static_cast<size_t>(times[i] / baseBucketMicros)].Add(values[i], static_cast<std::uint32_t>(i));
+    }
+    for (auto& levels : lanes) {
+        while (levels.back().size() > 1) {
+            const auto& fine = levels.back();
+            std::vector<TimelineBucket> coarse((fine.size() + 1) / 2);
+            for (size_t i = 0; i < fine.size(); ++i) coarse[i / 2].Add(fine[i]);
+            levels.push_back(std::move(coarse));
+        }
+    }
+}
+
+TimelineSummary TimelineSummary::Build(const ActionTable& actions) {
+    TimelineSummary summary;
+    summary.Reset(1);
+    summary.times.reserve(actions.size());
+    summary.actionLanes.reserve(actions.size());
+    summary.values.reserve(actions.size());
+    actions.ForEach([&summary](const Action& action) { summary.AddAction(action); });
+    summary.Finish();
+    return summary;
+}
+
+TimelineSummary TimelineSummary::Build(const ActionStream& stream) {
+    TimelineSummary summary;
+    summary.Reset(1);
+    summary.times.reserve(stream.size());
+    summary.actionLanes.reserve(stream.size());
+    summary.values.reserve(stream.size());
+    stream.ForEach([&summary](const Action& action) { summary.AddAction(action); });
+    summary.Finish();
+    return summary;
+}
+
+QString TimelineSummary::LaneName(int lane) const {
+    if (lane == kLaneKeyboard) return "Teclado";
+    if (lane == kLaneClicks) return "Cliques e roda";
+    return QString("Mouse · Tela %1").arg(lane - kLaneFirstMonitor + 1);
+}
+
+TimelineBucket TimelineSummary::Query(int lane, std::int64_t from, std::int64_t to, std::int64_t resolution) const {
+    TimelineBucket result;
+    if (lane < 0 || lane >= LaneCount() || to <= 0 || from > duration) return result;
+    int level = 0;
+    while (level + 1 < LevelCount() && BucketMicros(level + 1) <= resolution) ++level;
+    const auto& buckets = lanes[lane][level];
+    const std::int64_t width = BucketMicros(level);
+    const size_t first = static_cast<size_t>(std::max<std::int64_t>(from, 0) / width);
+    const size_t last = std::min(buckets.size() - 1, static_cast<size_t>(std::max<std::int64_t>(to - 1, 0) / width));
+    for (size_t i = first; i <= last; ++i) result.Add(buckets[i]);
+    return result;
+}
+
+size_t TimelineSummary::ActionAtMicros(std::int64_t micros) const {
+    if (times.empty()) return 0;
+    auto it = std::upper_bound(times.begin(), times.end(), micros);
+    return it == times.begin() ? 0 : static_cast<size_t>(it - times.begin()) - 1;
+}
+
+size_t TimelineSummary::NearestAction(int lane, std::int64_t micros, std::int64_t tolerance) const {
+    size_t best = SIZE_MAX;
+    std::int64_t bestDistance = tolerance + 1;
+    auto first = std::lower_bound(times.begin(), times.end(), micros - tolerance);
+    for (auto it = first; it != times.end() && *it <= micros + tolerance; ++it) {
+        const size_t index = static_cast<size_t>(it - times.begin());
+        if (actionLanes[index] != lane) continue;
+        const std::int64_t distance = std::llabs(*it - micros);
+        if (distance < bestDistance) {
+            best = index;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+// =============================================
+// DESENHO
+// =============================================
+
+bool TimelineView::operator==(const TimelineView& other) const {
+    return startMicros == other.startMicros && microsPerPixel == other.microsPerPixel &&
+           playheadMicros == other.playheadMicros && selectionFrom == other.selectionFrom &&
+           selectionTo == other.selectionTo;
+}
+
+QImage RenderTimeline(const TimelineSummary& summary, const TimelineView& view, int width, int height) {
+    width = std::max(1, width);
+    height = std::max(kRulerHeight + 1, height);
+    QImage image(width, height, QImage::Format_RGB32);
+    image.fill(kBackground);
+    const int laneCount = std::max(1, summary.LaneCount());
+    const int laneHeight = std::max(1, (height - kRulerHeight) / laneCount);
+    const double mpp = std::max(view.microsPerPixel, 1e-3);
+    auto xOf = [&](std::int64_t micros) { return static_cast<int>(std::floor((micros - view.startMicros) / mpp)); };
+
+    // Colunas de cada faixa: do resumo (zoom afastado) ou dos eventos (zoom
+    // abaixo da resolução do nível 0)
+    std::vector<std::vector<TimelineBucket>> columns(summary.LaneCount(), std::vector<TimelineBucket>(width));
+    const std::int64_t viewEnd = view.startMicros + static_cast<std::int64_t>(std::ceil(width * mpp));
+    if (mpp >= summary.BucketMicros(0)) {
+        for (int lane = 0; lane < summary.LaneCount(); ++lane) {
+            for (int x = 0; x < width; ++x) {
+                const std::int64_t from = view.startMicros + static_cast<std::int64_t>(x * mpp);
+                const std::int64_t to = view.startMicros + static_cast<std::int64_t>((x + 1) * mpp);
+                columns[lane][x] = summary.Query(lane, from, std::max(to, from + 1), static_cast<std::int64_t>(mpp));
+            }
+        }
+    } else {
+        for (size_t i = summary.ActionAtMicros(view.startMicros); i < summary.ActionCount(); ++i) {
+            const std::int64_t t = summary.MicrosAt(i);
+            if (t >= viewEnd) break;
+            const int lane = summary.LaneOf(i);
+            const int x = xOf(t);
+            if (lane >= summary.LaneCount() || x < 0 || x >= width) continue;
+            columns[lane][x].Add(summary.ValueOf(i), static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // Faixas
+    for (int lane = 0; lane < summary.LaneCount(); ++lane) {
+        const int top = kRulerHeight + lane * laneHeight;
+        const int bottom = std::min(height - 1, top + laneHeight - 1);
+        if (lane % 2) {
+            for (int y = top; y <= bottom; ++y) {
+                std::fill_n(reinterpret_cast<QRgb*>(image.scanLine(y)), width, kLaneStripe);
+            }
+        }
+        const bool isMove = lane >= kLaneFirstMonitor;
+        const QRgb color = lane == kLaneKeyboard ? kKeyColor : lane == kLaneClicks ? kClickColor : kMoveColor;
+        const int inner = std::max(1, bottom - top - 4);
+        for (int x = 0; x < width; ++x) {
+            const TimelineBucket& b = columns[lane][x];
+            if (b.count == 0) continue;
+            if (isMove) {
+                // Faixa vertical = menor e maior y alcançados na coluna
+                const int y0 = top + 2 + static_cast<int>(static_cast<std::int64_t>(b.minValue) * inner / kScreenScale);
+                const int y1 = top + 2 + static_cast<int>(static_cast<std::int64_t>(b.maxValue) * inner / kScreenScale);
+                VLine(image, x, std::min(y0, bottom), std::min(y1, bottom), color);
+            } else {
+                // Altura pela densidade (log), intensidade cresce com a contagem
+                const double density = std::min(1.0, (std::log2(static_cast<double>(b.count)) + 1.0) / 8.0);
+                const int h = std::max(2, static_cast<int>(density * (bottom - top - 2)));
+                const int alpha = std::min(255, 140 + static_cast<int>(b.count) * 10);
+                QRgb base = (lane % 2) ? kLaneStripe : kBackground;
+                VLine(image, x, bottom - h, bottom - 1, Blend(base, color, alpha));
+            }
+        }
+        for (int x = 0; x < width && bottom + 1 < height; ++x) {
+            reinterpret_cast<QRgb*>(image.scanLine(bottom))[x] = kSeparator;
+        }
+    }
+
+    QPainter painter(&image);
+    QFont font = painter.font();
+    font.setPixelSize(10);
+    painter.setFont(font);
+
+    // Seleção e início da reprodução
+    if (view.selectionFrom >= 0) {
+        const int x0 = xOf(std::min(view.selectionFrom, view.selectionTo));
+        const int x1 = std::max(x0 + 1, xOf(std::max(view.selectionFrom, view.selectionTo)));
+        painter.fillRect(QRect(x0, kRulerHeight, x1 - x0 + 1, height - kRulerHeight), QColor(59, 130, 246, 70));
+        painter.setPen(QColor(59, 130, 246));
+        painter.drawLine(x0, kRulerHeight, x0, height - 1);
+    }
+    if (view.playheadMicros >= 0) {
+        const int x = xOf(view.playheadMicros);
+        painter.setPen(QPen(Qt::white, 1, Qt::DashLine));
+        painter.drawLine(x, 0, x, height - 1);
+    }
+
+    // Régua
+    painter.fillRect(QRect(0, 0, width, kRulerHeight), QColor(0x2d, 0x2d, 0x30));
+    painter.setPen(QColor(0xa0, 0xa0, 0xa0));
+    const std::int64_t step = TickStep(mpp, 90);
+    for (std::int64_t t = std::max<std::int64_t>(0, view.startMicros / step * step); t <= viewEnd; t += step) {
+        const int x = xOf(t);
+        if (x < 0) continue;
+        painter.drawLine(x, kRulerHeight - 5, x, kRulerHeight - 1);
+        painter.drawText(x + 3, kRulerHeight - 4, FormatTick(t, step));
+    }
+    // Fim da gravação
+    const int endX = xOf(summary.DurationMicros());
+    if (endX >= 0 && endX < width) {
+        painter.setPen(QColor(0x56, 0x56, 0x56));
+        painter.drawLine(endX, kRulerHeight, endX, height - 1);
+    }
+
+    // Nomes das faixas
+    painter.setPen(QColor(0xd0, 0xd0, 0xd0));
+    for (int lane = 0; lane < summary.LaneCount(); ++lane) {
+        painter.drawText(4, kRulerHeight + lane * laneHeight + 11, summary.LaneName(lane));
+    }
+    if (summary.ActionCount() == 0) {
+        painter.drawText(QRect(0, kRulerHeight, width, height - kRulerHeight), Qt::AlignCenter, "Nenhuma ação gravada");
+    }
+    return image;
+}
+
+// =============================================
+// WIDGET
+// =============================================
+
+TimelineWidget::TimelineWidget(QWidget* parent)
+    : QWidget(parent), summary(std::make_shared<const TimelineSummary>()) {
+    setMinimumHeight(110);
+    setToolTip("Roda: zoom · Arrastar: rolar · Clique: selecionar ação\n"
+               "Shift+arrastar: selecionar trecho · Duplo clique: início da reprodução");
+    worker = std::thread(&TimelineWidget::ThreadMain, this);
+}
+
+TimelineWidget::~TimelineWidget() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+void TimelineWidget::SetSource(SummaryBuilder build) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingBuild = std::move(build);
+    }
+    wakeUp.notify_one();
+}
+
+void TimelineWidget::SetPlayhead(std::int64_t micros) {
+    if (view.playheadMicros == micros) return;
+    view.playheadMicros = micros;
+    RequestRender();
+}
+
+void TimelineWidget::ShowAction(size_t action) {
+    if (action >= summary->ActionCount()) return;
+    const std::int64_t t = summary->MicrosAt(action);
+    view.selectionFrom = view.selectionTo = t;
+    // Centraliza só se estiver fora da vista
+    if (MicrosAtX(0) > t || MicrosAtX(width()) < t) {
+        view.startMicros = t - static_cast<std::int64_t>(width() / 2 * view.microsPerPixel);
+    }
+    RequestRender();
+}
+
+void TimelineWidget::RequestRender() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        renderPending = true;
+        pendingView = view;
+        pendingWidth = width();
+        pendingHeight = height();
+    }
+    wakeUp.notify_one();
+    update();
+}
+
+void TimelineWidget::ThreadMain() {
+    std::shared_ptr<const TimelineSummary> current = summary;
+    for (;;) {
+        SummaryBuilder build;
+        bool render = false;
+        TimelineView renderView;
+        int w = 0, h = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return !running || pendingBuild || renderPending; });
+            if (!running) break;
+            build = std::move(pendingBuild);
+            pendingBuild = nullptr;
+            render = renderPending;
+            renderPending = false;
+            renderView = pendingView;
+            w = pendingWidth;
+            h = pendingHeight;
+        }
+
+        if (build) {
+            // Resumo novo vai para a interface, que ajusta a vista e pede o desenho
+            current = std::make_shared<const TimelineSummary>(build());
+            auto result = current;
+            QMetaObject::invokeMethod(this, [this, result]() {
+                const bool refit = summary->ActionCount() == 0 ||
+                    view.startMicros + width() * view.microsPerPixel >= summary->DurationMicros();
+                summary = result;
+                if (refit) FitAll();
+                RequestRender();
+            }, Qt::QueuedConnection);
+            continue;   // o desenho com a vista antiga seria descartado
+        }
+        if (render && w > 0 && h > 0) {
+            QImage frame = RenderTimeline(*current, renderView, w, h);
+            QMetaObject::invokeMethod(this, [this, frame, renderView]() {
+                image = frame;
+                imageView = renderView;
+                update();
+            }, Qt::QueuedConnection);
+        }
+    }
+}
+
+void TimelineWidget::FitAll() {
+    const std::int64_t duration = std::max<std::int64_t>(summary->DurationMicros(), 1000000);
+    view.microsPerPixel = duration * 1.02 / std::max(1, width());
+    view.startMicros = 0;
+}
+
+std::int64_t TimelineWidget::MicrosAtX(int x) const {
+    return view.startMicros + static_cast<std::int64_t>(x * view.microsPerPixel);
+}
+
+int TimelineWidget::LaneAtY(int y) const {
+    const int laneCount = std::max(1, summary->LaneCount());
+    const int laneHeight = std::max(1, (height() - kRulerHeight) / laneCount);
+    return y < kRulerHeight ? -1 : (y - kRulerHeight) / laneHeight;
+}
+
+void TimelineWidget::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    if (image.isNull()) {
+        painter.fillRect(rect(), QColor(kBackground));
+        return;
+    }
+    if (imageView.startMicros == view.startMicros && imageView.microsPerPixel == view.microsPerPixel) {
+        painter.drawImage(0, 0, image);
+        return;
+    }
+    // Imagem anterior reposicionada enquanto a nova é desenhada
+    painter.fillRect(rect(), QColor(kBackground));
+    const double scale = imageView.microsPerPixel / view.microsPerPixel;
+    const double offset = (imageView.startMicros - view.startMicros) / view.microsPerPixel;
+    painter.drawImage(QRectF(offset, 0, image.width() * scale, image.height()), image);
+}
+
+void TimelineWidget::resizeEvent(QResizeEvent*) {
+    if (image.isNull()) FitAll();
+    RequestRender();
+}
+
+void TimelineWidget::wheelEvent(QWheelEvent* event) {
+    const int x = static_cast<int>(event->position().x());
+    const std::int64_t anchor = MicrosAtX(x);
+    const double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    // Até 10 µs por pixel, e no máximo a gravação inteira 4x menor que a largura
+    const double maxMpp = std::max<std::int64_t>(summary->DurationMicros(), 1000000) * 4.0 / std::max(1, width());
+    view.microsPerPixel = std::min(maxMpp, std::max(10.0, view.microsPerPixel * factor));
+    view.startMicros = anchor - static_cast<std::int64_t>(x * view.microsPerPixel);
+    RequestRender();
+}
+
+void TimelineWidget::mousePressEvent(QMouseEvent* event) {
+    if (event->button() != Qt::LeftButton) return;
+    dragStartX = event->x();
+    dragStartMicros = view.startMicros;
+    if (event->modifiers() & Qt::ShiftModifier) {
+        selecting = true;
+        view.selectionFrom = view.selectionTo = MicrosAtX(event->x());
+        RequestRender();
+    } else {
+        dragging = true;
+    }
+}
+
+void TimelineWidget::mouseMoveEvent(QMouseEvent* event) {
+    if (selecting) {
+        view.selectionTo = MicrosAtX(event->x());
+        RequestRender();
+    } else if (dragging) {
+        view.startMicros = dragStartMicros - static_cast<std::int64_t>((event->x() - dragStartX) * view.microsPerPixel);
+        RequestRender();
+    }
+}
+
+void TimelineWidget::mouseReleaseEvent(QMouseEvent* event) {
+    if (selecting) {
+        selecting = false;
+        const std::int64_t from = std::min(view.selectionFrom, view.selectionTo);
+        const std::int64_t to = std::max(view.selectionFrom, view.selectionTo);
+        if (summary->ActionCount() == 0) return;
+        size_t first = summary->ActionAtMicros(from);
+        if (summary->MicrosAt(first) < from && first + 1 < summary->ActionCount()) ++first;
+        const size_t last = summary->ActionAtMicros(to);
+        if (last >= first) emit rangeSelected(first, last - first + 1);
+        return;
+    }
+    if (!dragging) return;
+    dragging = false;
+    if (std::abs(event->x() - dragStartX) > 3) return;
+
+    // Clique: ação mais próxima na faixa, até 6 pixels de distância
+    const size_t action = summary->NearestAction(LaneAtY(event->y()), MicrosAtX(event->x()),
+                                                 static_cast<std::int64_t>(6 * view.microsPerPixel) + 1);
+    if (action != SIZE_MAX) {
+        view.selectionFrom = view.selectionTo = summary->MicrosAt(action);
+        RequestRender();
+        emit actionSelected(action);
+    }
+}
+
+void TimelineWidget::mouseDoubleClickEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) {
+        emit seekRequested(std::max<std::int64_t>(0, MicrosAtX(event->x())));
+    }
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+TimelineBenchmarkResult BenchmarkTimeline(size_t actions, int width, int height) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    ActionTable table(SyntheticActionTrace(2, actions, 19));
+    TimelineBenchmarkResult r = {table.size(), 0, 0, 0, 0, 0};
+
+    auto start = Clock::now();
+    TimelineSummary summary = TimelineSummary::Build(table);
+    r.buildMs = elapsedMs(start);
+    r.summaryBytes = summary.ActionCount() * (sizeof(std::int64_t) + 1 + sizeof(std::int32_t));
+    for (int lane = 0; lane < summary.LaneCount(); ++lane) {
+        for (int level = 0; level < summary.LevelCount(); ++level) {
+            r.summaryBytes += summary.Level(lane, level).size() * sizeof(TimelineBucket);
+        }
+    }
+
+    // Média de quadros rolando pela gravação em cada zoom
+    auto frames = [&](double microsPerPixel) {
+        const int count = 20;
+        TimelineView view;
+        view.microsPerPixel = microsPerPixel;
+        const std::int64_t span = std::max<std::int64_t>(1, summary.DurationMicros() - static_cast<std::int64_t>(width * microsPerPixel));
+        auto begin = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            view.startMicros = span * i / count;
+            RenderTimeline(summary, view, width, height);
+        }
+        return elapsedMs(begin) / count;
+    };
+    const double fit = std::max<std::int64_t>(summary.DurationMicros(), 1) / static_cast<double>(width);
+    r.fitFrameMs = frames(fit);
+    r.zoomFrameMs = frames(std::max(fit / 64, 1.0));
+    r.closeFrameMs = frames(std::max(summary.BucketMicros(0) / 4.0, 10.0));
+    return r;
+}
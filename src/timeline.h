@@ -0,0 +1,173 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "action.h"
+#include <QImage>
+#include <QString>
+#include <QWidget>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ActionTable;
+class ActionStream;
+
+// Faixas da linha do tempo: teclado, cliques/roda e uma faixa de movimento por tela
+enum TimelineLaneKind {
+    kLaneKeyboard = 0,
+    kLaneClicks = 1,
+    kLaneFirstMonitor = 2
+};
+
+// Resumo de um intervalo de tempo de uma faixa
+struct TimelineBucket {
+    std::uint32_t count = 0;
+    std::int32_t minValue = INT32_MAX;      // tecla/botão, ou y (centésimos de %) nos movimentos
+    std::int32_t maxValue = INT32_MIN;
+    std::uint32_t firstAction = UINT32_MAX;
+
+    void Add(std::int32_t value, std::uint32_t action);
+    void Add(const TimelineBucket& other);
+};
+
+// Resumo em várias resoluções de uma gravação: o nível 0 tem até
+// kMaxBaseBuckets intervalos por faixa e cada nível seguinte junta pares do
+// anterior. Desenhar uma janela de W pixels lê ~W intervalos por faixa, em
+// qualquer zoom; abaixo da resolução do nível 0 usa os eventos individuais
+// (a janela visível é curta o bastante para isso).
+class TimelineSummary {
+public:
+    static constexpr size_t kMaxBaseBuckets = 65536;
+
+    static TimelineSummary Build(const ActionTable& actions);
+    static TimelineSummary Build(const ActionStream& stream);
+
+    size_t ActionCount() const { return times.size(); }
+    std::int64_t DurationMicros() const { return duration; }
+    int LaneCount() const { return static_cast<int>(lanes.size()); }
+    QString LaneName(int lane) const;
+
+    int LevelCount() const { return lanes.empty() ? 0 : static_cast<int>(lanes[0].size()); }
+    std::int64_t BucketMicros(int level) const { return baseBucketMicros << level; }
+    const std::vector<TimelineBucket>& Level(int lane, int level) const { return lanes[lane][level]; }
+    // Junta os intervalos que cobrem [from, to) no nível mais grosso cuja
+    // resolução ainda é <= 'resolution'
+    TimelineBucket Query(int lane, std::int64_t from, std::int64_t to, std::int64_t resolution) const;
+
+    std::int64_t MicrosAt(size_t action) const { return action < times.size() ? times[action] : duration; }
+    // Última ação que começa até 'micros'
+    size_t ActionAtMicros(std::int64_t micros) const;
+    int LaneOf(size_t action) const { return actionLanes[action]; }
+    std::int32_t ValueOf(size_t action) const { return values[action]; }
+    // Ação da faixa mais próxima de 'micros', até 'tolerance' de distância;
+    // SIZE_MAX se não houver
+    size_t NearestAction(int lane, std::int64_t micros, std::int64_t tolerance) const;
+
+private:
+    void Reset(int monitorLanes);
+    void AddAction(const Action& action);
+    void Finish();
+
+    std::vector<std::int64_t> times;        // instante de cada ação
+    std::vector<std::uint8_t> actionLanes;  // faixa de cada ação (255 = esperas)
+    std::vector<std::int32_t> values;
+    std::vector<std::vector<std::vector<TimelineBucket>>> lanes;   // [faixa][nível][intervalo]
+    std::int64_t baseBucketMicros = 1;
+    std::int64_t duration = 0;
+};
+
+// Parte visível: 'startMicros' na borda esquerda, 'microsPerPixel' de zoom
+struct TimelineView {
+    std::int64_t startMicros = 0;
+    double microsPerPixel = 1000.0;
+    std::int64_t playheadMicros = -1;       // início da reprodução (-1 = nenhum)
+    std::int64_t selectionFrom = -1;        // trecho selecionado (-1 = nenhum)
+    std::int64_t selectionTo = -1;
+
+    bool operator==(const TimelineView& other) const;
+    bool operator!=(const TimelineView& other) const { return !(*this == other); }
+};
+
+// Desenha a linha do tempo numa QImage. Não usa nada da thread da interface:
+// roda no worker do TimelineWidget e em testes/benchmarks sem janela.
+QImage RenderTimeline(const TimelineSummary& summary, const TimelineView& view, int width, int height);
+
+// Linha do tempo interativa: roda do mouse = zoom, arrastar = rolar,
+// clique = selecionar ação, Shift+arrastar = selecionar trecho, duplo clique =
+// início da reprodução. Resumo e imagem são feitos numa thread própria (o
+// pedido mais recente substitui os pendentes); enquanto a imagem nova não
+// chega, a anterior é reaproveitada com a translação/escala do gesto.
+class TimelineWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    using SummaryBuilder = std::function<TimelineSummary()>;
+
+    explicit TimelineWidget(QWidget* parent = nullptr);
+    ~TimelineWidget() override;
+
+    // 'build' roda na thread da linha do tempo (ex.: captura um instantâneo da ActionTable)
+    void SetSource(SummaryBuilder build);
+    void SetPlayhead(std::int64_t micros);
+    void ShowAction(size_t action);
+    std::shared_ptr<const TimelineSummary> Summary() const { return summary; }
+
+signals:
+    void actionSelected(qulonglong action);
+    void rangeSelected(qulonglong first, qulonglong count);
+    void seekRequested(qint64 micros);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    void RequestRender();
+    void ThreadMain();
+    void FitAll();
+    std::int64_t MicrosAtX(int x) const;
+    int LaneAtY(int y) const;
+
+    // Só na thread da interface
+    std::shared_ptr<const TimelineSummary> summary;
+    TimelineView view;
+    QImage image;
+    TimelineView imageView;             // vista em que 'image' foi desenhada
+    bool dragging = false;
+    bool selecting = false;
+    int dragStartX = 0;
+    std::int64_t dragStartMicros = 0;
+
+    // Pedidos para a thread (sob 'mutex')
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    SummaryBuilder pendingBuild;
+    bool renderPending = false;
+    TimelineView pendingView;
+    int pendingWidth = 0;
+    int pendingHeight = 0;
+    bool running = true;
+    std::thread worker;
+};
+
+struct TimelineBenchmarkResult {
+    size_t actions;
+    double buildMs;             // resumo completo
+    size_t summaryBytes;
+    double fitFrameMs;          // gravação inteira na tela
+    double zoomFrameMs;         // zoom médio (níveis intermediários)
+    double closeFrameMs;        // zoom máximo (eventos individuais)
+};
+
+TimelineBenchmarkResult BenchmarkTimeline(size_t actions, int width, int height);
+
+#endif // TIMELINE_H
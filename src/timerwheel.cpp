@@ -0,0 +1,364 @@
+#include "timerwheel.h"
+#include "tracing.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+
+namespace {
+
+inline int CountTrailingZeros(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int n = 0;
+    while ((value & 1) == 0) { value >>= 1; ++n; }
+    return n;
+#endif
+}
+
+constexpr int kLevelShift(int level) { return level * TimerWheel::kLevelBits; }
+constexpr std::uint64_t kSlotMask = TimerWheel::kSlotsPerLevel - 1;
+constexpr int kRangeBits = TimerWheel::kLevels * TimerWheel::kLevelBits;
+
+} // namespace
+
+TimerWheel::TimerWheel(std::chrono::microseconds tick)
+    : tickLength(std::max(tick, std::chrono::microseconds(1))),
+      origin(Clock::now()) {
+    for (auto& level : heads) {
+        std::fill(std::begin(level), std::end(level), kNone);
+    }
+    worker = std::thread(&TimerWheel::ThreadMain, this);
+}
+
+TimerWheel::~TimerWheel() {
+    Shutdown();
+}
+
+void TimerWheel::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    wakeUp.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+std::uint64_t TimerWheel::TickOf(Clock::time_point t) const {
+    if (t <= origin) return 0;
+    // Arredonda para cima: um temporizador nunca dispara antes do prazo
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count();
+    return static_cast<std::uint64_t>((elapsed + tickLength.count() - 1) / tickLength.count());
+}
+
+TimerWheel::Clock::time_point TimerWheel::TimeOfTick(std::uint64_t tick) const {
+    return origin + tickLength * static_cast<std::int64_t>(tick);
+}
+
+void TimerWheel::MarkSlot(int level, size_t slot, bool isOccupied) {
+    std::uint64_t bit = 1ULL << (slot % 64);
+    if (isOccupied) occupancy[level][slot / 64] |= bit;
+    else occupancy[level][slot / 64] &= ~bit;
+}
+
+int TimerWheel::NextOccupied(int level, size_t from) const {
+    for (size_t word = from / 64; word < kSlotsPerLevel / 64; ++word) {
+        std::uint64_t bits = occupancy[level][word];
+        if (word == from / 64) bits &= ~0ULL << (from % 64);
+        if (bits) return static_cast<int>(word * 64 + CountTrailingZeros(bits));
+    }
+    return -1;
+}
+
+std::uint32_t TimerWheel::Acquire() {
+    if (freeList != kNone) {
+        std::uint32_t node = freeList;
+        freeList = nodes[node].next;
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<std::uint32_t>(nodes.size() - 1);
+}
+
+void TimerWheel::Release(std::uint32_t node) {
+    Node& n = nodes[node];
+    n.active = false;
+    n.generation++;
+    n.prev = kNone;
+    n.next = freeList;
+    freeList = node;
+    pending--;
+}
+
+void TimerWheel::Link(std::uint32_t node) {
+    Node& n = nodes[node];
+    // Prazos vencidos entram no tick corrente
+    const std::uint64_t tick = std::max(n.tick, currentTick);
+
+    // Nível = primeiro em que os bits acima dele coincidem com o tick corrente
+    std::uint32_t* head = &overflowHead;
+    n.bucket = kOverflow;
+    for (int level = 0; level < kLevels; ++level) {
+        int above = kLevelShift(level + 1);
+        if (above >= 64 || (tick >> above) == (currentTick >> above)) {
+            size_t slot = static_cast<size_t>((tick >> kLevelShift(level)) & kSlotMask);
+            head = &heads[level][slot];
+            n.bucket = static_cast<std::uint16_t>(level * kSlotsPerLevel + slot);
+            MarkSlot(level, slot, true);
+            break;
+        }
+    }
+
+    n.prev = kNone;
+    n.next = *head;
+    if (*head != kNone) nodes[*head].prev = node;
+    *head = node;
+}
+
+void TimerWheel::Unlink(std::uint32_t node) {
+    Node& n = nodes[node];
+    if (n.prev != kNone) {
+        nodes[n.prev].next = n.next;
+    } else if (n.bucket == kOverflow) {
+        overflowHead = n.next;
+    } else {
+        int level = n.bucket / kSlotsPerLevel;
+        size_t slot = n.bucket % kSlotsPerLevel;
+        heads[level][slot] = n.next;
+        if (n.next == kNone) MarkSlot(level, slot, false);
+    }
+    if (n.next != kNone) nodes[n.next].prev = n.prev;
+}
+
+void TimerWheel::Cascade(int level, size_t slot) {
+    std::uint32_t node = heads[level][slot];
+    heads[level][slot] = kNone;
+    MarkSlot(level, slot, false);
+    while (node != kNone) {
+        std::uint32_t next = nodes[node].next;
+        Link(node);
+        node = next;
+    }
+}
+
+void TimerWheel::ReinsertOverflow() {
+    std::uint32_t node = overflowHead;
+    overflowHead = kNone;
+    while (node != kNone) {
+        std::uint32_t next = nodes[node].next;
+        Link(node);
+        node = next;
+    }
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleAt(Clock::time_point deadline, Callback callback) {
+    TimerId id;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending == 0) {
+            // Roda vazia: o tick corrente pode pular direto para agora
+            auto now = Clock::now();
+            if (now > origin) {
+                currentTick = std::max<std::uint64_t>(currentTick,
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - origin).count() / tickLength.count());
+            }
+        }
+        std::uint32_t node = Acquire();
+        Node& n = nodes[node];
+        n.callback = std::move(callback);
+        n.tick = TickOf(deadline);
+        n.active = true;
+        Link(node);
+        pending++;
+        id = (static_cast<TimerId>(n.generation) << 32) | (static_cast<TimerId>(node) + 1);
+        // Só acorda a thread se o novo prazo vem antes do despertar já planejado
+        wake = std::max(n.tick, currentTick) < plannedWake;
+    }
+    if (wake) wakeUp.notify_one();
+    return id;
+}
+
+TimerWheel::TimerId TimerWheel::ScheduleAfter(Clock::duration delay, Callback callback) {
+    return ScheduleAt(Clock::now() + delay, std::move(callback));
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+    Callback doomed;   // destruído fora do lock: capturas podem tocar a roda
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::uint64_t index = (id & 0xFFFFFFFFu);
+        if (index == 0 || index > nodes.size()) return false;
+        const std::uint32_t node = static_cast<std::uint32_t>(index - 1);
+        Node& n = nodes[node];
+        if (!n.active || n.generation != static_cast<std::uint32_t>(id >> 32)) return false;
+        Unlink(node);
+        doomed = std::move(n.callback);
+        n.callback = nullptr;
+        Release(node);
+    }
+    return true;
+}
+
+size_t TimerWheel::Pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+void TimerWheel::Advance(std::uint64_t nowTick, std::vector<Callback>& ready) {
+    while (currentTick <= nowTick && pending > 0) {
+        const std::uint64_t tick = currentTick;
+
+        // Fronteiras de nível: desce os temporizadores do nível de cima
+        if ((tick & kSlotMask) == 0) {
+            if ((tick & ((1ULL << kRangeBits) - 1)) == 0 && overflowHead != kNone) {
+                ReinsertOverflow();
+            }
+            for (int level = kLevels - 1; level >= 1; --level) {
+                if ((tick & ((1ULL << kLevelShift(level)) - 1)) != 0) continue;
+                size_t slot = static_cast<size_t>((tick >> kLevelShift(level)) & kSlotMask);
+                if (heads[level][slot] != kNone) Cascade(level, slot);
+            }
+        }
+
+        const size_t slot = static_cast<size_t>(tick & kSlotMask);
+        std::uint32_t node = heads[0][slot];
+        if (node != kNone) {
+            heads[0][slot] = kNone;
+            MarkSlot(0, slot, false);
+            while (node != kNone) {
+                std::uint32_t next = nodes[node].next;
+                ready.push_back(std::move(nodes[node].callback));
+                nodes[node].callback = nullptr;
+                Release(node);
+                node = next;
+            }
+        }
+
+        // Pula os ticks vazios até o próximo slot ocupado ou a próxima fronteira
+        int nextSlot = slot + 1 < kSlotsPerLevel ? NextOccupied(0, slot + 1) : -1;
+        std::uint64_t next = nextSlot >= 0 ? (tick & ~kSlotMask) + nextSlot : (tick | kSlotMask) + 1;
+        currentTick = std::min(next, nowTick + 1);
+    }
+    if (pending == 0) {
+        currentTick = std::max(currentTick, nowTick + 1);
+    }
+}
+
+std::uint64_t TimerWheel::NextEventTick() const {
+    if (pending == 0) return ~0ULL;
+
+    std::uint64_t best = ~0ULL;
+    int slot = NextOccupied(0, static_cast<size_t>(currentTick & kSlotMask));
+    if (slot >= 0) best = (currentTick & ~kSlotMask) + slot;
+
+    for (int level = 1; level < kLevels; ++level) {
+        int shift = kLevelShift(level);
+        slot = NextOccupied(level, static_cast<size_t>((currentTick >> shift) & kSlotMask));
+        if (slot < 0) continue;
+        std::uint64_t base = (currentTick >> (shift + kLevelBits)) << (shift + kLevelBits);
+        best = std::min(best, base + (static_cast<std::uint64_t>(slot) << shift));
+    }
+
+    if (overflowHead != kNone) {
+        best = std::min(best, ((currentTick >> kRangeBits) + 1) << kRangeBits);
+    }
+    return best;
+}
+
+void TimerWheel::ThreadMain() {
+    TraceRecorder::Global().SetThreadName("roda de temporizadores");
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<Callback> ready;
+
+    while (running) {
+        if (pending == 0) {
+            // Sem temporizadores pendentes a thread fica bloqueada: custo zero
+            plannedWake = ~0ULL;
+            wakeUp.wait(lock);
+            continue;
+        }
+
+        // Tick já iniciado (arredondado para baixo): só vence o que passou do prazo
+        auto now = Clock::now();
+        std::uint64_t nowTick = now <= origin ? 0 : static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - origin).count() / tickLength.count());
+        Advance(nowTick, ready);
+
+        if (!ready.empty()) {
+            plannedWake = 0;   // a thread reavalia tudo ao voltar; agendamentos não precisam acordá-la
+            lock.unlock();
+            for (auto& callback : ready) {
+                callback();
+            }
+            ready.clear();
+            lock.lock();
+            continue;
+        }
+
+        plannedWake = NextEventTick();
+        if (plannedWake == ~0ULL) continue;
+        wakeUp.wait_until(lock, TimeOfTick(plannedWake));
+    }
+}
+
+// =============================================
+// BENCHMARK
+// =============================================
+
+TimerBenchmarkResult BenchmarkTimerWheel(size_t timers) {
+    using Clock = TimerWheel::Clock;
+    TimerBenchmarkResult result = {timers, 0.0, 0.0, 0, 0.0, 0.0, 0.0};
+    TimerWheel wheel;
+    std::mt19937 rng(12345);
+
+    // Prazos entre 1 s e 1 h: espalhados por todos os níveis, nenhum dispara
+    std::uniform_int_distribution<int> farDelay(1000, 3600 * 1000);
+    std::vector<std::chrono::milliseconds> delays(timers);
+    for (auto& delay : delays) delay = std::chrono::milliseconds(farDelay(rng));
+
+    std::vector<TimerWheel::TimerId> ids(timers);
+    auto start = Clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        ids[i] = wheel.ScheduleAfter(delays[i], []() {});
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    result.insertNs = timers ? elapsed / timers : 0.0;
+
+    // Precisão: prazos curtos disparando com a roda carregada
+    const size_t samples = 200;
+    std::uniform_int_distribution<int> nearDelay(2000, 300000);
+    std::vector<double> late(samples, 0.0);
+    std::atomic<size_t> fired{0};
+    for (size_t i = 0; i < samples; ++i) {
+        auto deadline = Clock::now() + std::chrono::microseconds(nearDelay(rng));
+        wheel.ScheduleAt(deadline, [&late, &fired, deadline]() {
+            late[fired++] = std::chrono::duration<double, std::micro>(Clock::now() - deadline).count();
+        });
+    }
+    auto limit = Clock::now() + std::chrono::seconds(2);
+    while (fired < samples && Clock::now() < limit) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    start = Clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        wheel.Cancel(ids[i]);
+    }
+    elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    result.cancelNs = timers ? elapsed / timers : 0.0;
+    wheel.Shutdown();
+
+    result.accuracySamples = fired;
+    late.resize(fired);
+    if (!late.empty()) {
+        std::sort(late.begin(), late.end());
+        double sum = 0.0;
+        for (double value : late) sum += value;
+        result.lateMeanUs = sum / late.size();
+        result.lateP99Us = late[std::min(late.size() - 1, late.size() * 99 / 100)];
+        result.lateMaxUs = late.back();
+    }
+    return result;
+}
@@ -0,0 +1,106 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Roda de temporizadores hierárquica (4 níveis de 256 slots; com o tick padrão
+// de 1 ms cobre ~49 dias, prazos mais longos esperam numa lista à parte) com
+// uma única thread de disparo que dorme até o próximo prazo.
+// Inserção e cancelamento são O(1): cada temporizador é um nó de uma lista
+// duplamente ligada intrusiva, endereçado diretamente pelo seu TimerId.
+// Os callbacks rodam nessa thread, sem o lock interno: podem agendar e cancelar
+// outros temporizadores livremente, mas não devem bloquear.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+    using TimerId = std::uint64_t;     // 0 nunca é um id válido
+
+    static constexpr int kLevelBits = 8;
+    static constexpr size_t kSlotsPerLevel = size_t(1) << kLevelBits;
+    static constexpr int kLevels = 4;
+
+    explicit TimerWheel(std::chrono::microseconds tick = std::chrono::milliseconds(1));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    TimerId ScheduleAt(Clock::time_point deadline, Callback callback);
+    TimerId ScheduleAfter(Clock::duration delay, Callback callback);
+    // false se o temporizador já disparou, foi cancelado ou não existe
+    bool Cancel(TimerId id);
+
+    size_t Pending() const;
+    void Shutdown();
+
+private:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+    static constexpr std::uint16_t kOverflow = 0xFFFF;
+
+    struct Node {
+        Callback callback;
+        std::uint64_t tick = 0;
+        std::uint32_t prev = kNone;
+        std::uint32_t next = kNone;
+        std::uint32_t generation = 0;   // muda a cada reuso: ids antigos não cancelam o novo dono
+        std::uint16_t bucket = 0;       // nível * kSlotsPerLevel + slot, ou kOverflow
+        bool active = false;
+    };
+
+    std::uint64_t TickOf(Clock::time_point t) const;
+    Clock::time_point TimeOfTick(std::uint64_t tick) const;
+
+    std::uint32_t Acquire();
+    void Release(std::uint32_t node);
+    void Link(std::uint32_t node);
+    void Unlink(std::uint32_t node);
+    // Redistribui um slot de nível superior para os níveis abaixo
+    void Cascade(int level, size_t slot);
+    void ReinsertOverflow();
+    // Processa os ticks até 'nowTick', movendo os callbacks vencidos para 'ready'
+    void Advance(std::uint64_t nowTick, std::vector<Callback>& ready);
+    // Próximo tick em que há trabalho (disparo ou cascata)
+    std::uint64_t NextEventTick() const;
+    int NextOccupied(int level, size_t from) const;
+    void MarkSlot(int level, size_t slot, bool occupied);
+    void ThreadMain();
+
+    const std::chrono::microseconds tickLength;
+    const Clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<Node> nodes;
+    std::uint32_t freeList = kNone;
+    std::uint32_t heads[kLevels][kSlotsPerLevel];
+    std::uint64_t occupancy[kLevels][kSlotsPerLevel / 64] = {};
+    std::uint32_t overflowHead = kNone;
+    size_t pending = 0;
+    std::uint64_t currentTick = 0;      // próximo tick ainda não processado
+    std::uint64_t plannedWake = ~0ULL;  // tick em que a thread pretende acordar
+    bool running = true;
+    std::thread worker;
+};
+
+struct TimerBenchmarkResult {
+    size_t timers;
+    double insertNs;          // por temporizador
+    double cancelNs;          // por temporizador
+    size_t accuracySamples;
+    double lateMeanUs;        // atraso do disparo em relação ao prazo
+    double lateP99Us;
+    double lateMaxUs;
+};
+
+// Insere e cancela 'timers' temporizadores e mede o atraso de disparo de
+// prazos curtos com a roda carregada por esses temporizadores
+TimerBenchmarkResult BenchmarkTimerWheel(size_t timers);
+
+#endif // TIMERWHEEL_H
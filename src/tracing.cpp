@@ -0,0 +1,220 @@
+#include "tracing.h"
+#include "macrosaver.h"
+#include <QByteArray>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+std::atomic<std::uint64_t> nextInstance{1};
+
+// Buffer da thread no último gravador usado por ela (quase sempre o global)
+struct LocalBuffer {
+    std::uint64_t instance = 0;
+    void* buffer = nullptr;
+};
+thread_local LocalBuffer localBuffer;
+
+void AppendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        const unsigned char ch = static_cast<unsigned char>(*c);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (ch < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", ch);
+            out += code;
+        } else {
+            out += *c;
+        }
+    }
+}
+
+} // namespace
+
+TraceRecorder::TraceRecorder()
+    : instance(nextInstance.fetch_add(1, std::memory_order_relaxed)) {
+}
+
+TraceRecorder& TraceRecorder::Global() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+std::int64_t TraceRecorder::NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::Local() {
+    if (localBuffer.instance == instance) return *static_cast<ThreadBuffer*>(localBuffer.buffer);
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::thread::id self = std::this_thread::get_id();
+    ThreadBuffer* found = nullptr;
+    for (const auto& buffer : buffers) {
+        if (buffer->owner == self) found = buffer.get();
+    }
+    if (!found) {
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        found = buffers.back().get();
+        found->owner = self;
+        found->tid = static_cast<int>(buffers.size());
+    }
+    localBuffer.instance = instance;
+    localBuffer.buffer = found;
+    return *found;
+}
+
+void TraceRecorder::Prepare(ThreadBuffer& buffer, std::uint32_t current) {
+    if (buffer.session.load(std::memory_order_relaxed) == current) return;
+    // Primeira vez desta thread na sessão: começa do zero
+    if (!buffer.spans) buffer.spans.reset(new Span[kSpansPerThread]);
+    buffer.count.store(0, std::memory_order_relaxed);
+    buffer.dropped.store(0, std::memory_order_relaxed);
+    buffer.sampleCounter = 0;
+    buffer.session.store(current, std::memory_order_release);
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+    ThreadBuffer& buffer = Local();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.name = name;
+}
+
+void TraceRecorder::Start(std::uint32_t every) {
+    sampleEvery.store(std::max<std::uint32_t>(1, every), std::memory_order_relaxed);
+    startedMicros.store(NowMicros(), std::memory_order_relaxed);
+    session.fetch_add(1, std::memory_order_release);
+    active.store(true, std::memory_order_release);
+}
+
+bool TraceRecorder::ShouldSample() {
+    if (!active.load(std::memory_order_relaxed)) return false;
+    ThreadBuffer& buffer = Local();
+    Prepare(buffer, session.load(std::memory_order_acquire));
+    return buffer.sampleCounter++ % sampleEvery.load(std::memory_order_relaxed) == 0;
+}
+
+void TraceRecorder::Record(const char* name, const char* category, std::int64_t startMicros, std::int64_t durationMicros,
+                           std::int32_t asyncId) {
+    ThreadBuffer& buffer = Local();
+    // A sessão pode ter recomeçado entre o início e o fim do trecho
+    Prepare(buffer, session.load(std::memory_order_acquire));
+    const size_t n = buffer.count.load(std::memory_order_relaxed);
+    if (n >= kSpansPerThread) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.spans[n] = {name, category, startMicros, durationMicros, asyncId};
+    buffer.count.store(n + 1, std::memory_order_release);
+}
+
+std::string TraceRecorder::ChromeJson(size_t* spans) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::uint32_t current = session.load(std::memory_order_acquire);
+    const std::int64_t origin = startedMicros.load(std::memory_order_relaxed);
+    std::string out;
+    out.reserve(1024);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t written = 0;
+    std::uint64_t dropped = 0;
+    bool first = true;
+    auto separator = [&out, &first]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+
+    for (const auto& buffer : buffers) {
+        if (buffer->session.load(std::memory_order_acquire) != current) continue;
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+        out.reserve(out.size() + count * 96);
+
+        separator();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->tid) + ",\"args\":{\"name\":\"";
+        AppendEscaped(out, buffer->name.empty() ? ("thread " + std::to_string(buffer->tid)).c_str() : buffer->name.c_str());
+        out += "\"}}";
+
+        for (size_t i = 0; i < count; ++i) {
+            const Span& span = buffer->spans[i];
+            // Trecho começado antes desta sessão (ficou no meio do Start)
+            if (span.startMicros < origin) continue;
+            const std::int64_t ts = span.startMicros - origin;
+            const std::int64_t duration = std::max<std::int64_t>(0, span.durationMicros);
+            auto open = [&](const char* phase) {
+                separator();
+                out += "{\"name\":\"";
+                AppendEscaped(out, span.name);
+                out += "\",\"cat\":\"";
+                AppendEscaped(out, span.category);
+                out += "\",\"ph\":\"";
+                out += phase;
+                out += "\",\"pid\":1,\"tid\":" + std::to_string(buffer->tid);
+            };
+            if (span.asyncId < 0) {
+                open("X");
+                out += ",\"ts\":" + std::to_string(ts) + ",\"dur\":" + std::to_string(duration) + "}";
+            } else {
+                // Par início/fim assíncrono: não precisa aninhar nos trechos da thread
+                const std::string id = ",\"id\":" + std::to_string(span.asyncId);
+                open("b");
+                out += id + ",\"ts\":" + std::to_string(ts) + "}";
+                open("e");
+                out += id + ",\"ts\":" + std::to_string(ts + duration) + "}";
+            }
+            ++written;
+        }
+    }
+    out += "\n],\"otherData\":{\"sample_every\":" + std::to_string(sampleEvery.load(std::memory_order_relaxed)) +
+           ",\"dropped_spans\":" + std::to_string(dropped) + "}}\n";
+    if (spans) *spans = written;
+    return out;
+}
+
+bool TraceRecorder::Stop(const QString& path, QString& error, size_t* spans) {
+    active.store(false, std::memory_order_release);
+    const std::string json = ChromeJson(spans);
+    return WriteFileAtomic(path, QByteArray(json.data(), static_cast<int>(json.size())), error);
+}
+
+// =============================================
+// BENCHMARK DO RASTREAMENTO
+// =============================================
+
+TracingBenchmarkResult BenchmarkTracing(size_t spans) {
+    using Clock = std::chrono::steady_clock;
+    TracingBenchmarkResult result = {spans, 0, 0, 0, 0, 0};
+    if (spans == 0) return result;
+
+    // Mesmo caminho do ScopedTraceSpan, num gravador próprio (não mistura com
+    // uma sessão em andamento)
+    TraceRecorder recorder;
+    auto run = [&recorder](size_t count) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            if (recorder.ShouldSample()) {
+                const std::int64_t begin = TraceRecorder::NowMicros();
+                recorder.Record("benchmark", "benchmark", begin, TraceRecorder::NowMicros() - begin);
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    };
+
+    result.disabledNs = run(spans);
+
+    // Todos gravados: até encher o buffer da thread
+    const size_t recorded = std::min(spans, TraceRecorder::kSpansPerThread);
+    recorder.Start(1);
+    result.enabledNs = run(recorded);
+
+    auto start = Clock::now();
+    const std::string json = recorder.ChromeJson();
+    result.exportMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    result.exportedBytes = json.size();
+
+    recorder.Start(16);
+    result.sampledNs = run(spans);
+    return result;
+}
@@ -0,0 +1,112 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rastreamento opcional das sessões de gravação e reprodução, no formato de
+// trace do Chrome (abre em chrome://tracing e em ui.perfetto.dev). Cada thread
+// grava seus trechos (nome, início, duração) no próprio buffer, sem lock; o
+// JSON só é montado no fim da sessão. Desligado, um trecho custa uma leitura
+// atômica; com amostragem 1/N, cada thread grava um a cada N trechos.
+
+class TraceRecorder {
+public:
+    static constexpr size_t kSpansPerThread = 1 << 16;   // cheio: os seguintes são descartados
+
+    TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void Start(std::uint32_t sampleEvery = 1);
+    // Para e escreve o trace em 'path'; 'spans' recebe quantos trechos foram escritos
+    bool Stop(const QString& path, QString& error, size_t* spans = nullptr);
+    bool IsActive() const { return active.load(std::memory_order_relaxed); }
+    std::uint32_t SampleEvery() const { return sampleEvery.load(std::memory_order_relaxed); }
+
+    // Nome da thread atual no trace (pode ser chamado antes de Start)
+    void SetThreadName(const char* name);
+
+    // Thread atual: a sessão está ativa e a amostragem escolheu o próximo trecho
+    bool ShouldSample();
+    // 'name' e 'category' precisam durar até o fim da sessão (literais).
+    // Com 'asyncId' >= 0 o trecho vai para uma faixa própria (esperas que
+    // atravessam outros trechos da thread, uma faixa por id)
+    void Record(const char* name, const char* category, std::int64_t startMicros, std::int64_t durationMicros,
+                std::int32_t asyncId = -1);
+
+    // Trechos gravados até agora, em JSON (Stop usa o mesmo)
+    std::string ChromeJson(size_t* spans = nullptr) const;
+
+    static TraceRecorder& Global();
+    static std::int64_t NowMicros();
+
+private:
+    struct Span {
+        const char* name;
+        const char* category;
+        std::int64_t startMicros;
+        std::int64_t durationMicros;
+        std::int32_t asyncId;
+    };
+    struct ThreadBuffer {
+        std::thread::id owner;
+        int tid = 0;
+        std::string name;                           // sob o mutex do gravador
+        std::atomic<std::uint32_t> session{0};
+        std::uint32_t sampleCounter = 0;            // só a thread dona
+        std::unique_ptr<Span[]> spans;
+        std::atomic<size_t> count{0};               // publicado depois do trecho escrito
+        std::atomic<std::uint64_t> dropped{0};
+    };
+
+    ThreadBuffer& Local();
+    void Prepare(ThreadBuffer& buffer, std::uint32_t current);
+
+    const std::uint64_t instance;                          // chave do cache por thread
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;   // nunca removidos (poucas threads)
+    std::atomic<bool> active{false};
+    std::atomic<std::uint32_t> session{0};
+    std::atomic<std::uint32_t> sampleEvery{1};
+    std::atomic<std::int64_t> startedMicros{0};
+};
+
+// Trecho do início até o fim do escopo (se a amostragem o escolher)
+class ScopedTraceSpan {
+public:
+    ScopedTraceSpan(const char* name, const char* category)
+        : name(name), category(category),
+          start(TraceRecorder::Global().ShouldSample() ? TraceRecorder::NowMicros() : -1) {}
+    ~ScopedTraceSpan() {
+        if (start >= 0) TraceRecorder::Global().Record(name, category, start, TraceRecorder::NowMicros() - start);
+    }
+
+    ScopedTraceSpan(const ScopedTraceSpan&) = delete;
+    ScopedTraceSpan& operator=(const ScopedTraceSpan&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    std::int64_t start;
+};
+
+struct TracingBenchmarkResult {
+    size_t spans;
+    double disabledNs;      // por trecho, rastreamento desligado
+    double enabledNs;       // por trecho, todos gravados
+    double sampledNs;       // por trecho, amostragem 1/16
+    double exportMs;        // JSON dos trechos gravados
+    size_t exportedBytes;
+};
+
+TracingBenchmarkResult BenchmarkTracing(size_t spans);
+
+#endif // TRACING_H
@@ -0,0 +1,193 @@
+#include "windowtarget.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+
+#ifdef _WIN32
+#include <QString>
+#include <windows.h>
+#endif
+
+std::string WindowTarget::Encode() const {
+    return process + "|" + className + "|" + title;
+}
+
+bool WindowTarget::Decode(const std::string& text, WindowTarget& out) {
+    const size_t first = text.find('|');
+    if (first == std::string::npos) return false;
+    const size_t second = text.find('|', first + 1);
+    if (second == std::string::npos) return false;
+    out.process = text.substr(0, first);
+    out.className = text.substr(first + 1, second - first - 1);
+    out.title = text.substr(second + 1);
+    return !out.empty();
+}
+
+int WindowMatchScore(const WindowTarget& recorded, const WindowTarget& candidate) {
+    if (recorded.className != candidate.className) return 0;
+    const bool sameProcess = recorded.process.size() == candidate.process.size() &&
+        std::equal(recorded.process.begin(), recorded.process.end(), candidate.process.begin(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        });
+    if (!sameProcess) return 0;
+    return recorded.title == candidate.title ? 2 : 1;
+}
+
+#ifdef _WIN32
+
+namespace {
+
+// Um resolvedor por vez recebe os eventos (o callback do SetWinEventHook não tem contexto)
+std::atomic<Win32WindowResolver*> activeResolver{nullptr};
+
+void CALLBACK WindowEventProc(HWINEVENTHOOK, DWORD, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD) {
+    // Cursor e cursor de texto também geram LOCATIONCHANGE: só a janela em si interessa
+    if (!hwnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+    if (Win32WindowResolver* resolver = activeResolver.load()) {
+        resolver->Invalidate(reinterpret_cast<WindowResolver::Handle>(hwnd));
+    }
+}
+
+std::string ProcessName(HWND hwnd) {
+    DWORD pid = 0;
+    GetWindowThreadProcessId(hwnd, &pid);
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) return std::string();
+    wchar_t path[MAX_PATH];
+    DWORD size = MAX_PATH;
+    std::string name;
+    if (QueryFullProcessImageNameW(process, 0, path, &size)) {
+        QString full = QString::fromWCharArray(path, static_cast<int>(size));
+        name = full.mid(full.lastIndexOf('\\') + 1).toStdString();
+    }
+    CloseHandle(process);
+    return name;
+}
+
+std::string ClassName(HWND hwnd) {
+    wchar_t name[256];
+    const int length = GetClassNameW(hwnd, name, 256);
+    return length > 0 ? QString::fromWCharArray(name, length).toStdString() : std::string();
+}
+
+// Em janelas de outro processo não envia WM_GETTEXT (não trava com uma janela
+// que não responde): lê o título guardado pelo sistema
+std::string WindowTitle(HWND hwnd) {
+    wchar_t title[512];
+    const int length = GetWindowTextW(hwnd, title, 512);
+    return length > 0 ? QString::fromWCharArray(title, length).toStdString() : std::string();
+}
+
+struct WindowSearch {
+    const WindowTarget* target;
+    HWND best;
+    int bestScore;
+};
+
+BOOL CALLBACK SearchWindowProc(HWND hwnd, LPARAM param) {
+    WindowSearch* search = reinterpret_cast<WindowSearch*>(param);
+    if (!IsWindowVisible(hwnd) || IsIconic(hwnd)) return TRUE;
+    // A classe primeiro: descarta quase todas sem abrir o processo
+    WindowTarget candidate;
+    candidate.className = ClassName(hwnd);
+    if (candidate.className != search->target->className) return TRUE;
+    candidate.process = ProcessName(hwnd);
+    candidate.title = WindowTitle(hwnd);
+    // Ordem do EnumWindows = ordem Z: no empate, fica a da frente
+    const int score = WindowMatchScore(*search->target, candidate);
+    if (score > search->bestScore) {
+        search->best = hwnd;
+        search->bestScore = score;
+    }
+    return search->bestScore < 2;
+}
+
+} // namespace
+
+Win32WindowResolver::Win32WindowResolver(std::vector<CaptureMonitor> monitors)
+    : monitors(std::move(monitors)) {
+    activeResolver.store(this);
+    // Fora de contexto: o callback roda nesta thread, sem DLL injetada nos outros processos
+    locationHook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, nullptr,
+                                   WindowEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    destroyHook = SetWinEventHook(EVENT_OBJECT_DESTROY, EVENT_OBJECT_DESTROY, nullptr,
+                                  WindowEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+}
+
+Win32WindowResolver::~Win32WindowResolver() {
+    if (locationHook) UnhookWinEvent(static_cast<HWINEVENTHOOK>(locationHook));
+    if (destroyHook) UnhookWinEvent(static_cast<HWINEVENTHOOK>(destroyHook));
+    Win32WindowResolver* self = this;
+    activeResolver.compare_exchange_strong(self, nullptr);
+}
+
+void Win32WindowResolver::SetMonitors(std::vector<CaptureMonitor> newMonitors) {
+    std::lock_guard<std::mutex> lock(mutex);
+    monitors = std::move(newMonitors);
+}
+
+WindowResolver::Handle Win32WindowResolver::Find(const WindowTarget& target) {
+    WindowSearch search = {&target, nullptr, 0};
+    EnumWindows(SearchWindowProc, reinterpret_cast<LPARAM>(&search));
+    return reinterpret_cast<Handle>(search.best);
+}
+
+bool Win32WindowResolver::ToScreen(Handle window, int offsetX, int offsetY, int& relX, int& relY, int& monitorIndex) {
+    HWND hwnd = reinterpret_cast<HWND>(window);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = rects.find(window);
+    if (it == rects.end()) {
+        // Sem evento de quando foi minimizada/fechada antes do cache: confere agora
+        RECT rect;
+        if (!IsWindow(hwnd) || IsIconic(hwnd) || !GetWindowRect(hwnd, &rect)) return false;
+        const Rect cached = {static_cast<int>(rect.left), static_cast<int>(rect.top),
+                             static_cast<int>(rect.right), static_cast<int>(rect.bottom)};
+        it = rects.emplace(window, cached).first;
+    }
+    const Rect& rect = it->second;
+    const int x = rect.left + offsetX;
+    const int y = rect.top + offsetY;
+    // O ponto gravado pode ter ficado fora de uma janela que encolheu
+    if (x >= rect.right || y >= rect.bottom) return false;
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        const CaptureMonitor& monitor = monitors[i];
+        if (x < monitor.left || y < monitor.top || x >= monitor.left + monitor.width || y >= monitor.top + monitor.height) {
+            continue;
+        }
+        relX = PixelToRelative(x - monitor.left, monitor.width);
+        relY = PixelToRelative(y - monitor.top, monitor.height);
+        monitorIndex = static_cast<int>(i);
+        return true;
+    }
+    return false;
+}
+
+void Win32WindowResolver::Invalidate(Handle window) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rects.erase(window);
+}
+
+bool WindowTargetAt(int x, int y, WindowTarget& target, int& offsetX, int& offsetY) {
+    static HWND lastWindow = nullptr;
+    static WindowTarget lastTarget;
+
+    POINT point = {x, y};
+    HWND hwnd = WindowFromPoint(point);
+    if (!hwnd) return false;
+    HWND root = GetAncestor(hwnd, GA_ROOT);
+    RECT rect;
+    if (!root || !GetWindowRect(root, &rect)) return false;
+    if (root != lastWindow) {
+        lastWindow = root;
+        lastTarget.process = ProcessName(root);
+        lastTarget.className = ClassName(root);
+    }
+    lastTarget.title = WindowTitle(root);
+    if (lastTarget.empty()) return false;
+    target = lastTarget;
+    offsetX = x - rect.left;
+    offsetY = y - rect.top;
+    return true;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef WINDOWTARGET_H
+#define WINDOWTARGET_H
+
+#include "screencapture.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Janela de destino de um clique gravado: processo, classe e título da janela
+// de nível superior sob o cursor. Vai no 'text' da ação como
+// "processo|classe|título" (o título fica por último e pode conter '|').
+struct WindowTarget {
+    std::string process;     // nome do executável, sem o caminho
+    std::string className;
+    std::string title;
+
+    bool empty() const { return process.empty() && className.empty(); }
+    std::string Encode() const;
+    static bool Decode(const std::string& text, WindowTarget& out);
+};
+
+// Quanto 'candidate' serve como a janela gravada: 0 = não serve (processo ou
+// classe diferentes), 1 = mesmo processo e classe, 2 = também o mesmo título.
+// O processo é comparado sem diferenciar maiúsculas.
+int WindowMatchScore(const WindowTarget& recorded, const WindowTarget& candidate);
+
+// Localiza a janela de destino na reprodução. Seguro para chamadas de qualquer thread.
+class WindowResolver {
+public:
+    using Handle = std::uintptr_t;
+
+    virtual ~WindowResolver() = default;
+    // Janela visível que melhor corresponde a 'target' agora (0 = nenhuma)
+    virtual Handle Find(const WindowTarget& target) = 0;
+    // Ponto a (offsetX, offsetY) pixels do canto superior esquerdo da janela,
+    // em centésimos de % da tela em que cai; false se a janela sumiu, está
+    // minimizada ou o ponto está fora das telas
+    virtual bool ToScreen(Handle window, int offsetX, int offsetY, int& relX, int& relY, int& monitorIndex) = 0;
+};
+
+#ifdef _WIN32
+// Busca pelo EnumWindows; o retângulo de cada janela usada fica em cache até
+// um evento EVENT_OBJECT_LOCATIONCHANGE (mover, redimensionar, minimizar) ou
+// EVENT_OBJECT_DESTROY dela (SetWinEventHook). Criar e destruir na thread da
+// interface: os eventos chegam pelo laço de mensagens dela.
+class Win32WindowResolver : public WindowResolver {
+public:
+    explicit Win32WindowResolver(std::vector<CaptureMonitor> monitors);
+    ~Win32WindowResolver() override;
+
+    // Após uma mudança de telas (mesma ordem de MainWindow::monitors)
+    void SetMonitors(std::vector<CaptureMonitor> monitors);
+
+    Handle Find(const WindowTarget& target) override;
+    bool ToScreen(Handle window, int offsetX, int offsetY, int& relX, int& relY, int& monitorIndex) override;
+
+    // Chamado pelo hook de eventos
+    void Invalidate(Handle window);
+
+private:
+    struct Rect {
+        int left;
+        int top;
+        int right;
+        int bottom;
+    };
+
+    std::mutex mutex;
+    std::vector<CaptureMonitor> monitors;
+    std::unordered_map<Handle, Rect> rects;
+    void* locationHook = nullptr;
+    void* destroyHook = nullptr;
+};
+
+// Janela de nível superior no ponto (x, y) da área de trabalho e a posição do
+// ponto a partir do canto dela. Para o hook do mouse: processo e classe ficam
+// em cache enquanto a janela sob o cursor for a mesma.
+bool WindowTargetAt(int x, int y, WindowTarget& target, int& offsetX, int& offsetY);
+#endif
+
+#endif // WINDOWTARGET_H
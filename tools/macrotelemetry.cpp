@@ -0,0 +1,128 @@
+// Leitor da telemetria do MacroApp: lê o anel em memória compartilhada e
+// imprime, a cada intervalo, taxas e percentis de atraso por tipo de registro.
+//
+// Compilação (só QtCore):
+//   g++ -std=c++17 -O2 -I../src macrotelemetry.cpp ../src/telemetry.cpp $(pkg-config --cflags --libs Qt5Core) -o macrotelemetry
+//
+// Uso: macrotelemetry [--interval ms] [--key nome]
+//   capturados  eventos do hook de gravação (atraso do hook)
+//   injetados   eventos injetados pela reprodução (atraso em relação ao previsto)
+//   agendador   fatias de macro (atraso do temporizador em relação ao prazo)
+//   fila        profundidade da fila de injeção
+
+#include "telemetry.h"
+#include <QDateTime>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct KindStats {
+    std::uint64_t count = 0;
+    std::vector<std::int64_t> values;
+    std::int64_t last = 0;
+    std::int64_t max = 0;
+
+    void Add(std::int64_t value) {
+        ++count;
+        values.push_back(value);
+        last = value;
+        max = std::max(max, value);
+    }
+    void Reset() {
+        count = 0;
+        values.clear();
+        max = 0;
+    }
+};
+
+std::int64_t Percentile(std::vector<std::int64_t>& values, double fraction) {
+    if (values.empty()) return 0;
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(values.size() * fraction));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+QString FormatMicros(std::int64_t micros) {
+    if (micros >= 10000 || micros <= -10000) return QString("%1ms").arg(micros / 1000.0, 0, 'f', 1);
+    return QString("%1us").arg(micros);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int intervalMs = 1000;
+    QString key = TelemetryRing::kDefaultKey;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            intervalMs = std::max(100, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+            key = QString::fromLocal8Bit(argv[++i]);
+        } else {
+            std::fprintf(stderr, "uso: %s [--interval ms] [--key nome]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    TelemetryRing ring;
+    QString error;
+    if (!ring.Attach(key, error)) {
+        std::fprintf(stderr, "telemetria '%s' indisponível: %s (o MacroApp está aberto?)\n",
+                     key.toLocal8Bit().constData(), error.toLocal8Bit().constData());
+        return 1;
+    }
+    std::printf("MacroApp telemetria: anel de %u registros, intervalo %d ms\n", ring.Capacity(), intervalMs);
+
+    // Só o que chegar a partir de agora; leituras frequentes para o anel não dar a volta
+    std::uint64_t cursor = ring.Head();
+    std::uint64_t dropped = 0;
+    std::vector<TelemetryEvent> events;
+    events.reserve(ring.Capacity());
+    KindStats stats[static_cast<int>(TelemetryKind::Count)];
+    auto reportAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs);
+
+    for (;;) {
+        events.clear();
+        ring.Read(cursor, events, ring.Capacity(), dropped);
+        for (const TelemetryEvent& event : events) {
+            const int kind = static_cast<int>(event.kind);
+            if (kind > 0 && kind < static_cast<int>(TelemetryKind::Count)) stats[kind].Add(event.value);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now < reportAt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        const double seconds = intervalMs / 1000.0;
+        reportAt += std::chrono::milliseconds(intervalMs);
+
+        QString line = QDateTime::currentDateTime().toString("[hh:mm:ss]");
+        for (TelemetryKind kind : {TelemetryKind::Captured, TelemetryKind::Injected, TelemetryKind::SchedulerLate}) {
+            KindStats& s = stats[static_cast<int>(kind)];
+            line += QString(" | %1 %2/s").arg(TelemetryKindName(kind)).arg(s.count / seconds, 0, 'f', 0);
+            if (s.count > 0) {
+                line += QString(" p50 %1 p99 %2 máx %3")
+                    .arg(FormatMicros(Percentile(s.values, 0.5)))
+                    .arg(FormatMicros(Percentile(s.values, 0.99)))
+                    .arg(FormatMicros(s.max));
+            }
+            s.Reset();
+        }
+        KindStats& depth = stats[static_cast<int>(TelemetryKind::QueueDepth)];
+        line += QString(" | fila %1 (máx %2)").arg(depth.last).arg(depth.max);
+        depth.Reset();
+        // Só é publicada quando muda: o próximo intervalo parte da atual
+        depth.max = depth.last;
+        if (dropped > 0) line += QString(" | perdidos %1").arg(dropped);
+        std::printf("%s\n", line.toLocal8Bit().constData());
+        std::fflush(stdout);
+        dropped = 0;
+    }
+}